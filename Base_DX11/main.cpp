@@ -17,6 +17,14 @@
 
 // Based on code from Microsoft Documentation and tutorial found here: https://antongerdelan.net/opengl/d3d11.html
 
+// Tools/embed_shaders.py compiles shaderSource to DXBC at build time when fxc is available.
+#if __has_include("ShadersDxbc.h")
+    #include "ShadersDxbc.h"
+    #define HAS_EMBEDDED_SHADERS 1
+#else
+    #define HAS_EMBEDDED_SHADERS 0
+#endif
+
 
 #define HLSL(input) #input
 
@@ -172,55 +180,78 @@ int main()
     assert(SUCCEEDED(hr));
 
 
-    // Compile Shaders
-    UINT compilerFlags = D3DCOMPILE_ENABLE_STRICTNESS;
-    #if defined( DEBUG ) || defined( _DEBUG )
-        compilerFlags |= D3DCOMPILE_DEBUG; // add more debug output
-    #endif
-    ID3DBlob* vsBlob    = NULL;
-    ID3DBlob* psBlob    = NULL;
-    ID3DBlob* errorBlob = NULL;
-
-    hr = D3DCompile(    shaderSource.data(), shaderSource.length(),
-                        "vertex_shader",
-                        nullptr, D3D_COMPILE_STANDARD_FILE_INCLUDE,
-                        "vs_main",  "vs_5_0",
-                        compilerFlags,  0,
-                        &vsBlob, &errorBlob);
-    if (FAILED(hr)) 
+    // Use the shaders compiled at build time, or compile them now. D3DCompiler is only loaded here.
+    ID3DBlob*   vsBlob      = NULL;
+    ID3DBlob*   psBlob      = NULL;
+    const void* vsBytecode  = NULL;
+    SIZE_T      vsSize      = 0;
+    const void* psBytecode  = NULL;
+    SIZE_T      psSize      = 0;
+#if HAS_EMBEDDED_SHADERS
+    const EmbeddedShader* embeddedVS = FindEmbeddedShader("shaderSource", "vs_main");
+    const EmbeddedShader* embeddedPS = FindEmbeddedShader("shaderSource", "ps_main");
+    if (embeddedVS && embeddedPS)
+    {
+        vsBytecode  = embeddedVS->bytecode;
+        vsSize      = embeddedVS->size;
+        psBytecode  = embeddedPS->bytecode;
+        psSize      = embeddedPS->size;
+    }
+#endif
+    if (!vsBytecode)
     {
-        if (errorBlob) 
+        UINT compilerFlags = D3DCOMPILE_ENABLE_STRICTNESS;
+        #if defined( DEBUG ) || defined( _DEBUG )
+            compilerFlags |= D3DCOMPILE_DEBUG; // add more debug output
+        #endif
+        ID3DBlob* errorBlob = NULL;
+
+        hr = D3DCompile(    shaderSource.data(), shaderSource.length(),
+                            "vertex_shader",
+                            nullptr, D3D_COMPILE_STANDARD_FILE_INCLUDE,
+                            "vs_main",  "vs_5_0",
+                            compilerFlags,  0,
+                            &vsBlob, &errorBlob);
+        if (FAILED(hr)) 
         {
-            OutputDebugStringA((char*)errorBlob->GetBufferPointer());
-            errorBlob->Release();
+            if (errorBlob) 
+            {
+                OutputDebugStringA((char*)errorBlob->GetBufferPointer());
+                errorBlob->Release();
+            }
+            if (vsBlob) { vsBlob->Release(); }
+            assert(false);
         }
-        if (vsBlob) { vsBlob->Release(); }
-        assert(false);
-    }
 
-    hr = D3DCompile(shaderSource.data(), shaderSource.length(),
-                    "pixel_shader",
-                    nullptr, D3D_COMPILE_STANDARD_FILE_INCLUDE,
-                    "ps_main", "ps_5_0",
-                    compilerFlags, 0,
-                    &psBlob, &errorBlob);
-    if (FAILED(hr)) 
-    {
-        if (errorBlob) 
+        hr = D3DCompile(shaderSource.data(), shaderSource.length(),
+                        "pixel_shader",
+                        nullptr, D3D_COMPILE_STANDARD_FILE_INCLUDE,
+                        "ps_main", "ps_5_0",
+                        compilerFlags, 0,
+                        &psBlob, &errorBlob);
+        if (FAILED(hr)) 
         {
-            OutputDebugStringA((char*)errorBlob->GetBufferPointer());
-            errorBlob->Release();
+            if (errorBlob) 
+            {
+                OutputDebugStringA((char*)errorBlob->GetBufferPointer());
+                errorBlob->Release();
+            }
+            if (psBlob) { psBlob->Release(); }
+            assert(false);
         }
-        if (psBlob) { psBlob->Release(); }
-        assert(false);
+
+        vsBytecode  = vsBlob->GetBufferPointer();
+        vsSize      = vsBlob->GetBufferSize();
+        psBytecode  = psBlob->GetBufferPointer();
+        psSize      = psBlob->GetBufferSize();
     }
 
     ID3D11VertexShader* vertexShader = NULL;
-    hr = device->CreateVertexShader( vsBlob->GetBufferPointer(), vsBlob->GetBufferSize(), NULL, &vertexShader);
+    hr = device->CreateVertexShader( vsBytecode, vsSize, NULL, &vertexShader);
     assert(SUCCEEDED(hr));
 
     ID3D11PixelShader* pixelShader = NULL;
-    hr = device->CreatePixelShader( psBlob->GetBufferPointer(), psBlob->GetBufferSize(), NULL, &pixelShader);
+    hr = device->CreatePixelShader( psBytecode, psSize, NULL, &pixelShader);
     assert(SUCCEEDED(hr));
 
     // Define Triangle Input
@@ -234,7 +265,7 @@ int main()
     inputElementDesc.AlignedByteOffset      = 0;
     inputElementDesc.InputSlotClass         = D3D11_INPUT_PER_VERTEX_DATA;
     inputElementDesc.InstanceDataStepRate   = 0;
-    hr = device->CreateInputLayout( &inputElementDesc, 1, vsBlob->GetBufferPointer(), vsBlob->GetBufferSize(), &inputLayout);
+    hr = device->CreateInputLayout( &inputElementDesc, 1, vsBytecode, vsSize, &inputLayout);
     assert(SUCCEEDED(hr));
 
     // Define Triangle Data
@@ -307,8 +338,8 @@ int main()
     // Release GPU Memory
     framebuffer->Release();
     vertexBuffer->Release();
-    vsBlob->Release();
-    psBlob->Release();
+    if (vsBlob) { vsBlob->Release(); }
+    if (psBlob) { psBlob->Release(); }
     vertexShader->Release();
     pixelShader->Release();
     renderTargetView->Release();
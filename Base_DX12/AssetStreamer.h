@@ -0,0 +1,595 @@
+#pragma once
+
+// Streams asset files from disk in the background and hands back their contents.
+// An asset file is cut into fixed size blocks, each compressed on its own with BlockCompression,
+// or stored raw where that does not help, behind a table of their offsets and sizes. A dedicated
+// I/O thread owns an AsyncFileReader and keeps it fed: per load it reads the header, then the
+// table, then the blocks, and everything queued across loads goes out as one batch. Loads are
+// served in the order they were made, so the oldest finishes first.
+// Stored blocks are read straight into the asset's buffer. Compressed ones are read into staging
+// memory and decompressed by jobs on the job system, each into its own range of that buffer, so
+// decompression overlaps the reads after it. Reads and staging together stay within
+// _maxInFlightBytes; a single block larger than that is still read, alone.
+// Finished loads wait for Update, which runs their callbacks on the calling thread, e.g. the
+// render thread handing the data to the GPU upload path. Load and Update are thread-safe.
+// Files are written and read in native byte order.
+// Portable C++, no graphics API dependencies.
+
+#include "AsyncFileReader.h"
+#include "BlockCompression.h"
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+static const uint32_t AssetFileMagic    = 0x54535341; // "ASST"
+static const uint32_t AssetFileVersion  = 1;
+static const uint32_t AssetMaxBlockSize = 16 * 1024 * 1024;
+
+struct AssetFileHeader
+{
+    uint32_t    magic       = AssetFileMagic;
+    uint32_t    version     = AssetFileVersion;
+    uint64_t    rawSize     = 0;
+    uint32_t    blockSize   = 0;    // Every block but the last holds this many raw bytes.
+    uint32_t    blockCount  = 0;
+};
+
+// Stored raw when packedSize equals rawSize.
+struct AssetBlock
+{
+    uint64_t    offset      = 0;    // In the file.
+    uint32_t    packedSize  = 0;
+    uint32_t    rawSize     = 0;
+};
+
+// Writes _data as an asset file of _blockSize blocks, next to the destination and renamed into place.
+static bool WriteAssetFile(const std::filesystem::path& _path, const void* _data, uint64_t _size, uint32_t _blockSize)
+{
+    if (_blockSize == 0 || _blockSize > AssetMaxBlockSize)
+    {
+        return false;
+    }
+
+    const uint8_t*  source = static_cast<const uint8_t*>(_data);
+    AssetFileHeader header;
+    header.rawSize      = _size;
+    header.blockSize    = _blockSize;
+    header.blockCount   = static_cast<uint32_t>((_size + _blockSize - 1) / _blockSize);
+
+    std::vector<AssetBlock> blocks(header.blockCount);
+    std::vector<uint8_t>    packed;
+    std::vector<uint8_t>    scratch(CompressBlockBound(_blockSize));
+    uint64_t                offset = sizeof(AssetFileHeader) + sizeof(AssetBlock) * header.blockCount;
+    for (uint32_t i = 0; i < header.blockCount; i++)
+    {
+        const uint8_t*  raw     = source + static_cast<uint64_t>(i) * _blockSize;
+        uint32_t        rawSize = static_cast<uint32_t>((std::min)(static_cast<uint64_t>(_blockSize), _size - static_cast<uint64_t>(i) * _blockSize));
+
+        // Only worth decompressing if it saves something; a capacity of rawSize - 1 says so.
+        size_t          size    = rawSize > 1 ? CompressBlock(raw, rawSize, scratch.data(), rawSize - 1) : 0;
+        const uint8_t*  stored  = size > 0 ? scratch.data() : raw;
+        size                    = size > 0 ? size : rawSize;
+
+        blocks[i].offset        = offset;
+        blocks[i].packedSize    = static_cast<uint32_t>(size);
+        blocks[i].rawSize       = rawSize;
+        packed.insert(packed.end(), stored, stored + size);
+        offset += size;
+    }
+
+    std::filesystem::path temp = _path;
+    temp += ".tmp";
+    {
+        std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+        if (!out)
+        {
+            return false;
+        }
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(blocks.data()), sizeof(AssetBlock) * blocks.size());
+        out.write(reinterpret_cast<const char*>(packed.data()), packed.size());
+        if (!out)
+        {
+            return false;
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(temp, _path, ec);
+    return !ec;
+}
+
+// _data is the whole asset, empty when _ok is false.
+typedef std::function<void(bool _ok, std::vector<uint8_t>&& _data)> AssetLoadCallback;
+
+struct AssetStreamerStats
+{
+    uint64_t    loads           = 0;
+    uint64_t    failed          = 0;
+    uint64_t    fileBytes       = 0;    // Read from disk, headers and tables included.
+    uint64_t    rawBytes        = 0;    // Delivered after decompression.
+    double      busySeconds     = 0.0;  // Time with at least one load in progress.
+    double      totalLatencyMs  = 0.0;  // From Load until the data is ready for Update.
+    double      maxLatencyMs    = 0.0;
+
+    double ReadGBps() const             { return busySeconds > 0.0 ? fileBytes / busySeconds / 1e9 : 0.0; }
+    double RawGBps() const              { return busySeconds > 0.0 ? rawBytes / busySeconds / 1e9 : 0.0; }
+    double AverageLatencyMs() const     { return loads > 0 ? totalLatencyMs / loads : 0.0; }
+};
+
+class AssetStreamer
+{
+public:
+    // Without a job system, blocks are decompressed on the I/O thread.
+    AssetStreamer(JobSystem* _jobSystem, uint32_t _queueDepth, uint64_t _maxInFlightBytes)
+        : m_jobSystem(_jobSystem), m_reader(_queueDepth), m_maxInFlightBytes(_maxInFlightBytes)
+    {
+        m_thread = std::thread([this] { IoLoop(); });
+    }
+
+    // Loads in progress finish first; callbacks Update has not run yet are dropped.
+    ~AssetStreamer()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopping = true;
+            m_signaled = true;
+        }
+        m_wake.notify_one();
+        m_thread.join();
+        if (m_jobSystem)
+        {
+            m_jobSystem->Wait(m_jobs);
+        }
+    }
+
+    const char* Backend() const { return m_reader.Backend(); }
+
+    void Load(const std::filesystem::path& _path, AssetLoadCallback _callback)
+    {
+        std::shared_ptr<PendingLoad> load = std::make_shared<PendingLoad>();
+        load->path      = _path;
+        load->callback  = std::move(_callback);
+        load->start     = std::chrono::steady_clock::now();
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_inProgress++ == 0)
+            {
+                m_busyStart = load->start;
+            }
+            m_requests.push_back(std::move(load));
+            m_signaled = true;
+        }
+        m_wake.notify_one();
+    }
+
+    // Runs the callbacks of loads finished since the last call. Returns how many ran.
+    size_t Update()
+    {
+        std::vector<CompletedLoad> completed;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            completed.swap(m_completed);
+        }
+        for (CompletedLoad& load : completed)
+        {
+            load.callback(load.ok, std::move(load.data));
+        }
+        return completed.size();
+    }
+
+    // Loads whose callbacks have not run yet.
+    size_t Pending() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_inProgress + m_completed.size();
+    }
+
+    AssetStreamerStats Stats() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_stats;
+    }
+
+private:
+    enum class LoadStage
+    {
+        Header,         // Header read not queued yet.
+        ReadingHeader,
+        Table,
+        ReadingTable,
+        Blocks,
+        Done,           // Nothing more to issue.
+    };
+
+    struct PendingLoad
+    {
+        std::filesystem::path                   path;
+        AssetLoadCallback                       callback;
+        std::chrono::steady_clock::time_point   start;
+        AssetFileHeader                         header;
+        std::vector<AssetBlock>                 blocks;
+        std::vector<uint8_t>                    data;
+        std::atomic<uint32_t>                   unfinished{ 1 };    // Blocks not yet in data, plus one until the table is read.
+        std::atomic<bool>                       failed{ false };
+
+        // Only touched by the I/O thread.
+        uint32_t                                file            = FileInvalid;
+        uint64_t                                fileSize        = 0;
+        uint64_t                                fileBytes       = 0;
+        LoadStage                               stage           = LoadStage::Header;
+        uint32_t                                nextBlock       = 0;
+        uint32_t                                readsInFlight   = 0;
+    };
+
+    struct BlockRead
+    {
+        std::shared_ptr<PendingLoad>    load;
+        uint32_t                        block   = 0;
+        std::vector<uint8_t>            staging;        // Compressed blocks only.
+    };
+
+    struct CompletedLoad
+    {
+        AssetLoadCallback       callback;
+        bool                    ok = false;
+        std::vector<uint8_t>    data;
+    };
+
+    static const uint32_t ReadHeader    = 0xFFFFFFFF;
+    static const uint32_t ReadTable     = 0xFFFFFFFE;
+
+    void IoLoop()
+    {
+        std::vector<FileReadCompletion> completions;
+        while (true)
+        {
+            StartLoads();
+            IssueReads();
+            RetireLoads();
+            m_reader.Submit();
+
+            if (m_reader.InFlight() > 0)
+            {
+                completions.clear();
+                m_reader.Reap(&completions, true);
+                for (const FileReadCompletion& completion : completions)
+                {
+                    OnRead(completion);
+                }
+                continue;
+            }
+
+            // Nothing in flight: wait for a new load, or for a job to free budget.
+            std::unique_lock<std::mutex> lock(m_mutex);
+            if (m_stopping && m_requests.empty() && m_active.empty())
+            {
+                return;
+            }
+            m_wake.wait(lock, [this] { return m_signaled; });
+            m_signaled = false;
+        }
+    }
+
+    void Signal()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_signaled = true;
+        }
+        m_wake.notify_one();
+    }
+
+    void StartLoads()
+    {
+        std::deque<std::shared_ptr<PendingLoad>> requests;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            requests.swap(m_requests);
+        }
+        for (std::shared_ptr<PendingLoad>& load : requests)
+        {
+            load->file = m_reader.Open(load->path, &load->fileSize);
+            if (load->file == FileInvalid)
+            {
+                Fail(*load);
+            }
+            m_active.push_back(std::move(load));
+        }
+    }
+
+    // Queues reads for the oldest loads first, until the reader or the byte budget is full.
+    void IssueReads()
+    {
+        for (const std::shared_ptr<PendingLoad>& load : m_active)
+        {
+            if (load->stage == LoadStage::Blocks && load->failed)
+            {
+                // Blocks not read yet never will be.
+                uint32_t skipped = load->header.blockCount - load->nextBlock;
+                load->nextBlock  = load->header.blockCount;
+                load->stage      = LoadStage::Done;
+                FinishBlocks(load, skipped);
+                continue;
+            }
+
+            if (load->stage == LoadStage::Header)
+            {
+                if (!QueueRead(load, ReadHeader, 0, sizeof(AssetFileHeader), reinterpret_cast<uint8_t*>(&load->header)))
+                {
+                    return;
+                }
+                load->stage = LoadStage::ReadingHeader;
+            }
+            if (load->stage == LoadStage::Table)
+            {
+                if (!QueueRead(load, ReadTable, sizeof(AssetFileHeader), static_cast<uint32_t>(sizeof(AssetBlock) * load->blocks.size()),
+                               reinterpret_cast<uint8_t*>(load->blocks.data())))
+                {
+                    return;
+                }
+                load->stage = LoadStage::ReadingTable;
+            }
+            while (load->stage == LoadStage::Blocks && load->nextBlock < load->header.blockCount)
+            {
+                const AssetBlock& block    = load->blocks[load->nextBlock];
+                uint64_t          inFlight = m_inFlightBytes.load(std::memory_order_acquire);
+                if (inFlight > 0 && inFlight + block.packedSize > m_maxInFlightBytes)
+                {
+                    return;
+                }
+
+                std::vector<uint8_t> staging;
+                uint8_t*             dest = load->data.data() + static_cast<uint64_t>(load->nextBlock) * load->header.blockSize;
+                if (block.packedSize != block.rawSize)
+                {
+                    staging.resize(block.packedSize);
+                    dest = staging.data();
+                }
+                if (!QueueRead(load, load->nextBlock, block.offset, block.packedSize, dest, std::move(staging)))
+                {
+                    return;
+                }
+                m_inFlightBytes.fetch_add(block.packedSize, std::memory_order_relaxed);
+                load->nextBlock++;
+            }
+            if (load->stage == LoadStage::Blocks)
+            {
+                load->stage = LoadStage::Done;
+            }
+        }
+    }
+
+    // Closes and drops loads with nothing left to issue or read; jobs may still hold them.
+    void RetireLoads()
+    {
+        for (auto load = m_active.begin(); load != m_active.end();)
+        {
+            if ((*load)->stage == LoadStage::Done && (*load)->readsInFlight == 0)
+            {
+                m_reader.Close((*load)->file);
+                load = m_active.erase(load);
+            }
+            else
+            {
+                ++load;
+            }
+        }
+    }
+
+    bool QueueRead(const std::shared_ptr<PendingLoad>& _load, uint32_t _block, uint64_t _offset, uint32_t _size, uint8_t* _dest,
+                   std::vector<uint8_t>&& _staging = std::vector<uint8_t>())
+    {
+        uint64_t id = m_nextReadId;
+        if (!m_reader.Read({ _load->file, _offset, _size, _dest, id }))
+        {
+            return false;
+        }
+        m_nextReadId++;
+        m_reads[id] = BlockRead{ _load, _block, std::move(_staging) };
+        _load->readsInFlight++;
+        _load->fileBytes += _size;
+        return true;
+    }
+
+    void OnRead(const FileReadCompletion& _completion)
+    {
+        auto found = m_reads.find(_completion.userData);
+        BlockRead read = std::move(found->second);
+        m_reads.erase(found);
+
+        PendingLoad& load = *read.load;
+        load.readsInFlight--;
+        if (read.block == ReadHeader)
+        {
+            if (!_completion.ok || !ValidHeader(load))
+            {
+                Fail(load);
+                return;
+            }
+            load.blocks.resize(load.header.blockCount);
+            load.stage = LoadStage::Table;
+            return;
+        }
+        if (read.block == ReadTable)
+        {
+            if (!_completion.ok || !ValidTable(load))
+            {
+                Fail(load);
+                return;
+            }
+            // The table bounds rawSize by the file, but the file may still be larger than memory.
+            try
+            {
+                load.data.resize(static_cast<size_t>(load.header.rawSize));
+            }
+            catch (const std::bad_alloc&)
+            {
+                Fail(load);
+                return;
+            }
+            load.unfinished.fetch_add(load.header.blockCount, std::memory_order_relaxed);
+            load.stage = LoadStage::Blocks;
+            FinishBlocks(read.load, 1);
+            return;
+        }
+
+        const AssetBlock& block = load.blocks[read.block];
+        if (!_completion.ok)
+        {
+            load.failed = true;
+        }
+        if (!_completion.ok || block.packedSize == block.rawSize)
+        {
+            m_inFlightBytes.fetch_sub(block.packedSize, std::memory_order_release);
+            FinishBlocks(read.load, 1);
+            return;
+        }
+
+        if (m_jobSystem)
+        {
+            m_jobSystem->Submit(m_jobs, [this, read](uint32_t) { Decompress(read); });
+        }
+        else
+        {
+            Decompress(read);
+        }
+    }
+
+    // Runs on a job thread, or the I/O thread without a job system.
+    void Decompress(const BlockRead& _read)
+    {
+        PendingLoad&      load  = *_read.load;
+        const AssetBlock& block = load.blocks[_read.block];
+        uint8_t*          dest  = load.data.data() + static_cast<uint64_t>(_read.block) * load.header.blockSize;
+        if (!DecompressBlock(_read.staging.data(), block.packedSize, dest, block.rawSize))
+        {
+            load.failed = true;
+        }
+        m_inFlightBytes.fetch_sub(block.packedSize, std::memory_order_release);
+        FinishBlocks(_read.load, 1);
+        Signal();
+    }
+
+    static bool ValidHeader(const PendingLoad& _load)
+    {
+        const AssetFileHeader& header = _load.header;
+        if (header.magic != AssetFileMagic || header.version != AssetFileVersion || header.blockSize == 0 || header.blockSize > AssetMaxBlockSize)
+        {
+            return false;
+        }
+        // The table is a single read, so its size must fit a request. Every block takes at least a
+        // byte after it and none expands by more than LzMaxExpansion, which bounds rawSize by the
+        // file before anything that size is allocated.
+        uint64_t tableSize = sizeof(AssetBlock) * static_cast<uint64_t>(header.blockCount);
+        if (header.blockCount != (header.rawSize + header.blockSize - 1) / header.blockSize || tableSize > 0xFFFFFFFF ||
+            sizeof(AssetFileHeader) + tableSize + header.blockCount > _load.fileSize)
+        {
+            return false;
+        }
+        return header.rawSize <= (_load.fileSize - sizeof(AssetFileHeader) - tableSize) * LzMaxExpansion;
+    }
+
+    // Blocks follow the table in order without overlapping, so together they fit in the file.
+    static bool ValidTable(const PendingLoad& _load)
+    {
+        const AssetFileHeader& header = _load.header;
+        uint64_t               end    = sizeof(AssetFileHeader) + sizeof(AssetBlock) * static_cast<uint64_t>(header.blockCount);
+        for (uint32_t i = 0; i < header.blockCount; i++)
+        {
+            const AssetBlock& block     = _load.blocks[i];
+            uint64_t          remaining = header.rawSize - static_cast<uint64_t>(i) * header.blockSize;
+            if (block.rawSize != (std::min)(static_cast<uint64_t>(header.blockSize), remaining) || block.packedSize == 0 || block.packedSize > block.rawSize ||
+                block.rawSize > block.packedSize * LzMaxExpansion || block.offset < end || block.offset > _load.fileSize ||
+                block.packedSize > _load.fileSize - block.offset)
+            {
+                return false;
+            }
+            end = block.offset + block.packedSize;
+        }
+        return true;
+    }
+
+    // Before the blocks are counted in, while unfinished is still 1; nothing else refers to the load yet.
+    void Fail(PendingLoad& _load)
+    {
+        _load.failed = true;
+        _load.stage  = LoadStage::Done;
+        if (_load.unfinished.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            Complete(_load);
+        }
+    }
+
+    void FinishBlocks(const std::shared_ptr<PendingLoad>& _load, uint32_t _count)
+    {
+        if (_count > 0 && _load->unfinished.fetch_sub(_count, std::memory_order_acq_rel) == _count)
+        {
+            Complete(*_load);
+        }
+    }
+
+    void Complete(PendingLoad& _load)
+    {
+        auto   now      = std::chrono::steady_clock::now();
+        double latency  = std::chrono::duration<double, std::milli>(now - _load.start).count();
+        bool   ok       = !_load.failed;
+
+        CompletedLoad completed;
+        completed.callback  = std::move(_load.callback);
+        completed.ok        = ok;
+        if (ok)
+        {
+            completed.data  = std::move(_load.data);
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stats.loads++;
+        m_stats.failed         += ok ? 0 : 1;
+        m_stats.fileBytes      += _load.fileBytes;
+        m_stats.rawBytes       += completed.data.size();
+        m_stats.totalLatencyMs += latency;
+        m_stats.maxLatencyMs    = (std::max)(m_stats.maxLatencyMs, latency);
+        if (--m_inProgress == 0)
+        {
+            m_stats.busySeconds += std::chrono::duration<double>(now - m_busyStart).count();
+        }
+        m_completed.push_back(std::move(completed));
+    }
+
+    JobSystem*                                      m_jobSystem;
+    JobCounter                                      m_jobs;
+    AsyncFileReader                                 m_reader;           // I/O thread only, once started.
+    uint64_t                                        m_maxInFlightBytes;
+    std::atomic<uint64_t>                           m_inFlightBytes{ 0 };
+
+    // I/O thread only.
+    std::list<std::shared_ptr<PendingLoad>>         m_active;           // In load order.
+    std::unordered_map<uint64_t, BlockRead>         m_reads;            // By read request userData.
+    uint64_t                                        m_nextReadId        = 0;
+
+    mutable std::mutex                              m_mutex;
+    std::condition_variable                         m_wake;
+    bool                                            m_signaled          = false;
+    bool                                            m_stopping          = false;
+    std::deque<std::shared_ptr<PendingLoad>>        m_requests;
+    std::vector<CompletedLoad>                      m_completed;
+    size_t                                          m_inProgress        = 0;
+    std::chrono::steady_clock::time_point           m_busyStart;
+    AssetStreamerStats                              m_stats;
+    std::thread                                     m_thread;
+};
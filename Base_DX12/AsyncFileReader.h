@@ -0,0 +1,483 @@
+#pragma once
+
+// Batched asynchronous file reads.
+// Read queues a request and Submit hands everything queued to the OS together; Reap collects
+// completions. On Linux the batch goes through io_uring: Submit fills submission queue entries and
+// makes one io_uring_enter call, and Reap reads completions straight from the shared ring. The
+// raw system calls are used, so there is no liburing dependency. Where io_uring is unavailable,
+// on an old kernel or in a sandbox that filters it, Submit falls back to pread on the calling
+// thread. On Windows each read is an overlapped ReadFile on a handle bound to an I/O completion
+// port, which Reap drains with GetQueuedCompletionStatusEx.
+// Short reads are continued internally, so a successful completion always covers the whole
+// request. At most _queueDepth reads are in flight; Read returns false beyond that.
+// Not thread-safe: one thread queues, submits and reaps. Buffers must stay valid until their
+// request completes. No graphics API dependencies.
+
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+#if defined(_WIN32)
+    #include <Windows.h>
+    #define ASYNC_FILE_READER_IOCP 1
+#else
+    #include <fcntl.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+    #include <cerrno>
+    #if defined(__linux__) && __has_include(<linux/io_uring.h>)
+        #include <linux/io_uring.h>
+        // IORING_OP_READ arrived in 5.6 together with this feature flag.
+        #if defined(IORING_FEAT_RW_CUR_POS)
+            #include <sys/mman.h>
+            #include <sys/syscall.h>
+            #include <cstring>
+            #define ASYNC_FILE_READER_IO_URING 1
+        #endif
+    #endif
+#endif
+
+static const uint32_t FileInvalid = 0xFFFFFFFF;
+
+struct FileReadRequest
+{
+    uint32_t    file        = FileInvalid;
+    uint64_t    offset      = 0;
+    uint32_t    size        = 0;
+    uint8_t*    dest        = nullptr;
+    uint64_t    userData    = 0;
+};
+
+struct FileReadCompletion
+{
+    uint64_t    userData    = 0;
+    bool        ok          = false;
+};
+
+class AsyncFileReader
+{
+public:
+    explicit AsyncFileReader(uint32_t _queueDepth = 64)
+    {
+        m_slots.resize(_queueDepth);
+        for (uint32_t i = _queueDepth; i > 0; i--)
+        {
+            m_freeSlots.push_back(i - 1);
+        }
+
+#if ASYNC_FILE_READER_IOCP
+        m_port = CreateIoCompletionPort(INVALID_HANDLE_VALUE, nullptr, 0, 1);
+#elif ASYNC_FILE_READER_IO_URING
+        SetupRing(_queueDepth);
+#endif
+    }
+
+    // Waits for reads in flight, as their buffers and OVERLAPPEDs must outlive them, then closes everything.
+    ~AsyncFileReader()
+    {
+        std::vector<FileReadCompletion> drained;
+        Submit();
+        while (InFlight() > 0)
+        {
+            Reap(&drained, true);
+        }
+        for (uint32_t file = 0; file < m_files.size(); file++)
+        {
+            Close(file);
+        }
+
+#if ASYNC_FILE_READER_IOCP
+        if (m_port)
+        {
+            CloseHandle(m_port);
+        }
+#elif ASYNC_FILE_READER_IO_URING
+        if (m_ring >= 0)
+        {
+            munmap(m_sqes, m_sqesSize);
+            if (m_cqRing != m_sqRing)
+            {
+                munmap(m_cqRing, m_cqRingSize);
+            }
+            munmap(m_sqRing, m_sqRingSize);
+            close(m_ring);
+        }
+#endif
+    }
+
+    const char* Backend() const
+    {
+#if ASYNC_FILE_READER_IOCP
+        return "overlapped I/O";
+#elif ASYNC_FILE_READER_IO_URING
+        return m_ring >= 0 ? "io_uring" : "pread";
+#else
+        return "pread";
+#endif
+    }
+
+    // Returns the file's index for requests, or FileInvalid.
+    uint32_t Open(const std::filesystem::path& _path, uint64_t* _size)
+    {
+#if ASYNC_FILE_READER_IOCP
+        HANDLE handle = CreateFileW(_path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                    FILE_FLAG_OVERLAPPED | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        LARGE_INTEGER size = {};
+        if (handle == INVALID_HANDLE_VALUE)
+        {
+            return FileInvalid;
+        }
+        if (!GetFileSizeEx(handle, &size) || !CreateIoCompletionPort(handle, m_port, 0, 0))
+        {
+            CloseHandle(handle);
+            return FileInvalid;
+        }
+        *_size = static_cast<uint64_t>(size.QuadPart);
+        return AddFile(reinterpret_cast<intptr_t>(handle));
+#else
+        int descriptor = open(_path.c_str(), O_RDONLY | O_CLOEXEC);
+        struct stat status = {};
+        if (descriptor < 0)
+        {
+            return FileInvalid;
+        }
+        if (fstat(descriptor, &status) != 0)
+        {
+            close(descriptor);
+            return FileInvalid;
+        }
+        *_size = static_cast<uint64_t>(status.st_size);
+        return AddFile(descriptor);
+#endif
+    }
+
+    // No reads may be in flight on _file.
+    void Close(uint32_t _file)
+    {
+        if (_file >= m_files.size() || m_files[_file] == FileHandleInvalid)
+        {
+            return;
+        }
+#if ASYNC_FILE_READER_IOCP
+        CloseHandle(reinterpret_cast<HANDLE>(m_files[_file]));
+#else
+        close(static_cast<int>(m_files[_file]));
+#endif
+        m_files[_file] = FileHandleInvalid;
+    }
+
+    // Queues a read for the next Submit. False if the queue depth is reached.
+    bool Read(const FileReadRequest& _request)
+    {
+        if (m_freeSlots.empty())
+        {
+            return false;
+        }
+        uint32_t slot = m_freeSlots.back();
+        m_freeSlots.pop_back();
+        m_slots[slot]           = Slot();
+        m_slots[slot].request   = _request;
+        m_queued.push_back(slot);
+        return true;
+    }
+
+    // Hands every queued read to the OS.
+    void Submit()
+    {
+        std::vector<uint32_t> queued;
+        queued.swap(m_queued);
+        for (uint32_t slot : queued)
+        {
+            Issue(slot);
+        }
+#if ASYNC_FILE_READER_IO_URING
+        if (m_ring >= 0)
+        {
+            EnterRing(0);
+        }
+#endif
+    }
+
+    // Appends completed reads to _completions. With _wait, blocks until at least one completes,
+    // unless nothing is in flight. Returns the number appended.
+    size_t Reap(std::vector<FileReadCompletion>* _completions, bool _wait)
+    {
+        size_t before = _completions->size();
+        bool   block  = false;
+        while (true)
+        {
+            ReapBackend(_completions, block);
+
+            // Short reads were requeued; send them on straight away.
+            if (!m_queued.empty())
+            {
+                Submit();
+            }
+            _completions->insert(_completions->end(), m_ready.begin(), m_ready.end());
+            m_ready.clear();
+            if (_completions->size() > before || !_wait || InFlight() == 0)
+            {
+                return _completions->size() - before;
+            }
+            block = true;
+        }
+    }
+
+    uint32_t InFlight() const   { return static_cast<uint32_t>(m_slots.size() - m_freeSlots.size()); }
+    uint32_t QueueDepth() const { return static_cast<uint32_t>(m_slots.size()); }
+
+private:
+    // INVALID_HANDLE_VALUE on Windows, an invalid descriptor elsewhere.
+    static constexpr intptr_t FileHandleInvalid = -1;
+
+    struct Slot
+    {
+#if ASYNC_FILE_READER_IOCP
+        OVERLAPPED      overlapped  = {};   // First, so a completion's OVERLAPPED* is the slot.
+#endif
+        FileReadRequest request;
+        uint32_t        done        = 0;    // Bytes read so far.
+    };
+
+    uint32_t AddFile(intptr_t _handle)
+    {
+        for (uint32_t file = 0; file < m_files.size(); file++)
+        {
+            if (m_files[file] == FileHandleInvalid)
+            {
+                m_files[file] = _handle;
+                return file;
+            }
+        }
+        m_files.push_back(_handle);
+        return static_cast<uint32_t>(m_files.size() - 1);
+    }
+
+    // Completes a slot with _result bytes read this time, or a negative error; continues short reads.
+    void Finish(uint32_t _slot, int64_t _result, std::vector<FileReadCompletion>* _completions)
+    {
+        Slot& slot = m_slots[_slot];
+        if (_result > 0 && slot.done + static_cast<uint64_t>(_result) < slot.request.size)
+        {
+            slot.done += static_cast<uint32_t>(_result);
+            m_queued.push_back(_slot);
+            return;
+        }
+
+        FileReadCompletion completion;
+        completion.userData = slot.request.userData;
+        completion.ok       = _result >= 0 && slot.done + static_cast<uint64_t>(_result) == slot.request.size;
+        _completions->push_back(completion);
+        m_freeSlots.push_back(_slot);
+    }
+
+    bool ValidFile(uint32_t _file) const { return _file < m_files.size() && m_files[_file] != FileHandleInvalid; }
+
+#if ASYNC_FILE_READER_IOCP
+    void Issue(uint32_t _slot)
+    {
+        Slot& slot = m_slots[_slot];
+        if (!ValidFile(slot.request.file))
+        {
+            Finish(_slot, -1, &m_ready);
+            return;
+        }
+
+        uint64_t offset = slot.request.offset + slot.done;
+        slot.overlapped             = {};
+        slot.overlapped.Offset      = static_cast<DWORD>(offset);
+        slot.overlapped.OffsetHigh  = static_cast<DWORD>(offset >> 32);
+        HANDLE handle = reinterpret_cast<HANDLE>(m_files[slot.request.file]);
+        if (!ReadFile(handle, slot.request.dest + slot.done, slot.request.size - slot.done, nullptr, &slot.overlapped) && GetLastError() != ERROR_IO_PENDING)
+        {
+            // Nothing was queued to the port for this one.
+            Finish(_slot, -1, &m_ready);
+        }
+    }
+
+    void ReapBackend(std::vector<FileReadCompletion>* _completions, bool _wait)
+    {
+        OVERLAPPED_ENTRY entries[64];
+        ULONG            removed = 0;
+        if (!GetQueuedCompletionStatusEx(m_port, entries, 64, &removed, _wait ? INFINITE : 0, FALSE))
+        {
+            return;
+        }
+        for (ULONG i = 0; i < removed; i++)
+        {
+            Slot*    slot   = reinterpret_cast<Slot*>(entries[i].lpOverlapped);
+            uint32_t index  = static_cast<uint32_t>(slot - m_slots.data());
+            DWORD    bytes  = 0;
+            BOOL     ok     = GetOverlappedResult(reinterpret_cast<HANDLE>(m_files[slot->request.file]), &slot->overlapped, &bytes, FALSE);
+            Finish(index, ok ? static_cast<int64_t>(bytes) : -1, _completions);
+        }
+    }
+
+    HANDLE m_port = nullptr;
+#else
+    // Reads a slot to completion on the calling thread.
+    void ReadBlocking(uint32_t _slot)
+    {
+        Slot& slot = m_slots[_slot];
+        bool  ok   = ValidFile(slot.request.file);
+        while (ok && slot.done < slot.request.size)
+        {
+            ssize_t read = pread(static_cast<int>(m_files[slot.request.file]), slot.request.dest + slot.done, slot.request.size - slot.done,
+                                 static_cast<off_t>(slot.request.offset + slot.done));
+            if (read < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            ok         = read > 0;
+            slot.done += ok ? static_cast<uint32_t>(read) : 0;
+        }
+        Finish(_slot, ok ? 0 : -1, &m_ready);
+    }
+
+#if ASYNC_FILE_READER_IO_URING
+    void SetupRing(uint32_t _queueDepth)
+    {
+        io_uring_params params = {};
+        m_ring = static_cast<int>(syscall(__NR_io_uring_setup, _queueDepth, &params));
+        if (m_ring < 0)
+        {
+            return;
+        }
+        if (!(params.features & IORING_FEAT_RW_CUR_POS))
+        {
+            close(m_ring);
+            m_ring = -1;
+            return;
+        }
+
+        m_sqRingSize = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+        m_cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        bool singleMap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (singleMap)
+        {
+            m_sqRingSize = m_cqRingSize = m_sqRingSize > m_cqRingSize ? m_sqRingSize : m_cqRingSize;
+        }
+        m_sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+
+        void* sqRing = mmap(nullptr, m_sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ring, IORING_OFF_SQ_RING);
+        void* cqRing = singleMap ? sqRing : mmap(nullptr, m_cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ring, IORING_OFF_CQ_RING);
+        void* sqes   = mmap(nullptr, m_sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ring, IORING_OFF_SQES);
+        if (sqRing == MAP_FAILED || cqRing == MAP_FAILED || sqes == MAP_FAILED)
+        {
+            if (sqes != MAP_FAILED)                         { munmap(sqes, m_sqesSize); }
+            if (cqRing != MAP_FAILED && cqRing != sqRing)   { munmap(cqRing, m_cqRingSize); }
+            if (sqRing != MAP_FAILED)                       { munmap(sqRing, m_sqRingSize); }
+            close(m_ring);
+            m_ring = -1;
+            return;
+        }
+
+        m_sqRing    = static_cast<uint8_t*>(sqRing);
+        m_cqRing    = static_cast<uint8_t*>(cqRing);
+        m_sqes      = static_cast<io_uring_sqe*>(sqes);
+        m_sqTail    = reinterpret_cast<uint32_t*>(m_sqRing + params.sq_off.tail);
+        m_sqMask    = *reinterpret_cast<uint32_t*>(m_sqRing + params.sq_off.ring_mask);
+        m_sqArray   = reinterpret_cast<uint32_t*>(m_sqRing + params.sq_off.array);
+        m_cqHead    = reinterpret_cast<uint32_t*>(m_cqRing + params.cq_off.head);
+        m_cqTail    = reinterpret_cast<uint32_t*>(m_cqRing + params.cq_off.tail);
+        m_cqMask    = *reinterpret_cast<uint32_t*>(m_cqRing + params.cq_off.ring_mask);
+        m_cqes      = reinterpret_cast<io_uring_cqe*>(m_cqRing + params.cq_off.cqes);
+    }
+
+    // Submits _unsubmitted entries and, with _waitFor, waits for that many completions.
+    void EnterRing(uint32_t _waitFor)
+    {
+        while (m_unsubmitted > 0 || _waitFor > 0)
+        {
+            long submitted = syscall(__NR_io_uring_enter, m_ring, m_unsubmitted, _waitFor, _waitFor ? IORING_ENTER_GETEVENTS : 0, nullptr, 0);
+            if (submitted < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                // Out of resources; the entries stay in the ring for the next call.
+                return;
+            }
+            m_unsubmitted -= static_cast<uint32_t>(submitted);
+            _waitFor = 0;
+        }
+    }
+#endif
+
+    void Issue(uint32_t _slot)
+    {
+#if ASYNC_FILE_READER_IO_URING
+        Slot& slot = m_slots[_slot];
+        if (m_ring >= 0 && ValidFile(slot.request.file))
+        {
+            // The submission queue has as many entries as there are slots, so it cannot be full.
+            uint32_t      tail  = *m_sqTail;
+            uint32_t      index = tail & m_sqMask;
+            io_uring_sqe* entry = &m_sqes[index];
+            memset(entry, 0, sizeof(*entry));
+            entry->opcode       = IORING_OP_READ;
+            entry->fd           = static_cast<int>(m_files[slot.request.file]);
+            entry->addr         = reinterpret_cast<uint64_t>(slot.request.dest + slot.done);
+            entry->len          = slot.request.size - slot.done;
+            entry->off          = slot.request.offset + slot.done;
+            entry->user_data    = _slot;
+            m_sqArray[index]    = index;
+            __atomic_store_n(m_sqTail, tail + 1, __ATOMIC_RELEASE);
+            m_unsubmitted++;
+            return;
+        }
+#endif
+        ReadBlocking(_slot);
+    }
+
+    void ReapBackend(std::vector<FileReadCompletion>* _completions, bool _wait)
+    {
+#if ASYNC_FILE_READER_IO_URING
+        if (m_ring < 0)
+        {
+            return;
+        }
+        uint32_t head = *m_cqHead;
+        if (_wait && head == __atomic_load_n(m_cqTail, __ATOMIC_ACQUIRE))
+        {
+            EnterRing(1);
+        }
+        uint32_t tail = __atomic_load_n(m_cqTail, __ATOMIC_ACQUIRE);
+        for (; head != tail; head++)
+        {
+            const io_uring_cqe& entry = m_cqes[head & m_cqMask];
+            Finish(static_cast<uint32_t>(entry.user_data), entry.res, _completions);
+        }
+        __atomic_store_n(m_cqHead, head, __ATOMIC_RELEASE);
+#else
+        (void)_completions;
+        (void)_wait;
+#endif
+    }
+
+#if ASYNC_FILE_READER_IO_URING
+    int             m_ring          = -1;
+    uint8_t*        m_sqRing        = nullptr;
+    uint8_t*        m_cqRing        = nullptr;
+    io_uring_sqe*   m_sqes          = nullptr;
+    size_t          m_sqRingSize    = 0;
+    size_t          m_cqRingSize    = 0;
+    size_t          m_sqesSize      = 0;
+    uint32_t*       m_sqTail        = nullptr;
+    uint32_t        m_sqMask        = 0;
+    uint32_t*       m_sqArray       = nullptr;
+    uint32_t*       m_cqHead        = nullptr;
+    uint32_t*       m_cqTail        = nullptr;
+    uint32_t        m_cqMask        = 0;
+    io_uring_cqe*   m_cqes          = nullptr;
+    uint32_t        m_unsubmitted   = 0;
+#endif
+#endif
+
+    std::vector<Slot>               m_slots;
+    std::vector<uint32_t>           m_freeSlots;
+    std::vector<uint32_t>           m_queued;       // Read or continued, not yet handed to the OS.
+    std::vector<FileReadCompletion> m_ready;        // Completed without the OS: errors at issue, blocking reads.
+    std::vector<intptr_t>           m_files;
+};
@@ -0,0 +1,208 @@
+#pragma once
+
+// LZ4 block format compression for streamed assets.
+// Blocks are compressed independently, so they can be read and decompressed in any order and on
+// any thread. CompressBlock is a greedy single-probe hash match finder, fast rather than tight,
+// for packing assets offline or on first run. DecompressBlock checks every length and offset
+// against both buffers, so a corrupt or truncated block fails instead of writing out of bounds.
+// The layout is the standard LZ4 block format, so blocks written by the reference lz4 library
+// decompress here too.
+// Portable C++, no graphics API dependencies.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+static const size_t LzMinMatch          = 4;
+static const size_t LzLastLiterals      = 5;    // The block always ends in at least this many literals.
+static const size_t LzMatchSearchEnd    = 12;   // No match may start in the block's last 12 bytes.
+static const size_t LzMaxOffset         = 65535;
+static const uint32_t LzHashBits        = 14;
+
+// Worst case compressed size of _size bytes.
+static inline size_t CompressBlockBound(size_t _size)
+{
+    return _size + _size / 255 + 16;
+}
+
+// Upper bound on decompressed bytes per compressed byte: a match sequence adds at most 255 bytes
+// per length byte, and literals are copied one for one.
+static const uint64_t LzMaxExpansion    = 255;
+
+static inline uint32_t LzRead32(const uint8_t* _p)
+{
+    uint32_t value;
+    memcpy(&value, _p, sizeof(value));
+    return value;
+}
+
+// Writes a length nibble's continuation: 255s, then the remainder.
+static inline bool LzWriteLength(uint8_t*& _out, const uint8_t* _end, size_t _length)
+{
+    for (; _length >= 255; _length -= 255)
+    {
+        if (_out >= _end) { return false; }
+        *_out++ = 255;
+    }
+    if (_out >= _end) { return false; }
+    *_out++ = static_cast<uint8_t>(_length);
+    return true;
+}
+
+// One sequence: literals, then a match unless _matchLength is 0, which ends the block.
+static inline bool LzWriteSequence(uint8_t*& _out, const uint8_t* _end, const uint8_t* _literals, size_t _literalLength, size_t _offset, size_t _matchLength)
+{
+    if (_out >= _end) { return false; }
+    size_t   matchCode = _matchLength ? _matchLength - LzMinMatch : 0;
+    uint8_t* token     = _out++;
+    *token = static_cast<uint8_t>(((_literalLength < 15 ? _literalLength : 15) << 4) | (matchCode < 15 ? matchCode : 15));
+    if (_literalLength >= 15 && !LzWriteLength(_out, _end, _literalLength - 15))
+    {
+        return false;
+    }
+    if (static_cast<size_t>(_end - _out) < _literalLength)
+    {
+        return false;
+    }
+    // Empty blocks come with null pointers, which memcpy must not see even for zero bytes.
+    if (_literalLength > 0)
+    {
+        memcpy(_out, _literals, _literalLength);
+    }
+    _out += _literalLength;
+
+    if (_matchLength == 0)
+    {
+        return true;
+    }
+    if (_end - _out < 2) { return false; }
+    *_out++ = static_cast<uint8_t>(_offset);
+    *_out++ = static_cast<uint8_t>(_offset >> 8);
+    return matchCode < 15 || LzWriteLength(_out, _end, matchCode - 15);
+}
+
+// Returns the compressed size, or 0 if it would not fit in _capacity.
+static size_t CompressBlock(const uint8_t* _source, size_t _size, uint8_t* _dest, size_t _capacity)
+{
+    uint8_t*        out     = _dest;
+    const uint8_t*  end     = _dest + _capacity;
+    size_t          anchor  = 0;
+
+    if (_size > LzMatchSearchEnd)
+    {
+        // Positions are stored plus one, so zero marks an empty entry.
+        std::vector<uint32_t> table(size_t(1) << LzHashBits, 0);
+        size_t searchEnd = _size - LzMatchSearchEnd;
+        size_t matchEnd  = _size - LzLastLiterals;
+        size_t position  = 0;
+        while (position < searchEnd)
+        {
+            uint32_t sequence  = LzRead32(_source + position);
+            uint32_t hash      = (sequence * 2654435761u) >> (32 - LzHashBits);
+            size_t   candidate = table[hash];
+            table[hash]        = static_cast<uint32_t>(position + 1);
+
+            if (candidate == 0 || position - (candidate - 1) > LzMaxOffset || LzRead32(_source + candidate - 1) != sequence)
+            {
+                position++;
+                continue;
+            }
+
+            size_t match  = candidate - 1;
+            size_t length = LzMinMatch;
+            while (position + length < matchEnd && _source[match + length] == _source[position + length])
+            {
+                length++;
+            }
+            if (!LzWriteSequence(out, end, _source + anchor, position - anchor, position - match, length))
+            {
+                return 0;
+            }
+            position += length;
+            anchor    = position;
+        }
+    }
+
+    if (!LzWriteSequence(out, end, _source + anchor, _size - anchor, 0, 0))
+    {
+        return 0;
+    }
+    return static_cast<size_t>(out - _dest);
+}
+
+// Decompresses exactly _rawSize bytes. False if the block is malformed or does not produce _rawSize bytes.
+static bool DecompressBlock(const uint8_t* _source, size_t _size, uint8_t* _dest, size_t _rawSize)
+{
+    size_t in  = 0;
+    size_t out = 0;
+    while (in < _size)
+    {
+        uint8_t token   = _source[in++];
+        size_t  literal = token >> 4;
+        if (literal == 15)
+        {
+            uint8_t extra;
+            do
+            {
+                if (in >= _size) { return false; }
+                extra    = _source[in++];
+                literal += extra;
+            } while (extra == 255);
+        }
+        if (literal > _size - in || literal > _rawSize - out)
+        {
+            return false;
+        }
+        if (literal > 0)
+        {
+            memcpy(_dest + out, _source + in, literal);
+        }
+        in  += literal;
+        out += literal;
+
+        // The last sequence has no match.
+        if (in == _size)
+        {
+            break;
+        }
+
+        if (_size - in < 2) { return false; }
+        size_t offset = _source[in] | (static_cast<size_t>(_source[in + 1]) << 8);
+        in += 2;
+        if (offset == 0 || offset > out)
+        {
+            return false;
+        }
+
+        size_t length = token & 15;
+        if (length == 15)
+        {
+            uint8_t extra;
+            do
+            {
+                if (in >= _size) { return false; }
+                extra   = _source[in++];
+                length += extra;
+            } while (extra == 255);
+        }
+        length += LzMinMatch;
+        if (length > _rawSize - out)
+        {
+            return false;
+        }
+
+        // An overlapping match repeats the last _offset bytes. Every copy stays disjoint by reaching
+        // back a whole number of periods no further than what is already written, doubling each time.
+        uint8_t* dest   = _dest + out;
+        size_t   copied = 0;
+        for (size_t step = offset; copied < length; step *= 2)
+        {
+            size_t chunk = step < length - copied ? step : length - copied;
+            memcpy(dest + copied, dest + copied - step, chunk);
+            copied += chunk;
+        }
+        out += length;
+    }
+    return out == _rawSize;
+}
@@ -0,0 +1,138 @@
+#pragma once
+
+// Command allocator and list pairs, pooled per queue type.
+// A command allocator holds the memory its lists recorded into until the GPU has executed them,
+// so it can only be reset once the queue's fence passes the submission. Each pair is acquired
+// already reset and open for recording, and retired with the fence value signalled after the
+// submission that used it; FenceRecyclePool hands it out again once the GPU gets there. Each
+// queue type has its own pool and fence, as values on different queues are not comparable.
+// The pools are capped, and trimmed to their recent high-water mark once a frame, so the
+// allocators a burst of work grew are not kept for good. Destruction waits for every retired
+// pair before releasing it; pairs still acquired are the caller's.
+
+#include <d3d12.h>
+#include "FenceRecyclePool.h"
+
+#include <iostream>
+#include <memory>
+
+struct CommandListPair
+{
+    ID3D12CommandAllocator*     allocator   = nullptr;
+    ID3D12GraphicsCommandList*  list        = nullptr;
+    D3D12_COMMAND_LIST_TYPE     type        = D3D12_COMMAND_LIST_TYPE_DIRECT;
+};
+
+class CommandListPool
+{
+public:
+    // _maxPairs caps each queue type's pool; the high-water mark is taken over _highWaterFrames Trim calls.
+    CommandListPool(ID3D12Device* _device, uint32_t _maxPairs, uint32_t _highWaterFrames)
+        : m_device(_device), m_maxPairs(_maxPairs), m_highWaterFrames(_highWaterFrames)
+    {
+    }
+
+    // Pairs of _type are retired against _fence, which must signal on the queue they are executed on.
+    void AddQueue(D3D12_COMMAND_LIST_TYPE _type, IGpuFence* _fence)
+    {
+        ID3D12Device* device = m_device;
+        m_pools[_type].reset(new FenceRecyclePool<CommandListPair>(_fence,
+            [device, _type](CommandListPair* _pair) { return CreatePair(device, _type, _pair); },
+            [](CommandListPair& _pair) { _pair.list->Release(); _pair.allocator->Release(); },
+            m_maxPairs, m_highWaterFrames));
+    }
+
+    // Returns a pair of _type open for recording with _initialState, which may be null. Thread-safe.
+    bool Acquire(D3D12_COMMAND_LIST_TYPE _type, ID3D12PipelineState* _initialState, CommandListPair* _pair)
+    {
+        FenceRecyclePool<CommandListPair>* pool = Pool(_type);
+        if (!pool || !pool->Acquire(_pair))
+        {
+            std::cout << "Failed to acquire command list\n";
+            return false;
+        }
+
+        if (!SUCCEEDED(_pair->allocator->Reset()) || !SUCCEEDED(_pair->list->Reset(_pair->allocator, _initialState)))
+        {
+            // A pair that fails to reset would fail again; destroy it so the next acquire gets another.
+            std::cout << "Failed to reset command list\n";
+            pool->Discard(*_pair);
+            *_pair = CommandListPair();
+            return false;
+        }
+        return true;
+    }
+
+    // _fenceValue is signalled after the submission the list was executed in; 0 if it never was.
+    // The list must be closed. Thread-safe.
+    void Retire(const CommandListPair& _pair, uint64_t _fenceValue)
+    {
+        if (_pair.list)
+        {
+            Pool(_pair.type)->Retire(_pair, _fenceValue);
+        }
+    }
+
+    // Once a frame: destroys idle pairs above each pool's high-water mark.
+    void Trim()
+    {
+        for (auto& pool : m_pools)
+        {
+            if (pool)
+            {
+                pool->Trim();
+            }
+        }
+    }
+
+    // Pairs alive of _type, whether acquired, in flight or idle.
+    size_t Owned(D3D12_COMMAND_LIST_TYPE _type) const
+    {
+        const FenceRecyclePool<CommandListPair>* pool = Pool(_type);
+        return pool ? pool->Owned() : 0;
+    }
+
+    size_t HighWater(D3D12_COMMAND_LIST_TYPE _type) const
+    {
+        const FenceRecyclePool<CommandListPair>* pool = Pool(_type);
+        return pool ? pool->HighWater() : 0;
+    }
+
+    uint64_t Created(D3D12_COMMAND_LIST_TYPE _type) const
+    {
+        const FenceRecyclePool<CommandListPair>* pool = Pool(_type);
+        return pool ? pool->Created() : 0;
+    }
+
+private:
+    // Lists are created open; close them so every acquire resets the same way.
+    static bool CreatePair(ID3D12Device* _device, D3D12_COMMAND_LIST_TYPE _type, CommandListPair* _pair)
+    {
+        _pair->type = _type;
+        if (!SUCCEEDED(_device->CreateCommandAllocator(_type, IID_PPV_ARGS(&_pair->allocator))))
+        {
+            return false;
+        }
+        if (!SUCCEEDED(_device->CreateCommandList(0, _type, _pair->allocator, nullptr, IID_PPV_ARGS(&_pair->list))))
+        {
+            _pair->allocator->Release();
+            _pair->allocator = nullptr;
+            return false;
+        }
+        _pair->list->Close();
+        return true;
+    }
+
+    FenceRecyclePool<CommandListPair>* Pool(D3D12_COMMAND_LIST_TYPE _type) const
+    {
+        return _type < QueueTypeCount ? m_pools[_type].get() : nullptr;
+    }
+
+    // DIRECT, BUNDLE, COMPUTE and COPY; bundles are not executed on a queue and have no pool.
+    static const uint32_t QueueTypeCount = D3D12_COMMAND_LIST_TYPE_COPY + 1;
+
+    ID3D12Device*                                       m_device;
+    uint32_t                                            m_maxPairs;
+    uint32_t                                            m_highWaterFrames;
+    std::unique_ptr<FenceRecyclePool<CommandListPair>>  m_pools[QueueTypeCount];
+};
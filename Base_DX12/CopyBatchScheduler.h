@@ -0,0 +1,175 @@
+#pragma once
+
+// Batching and scheduling for a dedicated copy queue.
+// Uploads are queued from any thread and handed out as tickets. Flush, called from one thread,
+// packs the queued uploads in order into batches bounded by staging bytes and upload count, hands
+// each batch to the caller to record and execute, then signals the copy fence after it. Every ticket in a batch
+// completes at that batch's fence value, which consumers on other queues wait on before use.
+// An upload larger than the batch budget goes in a batch of its own.
+// The upload payload is a template parameter and recording is supplied by the caller, so the
+// scheduling has no graphics API dependency.
+
+#include "GpuFence.h"
+
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+typedef uint64_t CopyTicket;
+static const CopyTicket CopyTicketInvalid = 0;
+
+template<typename Upload>
+class CopyBatchScheduler
+{
+public:
+    // Records and executes the batch on the copy queue. Returns false to leave it queued.
+    typedef std::function<bool(std::vector<Upload>& _uploads, uint64_t _stagingBytes)> SubmitFn;
+
+    CopyBatchScheduler(IGpuFence* _fence, uint64_t _maxBatchBytes, uint32_t _maxBatchUploads)
+        : m_fence(_fence), m_maxBatchBytes(_maxBatchBytes), m_maxBatchUploads(_maxBatchUploads)
+    {
+    }
+
+    // _stagingBytes is the intermediate memory the upload needs. Thread-safe.
+    CopyTicket Enqueue(Upload _upload, uint64_t _stagingBytes)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_queued.push_back({ std::move(_upload), _stagingBytes, ++m_lastTicket });
+        m_queuedBytes += _stagingBytes;
+        return m_lastTicket;
+    }
+
+    // Submits everything queued so far. Returns the number of batches submitted; stops at the
+    // first batch _submit refuses, which stays at the front of the queue.
+    uint32_t Flush(const SubmitFn& _submit)
+    {
+        std::deque<Pending> queued;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            queued.swap(m_queued);
+            m_queuedBytes = 0;
+        }
+
+        uint32_t batches = 0;
+        std::vector<Upload> uploads;
+        while (!queued.empty())
+        {
+            // Greedy in queue order, so tickets complete in order.
+            uint64_t bytes = 0;
+            size_t   count = 0;
+            while (count < queued.size() && count < m_maxBatchUploads &&
+                   (count == 0 || bytes + queued[count].stagingBytes <= m_maxBatchBytes))
+            {
+                bytes += queued[count].stagingBytes;
+                count++;
+            }
+
+            uploads.clear();
+            for (size_t i = 0; i < count; i++)
+            {
+                uploads.push_back(queued[i].upload);
+            }
+            if (!_submit(uploads, bytes))
+            {
+                break;
+            }
+
+            uint64_t fenceValue = m_fence->Signal();
+            CopyTicket lastTicket = queued[count - 1].ticket;
+            queued.erase(queued.begin(), queued.begin() + count);
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_submitted.push_back({ lastTicket, fenceValue });
+            }
+            batches++;
+        }
+
+        // Put back what could not be submitted, ahead of anything queued meanwhile.
+        if (!queued.empty())
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            for (const Pending& pending : queued)
+            {
+                m_queuedBytes += pending.stagingBytes;
+            }
+            m_queued.insert(m_queued.begin(), queued.begin(), queued.end());
+        }
+        return batches;
+    }
+
+    // Copy fence value to wait on before using the ticket's upload, 0 while it has not been submitted.
+    uint64_t FenceValue(CopyTicket _ticket)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        Prune();
+        if (_ticket <= m_completedTicket)
+        {
+            return m_completedFence;
+        }
+        for (const Submitted& submitted : m_submitted)
+        {
+            if (_ticket <= submitted.lastTicket)
+            {
+                return submitted.fenceValue;
+            }
+        }
+        return 0;
+    }
+
+    bool IsComplete(CopyTicket _ticket)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        Prune();
+        return _ticket <= m_completedTicket;
+    }
+
+    uint64_t QueuedBytes()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_queuedBytes;
+    }
+
+    size_t QueuedCount()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_queued.size();
+    }
+
+private:
+    struct Pending
+    {
+        Upload      upload;
+        uint64_t    stagingBytes;
+        CopyTicket  ticket;
+    };
+
+    struct Submitted
+    {
+        CopyTicket  lastTicket;
+        uint64_t    fenceValue;
+    };
+
+    void Prune()
+    {
+        uint64_t completed = m_fence->GetCompletedValue();
+        while (!m_submitted.empty() && m_submitted.front().fenceValue <= completed)
+        {
+            m_completedTicket   = m_submitted.front().lastTicket;
+            m_completedFence    = m_submitted.front().fenceValue;
+            m_submitted.pop_front();
+        }
+    }
+
+    IGpuFence*              m_fence;
+    uint64_t                m_maxBatchBytes;
+    uint32_t                m_maxBatchUploads;
+
+    std::deque<Pending>     m_queued;
+    uint64_t                m_queuedBytes       = 0;
+    std::deque<Submitted>   m_submitted;        // In fence order.
+    CopyTicket              m_lastTicket        = CopyTicketInvalid;
+    CopyTicket              m_completedTicket   = CopyTicketInvalid;
+    uint64_t                m_completedFence    = 0;
+    std::mutex              m_mutex;
+};
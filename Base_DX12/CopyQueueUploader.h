@@ -0,0 +1,174 @@
+#pragma once
+
+// Uploads into DEFAULT heap resources on a dedicated copy queue.
+// Source data is copied on enqueue, so callers may free it straight away. Flush batches the
+// queued uploads through CopyBatchScheduler: each batch is one command list from the command list
+// pool, of UpdateSubresources copies through staging memory from an upload ring retired by the
+// copy fence, written with streaming stores and, given a job system, across its threads. Queues that use an upload call
+// WaitOnQueue first, which inserts a GPU-side wait on the copy fence and costs nothing once the
+// upload has completed.
+// Destinations must be in the COMMON state. They promote to COPY_DEST on the copy queue and decay
+// back to COMMON when the batch completes; buffers and non render target textures then promote
+// to their read state on first use, so no barriers are recorded here.
+
+#include <d3d12.h>
+#include "d3dx12.h"
+#include "CommandListPool.h"
+#include "CopyBatchScheduler.h"
+#include "SubresourceUpload.h"
+#include "UploadRing.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+struct CopyUpload
+{
+    ID3D12Resource*                         destination         = nullptr;
+    UINT                                    firstSubresource    = 0;
+    std::vector<D3D12_SUBRESOURCE_DATA>     subresources;       // Point into data.
+    std::shared_ptr<std::vector<uint8_t>>   data;
+};
+
+class CopyQueueUploader
+{
+public:
+    // _fence signals on _queue, which must be a copy queue; _nativeFence is its ID3D12Fence.
+    // _commandLists must have a COPY queue registered against _fence.
+    // _jobSystem, if any, splits large staging copies across threads.
+    CopyQueueUploader(ID3D12CommandQueue* _queue, IGpuFence* _fence, ID3D12Fence* _nativeFence, CommandListPool* _commandLists,
+                      uint64_t _maxBatchBytes, uint32_t _maxBatchUploads, UploadPageCreateFn _createPage, UploadPageDestroyFn _destroyPage,
+                      JobSystem* _jobSystem = nullptr)
+        : m_queue(_queue), m_fence(_fence), m_nativeFence(_nativeFence), m_commandLists(_commandLists), m_jobSystem(_jobSystem),
+          m_scheduler(_fence, _maxBatchBytes, _maxBatchUploads), m_staging(_fence, _maxBatchBytes, std::move(_createPage), std::move(_destroyPage))
+    {
+    }
+
+    ~CopyQueueUploader()
+    {
+        m_fence->WaitForValue(m_fence->GetLastSignaledValue());
+        m_staging.Retire();
+    }
+
+    CopyTicket UploadBuffer(ID3D12Resource* _destination, const void* _data, uint64_t _size)
+    {
+        D3D12_SUBRESOURCE_DATA subresource = {};
+        subresource.pData       = _data;
+        subresource.RowPitch    = static_cast<LONG_PTR>(_size);
+        subresource.SlicePitch  = static_cast<LONG_PTR>(_size);
+        return UploadSubresources(_destination, 0, 1, &subresource);
+    }
+
+    // _subresources describe tightly or loosely packed source rows, as for UpdateSubresources.
+    CopyTicket UploadSubresources(ID3D12Resource* _destination, UINT _firstSubresource, UINT _count, const D3D12_SUBRESOURCE_DATA* _subresources)
+    {
+        D3D12_RESOURCE_DESC desc = _destination->GetDesc();
+
+        // Size of each subresource's source data, covering every depth slice of 3D textures.
+        std::vector<uint64_t> sizes(_count);
+        uint64_t total = 0;
+        for (UINT i = 0; i < _count; i++)
+        {
+            UINT     mip    = (_firstSubresource + i) % (desc.MipLevels ? desc.MipLevels : 1);
+            uint64_t depth  = desc.Dimension == D3D12_RESOURCE_DIMENSION_TEXTURE3D ? (std::max)(1, desc.DepthOrArraySize >> mip) : 1;
+            sizes[i]        = static_cast<uint64_t>(_subresources[i].SlicePitch) * depth;
+            total          += sizes[i];
+        }
+
+        CopyUpload upload;
+        upload.destination      = _destination;
+        upload.firstSubresource = _firstSubresource;
+        upload.data             = std::make_shared<std::vector<uint8_t>>(static_cast<size_t>(total));
+        uint64_t offset = 0;
+        for (UINT i = 0; i < _count; i++)
+        {
+            memcpy(upload.data->data() + offset, _subresources[i].pData, static_cast<size_t>(sizes[i]));
+            D3D12_SUBRESOURCE_DATA subresource = _subresources[i];
+            subresource.pData = upload.data->data() + offset;
+            upload.subresources.push_back(subresource);
+            offset += sizes[i];
+        }
+
+        uint64_t stagingBytes = GetRequiredIntermediateSize(_destination, _firstSubresource, _count);
+        return m_scheduler.Enqueue(std::move(upload), stagingBytes);
+    }
+
+    // Submits everything queued. Returns false if a batch could not be recorded; it stays queued.
+    bool Flush()
+    {
+        m_staging.Retire();
+        m_scheduler.Flush([this](std::vector<CopyUpload>& _uploads, uint64_t) { return SubmitBatch(_uploads); });
+        return m_scheduler.QueuedCount() == 0;
+    }
+
+    // Makes _queue wait for the ticket's upload. False if the ticket has not been flushed yet.
+    bool WaitOnQueue(ID3D12CommandQueue* _queue, CopyTicket _ticket)
+    {
+        uint64_t fenceValue = m_scheduler.FenceValue(_ticket);
+        if (fenceValue == 0)
+        {
+            return false;
+        }
+        if (!m_scheduler.IsComplete(_ticket))
+        {
+            _queue->Wait(m_nativeFence, fenceValue);
+        }
+        return true;
+    }
+
+    bool IsComplete(CopyTicket _ticket) { return m_scheduler.IsComplete(_ticket); }
+
+private:
+    bool SubmitBatch(std::vector<CopyUpload>& _uploads)
+    {
+        // Only the scheduler signals the copy fence, right after this batch executes.
+        uint64_t batchFence = m_fence->GetLastSignaledValue() + 1;
+
+        CommandListPair pair;
+        if (!m_commandLists->Acquire(D3D12_COMMAND_LIST_TYPE_COPY, nullptr, &pair))
+        {
+            return false;
+        }
+
+        bool recorded = true;
+        for (CopyUpload& upload : _uploads)
+        {
+            UINT             count  = static_cast<UINT>(upload.subresources.size());
+            uint64_t         size   = GetRequiredIntermediateSize(upload.destination, upload.firstSubresource, count);
+            UploadAllocation staging;
+            if (!m_staging.Allocate(size, UploadAlignTexture, &staging) ||
+                UpdateSubresourcesStreaming(pair.list, upload.destination, static_cast<ID3D12Resource*>(staging.resource), staging.cpuAddress, staging.offset,
+                                            upload.firstSubresource, count, upload.subresources.data(), m_jobSystem) == 0)
+            {
+                std::cout << "Failed to record upload\n";
+                recorded = false;
+                break;
+            }
+        }
+        pair.list->Close();
+
+        if (!recorded)
+        {
+            // Nothing executed, so the list and any staging taken are free again right away.
+            m_staging.EndFrame(0);
+            m_commandLists->Retire(pair, 0);
+            return false;
+        }
+
+        ID3D12CommandList* lists[] = { pair.list };
+        m_queue->ExecuteCommandLists(1, lists);
+        m_staging.EndFrame(batchFence);
+        m_commandLists->Retire(pair, batchFence);
+        return true;
+    }
+
+    ID3D12CommandQueue*             m_queue;
+    IGpuFence*                      m_fence;
+    ID3D12Fence*                    m_nativeFence;
+    CommandListPool*                m_commandLists;
+    JobSystem*                      m_jobSystem;
+    CopyBatchScheduler<CopyUpload>  m_scheduler;
+    UploadRing                      m_staging;
+};
@@ -0,0 +1,119 @@
+#pragma once
+
+// Releases reference counted objects once the GPU has finished with them.
+// Releasing a resource a queued command list still references is undefined, so instead of
+// waiting for the GPU, callers hand the reference over with the fence value of the submission
+// that last uses it. Collect, run once per completed frame, e.g. from a FenceCompletionService
+// continuation, releases the ones the fence has passed, oldest first, up to a budget so a burst
+// of destruction is spread over several frames rather than landing as one long stall; the rest
+// carry over. Entries are kept in fence order, so Collect stops at the first one still pending.
+// T is anything with a COM style Release(), e.g. IUnknown. Defer is thread-safe, and Release is
+// never called with the lock held.
+// Portable C++, no graphics API dependencies.
+
+#include "GpuFence.h"
+
+#include <algorithm>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+template<typename T>
+class DeferredReleaseQueue
+{
+public:
+    explicit DeferredReleaseQueue(IGpuFence* _fence)
+        : m_fence(_fence)
+    {
+    }
+
+    ~DeferredReleaseQueue()
+    {
+        Flush();
+    }
+
+    // Takes over one reference to _object, released once the fence reaches _fenceValue. Null is ignored.
+    void Defer(T* _object, uint64_t _fenceValue)
+    {
+        if (!_object)
+        {
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto position = std::upper_bound(m_pending.begin(), m_pending.end(), _fenceValue,
+                                         [](uint64_t _value, const Entry& _entry) { return _value < _entry.fence; });
+        m_pending.insert(position, Entry{ _object, _fenceValue });
+        m_peakPending = (std::max)(m_peakPending, m_pending.size());
+    }
+
+    // Releases up to _budget objects the GPU is done with. Returns how many were released.
+    size_t Collect(size_t _budget)
+    {
+        std::vector<T*> released;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            uint64_t completed = m_fence->GetCompletedValue();
+            while (released.size() < _budget && !m_pending.empty() && m_pending.front().fence <= completed)
+            {
+                released.push_back(m_pending.front().object);
+                m_pending.pop_front();
+            }
+            if (released.size() == _budget && !m_pending.empty() && m_pending.front().fence <= completed)
+            {
+                m_overBudget++;
+            }
+        }
+
+        for (T* object : released)
+        {
+            object->Release();
+        }
+        m_released += released.size();
+        return released.size();
+    }
+
+    // Waits for the newest deferred value and releases everything, ignoring the budget.
+    void Flush()
+    {
+        uint64_t last = 0;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_pending.empty())
+            {
+                return;
+            }
+            last = m_pending.back().fence;
+        }
+        m_fence->WaitForValue(last);
+        while (Collect(static_cast<size_t>(-1)) > 0)
+        {
+        }
+    }
+
+    size_t Pending() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_pending.size();
+    }
+
+    size_t      PeakPending() const { std::lock_guard<std::mutex> lock(m_mutex); return m_peakPending; }
+    uint64_t    Released() const    { return m_released; }
+
+    // Collect calls that left completed objects for a later frame.
+    uint64_t    OverBudget() const  { std::lock_guard<std::mutex> lock(m_mutex); return m_overBudget; }
+
+private:
+    struct Entry
+    {
+        T*          object;
+        uint64_t    fence;
+    };
+
+    IGpuFence*              m_fence;
+    mutable std::mutex      m_mutex;
+    std::deque<Entry>       m_pending;          // In fence order.
+    size_t                  m_peakPending   = 0;
+    uint64_t                m_overBudget    = 0;
+    uint64_t                m_released      = 0;    // Only touched by the collecting thread.
+};
@@ -0,0 +1,152 @@
+#pragma once
+
+// Lock-free descriptor index allocation.
+// IndexFreeList hands out single slots of a fixed-size CPU descriptor heap. It is a Treiber stack
+// whose head carries a tag that changes on every update, so a slot popped and pushed back between
+// a thread's read and its compare-exchange cannot be mistaken for an unchanged head.
+// DescriptorRingAllocator hands out contiguous ranges of a shader-visible heap for per-frame
+// descriptor tables. Positions only grow; ranges never straddle the end of the heap, and space is
+// reclaimed a frame at a time once the GPU has passed the frame's fence value.
+// Allocate and Free may be called from any thread. Ring EndFrame and Retire belong to the frame
+// loop. Portable C++, no graphics API dependencies.
+
+#include "GpuFence.h"
+
+#include <atomic>
+#include <deque>
+#include <memory>
+
+static const uint32_t DescriptorInvalid = 0xFFFFFFFF;
+
+class IndexFreeList
+{
+public:
+    explicit IndexFreeList(uint32_t _capacity) : m_capacity(_capacity), m_next(new std::atomic<uint32_t>[_capacity])
+    {
+        for (uint32_t i = 0; i < _capacity; i++)
+        {
+            m_next[i].store(i + 1 < _capacity ? i + 1 : DescriptorInvalid, std::memory_order_relaxed);
+        }
+        m_head.store(Pack(_capacity ? 0 : DescriptorInvalid, 0), std::memory_order_release);
+    }
+
+    // DescriptorInvalid when every slot is in use.
+    uint32_t Allocate()
+    {
+        uint64_t head = m_head.load(std::memory_order_acquire);
+        while (true)
+        {
+            uint32_t index = Index(head);
+            if (index == DescriptorInvalid)
+            {
+                return DescriptorInvalid;
+            }
+
+            uint64_t next = Pack(m_next[index].load(std::memory_order_relaxed), Tag(head) + 1);
+            if (m_head.compare_exchange_weak(head, next, std::memory_order_acq_rel, std::memory_order_acquire))
+            {
+                m_allocated.fetch_add(1, std::memory_order_relaxed);
+                return index;
+            }
+        }
+    }
+
+    void Free(uint32_t _index)
+    {
+        uint64_t head = m_head.load(std::memory_order_relaxed);
+        while (true)
+        {
+            m_next[_index].store(Index(head), std::memory_order_relaxed);
+            if (m_head.compare_exchange_weak(head, Pack(_index, Tag(head) + 1), std::memory_order_release, std::memory_order_relaxed))
+            {
+                m_allocated.fetch_sub(1, std::memory_order_relaxed);
+                return;
+            }
+        }
+    }
+
+    uint32_t Capacity() const       { return m_capacity; }
+    uint32_t AllocatedCount() const { return m_allocated.load(std::memory_order_relaxed); }
+
+private:
+    static uint64_t Pack(uint32_t _index, uint32_t _tag)    { return (static_cast<uint64_t>(_tag) << 32) | _index; }
+    static uint32_t Index(uint64_t _head)                   { return static_cast<uint32_t>(_head); }
+    static uint32_t Tag(uint64_t _head)                     { return static_cast<uint32_t>(_head >> 32); }
+
+    uint32_t                                    m_capacity;
+    std::unique_ptr<std::atomic<uint32_t>[]>    m_next;
+    std::atomic<uint64_t>                       m_head{ 0 };
+    std::atomic<uint32_t>                       m_allocated{ 0 };
+};
+
+class DescriptorRingAllocator
+{
+public:
+    DescriptorRingAllocator(IGpuFence* _fence, uint32_t _capacity) : m_fence(_fence), m_capacity(_capacity)
+    {
+    }
+
+    // Reserves _count contiguous slots and returns the first in _first. Fails when the frames still
+    // in flight hold too much of the ring.
+    bool Allocate(uint32_t _count, uint32_t* _first)
+    {
+        if (_count == 0 || _count > m_capacity)
+        {
+            return false;
+        }
+
+        uint64_t head = m_head.load(std::memory_order_relaxed);
+        uint64_t start;
+        do
+        {
+            // Skip the remainder of the heap rather than wrap a table around its end.
+            start = head;
+            if (start % m_capacity + _count > m_capacity)
+            {
+                start += m_capacity - start % m_capacity;
+            }
+            // Only positions from the tail up to the head are live; skipped ones never were.
+            uint64_t tail = m_tail.load(std::memory_order_acquire);
+            if (tail < head && start + _count - tail > m_capacity)
+            {
+                return false;
+            }
+        } while (!m_head.compare_exchange_weak(head, start + _count, std::memory_order_acq_rel, std::memory_order_relaxed));
+
+        *_first = static_cast<uint32_t>(start % m_capacity);
+        return true;
+    }
+
+    // Everything allocated since the previous call belongs to the frame signalled with _fenceValue.
+    void EndFrame(uint64_t _fenceValue)
+    {
+        m_frames.push_back({ m_head.load(std::memory_order_acquire), _fenceValue });
+    }
+
+    // Reclaims the space of frames the GPU has finished with.
+    void Retire()
+    {
+        uint64_t completed = m_fence->GetCompletedValue();
+        while (!m_frames.empty() && m_frames.front().fenceValue <= completed)
+        {
+            m_tail.store(m_frames.front().end, std::memory_order_release);
+            m_frames.pop_front();
+        }
+    }
+
+    uint32_t Capacity() const   { return m_capacity; }
+    uint32_t InUse() const      { return static_cast<uint32_t>(m_head.load(std::memory_order_relaxed) - m_tail.load(std::memory_order_relaxed)); }
+
+private:
+    struct Frame
+    {
+        uint64_t end;
+        uint64_t fenceValue;
+    };
+
+    IGpuFence*              m_fence;
+    uint32_t                m_capacity;
+    std::atomic<uint64_t>   m_head{ 0 };    // Next free position; the slot is position % capacity.
+    std::atomic<uint64_t>   m_tail{ 0 };    // Oldest position the GPU may still read.
+    std::deque<Frame>       m_frames;       // In fence order.
+};
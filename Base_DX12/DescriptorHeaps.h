@@ -0,0 +1,70 @@
+#pragma once
+
+// D3D12 descriptor heaps built on the lock-free index allocators.
+// CpuDescriptorHeap is a non shader-visible heap of individually allocated descriptors, used for
+// RTVs and DSVs. The sample binds everything else through root parameters, so it has no
+// shader-visible heap; DescriptorRingAllocator is the allocator one would be carved with.
+
+#include <d3d12.h>
+#include "d3dx12.h"
+#include "DescriptorAllocator.h"
+
+#include <iostream>
+
+class CpuDescriptorHeap
+{
+public:
+    CpuDescriptorHeap(ID3D12Device* _device, D3D12_DESCRIPTOR_HEAP_TYPE _type, uint32_t _capacity) : m_indices(_capacity)
+    {
+        D3D12_DESCRIPTOR_HEAP_DESC heapDesc = {};
+        heapDesc.NumDescriptors = _capacity;
+        heapDesc.Type           = _type;
+        heapDesc.Flags          = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
+        if (!SUCCEEDED(_device->CreateDescriptorHeap(&heapDesc, IID_PPV_ARGS(&m_heap))))
+        {
+            std::cout << "Failed to create descriptor heap\n";
+            return;
+        }
+
+        m_start         = m_heap->GetCPUDescriptorHandleForHeapStart();
+        m_increment     = _device->GetDescriptorHandleIncrementSize(_type);
+    }
+
+    ~CpuDescriptorHeap()
+    {
+        if (m_heap)
+        {
+            m_heap->Release();
+        }
+    }
+
+    // DescriptorInvalid when the heap is full.
+    uint32_t Allocate()
+    {
+        uint32_t index = m_heap ? m_indices.Allocate() : DescriptorInvalid;
+        if (index == DescriptorInvalid)
+        {
+            std::cout << "Descriptor heap exhausted\n";
+        }
+        return index;
+    }
+
+    void Free(uint32_t _index)
+    {
+        m_indices.Free(_index);
+    }
+
+    CD3DX12_CPU_DESCRIPTOR_HANDLE Handle(uint32_t _index) const
+    {
+        return CD3DX12_CPU_DESCRIPTOR_HANDLE(m_start, static_cast<INT>(_index), m_increment);
+    }
+
+    bool        IsValid() const         { return m_heap != nullptr; }
+    uint32_t    AllocatedCount() const  { return m_indices.AllocatedCount(); }
+
+private:
+    ID3D12DescriptorHeap*       m_heap      = nullptr;
+    D3D12_CPU_DESCRIPTOR_HANDLE m_start     = {};
+    UINT                        m_increment = 0;
+    IndexFreeList               m_indices;
+};
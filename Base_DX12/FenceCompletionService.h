@@ -0,0 +1,176 @@
+#pragma once
+
+// Runs continuations when GPU fences reach a value, on one thread of its own.
+// Work that only has to happen once the GPU is done with something, such as recycling a resource
+// or handing a readback to its consumer, is enqueued with the fence and value it waits for rather
+// than blocking the thread that submitted it. The service thread runs everything already reached,
+// then sleeps on one GpuFenceWaiter until any awaited value is reached, a request is enqueued or
+// the nearest timeout passes. Each request registers its value with its fence once, through
+// IGpuFence::WakeOnCompletion, which must therefore be safe to call while others use the fence.
+// Continuations on the same fence run in value order. Each may carry a timeout, after which it
+// runs with _reached false instead, so a hung or removed device is reported rather than waited on
+// forever. Continuations run on the service thread and must synchronise whatever they touch.
+// Portable C++, no graphics API dependencies.
+
+#include "GpuFence.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+typedef std::function<void(bool _reached)> FenceContinuation;
+
+class FenceCompletionService
+{
+public:
+    FenceCompletionService()
+    {
+        m_thread = std::thread([this]() { ServiceLoop(); });
+    }
+
+    // Runs every continuation still pending, waiting for their fences or timeouts, then stops.
+    // Values that timed out stay registered with their fences, so the GPU must be idle or lost.
+    ~FenceCompletionService()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopping = true;
+        }
+        m_waiter.Wake();
+        m_thread.join();
+    }
+
+    // Runs _continuation once _fence reaches _value, or after _timeoutMs if that comes first.
+    // Thread-safe; may be called from a continuation.
+    void Enqueue(IGpuFence* _fence, uint64_t _value, FenceContinuation _continuation, uint32_t _timeoutMs = GpuFenceInfinite)
+    {
+        Request request;
+        request.fence           = _fence;
+        request.value           = _value;
+        request.continuation    = std::move(_continuation);
+        request.hasDeadline     = _timeoutMs != GpuFenceInfinite;
+        request.deadline        = std::chrono::steady_clock::now() + std::chrono::milliseconds(request.hasDeadline ? _timeoutMs : 0);
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_pending.push_back(std::move(request));
+        }
+        m_waiter.Wake();
+    }
+
+    // Blocks until every continuation enqueued so far has run. Not from a continuation.
+    void Drain()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_drained.wait(lock, [this]() { return m_pending.empty() && m_running == 0; });
+    }
+
+    size_t Pending() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_pending.size() + m_running;
+    }
+
+    uint64_t Reached() const    { return m_reached.load(); }
+    uint64_t TimedOut() const   { return m_timedOut.load(); }
+
+private:
+    struct Request
+    {
+        IGpuFence*                              fence       = nullptr;
+        uint64_t                                value       = 0;
+        FenceContinuation                       continuation;
+        bool                                    hasDeadline = false;
+        std::chrono::steady_clock::time_point   deadline;
+        bool                                    reached     = false;
+        bool                                    registered  = false;    // With the fence, to wake m_waiter.
+    };
+
+    void ServiceLoop()
+    {
+        std::vector<Request> ready;
+        while (true)
+        {
+            uint32_t waitMs = 0;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                if (m_pending.empty() && m_stopping)
+                {
+                    return;
+                }
+
+                // Completed values are read once per fence, so every request sees the same state.
+                std::vector<std::pair<IGpuFence*, uint64_t>> completed;
+                auto now = std::chrono::steady_clock::now();
+                auto split = std::stable_partition(m_pending.begin(), m_pending.end(), [&](Request& _request)
+                {
+                    auto found = std::find_if(completed.begin(), completed.end(), [&](const std::pair<IGpuFence*, uint64_t>& _entry) { return _entry.first == _request.fence; });
+                    if (found == completed.end())
+                    {
+                        completed.push_back({ _request.fence, _request.fence->GetCompletedValue() });
+                        found = completed.end() - 1;
+                    }
+                    _request.reached = found->second >= _request.value;
+                    return !_request.reached && !(_request.hasDeadline && now >= _request.deadline);
+                });
+                std::move(split, m_pending.end(), std::back_inserter(ready));
+                m_pending.erase(split, m_pending.end());
+                m_running = ready.size();
+
+                // Nothing to run: register what is new and sleep until the nearest deadline.
+                if (ready.empty())
+                {
+                    waitMs = GpuFenceInfinite;
+                    for (Request& request : m_pending)
+                    {
+                        if (!request.registered)
+                        {
+                            request.fence->WakeOnCompletion(request.value, m_waiter);
+                            request.registered = true;
+                        }
+                        if (request.hasDeadline)
+                        {
+                            auto remaining = std::chrono::ceil<std::chrono::milliseconds>(request.deadline - now).count();
+                            waitMs = (std::min)(waitMs, static_cast<uint32_t>(remaining));
+                        }
+                    }
+                }
+            }
+
+            if (waitMs != 0)
+            {
+                m_waiter.Wait(waitMs);
+                continue;
+            }
+
+            // Stable, so requests for the same value keep their enqueue order.
+            std::stable_sort(ready.begin(), ready.end(), [](const Request& _a, const Request& _b) { return _a.value < _b.value; });
+            for (Request& request : ready)
+            {
+                request.continuation(request.reached);
+                (request.reached ? m_reached : m_timedOut)++;
+            }
+            ready.clear();
+
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_running = 0;
+            }
+            m_drained.notify_all();
+        }
+    }
+
+    GpuFenceWaiter              m_waiter;       // Woken by the fences, Enqueue and the destructor.
+    std::thread                 m_thread;
+    mutable std::mutex          m_mutex;
+    std::condition_variable     m_drained;
+    std::vector<Request>        m_pending;      // In enqueue order.
+    size_t                      m_running   = 0;
+    bool                        m_stopping  = false;
+    std::atomic<uint64_t>       m_reached{ 0 };
+    std::atomic<uint64_t>       m_timedOut{ 0 };
+};
@@ -0,0 +1,174 @@
+#pragma once
+
+// Pool of objects the GPU holds on to until a fence value, such as command allocators.
+// Acquire hands out the oldest retired item the fence has passed, creating one only when none
+// has. Retire takes an item back with the value the GPU will be done with it at; items are kept
+// in fence order, so only the front ever needs checking.
+// Memory is bounded two ways. A hard cap on the items alive at once makes Acquire wait for the
+// oldest retired item rather than create another. And a high-water mark: the most items
+// outstanding at once, acquired or not yet passed by the GPU, over the last few Trim calls.
+// Anything owned above that is idle and is destroyed, so a single heavy frame does not pin its
+// peak forever. An acquired item that turns out to be unusable is handed to Discard, which
+// destroys it rather than putting it back in line. Acquire, Retire and Discard are thread-safe.
+// Portable C++, no graphics API dependencies.
+
+#include "GpuFence.h"
+
+#include <algorithm>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+template<typename T>
+class FenceRecyclePool
+{
+public:
+    typedef std::function<bool(T* _item)> CreateFn;
+    typedef std::function<void(T& _item)> DestroyFn;
+
+    // _maxItems of 0 leaves the pool uncapped. The high-water mark is taken over _windowLength
+    // Trim calls, typically one per frame.
+    FenceRecyclePool(IGpuFence* _fence, CreateFn _create, DestroyFn _destroy, uint32_t _maxItems, uint32_t _windowLength)
+        : m_fence(_fence), m_create(std::move(_create)), m_destroy(std::move(_destroy)), m_maxItems(_maxItems),
+          m_window((std::max)(_windowLength, 1u), 0)
+    {
+    }
+
+    // Items still acquired belong to the caller; retired ones are waited for, then destroyed.
+    ~FenceRecyclePool()
+    {
+        if (!m_retired.empty())
+        {
+            m_fence->WaitForValue(m_retired.back().fence);
+        }
+        for (Retired& retired : m_retired)
+        {
+            m_destroy(retired.item);
+        }
+    }
+
+    // False if a new item could not be created.
+    bool Acquire(T* _item)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (m_retired.empty() || !m_fence->IsComplete(m_retired.front().fence))
+        {
+            if (m_maxItems == 0 || m_owned < m_maxItems)
+            {
+                // Reserve the slot, then create without holding up other threads.
+                m_owned++;
+                m_acquired++;
+                NoteOutstanding();
+                lock.unlock();
+                bool created = m_create(_item);
+                lock.lock();
+                if (!created)
+                {
+                    m_owned--;
+                    m_acquired--;
+                    return false;
+                }
+                m_created++;
+                return true;
+            }
+            if (m_retired.empty())
+            {
+                // Every item is acquired and none will come back while we wait.
+                return false;
+            }
+
+            uint64_t oldest = m_retired.front().fence;
+            m_capWaits++;
+            lock.unlock();
+            m_fence->WaitForValue(oldest);
+            lock.lock();
+        }
+
+        *_item = std::move(m_retired.front().item);
+        m_retired.pop_front();
+        m_acquired++;
+        NoteOutstanding();
+        return true;
+    }
+
+    // _fenceValue is the value the GPU is done with _item at; 0 if it was never submitted.
+    void Retire(T _item, uint64_t _fenceValue)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto position = std::upper_bound(m_retired.begin(), m_retired.end(), _fenceValue,
+                                         [](uint64_t _value, const Retired& _retired) { return _value < _retired.fence; });
+        m_retired.insert(position, Retired{ std::move(_item), _fenceValue });
+        m_acquired--;
+    }
+
+    // Destroys an acquired item instead of retiring it, e.g. one that failed to reset. The GPU must
+    // be done with it, as it is for anything Acquire hands out.
+    void Discard(T& _item)
+    {
+        m_destroy(_item);
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_owned--;
+        m_acquired--;
+        m_destroyed++;
+    }
+
+    // Closes a step of the high-water window and destroys idle items above the mark.
+    void Trim()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_window[m_windowIndex] = m_stepPeak;
+        m_windowIndex           = (m_windowIndex + 1) % m_window.size();
+        m_highWater             = *std::max_element(m_window.begin(), m_window.end());
+
+        while (m_owned > m_highWater && !m_retired.empty() && m_fence->IsComplete(m_retired.front().fence))
+        {
+            m_destroy(m_retired.front().item);
+            m_retired.pop_front();
+            m_owned--;
+            m_destroyed++;
+        }
+
+        // The next step starts from what is outstanding now, so work in flight across it counts.
+        m_stepPeak = 0;
+        NoteOutstanding();
+    }
+
+    size_t      Owned() const       { std::lock_guard<std::mutex> lock(m_mutex); return m_owned; }
+    size_t      HighWater() const   { std::lock_guard<std::mutex> lock(m_mutex); return m_highWater; }
+    uint64_t    Created() const     { std::lock_guard<std::mutex> lock(m_mutex); return m_created; }
+    uint64_t    Destroyed() const   { std::lock_guard<std::mutex> lock(m_mutex); return m_destroyed; }
+    uint64_t    CapWaits() const    { std::lock_guard<std::mutex> lock(m_mutex); return m_capWaits; }
+
+private:
+    struct Retired
+    {
+        T           item;
+        uint64_t    fence;
+    };
+
+    // Counts acquired items and retired ones the GPU has not passed yet. Called with the lock held.
+    void NoteOutstanding()
+    {
+        uint64_t completed = m_fence->GetCompletedValue();
+        auto     pending   = std::partition_point(m_retired.begin(), m_retired.end(), [completed](const Retired& _retired) { return _retired.fence <= completed; });
+        size_t   outstanding = m_acquired + static_cast<size_t>(m_retired.end() - pending);
+        m_stepPeak = (std::max)(m_stepPeak, outstanding);
+    }
+
+    IGpuFence*              m_fence;
+    CreateFn                m_create;
+    DestroyFn               m_destroy;
+    size_t                  m_maxItems;
+    mutable std::mutex      m_mutex;
+    std::deque<Retired>     m_retired;          // In fence order.
+    size_t                  m_owned         = 0;
+    size_t                  m_acquired      = 0;
+    std::vector<size_t>     m_window;           // Peak outstanding per Trim step.
+    size_t                  m_windowIndex   = 0;
+    size_t                  m_stepPeak      = 0;
+    size_t                  m_highWater     = 0;
+    uint64_t                m_created       = 0;
+    uint64_t                m_destroyed     = 0;
+    uint64_t                m_capWaits      = 0;
+};
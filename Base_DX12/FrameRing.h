@@ -0,0 +1,56 @@
+#pragma once
+
+// Frames in flight.
+// Each of the N frame slots remembers the fence value signalled when its work was submitted.
+// BeginFrame only blocks when the CPU has come round to a slot whose previous work the GPU has
+// not finished, i.e. when it is N frames ahead. Per-frame resources such as command allocators
+// are indexed by the slot BeginFrame returns.
+
+#include "GpuFence.h"
+
+#include <vector>
+
+class FrameRing
+{
+public:
+    FrameRing(IGpuFence* _fence, uint32_t _frameCount)
+        : m_fence(_fence), m_fenceValues(_frameCount, 0)
+    {
+    }
+
+    uint32_t FrameCount() const      { return static_cast<uint32_t>(m_fenceValues.size()); }
+    uint32_t CurrentFrame() const    { return m_current; }
+    uint64_t FramesSubmitted() const { return m_submitted; }
+
+    // Waits until the next slot's resources are free for reuse and returns its index.
+    uint32_t BeginFrame()
+    {
+        m_current = static_cast<uint32_t>(m_submitted % m_fenceValues.size());
+        m_fence->WaitForValue(m_fenceValues[m_current]);
+        return m_current;
+    }
+
+    // Signals the fence for the submitted frame and returns the value its resources retire at.
+    uint64_t EndFrame()
+    {
+        uint64_t value = m_fence->Signal();
+        m_fenceValues[m_current] = value;
+        m_submitted++;
+        return value;
+    }
+
+    // Fence value the given slot was last submitted with, 0 if never used.
+    uint64_t FrameFenceValue(uint32_t _frame) const { return m_fenceValues[_frame]; }
+
+    // Blocks until every submitted frame has completed, e.g. before resizing or shutdown.
+    void WaitIdle()
+    {
+        m_fence->WaitForValue(m_fence->GetLastSignaledValue());
+    }
+
+private:
+    IGpuFence*              m_fence;
+    std::vector<uint64_t>   m_fenceValues;
+    uint32_t                m_current   = 0;
+    uint64_t                m_submitted = 0;
+};
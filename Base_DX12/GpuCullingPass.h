@@ -0,0 +1,126 @@
+#pragma once
+
+// Compute culling that feeds ExecuteIndirect.
+// Objects are split into fixed-size chunks, one per indirect draw call. Each thread of the cull
+// shader tests one object's sphere and, if visible, appends its draw arguments to its chunk's
+// region of the argument buffer, bumping the chunk's count with an atomic. The draws then issue
+// one ExecuteIndirect per chunk with that count, so chunks can be drawn from parallel lists.
+// Arguments and constants follow ObjectCulling.h, which holds the matching CPU reference.
+// The caller transitions the two buffers: counts to COPY_DEST for RecordReset, both to
+// UNORDERED_ACCESS for RecordCull and to INDIRECT_ARGUMENT for drawing.
+
+#include <d3d12.h>
+#include "d3dx12.h"
+#include "HeapManager.h"
+#include "ObjectCulling.h"
+#include "PipelineStateCache.h"
+
+#include <cstring>
+#include <iostream>
+
+// Root constants of the cull shader, register b0.
+struct CullConstants
+{
+    float       planes[6][4];
+    uint32_t    objectCount;
+    uint32_t    chunkSize;
+    uint32_t    vertexCount;
+    uint32_t    padding;
+};
+
+class GpuCullingPass
+{
+public:
+    GpuCullingPass(ID3D12Device* _device, PipelineStateCache* _cache, HeapManager* _heaps, const D3D12_SHADER_BYTECODE& _computeShader, uint32_t _objectCount, uint32_t _chunkSize)
+        : m_heaps(_heaps), m_objectCount(_objectCount), m_chunkSize(_chunkSize), m_chunkCount((_objectCount + _chunkSize - 1) / _chunkSize)
+    {
+        if (!_computeShader.pShaderBytecode)
+        {
+            return;
+        }
+
+        // Constants, spheres (t0), arguments (u0) and counts (u1), all bound without descriptor heaps.
+        CD3DX12_ROOT_PARAMETER parameters[4];
+        parameters[0].InitAsConstants(sizeof(CullConstants) / sizeof(uint32_t), 0);
+        parameters[1].InitAsShaderResourceView(0);
+        parameters[2].InitAsUnorderedAccessView(0);
+        parameters[3].InitAsUnorderedAccessView(1);
+
+        CD3DX12_ROOT_SIGNATURE_DESC rootSignatureDesc;
+        rootSignatureDesc.Init(_countof(parameters), parameters, 0, nullptr, D3D12_ROOT_SIGNATURE_FLAG_NONE);
+        m_rootSignature = _cache->GetRootSignature(rootSignatureDesc);
+        if (!m_rootSignature)
+        {
+            std::cout << "Failed to create cull root signature\n";
+            return;
+        }
+
+        D3D12_COMPUTE_PIPELINE_STATE_DESC psoDesc = {};
+        psoDesc.pRootSignature  = m_rootSignature;
+        psoDesc.CS              = _computeShader;
+        if (!SUCCEEDED(_device->CreateComputePipelineState(&psoDesc, IID_PPV_ARGS(&m_pipelineState))))
+        {
+            std::cout << "Failed to create cull pipeline\n";
+            return;
+        }
+
+        D3D12_RESOURCE_FLAGS flags = D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS;
+        m_arguments = _heaps->CreateResource(CD3DX12_RESOURCE_DESC::Buffer(sizeof(IndirectDrawArguments) * _objectCount, flags), D3D12_RESOURCE_STATE_COMMON);
+        m_counts    = _heaps->CreateResource(CD3DX12_RESOURCE_DESC::Buffer(sizeof(uint32_t) * m_chunkCount, flags), D3D12_RESOURCE_STATE_COMMON);
+        if (!m_arguments || !m_counts)
+        {
+            std::cout << "Failed to create indirect argument buffers\n";
+        }
+    }
+
+    ~GpuCullingPass()
+    {
+        if (m_counts)           { m_heaps->DestroyResource(m_counts); }
+        if (m_arguments)        { m_heaps->DestroyResource(m_arguments); }
+        if (m_pipelineState)    { m_pipelineState->Release(); }
+    }
+
+    bool IsValid() const { return m_pipelineState && m_arguments && m_counts; }
+
+    // Zeroes the chunk counts from _zeros, which holds at least ChunkCount() zeroed uint32s at _offset.
+    void RecordReset(ID3D12GraphicsCommandList* _commandList, ID3D12Resource* _zeros, uint64_t _offset)
+    {
+        _commandList->CopyBufferRegion(m_counts->resource, 0, _zeros, _offset, sizeof(uint32_t) * m_chunkCount);
+    }
+
+    // _spheres holds one CullSphere per object.
+    void RecordCull(ID3D12GraphicsCommandList* _commandList, D3D12_GPU_VIRTUAL_ADDRESS _spheres, const CullPlanes& _planes, uint32_t _vertexCount)
+    {
+        CullConstants constants = {};
+        memcpy(constants.planes, _planes.planes, sizeof(constants.planes));
+        constants.objectCount   = m_objectCount;
+        constants.chunkSize     = m_chunkSize;
+        constants.vertexCount   = _vertexCount;
+
+        _commandList->SetPipelineState(m_pipelineState);
+        _commandList->SetComputeRootSignature(m_rootSignature);
+        _commandList->SetComputeRoot32BitConstants(0, sizeof(CullConstants) / sizeof(uint32_t), &constants, 0);
+        _commandList->SetComputeRootShaderResourceView(1, _spheres);
+        _commandList->SetComputeRootUnorderedAccessView(2, m_arguments->resource->GetGPUVirtualAddress());
+        _commandList->SetComputeRootUnorderedAccessView(3, m_counts->resource->GetGPUVirtualAddress());
+        _commandList->Dispatch((m_objectCount + CullGroupSize - 1) / CullGroupSize, 1, 1);
+    }
+
+    ID3D12Resource* Arguments() const   { return m_arguments ? m_arguments->resource : nullptr; }
+    ID3D12Resource* Counts() const      { return m_counts ? m_counts->resource : nullptr; }
+    uint32_t        ChunkSize() const   { return m_chunkSize; }
+    uint32_t        ChunkCount() const  { return m_chunkCount; }
+
+    // Must match numthreads in the cull shader.
+    static const uint32_t CullGroupSize = 64;
+
+private:
+    HeapManager*            m_heaps;
+    ID3D12RootSignature*    m_rootSignature = nullptr;  // Owned by the pipeline cache.
+    ID3D12PipelineState*    m_pipelineState = nullptr;
+    HeapAllocation*         m_arguments     = nullptr;
+    HeapAllocation*         m_counts        = nullptr;
+    uint32_t                m_objectCount;
+    uint32_t                m_chunkSize;
+    uint32_t                m_chunkCount;
+};
@@ -0,0 +1,101 @@
+#pragma once
+
+// Portable view of a GPU timeline fence.
+// The frame, allocation and recycling helpers only see this interface, so they can be driven by a
+// mock fence off Windows. The D3D12 implementation lives in main.cpp.
+
+#include <cstdint>
+
+#if defined(_WIN32)
+    #include <Windows.h>
+#else
+    #include <chrono>
+    #include <condition_variable>
+    #include <mutex>
+#endif
+
+static const uint32_t GpuFenceInfinite = 0xFFFFFFFF;
+
+// Lets one thread sleep until any of several fences reaches a value it was registered for, or
+// until Wake. On Windows it owns the auto-reset event D3D12 fences set through
+// SetEventOnCompletion, closed with the waiter; elsewhere test fences call Wake themselves.
+// A wake only means something may have changed: completed values must be read again after Wait.
+class GpuFenceWaiter
+{
+public:
+#if defined(_WIN32)
+    GpuFenceWaiter() : m_event(CreateEvent(nullptr, FALSE, FALSE, nullptr)) {}
+    ~GpuFenceWaiter() { CloseHandle(m_event); }
+
+    void Wake() { SetEvent(m_event); }
+
+    // Returns false on timeout.
+    bool Wait(uint32_t _timeoutMs) { return WaitForSingleObject(m_event, _timeoutMs) == WAIT_OBJECT_0; }
+
+    HANDLE Event() const { return m_event; }
+#else
+    GpuFenceWaiter() {}
+
+    void Wake()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_woken = true;
+        }
+        m_wake.notify_one();
+    }
+
+    // Returns false on timeout.
+    bool Wait(uint32_t _timeoutMs)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        auto woken = [this]() { return m_woken; };
+        if (_timeoutMs == GpuFenceInfinite)
+        {
+            m_wake.wait(lock, woken);
+        }
+        else if (!m_wake.wait_for(lock, std::chrono::milliseconds(_timeoutMs), woken))
+        {
+            return false;
+        }
+        m_woken = false;
+        return true;
+    }
+#endif
+
+    GpuFenceWaiter(const GpuFenceWaiter&) = delete;
+    GpuFenceWaiter& operator=(const GpuFenceWaiter&) = delete;
+
+private:
+#if defined(_WIN32)
+    HANDLE                  m_event;
+#else
+    std::mutex              m_mutex;
+    std::condition_variable m_wake;
+    bool                    m_woken = false;
+#endif
+};
+
+class IGpuFence
+{
+public:
+    virtual ~IGpuFence() {}
+
+    // Enqueues a signal of the next timeline value on the owning queue and returns that value.
+    virtual uint64_t Signal() = 0;
+
+    // Last value handed out by Signal().
+    virtual uint64_t GetLastSignaledValue() const = 0;
+
+    virtual uint64_t GetCompletedValue() const = 0;
+
+    // Blocks until the fence reaches _value. Returns false on timeout.
+    virtual bool WaitForValue(uint64_t _value, uint32_t _timeoutMs = GpuFenceInfinite) = 0;
+
+    // Wakes _waiter once the fence reaches _value, or straight away if it already has, without
+    // blocking. Each call is one registration, so call it once per value waited for. A registration
+    // cannot be withdrawn: destroy the waiter only once its values are reached, or never will be.
+    virtual void WakeOnCompletion(uint64_t _value, GpuFenceWaiter& _waiter) = 0;
+
+    bool IsComplete(uint64_t _value) const { return GetCompletedValue() >= _value; }
+};
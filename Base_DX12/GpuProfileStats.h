@@ -0,0 +1,248 @@
+#pragma once
+
+// Portable side of the GPU timestamp profiler.
+// GpuScopeFrame collects the scopes recorded for one frame. Each scope owns a pair of timestamp
+// queries, 2 * scope and 2 * scope + 1 within the frame's range, and names its parent explicitly
+// so scopes can be opened on one command list and closed on another, from any thread.
+// GpuProfileStats takes each frame's scopes together with the timestamps read back for them and
+// folds them into a tree of per-scope statistics, keyed by name under the parent's node, so the
+// same scope recorded every frame accumulates into one node. The most recent frames are also
+// kept as events for export in the Chrome trace format (chrome://tracing, Perfetto).
+// Timestamps are raw ticks plus a frequency, so it can be driven with synthetic data. Portable
+// C++, no graphics API dependencies.
+
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+static const uint32_t GpuScopeRoot      = 0xFFFFFFFF;
+static const uint32_t GpuScopeInvalid   = 0xFFFFFFFF;
+
+struct GpuScopeRecord
+{
+    const char* name;       // Must outlive the frame, e.g. a string literal.
+    uint32_t    parent;     // GpuScopeRoot at the top level.
+    bool        begun;
+    bool        ended;
+};
+
+class GpuScopeFrame
+{
+public:
+    explicit GpuScopeFrame(uint32_t _maxScopes) : m_maxScopes(_maxScopes) {}
+
+    void Reset(uint64_t _frameIndex)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_frameIndex = _frameIndex;
+        m_scopes.clear();
+    }
+
+    // GpuScopeInvalid once the frame is full. Thread-safe.
+    uint32_t Add(const char* _name, uint32_t _parent)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_scopes.size() >= m_maxScopes)
+        {
+            return GpuScopeInvalid;
+        }
+        m_scopes.push_back({ _name, _parent, false, false });
+        return static_cast<uint32_t>(m_scopes.size() - 1);
+    }
+
+    // Each returns false if the timestamp should not be written: invalid scope or written already.
+    bool MarkBegun(uint32_t _scope) { return Mark(_scope, &GpuScopeRecord::begun); }
+    bool MarkEnded(uint32_t _scope) { return Mark(_scope, &GpuScopeRecord::ended); }
+
+    // Not thread-safe with Add; call once recording for the frame is done.
+    const std::vector<GpuScopeRecord>&  Scopes() const      { return m_scopes; }
+    uint64_t                            FrameIndex() const  { return m_frameIndex; }
+    uint32_t                            MaxScopes() const   { return m_maxScopes; }
+
+private:
+    bool Mark(uint32_t _scope, bool GpuScopeRecord::* _flag)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (_scope >= m_scopes.size() || m_scopes[_scope].*_flag)
+        {
+            return false;
+        }
+        m_scopes[_scope].*_flag = true;
+        return true;
+    }
+
+    uint32_t                    m_maxScopes;
+    uint64_t                    m_frameIndex = 0;
+    std::vector<GpuScopeRecord> m_scopes;
+    std::mutex                  m_mutex;
+};
+
+struct GpuScopeStats
+{
+    std::string name;
+    uint32_t    parent      = GpuScopeRoot;     // Index into GpuProfileStats::Scopes().
+    uint32_t    depth       = 0;
+    uint64_t    samples     = 0;
+    double      lastMs      = 0.0;
+    double      minMs       = 0.0;
+    double      maxMs       = 0.0;
+    double      totalMs     = 0.0;
+
+    double      AverageMs() const { return samples ? totalMs / samples : 0.0; }
+};
+
+class GpuProfileStats
+{
+public:
+    // _traceFrames is how many of the most recent frames are kept for the trace.
+    explicit GpuProfileStats(uint32_t _traceFrames = 120) : m_traceFrames(_traceFrames) {}
+
+    // _timestamps holds 2 * scope count ticks, begin and end per scope. Scopes whose timestamps
+    // were not both written, or run backwards, are skipped.
+    void AddFrame(uint64_t _frameIndex, const GpuScopeRecord* _scopes, uint32_t _count, const uint64_t* _timestamps, uint64_t _frequency)
+    {
+        if (_frequency == 0)
+        {
+            return;
+        }
+
+        // Parents are always added before their children, so one pass resolves the tree.
+        std::vector<uint32_t> nodes(_count, GpuScopeRoot);
+        for (uint32_t i = 0; i < _count; i++)
+        {
+            const GpuScopeRecord& scope = _scopes[i];
+            uint64_t begin  = _timestamps[2 * i];
+            uint64_t end    = _timestamps[2 * i + 1];
+            if (!scope.begun || !scope.ended || end < begin)
+            {
+                continue;
+            }
+
+            uint32_t parent = scope.parent < i ? nodes[scope.parent] : GpuScopeRoot;
+            if (scope.parent != GpuScopeRoot && parent == GpuScopeRoot)
+            {
+                continue;   // Parent was skipped.
+            }
+
+            uint32_t node   = FindOrAddNode(parent, scope.name);
+            double   ms     = 1000.0 * static_cast<double>(end - begin) / static_cast<double>(_frequency);
+            nodes[i]        = node;
+
+            GpuScopeStats& stats = m_nodes[node];
+            stats.minMs     = stats.samples ? (ms < stats.minMs ? ms : stats.minMs) : ms;
+            stats.maxMs     = stats.samples ? (ms > stats.maxMs ? ms : stats.maxMs) : ms;
+            stats.lastMs    = ms;
+            stats.totalMs  += ms;
+            stats.samples++;
+
+            // Trace times are relative to the first timestamp seen, in microseconds.
+            if (!m_haveOrigin)
+            {
+                m_origin        = begin;
+                m_haveOrigin    = true;
+            }
+            double beginUs = begin >= m_origin ?  1e6 * static_cast<double>(begin - m_origin) / static_cast<double>(_frequency)
+                                               : -1e6 * static_cast<double>(m_origin - begin) / static_cast<double>(_frequency);
+            m_events.push_back({ node, _frameIndex, beginUs, 1000.0 * ms });
+        }
+
+        m_frames++;
+        while (!m_events.empty() && m_events.front().frame + m_traceFrames <= _frameIndex)
+        {
+            m_events.pop_front();
+        }
+    }
+
+    // Every node seen so far; parents come before their children.
+    const std::vector<GpuScopeStats>& Scopes() const { return m_nodes; }
+
+    // GpuScopeInvalid if no scope of that name has been seen under _parent.
+    uint32_t Find(uint32_t _parent, const char* _name) const
+    {
+        auto found = m_lookup.find(std::make_pair(_parent, std::string(_name)));
+        return found == m_lookup.end() ? GpuScopeInvalid : found->second;
+    }
+
+    uint64_t FramesAdded() const { return m_frames; }
+
+    // Complete ("X") events for the kept frames on a single GPU track; viewers nest them by time.
+    std::string ChromeTrace() const
+    {
+        std::string json = "{\"traceEvents\":[\n";
+        json += "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":0,\"args\":{\"name\":\"GPU\"}}";
+        for (const Event& event : m_events)
+        {
+            const GpuScopeStats& stats = m_nodes[event.node];
+            json += ",\n{\"name\":\"" + Escape(stats.name) + "\",\"cat\":\"gpu\",\"ph\":\"X\",\"pid\":0,\"tid\":0";
+            json += ",\"ts\":" + std::to_string(event.beginUs) + ",\"dur\":" + std::to_string(event.durationUs);
+            json += ",\"args\":{\"frame\":" + std::to_string(event.frame) + "}}";
+        }
+        json += "\n]}\n";
+        return json;
+    }
+
+    bool WriteChromeTrace(const std::filesystem::path& _path) const
+    {
+        std::ofstream out(_path, std::ios::binary | std::ios::trunc);
+        std::string json = ChromeTrace();
+        out.write(json.data(), json.size());
+        return static_cast<bool>(out);
+    }
+
+private:
+    struct Event
+    {
+        uint32_t    node;
+        uint64_t    frame;
+        double      beginUs;
+        double      durationUs;
+    };
+
+    uint32_t FindOrAddNode(uint32_t _parent, const char* _name)
+    {
+        auto key    = std::make_pair(_parent, std::string(_name ? _name : ""));
+        auto found  = m_lookup.find(key);
+        if (found != m_lookup.end())
+        {
+            return found->second;
+        }
+
+        GpuScopeStats stats;
+        stats.name      = key.second;
+        stats.parent    = _parent;
+        stats.depth     = _parent == GpuScopeRoot ? 0 : m_nodes[_parent].depth + 1;
+        m_nodes.push_back(stats);
+
+        uint32_t node = static_cast<uint32_t>(m_nodes.size() - 1);
+        m_lookup.emplace(std::move(key), node);
+        return node;
+    }
+
+    static std::string Escape(const std::string& _value)
+    {
+        std::string escaped;
+        for (char c : _value)
+        {
+            if (c == '"' || c == '\\')
+            {
+                escaped += '\\';
+            }
+            escaped += (static_cast<unsigned char>(c) < 0x20) ? ' ' : c;
+        }
+        return escaped;
+    }
+
+    uint32_t                                            m_traceFrames;
+    std::vector<GpuScopeStats>                          m_nodes;
+    std::map<std::pair<uint32_t, std::string>, uint32_t> m_lookup;
+    std::deque<Event>                                   m_events;
+    uint64_t                                            m_origin        = 0;
+    bool                                                m_haveOrigin    = false;
+    uint64_t                                            m_frames        = 0;
+};
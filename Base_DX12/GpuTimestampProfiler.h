@@ -0,0 +1,208 @@
+#pragma once
+
+// D3D12 timestamp queries feeding GpuProfileStats.
+// Every frame slot owns a range of a timestamp query heap and of a readback buffer. Scopes write
+// EndQuery timestamps into the slot's range as command lists are recorded, and Resolve, recorded
+// after everything else in the frame, copies them into the readback buffer. EndFrame hands the
+// readback to the fence completion service, which folds the results into the statistics on its
+// own thread as soon as the frame's fence is reached, so the render thread never reads back or
+// stalls. BeginFrame only waits for that if the slot comes round before the service got to it.
+// Ticks are converted with the direct queue's timestamp frequency; timestamps from other queue
+// types are not comparable and must not be mixed in.
+
+#include <d3d12.h>
+#include "d3dx12.h"
+#include "FenceCompletionService.h"
+#include "GpuProfileStats.h"
+
+#include <condition_variable>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+class GpuTimestampProfiler
+{
+public:
+    GpuTimestampProfiler(ID3D12Device* _device, ID3D12CommandQueue* _queue, uint32_t _frameCount, uint32_t _maxScopes)
+        : m_queriesPerFrame(2 * _maxScopes), m_pending(_frameCount, false), m_reading(_frameCount, false)
+    {
+        for (uint32_t i = 0; i < _frameCount; i++)
+        {
+            m_frames.push_back(std::make_unique<GpuScopeFrame>(_maxScopes));
+        }
+
+        if (!SUCCEEDED(_queue->GetTimestampFrequency(&m_frequency)))
+        {
+            std::cout << "Failed to query timestamp frequency\n";
+            return;
+        }
+
+        D3D12_QUERY_HEAP_DESC heapDesc = {};
+        heapDesc.Type   = D3D12_QUERY_HEAP_TYPE_TIMESTAMP;
+        heapDesc.Count  = _frameCount * m_queriesPerFrame;
+        if (!SUCCEEDED(_device->CreateQueryHeap(&heapDesc, IID_PPV_ARGS(&m_queryHeap))))
+        {
+            std::cout << "Failed to create timestamp query heap\n";
+            return;
+        }
+
+        CD3DX12_HEAP_PROPERTIES readbackHeap(D3D12_HEAP_TYPE_READBACK);
+        CD3DX12_RESOURCE_DESC   readbackDesc = CD3DX12_RESOURCE_DESC::Buffer(sizeof(uint64_t) * heapDesc.Count);
+        if (!SUCCEEDED(_device->CreateCommittedResource(&readbackHeap, D3D12_HEAP_FLAG_NONE, &readbackDesc, D3D12_RESOURCE_STATE_COPY_DEST,
+                                                        nullptr, IID_PPV_ARGS(&m_readback))))
+        {
+            std::cout << "Failed to create timestamp readback buffer\n";
+            m_queryHeap->Release();
+            m_queryHeap = nullptr;
+        }
+    }
+
+    ~GpuTimestampProfiler()
+    {
+        if (m_readback)     { m_readback->Release(); }
+        if (m_queryHeap)    { m_queryHeap->Release(); }
+    }
+
+    // Starts recording into the slot once the service has read back what it resolved last time round.
+    void BeginFrame(uint32_t _slot, uint64_t _frameIndex)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_readMutex);
+            m_readDone.wait(lock, [this, _slot]() { return !m_reading[_slot]; });
+        }
+
+        m_pending[_slot]    = false;
+        m_slot              = _slot;
+        m_frames[_slot]->Reset(_frameIndex);
+    }
+
+    // Reads the frame's timestamps back once the GPU reaches _fenceValue, the value the frame
+    // containing Resolve was submitted with. A frame that times out is dropped from the statistics.
+    void EndFrame(FenceCompletionService* _service, IGpuFence* _fence, uint64_t _fenceValue, uint32_t _timeoutMs = GpuFenceInfinite)
+    {
+        uint32_t slot = m_slot;
+        if (!m_pending[slot])
+        {
+            return;
+        }
+        m_pending[slot] = false;
+
+        {
+            std::lock_guard<std::mutex> lock(m_readMutex);
+            m_reading[slot] = true;
+        }
+        _service->Enqueue(_fence, _fenceValue, [this, slot](bool _reached)
+        {
+            if (_reached)
+            {
+                ReadBack(slot);
+            }
+            {
+                std::lock_guard<std::mutex> lock(m_readMutex);
+                m_reading[slot] = false;
+            }
+            m_readDone.notify_all();
+        }, _timeoutMs);
+    }
+
+    // Declares a scope in the current frame without writing anything. Thread-safe.
+    uint32_t AddScope(const char* _name, uint32_t _parent = GpuScopeRoot)
+    {
+        return m_queryHeap ? m_frames[m_slot]->Add(_name, _parent) : GpuScopeInvalid;
+    }
+
+    // Begin and End may be recorded on different lists, as long as those execute in order. Invalid
+    // scopes are ignored.
+    void Begin(ID3D12GraphicsCommandList* _commandList, uint32_t _scope)
+    {
+        if (m_frames[m_slot]->MarkBegun(_scope))
+        {
+            _commandList->EndQuery(m_queryHeap, D3D12_QUERY_TYPE_TIMESTAMP, Query(_scope));
+        }
+    }
+
+    void End(ID3D12GraphicsCommandList* _commandList, uint32_t _scope)
+    {
+        if (m_frames[m_slot]->MarkEnded(_scope))
+        {
+            _commandList->EndQuery(m_queryHeap, D3D12_QUERY_TYPE_TIMESTAMP, Query(_scope) + 1);
+        }
+    }
+
+    uint32_t BeginScope(ID3D12GraphicsCommandList* _commandList, const char* _name, uint32_t _parent = GpuScopeRoot)
+    {
+        uint32_t scope = AddScope(_name, _parent);
+        Begin(_commandList, scope);
+        return scope;
+    }
+
+    // Copies the frame's timestamps to the readback buffer; record it on the last list of the frame.
+    // Scopes left open are closed here so every query in the range has been written.
+    void Resolve(ID3D12GraphicsCommandList* _commandList)
+    {
+        GpuScopeFrame& frame = *m_frames[m_slot];
+        uint32_t       count = static_cast<uint32_t>(frame.Scopes().size());
+        if (!m_queryHeap || count == 0)
+        {
+            return;
+        }
+
+        for (uint32_t scope = 0; scope < count; scope++)
+        {
+            Begin(_commandList, scope);
+            End(_commandList, scope);
+        }
+
+        uint32_t first = m_slot * m_queriesPerFrame;
+        _commandList->ResolveQueryData(m_queryHeap, D3D12_QUERY_TYPE_TIMESTAMP, first, 2 * count, m_readback, sizeof(uint64_t) * first);
+        m_pending[m_slot] = true;
+    }
+
+    // A copy, as the service thread keeps adding frames.
+    GpuProfileStats Stats() const
+    {
+        std::lock_guard<std::mutex> lock(m_statsMutex);
+        return m_stats;
+    }
+
+    uint64_t Frequency() const { return m_frequency; }
+
+private:
+    UINT Query(uint32_t _scope) const { return m_slot * m_queriesPerFrame + 2 * _scope; }
+
+    // Runs on the service thread. The slot's scopes stay untouched until BeginFrame sees it done.
+    void ReadBack(uint32_t _slot)
+    {
+        const GpuScopeFrame& frame = *m_frames[_slot];
+        if (!m_readback)
+        {
+            return;
+        }
+
+        uint32_t        count   = static_cast<uint32_t>(frame.Scopes().size());
+        SIZE_T          first   = sizeof(uint64_t) * _slot * m_queriesPerFrame;
+        CD3DX12_RANGE   readRange(first, first + sizeof(uint64_t) * 2 * count);
+        CD3DX12_RANGE   writeRange(0, 0);
+        uint8_t*        mapped  = nullptr;
+        if (SUCCEEDED(m_readback->Map(0, &readRange, reinterpret_cast<void**>(&mapped))))
+        {
+            std::lock_guard<std::mutex> lock(m_statsMutex);
+            m_stats.AddFrame(frame.FrameIndex(), frame.Scopes().data(), count, reinterpret_cast<const uint64_t*>(mapped + first), m_frequency);
+            m_readback->Unmap(0, &writeRange);
+        }
+    }
+
+    ID3D12QueryHeap*                            m_queryHeap         = nullptr;
+    ID3D12Resource*                             m_readback          = nullptr;
+    uint64_t                                    m_frequency         = 0;
+    uint32_t                                    m_queriesPerFrame;
+    uint32_t                                    m_slot              = 0;
+    std::vector<std::unique_ptr<GpuScopeFrame>> m_frames;
+    std::vector<bool>                           m_pending;          // Per slot, resolved and not yet handed to the service.
+    std::vector<bool>                           m_reading;          // Per slot, waiting for the service to read it back.
+    std::mutex                                  m_readMutex;
+    std::condition_variable                     m_readDone;
+    GpuProfileStats                             m_stats;
+    mutable std::mutex                          m_statsMutex;
+};
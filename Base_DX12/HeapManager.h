@@ -0,0 +1,228 @@
+#pragma once
+
+// Placed resource heap manager.
+// Reserves large ID3D12Heap blocks and places resources in them with CreatePlacedResource, so
+// creating a resource is a suballocation instead of an implicit heap per committed resource.
+// Offsets within each heap come from a TlsfAllocator using the size and alignment the device
+// reports in D3D12_RESOURCE_ALLOCATION_INFO. Resources larger than a heap get a dedicated heap
+// that is released with them. Shared heaps are kept for the manager's lifetime: releasing or
+// compacting them would need every freed range fenced against the GPU, aliasing barriers on reuse
+// and resource pointers that callers are allowed to hold, none of which the sample needs.
+
+#include <d3d12.h>
+#include "d3dx12.h"
+#include "TlsfAllocator.h"
+
+#include <iostream>
+#include <memory>
+#include <vector>
+
+struct HeapAllocation
+{
+    ID3D12Resource*         resource    = nullptr;
+    uint32_t                heap        = 0;
+    uint64_t                offset      = 0;
+    uint64_t                size        = 0;
+    uint32_t                block       = TlsfInvalid;
+    uint32_t                index       = 0;        // Position in the manager's allocation list.
+};
+
+class HeapManager
+{
+public:
+    HeapManager(ID3D12Device* _device, D3D12_HEAP_TYPE _type, D3D12_HEAP_FLAGS _flags, uint64_t _heapSize)
+        : m_device(_device), m_type(_type), m_flags(_flags), m_heapSize(_heapSize)
+    {
+    }
+
+    ~HeapManager()
+    {
+        for (HeapAllocation* allocation : m_allocations)
+        {
+            allocation->resource->Release();
+            delete allocation;
+        }
+        for (Heap& heap : m_heaps)
+        {
+            if (heap.heap)
+            {
+                heap.heap->Release();
+            }
+        }
+    }
+
+    HeapAllocation* CreateResource(const D3D12_RESOURCE_DESC& _desc, D3D12_RESOURCE_STATES _state, const D3D12_CLEAR_VALUE* _clearValue = nullptr)
+    {
+        D3D12_RESOURCE_ALLOCATION_INFO info = m_device->GetResourceAllocationInfo(0, 1, &_desc);
+        if (info.SizeInBytes == UINT64_MAX)
+        {
+            std::cout << "Invalid resource description for placed resource\n";
+            return nullptr;
+        }
+
+        HeapAllocation* allocation = new HeapAllocation();
+        if (!Reserve(info, allocation))
+        {
+            bool     dedicated  = info.SizeInBytes > m_heapSize;
+            uint64_t alignment  = HeapAlignment(info.Alignment);
+            uint64_t size       = dedicated ? (info.SizeInBytes + alignment - 1) & ~(alignment - 1) : m_heapSize;
+            uint32_t heap       = AddHeap(size, alignment, dedicated);
+            if (heap == TlsfInvalid || !ReserveIn(heap, info, allocation))
+            {
+                delete allocation;
+                return nullptr;
+            }
+        }
+
+        if (!SUCCEEDED(m_device->CreatePlacedResource(m_heaps[allocation->heap].heap, allocation->offset, &_desc, _state, _clearValue, IID_PPV_ARGS(&allocation->resource))))
+        {
+            std::cout << "Failed to create placed resource\n";
+            FreeBlock(allocation);
+            delete allocation;
+            return nullptr;
+        }
+
+        allocation->index = static_cast<uint32_t>(m_allocations.size());
+        m_allocations.push_back(allocation);
+        return allocation;
+    }
+
+    // The GPU must be done with the resource.
+    void DestroyResource(HeapAllocation* _allocation)
+    {
+        _allocation->resource->Release();
+        FreeBlock(_allocation);
+
+        HeapAllocation* last = m_allocations.back();
+        m_allocations[_allocation->index] = last;
+        last->index = _allocation->index;
+        m_allocations.pop_back();
+        delete _allocation;
+    }
+
+    uint32_t HeapCount() const
+    {
+        uint32_t count = 0;
+        for (const Heap& heap : m_heaps)
+        {
+            count += heap.heap ? 1 : 0;
+        }
+        return count;
+    }
+
+    uint64_t ReservedBytes() const
+    {
+        uint64_t bytes = 0;
+        for (const Heap& heap : m_heaps)
+        {
+            bytes += heap.heap ? heap.allocator->Size() : 0;
+        }
+        return bytes;
+    }
+
+    uint64_t UsedBytes() const
+    {
+        uint64_t bytes = 0;
+        for (const Heap& heap : m_heaps)
+        {
+            bytes += heap.heap ? heap.allocator->UsedBytes() : 0;
+        }
+        return bytes;
+    }
+
+    size_t AllocationCount() const { return m_allocations.size(); }
+
+private:
+    struct Heap
+    {
+        ID3D12Heap*                     heap        = nullptr;
+        std::unique_ptr<TlsfAllocator>  allocator;
+        bool                            dedicated   = false;
+    };
+
+    // Heaps that may hold MSAA render targets need the larger placement alignment.
+    uint64_t HeapAlignment(uint64_t _resourceAlignment) const
+    {
+        bool msaa = _resourceAlignment > D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT || !(m_flags & D3D12_HEAP_FLAG_DENY_RT_DS_TEXTURES);
+        return msaa ? D3D12_DEFAULT_MSAA_RESOURCE_PLACEMENT_ALIGNMENT : D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+    }
+
+    uint32_t AddHeap(uint64_t _size, uint64_t _alignment, bool _dedicated)
+    {
+        CD3DX12_HEAP_DESC heapDesc(_size, m_type, _alignment, m_flags);
+
+        Heap heap;
+        if (!SUCCEEDED(m_device->CreateHeap(&heapDesc, IID_PPV_ARGS(&heap.heap))))
+        {
+            std::cout << "Failed to create heap\n";
+            return TlsfInvalid;
+        }
+        heap.allocator.reset(new TlsfAllocator(_size));
+        heap.dedicated = _dedicated;
+
+        // Reuse a slot left by a released heap so indices held by allocations stay valid.
+        for (uint32_t i = 0; i < m_heaps.size(); i++)
+        {
+            if (!m_heaps[i].heap)
+            {
+                m_heaps[i] = std::move(heap);
+                return i;
+            }
+        }
+        m_heaps.push_back(std::move(heap));
+        return static_cast<uint32_t>(m_heaps.size() - 1);
+    }
+
+    void ReleaseHeap(uint32_t _heap)
+    {
+        m_heaps[_heap].heap->Release();
+        m_heaps[_heap] = Heap();
+    }
+
+    // First shared heap with room for the resource.
+    bool Reserve(const D3D12_RESOURCE_ALLOCATION_INFO& _info, HeapAllocation* _allocation)
+    {
+        for (uint32_t i = 0; i < m_heaps.size(); i++)
+        {
+            if (m_heaps[i].heap && !m_heaps[i].dedicated && ReserveIn(i, _info, _allocation))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool ReserveIn(uint32_t _heap, const D3D12_RESOURCE_ALLOCATION_INFO& _info, HeapAllocation* _allocation)
+    {
+        TlsfAllocation tlsf;
+        if (!m_heaps[_heap].allocator->Allocate(_info.SizeInBytes, _info.Alignment, &tlsf))
+        {
+            return false;
+        }
+
+        _allocation->heap   = _heap;
+        _allocation->offset = tlsf.offset;
+        _allocation->size   = tlsf.size;
+        _allocation->block  = tlsf.block;
+        return true;
+    }
+
+    void FreeBlock(HeapAllocation* _allocation)
+    {
+        Heap& heap = m_heaps[_allocation->heap];
+        heap.allocator->Free(_allocation->block);
+        _allocation->block = TlsfInvalid;
+        if (heap.dedicated)
+        {
+            ReleaseHeap(_allocation->heap);
+        }
+    }
+
+    ID3D12Device*                   m_device;
+    D3D12_HEAP_TYPE                 m_type;
+    D3D12_HEAP_FLAGS                m_flags;
+    uint64_t                        m_heapSize;
+
+    std::vector<Heap>               m_heaps;            // Released dedicated heaps leave an empty slot.
+    std::vector<HeapAllocation*>    m_allocations;
+};
@@ -0,0 +1,236 @@
+#pragma once
+
+// Small work-stealing job system.
+// Every worker owns a deque: it pushes and pops its own jobs at the back and steals from the front
+// of the others when it runs dry. Jobs receive the index of the thread running them so callers can
+// keep per-thread state, e.g. one command list and allocator per worker, without locking. A
+// thread outside the pool that waits on a counter helps run jobs and uses index WorkerCount();
+// there is one such slot, so external waiters take turns at it. With nothing left to run a waiter
+// sleeps until new work is queued or the counter drains, rather than spinning.
+// Portable C++, no graphics API dependencies.
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+typedef std::function<void(uint32_t _threadIndex)> Job;
+
+// Tracks a group of jobs; Wait returns once all of them have run.
+struct JobCounter
+{
+    std::atomic<uint32_t> pending{ 0 };
+};
+
+class JobSystem
+{
+public:
+    // 0 picks one worker per hardware thread, less the calling thread.
+    explicit JobSystem(uint32_t _workerCount = 0)
+    {
+        if (_workerCount == 0)
+        {
+            uint32_t hw = std::thread::hardware_concurrency();
+            _workerCount = hw > 1 ? hw - 1 : 1;
+        }
+
+        // One extra queue for jobs pushed from threads outside the pool.
+        for (uint32_t i = 0; i <= _workerCount; i++)
+        {
+            m_queues.push_back(std::make_unique<WorkerQueue>());
+        }
+        for (uint32_t i = 0; i < _workerCount; i++)
+        {
+            m_threads.emplace_back([this, i] { WorkerLoop(i); });
+        }
+    }
+
+    ~JobSystem()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_sleepMutex);
+            m_running = false;
+        }
+        m_wake.notify_all();
+        for (std::thread& thread : m_threads)
+        {
+            thread.join();
+        }
+    }
+
+    // Number of pool threads. Thread indices passed to jobs go up to and including this value.
+    uint32_t WorkerCount() const { return static_cast<uint32_t>(m_threads.size()); }
+
+    void Submit(JobCounter& _counter, Job _job)
+    {
+        _counter.pending.fetch_add(1, std::memory_order_relaxed);
+
+        Task task = { std::move(_job), &_counter };
+        WorkerQueue& queue = *m_queues[CurrentQueue()];
+        {
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            queue.tasks.push_back(std::move(task));
+        }
+
+        // Taking the sleep mutex orders the increment against a worker about to sleep.
+        m_queued.fetch_add(1, std::memory_order_release);
+        {
+            std::lock_guard<std::mutex> lock(m_sleepMutex);
+        }
+        m_wake.notify_one();
+    }
+
+    // Runs other jobs on the calling thread until the counter drains. Threads outside the pool
+    // all run jobs as index WorkerCount(), so only one of them waits at a time and the others
+    // block here until it is done; a job waiting again on the thread that holds the slot keeps it.
+    void Wait(JobCounter& _counter)
+    {
+        uint32_t                     threadIndex = CurrentQueue();
+        std::unique_lock<std::mutex> externalSlot(m_externalMutex, std::defer_lock);
+        const JobSystem*             previousOwner = t_externalOwner;
+        if (threadIndex == WorkerCount() && t_externalOwner != this)
+        {
+            externalSlot.lock();
+            t_externalOwner = this;
+        }
+
+        while (_counter.pending.load(std::memory_order_acquire) != 0)
+        {
+            Task task;
+            if (TryGetTask(threadIndex, task))
+            {
+                Run(task, threadIndex);
+                continue;
+            }
+
+            // The remaining jobs are running elsewhere. Run signals when a counter drains.
+            std::unique_lock<std::mutex> lock(m_sleepMutex);
+            m_wake.wait(lock, [this, &_counter]
+            {
+                return _counter.pending.load(std::memory_order_acquire) == 0 || m_queued.load(std::memory_order_acquire) > 0;
+            });
+        }
+
+        t_externalOwner = previousOwner;
+    }
+
+    // Calls _body(index, threadIndex) for every index in [0, _count) and waits for all of them.
+    void ParallelFor(uint32_t _count, const std::function<void(uint32_t _index, uint32_t _threadIndex)>& _body)
+    {
+        JobCounter counter;
+        for (uint32_t i = 0; i < _count; i++)
+        {
+            Submit(counter, [&_body, i](uint32_t _threadIndex) { _body(i, _threadIndex); });
+        }
+        Wait(counter);
+    }
+
+private:
+    struct Task
+    {
+        Job         job;
+        JobCounter* counter = nullptr;
+    };
+
+    struct WorkerQueue
+    {
+        std::mutex          mutex;
+        std::deque<Task>    tasks;
+    };
+
+    // Queue index of the calling thread; threads outside the pool share the last queue and index.
+    uint32_t CurrentQueue() const
+    {
+        return t_workerIndex >= 0 && t_owner == this ? static_cast<uint32_t>(t_workerIndex) : WorkerCount();
+    }
+
+    bool TryGetTask(uint32_t _queueIndex, Task& _task)
+    {
+        // Own queue first, newest job, for cache locality.
+        {
+            WorkerQueue& own = *m_queues[_queueIndex];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if (!own.tasks.empty())
+            {
+                _task = std::move(own.tasks.back());
+                own.tasks.pop_back();
+                m_queued.fetch_sub(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+
+        // Steal the oldest job from someone else.
+        uint32_t queueCount = static_cast<uint32_t>(m_queues.size());
+        for (uint32_t offset = 1; offset < queueCount; offset++)
+        {
+            WorkerQueue& victim = *m_queues[(_queueIndex + offset) % queueCount];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.tasks.empty())
+            {
+                _task = std::move(victim.tasks.front());
+                victim.tasks.pop_front();
+                m_queued.fetch_sub(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    void Run(Task& _task, uint32_t _threadIndex)
+    {
+        _task.job(_threadIndex);
+
+        // The counter may be gone as soon as it drains, so only the sleep mutex is touched after.
+        if (_task.counter->pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_sleepMutex);
+            }
+            m_wake.notify_all();
+        }
+    }
+
+    void WorkerLoop(uint32_t _index)
+    {
+        t_workerIndex   = static_cast<int32_t>(_index);
+        t_owner         = this;
+
+        while (true)
+        {
+            Task task;
+            if (TryGetTask(_index, task))
+            {
+                Run(task, _index);
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(m_sleepMutex);
+            m_wake.wait(lock, [this] { return !m_running || m_queued.load(std::memory_order_acquire) > 0; });
+            if (!m_running)
+            {
+                return;
+            }
+        }
+    }
+
+    std::vector<std::unique_ptr<WorkerQueue>>   m_queues;
+    std::vector<std::thread>                    m_threads;
+    std::atomic<int32_t>                        m_queued{ 0 };
+    std::mutex                                  m_sleepMutex;
+    std::condition_variable                     m_wake;
+    bool                                        m_running = true;
+    std::mutex                                  m_externalMutex;            // Held by the external thread in Wait.
+
+    static thread_local int32_t                 t_workerIndex;
+    static thread_local const JobSystem*        t_owner;
+    static thread_local const JobSystem*        t_externalOwner;            // Pool whose external slot this thread holds.
+};
+
+inline thread_local int32_t          JobSystem::t_workerIndex   = -1;
+inline thread_local const JobSystem* JobSystem::t_owner         = nullptr;
+inline thread_local const JobSystem* JobSystem::t_externalOwner = nullptr;
@@ -0,0 +1,193 @@
+#pragma once
+
+// CPU reference for the compute culling pass.
+// Objects are bounding spheres tested against six normalised frustum planes. Every visible object
+// becomes one draw argument, DrawInstanced of a single instance starting at the object's index, so
+// per-object data comes from an instance-rate vertex buffer with no per-draw root constants. The
+// arguments match D3D12_DRAW_ARGUMENTS and the sphere layout matches the float4 the shader reads.
+// CullSpheres tests four spheres at a time with SSE and falls back to the scalar loop elsewhere;
+// both evaluate the plane distance in the same order, so they agree exactly. The GPU compacts with
+// an atomic counter, so its output is only equal up to order and, right on a plane, rounding;
+// CountCullMismatches compares on those terms. Portable C++, no graphics API dependencies.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iterator>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define OBJECT_CULLING_SSE 1
+#include <emmintrin.h>
+#endif
+
+struct CullSphere
+{
+    float x, y, z, radius;
+};
+
+struct IndirectDrawArguments
+{
+    uint32_t vertexCountPerInstance;
+    uint32_t instanceCount;
+    uint32_t startVertexLocation;
+    uint32_t startInstanceLocation;
+};
+
+// Inside when a * x + b * y + c * z + d >= 0.
+struct CullPlanes
+{
+    float planes[6][4];
+};
+
+// Extracts the frustum of a row-major view-projection matrix applied to row vectors, as in
+// DirectXMath, with D3D clip depth [0, 1].
+static void CullPlanesFromMatrix(const float _m[16], CullPlanes* _planes)
+{
+    // Column j of the matrix is the clip coordinate j as a plane.
+    auto column = [&](int _j, int _k) { return _m[_k * 4 + _j]; };
+    for (int k = 0; k < 4; k++)
+    {
+        _planes->planes[0][k] = column(3, k) + column(0, k);    // Left
+        _planes->planes[1][k] = column(3, k) - column(0, k);    // Right
+        _planes->planes[2][k] = column(3, k) + column(1, k);    // Bottom
+        _planes->planes[3][k] = column(3, k) - column(1, k);    // Top
+        _planes->planes[4][k] = column(2, k);                   // Near
+        _planes->planes[5][k] = column(3, k) - column(2, k);    // Far
+    }
+
+    for (float* plane : _planes->planes)
+    {
+        float length = std::sqrt(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+        if (length > 0.0f)
+        {
+            for (int k = 0; k < 4; k++)
+            {
+                plane[k] /= length;
+            }
+        }
+    }
+}
+
+static inline float CullPlaneDistance(const float* _plane, const CullSphere& _sphere)
+{
+    return ((_plane[0] * _sphere.x + _plane[1] * _sphere.y) + _plane[2] * _sphere.z) + _plane[3];
+}
+
+static inline bool CullSphereVisible(const CullPlanes& _planes, const CullSphere& _sphere)
+{
+    for (const float* plane : _planes.planes)
+    {
+        if (CullPlaneDistance(plane, _sphere) < -_sphere.radius)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static inline void CullWriteDraw(uint32_t _object, uint32_t _vertexCount, IndirectDrawArguments* _arguments)
+{
+    _arguments->vertexCountPerInstance  = _vertexCount;
+    _arguments->instanceCount           = 1;
+    _arguments->startVertexLocation     = 0;
+    _arguments->startInstanceLocation   = _object;
+}
+
+// Culls spheres [_first, _first + _count) and writes a draw per visible one to _arguments, in object
+// order. Returns the number written.
+static uint32_t CullSpheresScalar(const CullSphere* _spheres, uint32_t _first, uint32_t _count, const CullPlanes& _planes,
+                                  uint32_t _vertexCount, IndirectDrawArguments* _arguments)
+{
+    uint32_t visible = 0;
+    for (uint32_t i = _first; i < _first + _count; i++)
+    {
+        if (CullSphereVisible(_planes, _spheres[i]))
+        {
+            CullWriteDraw(i, _vertexCount, &_arguments[visible++]);
+        }
+    }
+    return visible;
+}
+
+static uint32_t CullSpheres(const CullSphere* _spheres, uint32_t _first, uint32_t _count, const CullPlanes& _planes,
+                            uint32_t _vertexCount, IndirectDrawArguments* _arguments)
+{
+#if OBJECT_CULLING_SSE
+    __m128 planes[6][4];
+    for (int p = 0; p < 6; p++)
+    {
+        for (int k = 0; k < 4; k++)
+        {
+            planes[p][k] = _mm_set1_ps(_planes.planes[p][k]);
+        }
+    }
+    const __m128 signBit = _mm_set1_ps(-0.0f);
+
+    uint32_t visible = 0;
+    uint32_t end     = _first + _count;
+    uint32_t i       = _first;
+    for (; i + 4 <= end; i += 4)
+    {
+        // Four spheres to structure of arrays: x, y, z and radius lanes.
+        __m128 x = _mm_loadu_ps(&_spheres[i + 0].x);
+        __m128 y = _mm_loadu_ps(&_spheres[i + 1].x);
+        __m128 z = _mm_loadu_ps(&_spheres[i + 2].x);
+        __m128 r = _mm_loadu_ps(&_spheres[i + 3].x);
+        _MM_TRANSPOSE4_PS(x, y, z, r);
+        __m128 negRadius = _mm_xor_ps(r, signBit);
+
+        __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for (int p = 0; p < 6; p++)
+        {
+            __m128 distance = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(planes[p][0], x), _mm_mul_ps(planes[p][1], y)),
+                                                    _mm_mul_ps(planes[p][2], z)),
+                                         planes[p][3]);
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negRadius));
+        }
+
+        int mask = _mm_movemask_ps(inside);
+        while (mask)
+        {
+            int lane = 0;
+            while (!(mask & (1 << lane)))
+            {
+                lane++;
+            }
+            mask &= mask - 1;
+            CullWriteDraw(i + lane, _vertexCount, &_arguments[visible++]);
+        }
+    }
+    return visible + CullSpheresScalar(_spheres, i, end - i, _planes, _vertexCount, _arguments + visible);
+#else
+    return CullSpheresScalar(_spheres, _first, _count, _planes, _vertexCount, _arguments);
+#endif
+}
+
+// Objects drawn by exactly one of the two outputs whose sphere is further than _epsilon from every
+// plane it was tested against, i.e. real disagreements rather than rounding at a boundary.
+static uint32_t CountCullMismatches(const CullSphere* _spheres, const CullPlanes& _planes,
+                                    const IndirectDrawArguments* _a, uint32_t _countA,
+                                    const IndirectDrawArguments* _b, uint32_t _countB, float _epsilon)
+{
+    std::vector<uint32_t> a, b;
+    for (uint32_t i = 0; i < _countA; i++) { a.push_back(_a[i].startInstanceLocation); }
+    for (uint32_t i = 0; i < _countB; i++) { b.push_back(_b[i].startInstanceLocation); }
+    std::sort(a.begin(), a.end());
+    std::sort(b.begin(), b.end());
+
+    std::vector<uint32_t> differing;
+    std::set_symmetric_difference(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(differing));
+
+    uint32_t mismatches = 0;
+    for (uint32_t object : differing)
+    {
+        bool boundary = false;
+        for (const float* plane : _planes.planes)
+        {
+            boundary = boundary || std::fabs(CullPlaneDistance(plane, _spheres[object]) + _spheres[object].radius) <= _epsilon;
+        }
+        mismatches += boundary ? 0 : 1;
+    }
+    return mismatches;
+}
@@ -0,0 +1,161 @@
+#pragma once
+
+// Portable parts of the pipeline state cache.
+// Fnv1aHasher builds the 64-bit keys pipelines and root signatures are cached under. Structures
+// are fed in field by field so padding never reaches the hash. PipelineCacheFile is the on-disk
+// form: the driver's serialized pipeline library as an opaque blob, plus serialized root
+// signatures keyed by the hash of their description. Portable C++, no graphics API dependencies.
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+class Fnv1aHasher
+{
+public:
+    Fnv1aHasher& Bytes(const void* _data, size_t _size)
+    {
+        const uint8_t* bytes = static_cast<const uint8_t*>(_data);
+        for (size_t i = 0; i < _size; i++)
+        {
+            m_hash = (m_hash ^ bytes[i]) * 1099511628211ull;
+        }
+        return *this;
+    }
+
+    // Only for types without padding.
+    template<typename T>
+    Fnv1aHasher& Value(const T& _value)
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "Hash plain values only");
+        return Bytes(&_value, sizeof(T));
+    }
+
+    // Null and empty strings hash differently.
+    Fnv1aHasher& String(const char* _value)
+    {
+        uint8_t present = _value ? 1 : 0;
+        Value(present);
+        while (_value && *_value)
+        {
+            Value(*_value++);
+        }
+        return Value(uint8_t(0));
+    }
+
+    uint64_t Hash() const { return m_hash; }
+
+private:
+    uint64_t m_hash = 14695981039346656037ull;
+};
+
+static const uint32_t PipelineCacheMagic   = 0x43435350; // "PSCC"
+static const uint32_t PipelineCacheVersion = 1;
+
+struct PipelineCacheFile
+{
+    std::vector<uint8_t>                                library;
+    std::unordered_map<uint64_t, std::vector<uint8_t>>  rootSignatures;
+
+    // Fails, leaving the contents empty, when the file is missing or malformed.
+    bool Load(const std::filesystem::path& _path)
+    {
+        library.clear();
+        rootSignatures.clear();
+
+        std::error_code ec;
+        uint64_t        fileSize = std::filesystem::file_size(_path, ec);
+        std::ifstream   in(_path, std::ios::binary);
+        uint32_t magic = 0, version = 0, count = 0;
+        if (ec || !in || !ReadPod(in, magic) || !ReadPod(in, version) || magic != PipelineCacheMagic || version != PipelineCacheVersion)
+        {
+            return false;
+        }
+
+        if (!ReadBlob(in, fileSize, library) || !ReadPod(in, count))
+        {
+            library.clear();
+            return false;
+        }
+
+        for (uint32_t i = 0; i < count; i++)
+        {
+            uint64_t                hash = 0;
+            std::vector<uint8_t>    blob;
+            if (!ReadPod(in, hash) || !ReadBlob(in, fileSize, blob))
+            {
+                library.clear();
+                rootSignatures.clear();
+                return false;
+            }
+            rootSignatures[hash] = std::move(blob);
+        }
+        return true;
+    }
+
+    // Writes next to the destination and renames, so a crash never leaves a torn cache behind.
+    bool Save(const std::filesystem::path& _path) const
+    {
+        std::filesystem::path temp = _path;
+        temp += ".tmp";
+        {
+            std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+            if (!out)
+            {
+                return false;
+            }
+
+            WritePod(out, PipelineCacheMagic);
+            WritePod(out, PipelineCacheVersion);
+            WriteBlob(out, library);
+            WritePod(out, static_cast<uint32_t>(rootSignatures.size()));
+            for (const auto& rootSignature : rootSignatures)
+            {
+                WritePod(out, rootSignature.first);
+                WriteBlob(out, rootSignature.second);
+            }
+            if (!out)
+            {
+                return false;
+            }
+        }
+
+        std::error_code ec;
+        std::filesystem::rename(temp, _path, ec);
+        return !ec;
+    }
+
+private:
+    template<typename T>
+    static void WritePod(std::ofstream& _out, const T& _value)
+    {
+        _out.write(reinterpret_cast<const char*>(&_value), sizeof(T));
+    }
+
+    static void WriteBlob(std::ofstream& _out, const std::vector<uint8_t>& _blob)
+    {
+        WritePod(_out, static_cast<uint64_t>(_blob.size()));
+        _out.write(reinterpret_cast<const char*>(_blob.data()), _blob.size());
+    }
+
+    template<typename T>
+    static bool ReadPod(std::ifstream& _in, T& _value)
+    {
+        return static_cast<bool>(_in.read(reinterpret_cast<char*>(&_value), sizeof(T)));
+    }
+
+    // A size past the end of the file is corruption, and is rejected before anything is allocated.
+    static bool ReadBlob(std::ifstream& _in, uint64_t _fileSize, std::vector<uint8_t>& _blob)
+    {
+        uint64_t size = 0;
+        if (!ReadPod(_in, size) || size > _fileSize - static_cast<uint64_t>(_in.tellg()))
+        {
+            return false;
+        }
+        _blob.resize(static_cast<size_t>(size));
+        return static_cast<bool>(_in.read(reinterpret_cast<char*>(_blob.data()), _blob.size()));
+    }
+};
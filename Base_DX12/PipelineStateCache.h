@@ -0,0 +1,347 @@
+#pragma once
+
+// Persistent pipeline state cache.
+// Root signatures are serialized once and their blobs kept on disk, keyed by a hash of the
+// description. Graphics pipelines are keyed by a hash of the whole description, with shader
+// bytecode and input layout contents in place of their pointers, and stored in an
+// ID3D12PipelineLibrary that is written back to disk with Save. Warm runs load pipelines from
+// the library instead of compiling them.
+// Pipelines are requested asynchronously: misses compile on the job system while the caller
+// carries on, and every request for the same description shares one result. The cache owns the
+// root signatures and pipelines it returns; callers must not release them.
+
+#include <d3d12.h>
+#include "d3dx12.h"
+#include "JobSystem.h"
+#include "PipelineCacheFile.h"
+
+#include <atomic>
+#include <cwchar>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+static uint64_t HashRootSignatureDesc(const D3D12_ROOT_SIGNATURE_DESC& _desc)
+{
+    Fnv1aHasher hasher;
+    hasher.Value(_desc.NumParameters).Value(_desc.NumStaticSamplers).Value(_desc.Flags);
+    for (UINT i = 0; i < _desc.NumParameters; i++)
+    {
+        const D3D12_ROOT_PARAMETER& parameter = _desc.pParameters[i];
+        hasher.Value(parameter.ParameterType).Value(parameter.ShaderVisibility);
+        switch (parameter.ParameterType)
+        {
+        case D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE:
+            hasher.Value(parameter.DescriptorTable.NumDescriptorRanges);
+            hasher.Bytes(parameter.DescriptorTable.pDescriptorRanges, parameter.DescriptorTable.NumDescriptorRanges * sizeof(D3D12_DESCRIPTOR_RANGE));
+            break;
+        case D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS:
+            hasher.Value(parameter.Constants);
+            break;
+        default:
+            hasher.Value(parameter.Descriptor);
+            break;
+        }
+    }
+    hasher.Bytes(_desc.pStaticSamplers, _desc.NumStaticSamplers * sizeof(D3D12_STATIC_SAMPLER_DESC));
+    return hasher.Hash();
+}
+
+// _rootSignatureHash stands in for the root signature pointer.
+static uint64_t HashGraphicsPipelineDesc(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& _desc, uint64_t _rootSignatureHash)
+{
+    Fnv1aHasher hasher;
+    hasher.Value(_rootSignatureHash);
+
+    const D3D12_SHADER_BYTECODE* shaders[] = { &_desc.VS, &_desc.PS, &_desc.DS, &_desc.HS, &_desc.GS };
+    for (const D3D12_SHADER_BYTECODE* shader : shaders)
+    {
+        hasher.Value(static_cast<uint64_t>(shader->BytecodeLength));
+        hasher.Bytes(shader->pShaderBytecode, shader->BytecodeLength);
+    }
+
+    hasher.Value(_desc.StreamOutput.NumEntries).Value(_desc.StreamOutput.NumStrides).Value(_desc.StreamOutput.RasterizedStream);
+    for (UINT i = 0; i < _desc.StreamOutput.NumEntries; i++)
+    {
+        const D3D12_SO_DECLARATION_ENTRY& entry = _desc.StreamOutput.pSODeclaration[i];
+        hasher.Value(entry.Stream).String(entry.SemanticName).Value(entry.SemanticIndex);
+        hasher.Value(entry.StartComponent).Value(entry.ComponentCount).Value(entry.OutputSlot);
+    }
+    hasher.Bytes(_desc.StreamOutput.pBufferStrides, _desc.StreamOutput.NumStrides * sizeof(UINT));
+
+    hasher.Value(_desc.BlendState.AlphaToCoverageEnable).Value(_desc.BlendState.IndependentBlendEnable);
+    for (const D3D12_RENDER_TARGET_BLEND_DESC& blend : _desc.BlendState.RenderTarget)
+    {
+        hasher.Value(blend.BlendEnable).Value(blend.LogicOpEnable);
+        hasher.Value(blend.SrcBlend).Value(blend.DestBlend).Value(blend.BlendOp);
+        hasher.Value(blend.SrcBlendAlpha).Value(blend.DestBlendAlpha).Value(blend.BlendOpAlpha);
+        hasher.Value(blend.LogicOp).Value(blend.RenderTargetWriteMask);
+    }
+
+    hasher.Value(_desc.SampleMask).Value(_desc.RasterizerState);
+
+    const D3D12_DEPTH_STENCIL_DESC& depth = _desc.DepthStencilState;
+    hasher.Value(depth.DepthEnable).Value(depth.DepthWriteMask).Value(depth.DepthFunc);
+    hasher.Value(depth.StencilEnable).Value(depth.StencilReadMask).Value(depth.StencilWriteMask);
+    hasher.Value(depth.FrontFace).Value(depth.BackFace);
+
+    hasher.Value(_desc.InputLayout.NumElements);
+    for (UINT i = 0; i < _desc.InputLayout.NumElements; i++)
+    {
+        const D3D12_INPUT_ELEMENT_DESC& element = _desc.InputLayout.pInputElementDescs[i];
+        hasher.String(element.SemanticName).Value(element.SemanticIndex).Value(element.Format).Value(element.InputSlot);
+        hasher.Value(element.AlignedByteOffset).Value(element.InputSlotClass).Value(element.InstanceDataStepRate);
+    }
+
+    hasher.Value(_desc.IBStripCutValue).Value(_desc.PrimitiveTopologyType).Value(_desc.NumRenderTargets);
+    hasher.Value(_desc.RTVFormats).Value(_desc.DSVFormat).Value(_desc.SampleDesc).Value(_desc.NodeMask).Value(_desc.Flags);
+    return hasher.Hash();
+}
+
+// A pipeline description with copies of everything it points to, so it can outlive the caller's data.
+struct OwnedGraphicsPipelineDesc
+{
+    explicit OwnedGraphicsPipelineDesc(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& _desc) : desc(_desc)
+    {
+        D3D12_SHADER_BYTECODE* shaders[] = { &desc.VS, &desc.PS, &desc.DS, &desc.HS, &desc.GS };
+        for (int i = 0; i < 5; i++)
+        {
+            const uint8_t* bytecode = static_cast<const uint8_t*>(shaders[i]->pShaderBytecode);
+            bytecodes[i].assign(bytecode, bytecode + shaders[i]->BytecodeLength);
+            shaders[i]->pShaderBytecode = bytecodes[i].data();
+        }
+
+        for (UINT i = 0; i < desc.InputLayout.NumElements; i++)
+        {
+            semanticNames.push_back(desc.InputLayout.pInputElementDescs[i].SemanticName);
+            inputElements.push_back(desc.InputLayout.pInputElementDescs[i]);
+        }
+        for (UINT i = 0; i < desc.StreamOutput.NumEntries; i++)
+        {
+            semanticNames.push_back(desc.StreamOutput.pSODeclaration[i].SemanticName ? desc.StreamOutput.pSODeclaration[i].SemanticName : "");
+            soEntries.push_back(desc.StreamOutput.pSODeclaration[i]);
+        }
+        soStrides.assign(desc.StreamOutput.pBufferStrides, desc.StreamOutput.pBufferStrides + desc.StreamOutput.NumStrides);
+
+        // Names are fixed up once the vector has stopped growing.
+        for (UINT i = 0; i < inputElements.size(); i++)
+        {
+            inputElements[i].SemanticName = semanticNames[i].c_str();
+        }
+        for (UINT i = 0; i < soEntries.size(); i++)
+        {
+            soEntries[i].SemanticName = desc.StreamOutput.pSODeclaration[i].SemanticName ? semanticNames[inputElements.size() + i].c_str() : nullptr;
+        }
+
+        desc.InputLayout.pInputElementDescs = inputElements.data();
+        desc.StreamOutput.pSODeclaration    = soEntries.data();
+        desc.StreamOutput.pBufferStrides    = soStrides.data();
+        desc.CachedPSO                      = {};
+    }
+
+    D3D12_GRAPHICS_PIPELINE_STATE_DESC      desc;
+    std::vector<uint8_t>                    bytecodes[5];
+    std::vector<std::string>                semanticNames;
+    std::vector<D3D12_INPUT_ELEMENT_DESC>   inputElements;
+    std::vector<D3D12_SO_DECLARATION_ENTRY> soEntries;
+    std::vector<UINT>                       soStrides;
+};
+
+class PipelineStateCache
+{
+public:
+    PipelineStateCache(ID3D12Device* _device, const std::filesystem::path& _path, JobSystem* _jobSystem)
+        : m_device(_device), m_path(_path), m_jobSystem(_jobSystem)
+    {
+        m_file.Load(m_path);
+
+        // Pipeline libraries need ID3D12Device1; without one pipelines are still shared in memory.
+        if (SUCCEEDED(_device->QueryInterface(IID_PPV_ARGS(&m_device1))))
+        {
+            HRESULT hr = m_device1->CreatePipelineLibrary(m_file.library.data(), m_file.library.size(), IID_PPV_ARGS(&m_library));
+            if (!SUCCEEDED(hr) && !m_file.library.empty())
+            {
+                // Driver or adapter changed since the library was written: start an empty one.
+                std::cout << "Discarding stale pipeline library\n";
+                m_file.library.clear();
+                m_dirty = true;
+                hr = m_device1->CreatePipelineLibrary(nullptr, 0, IID_PPV_ARGS(&m_library));
+            }
+            if (!SUCCEEDED(hr))
+            {
+                m_library = nullptr;
+            }
+        }
+    }
+
+    ~PipelineStateCache()
+    {
+        m_jobSystem->Wait(m_pending);
+        for (auto& pipeline : m_pipelines)
+        {
+            ID3D12PipelineState* pipelineState = pipeline.second.get();
+            if (pipelineState)
+            {
+                pipelineState->Release();
+            }
+        }
+        for (auto& rootSignature : m_rootSignatures)
+        {
+            rootSignature.second->Release();
+        }
+        if (m_library) { m_library->Release(); }
+        if (m_device1) { m_device1->Release(); }
+    }
+
+    ID3D12RootSignature* GetRootSignature(const D3D12_ROOT_SIGNATURE_DESC& _desc)
+    {
+        uint64_t hash = HashRootSignatureDesc(_desc);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto cached = m_rootSignatures.find(hash);
+        if (cached != m_rootSignatures.end())
+        {
+            return cached->second;
+        }
+
+        std::vector<uint8_t>& blob = m_file.rootSignatures[hash];
+        if (blob.empty())
+        {
+            ID3DBlob* signature = nullptr;
+            ID3DBlob* error     = nullptr;
+            if (!SUCCEEDED(D3D12SerializeRootSignature(&_desc, D3D_ROOT_SIGNATURE_VERSION_1, &signature, &error)))
+            {
+                if (error) { error->Release(); }
+                m_file.rootSignatures.erase(hash);
+                return nullptr;
+            }
+            const uint8_t* bytes = static_cast<const uint8_t*>(signature->GetBufferPointer());
+            blob.assign(bytes, bytes + signature->GetBufferSize());
+            signature->Release();
+            m_dirty = true;
+        }
+
+        ID3D12RootSignature* rootSignature = nullptr;
+        if (!SUCCEEDED(m_device->CreateRootSignature(0, blob.data(), blob.size(), IID_PPV_ARGS(&rootSignature))))
+        {
+            m_file.rootSignatures.erase(hash);
+            return nullptr;
+        }
+
+        m_rootSignatures[hash]                  = rootSignature;
+        m_rootSignatureHashes[rootSignature]    = hash;
+        return rootSignature;
+    }
+
+    // The root signature must have come from GetRootSignature. The result is null if creation failed.
+    std::shared_future<ID3D12PipelineState*> RequestGraphicsPipeline(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& _desc)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        auto rootSignature = m_rootSignatureHashes.find(_desc.pRootSignature);
+        if (rootSignature == m_rootSignatureHashes.end())
+        {
+            std::cout << "Pipeline root signature is not cached\n";
+            std::promise<ID3D12PipelineState*> failed;
+            failed.set_value(nullptr);
+            return failed.get_future().share();
+        }
+
+        uint64_t hash   = HashGraphicsPipelineDesc(_desc, rootSignature->second);
+        auto     cached = m_pipelines.find(hash);
+        if (cached != m_pipelines.end())
+        {
+            return cached->second;
+        }
+
+        auto promise    = std::make_shared<std::promise<ID3D12PipelineState*>>();
+        auto owned      = std::make_shared<OwnedGraphicsPipelineDesc>(_desc);
+        std::shared_future<ID3D12PipelineState*> result = promise->get_future().share();
+        m_pipelines[hash] = result;
+
+        m_jobSystem->Submit(m_pending, [this, hash, promise, owned](uint32_t)
+        {
+            promise->set_value(LoadOrCreate(hash, owned->desc));
+        });
+        return result;
+    }
+
+    // Writes the library and root signatures back to disk if anything was added.
+    bool Save()
+    {
+        m_jobSystem->Wait(m_pending);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_dirty)
+        {
+            return true;
+        }
+
+        if (m_library)
+        {
+            // The library may still reference the loaded blob, so serialize into a new one.
+            std::vector<uint8_t> library(m_library->GetSerializedSize());
+            if (!SUCCEEDED(m_library->Serialize(library.data(), library.size())))
+            {
+                return false;
+            }
+            m_savedLibraries.push_back(std::move(m_file.library));
+            m_file.library = std::move(library);
+        }
+
+        m_dirty = !m_file.Save(m_path);
+        return !m_dirty;
+    }
+
+    uint32_t Hits() const   { return m_hits.load(); }
+    uint32_t Misses() const { return m_misses.load(); }
+
+private:
+    ID3D12PipelineState* LoadOrCreate(uint64_t _hash, const D3D12_GRAPHICS_PIPELINE_STATE_DESC& _desc)
+    {
+        wchar_t name[32];
+        swprintf_s(name, L"pso_%016llx", static_cast<unsigned long long>(_hash));
+
+        ID3D12PipelineState* pipelineState = nullptr;
+        if (m_library && SUCCEEDED(m_library->LoadGraphicsPipeline(name, &_desc, IID_PPV_ARGS(&pipelineState))))
+        {
+            m_hits++;
+            return pipelineState;
+        }
+
+        m_misses++;
+        if (!SUCCEEDED(m_device->CreateGraphicsPipelineState(&_desc, IID_PPV_ARGS(&pipelineState))))
+        {
+            std::cout << "Failed to create pipeline state\n";
+            return nullptr;
+        }
+
+        if (m_library && SUCCEEDED(m_library->StorePipeline(name, pipelineState)))
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_dirty = true;
+        }
+        return pipelineState;
+    }
+
+    ID3D12Device*                                                       m_device;
+    ID3D12Device1*                                                      m_device1   = nullptr;
+    ID3D12PipelineLibrary*                                              m_library   = nullptr;
+    std::filesystem::path                                               m_path;
+    JobSystem*                                                          m_jobSystem;
+    JobCounter                                                          m_pending;
+
+    PipelineCacheFile                                                   m_file;
+    std::vector<std::vector<uint8_t>>                                   m_savedLibraries;   // Blobs the library was created from.
+    bool                                                                m_dirty     = false;
+    std::unordered_map<uint64_t, ID3D12RootSignature*>                  m_rootSignatures;
+    std::unordered_map<ID3D12RootSignature*, uint64_t>                  m_rootSignatureHashes;
+    std::unordered_map<uint64_t, std::shared_future<ID3D12PipelineState*>> m_pipelines;
+    std::atomic<uint32_t>                                               m_hits{ 0 };
+    std::atomic<uint32_t>                                               m_misses{ 0 };
+    std::mutex                                                          m_mutex;
+};
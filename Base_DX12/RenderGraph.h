@@ -0,0 +1,405 @@
+#pragma once
+
+// Render graph barrier compiler.
+// Passes declare the resources they read and write and the state each access needs. Compile then
+//  - culls passes whose results are never consumed,
+//  - works out each resource's lifetime and lets transient resources with disjoint lifetimes share
+//    memory, adding aliasing barriers where one takes over from another,
+//  - merges consecutive reads into one combined read state, and emits the minimal transitions and
+//    UAV barriers, batched per pass. When passes separate two uses, the transition is split so
+//    the GPU can overlap it with the work in between.
+// States and barriers are backend-agnostic; the D3D12 translation lives in main.cpp. Passes are
+// recorded by the caller, which applies each pass's before and after batches around its commands.
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+enum GraphState : uint32_t
+{
+    GraphStateCommon            = 0,
+    GraphStatePresent           = 1 << 0,
+    GraphStateVertexBuffer      = 1 << 1,
+    GraphStateIndexBuffer       = 1 << 2,
+    GraphStateConstantBuffer    = 1 << 3,
+    GraphStateShaderResource    = 1 << 4,
+    GraphStateIndirectArgument  = 1 << 5,
+    GraphStateCopySource        = 1 << 6,
+    GraphStateDepthRead         = 1 << 7,
+    GraphStateRenderTarget      = 1 << 8,
+    GraphStateUnorderedAccess   = 1 << 9,
+    GraphStateDepthWrite        = 1 << 10,
+    GraphStateCopyDest          = 1 << 11,
+};
+
+enum class GraphBarrierType : uint8_t
+{
+    Transition,
+    Aliasing,
+    Uav,
+};
+
+enum class GraphSplit : uint8_t
+{
+    None,
+    Begin,
+    End,
+};
+
+static const uint32_t GraphInvalid = 0xFFFFFFFF;
+
+struct GraphBarrier
+{
+    GraphBarrierType    type            = GraphBarrierType::Transition;
+    GraphSplit          split           = GraphSplit::None;
+    uint32_t            resource        = GraphInvalid;
+    uint32_t            resourceBefore  = GraphInvalid;     // Aliasing only: the resource whose memory is taken over.
+    uint32_t            before          = GraphStateCommon;
+    uint32_t            after           = GraphStateCommon;
+};
+
+struct CompiledPass
+{
+    bool                        live = false;
+    std::vector<GraphBarrier>   before;     // Recorded ahead of the pass's commands.
+    std::vector<GraphBarrier>   after;      // Recorded after them.
+};
+
+struct CompiledResource
+{
+    bool        used        = false;
+    uint32_t    firstPass   = GraphInvalid;
+    uint32_t    lastPass    = GraphInvalid;
+    uint64_t    offset      = 0;                    // Transients: placement within the transient heap.
+    uint32_t    createState = GraphStateCommon;     // Transients: state to create the resource in.
+};
+
+class RenderGraph
+{
+public:
+    // A resource that lives outside the graph, such as the back buffer. It enters in _initialState
+    // and is left in _finalState.
+    uint32_t Import(const char* _name, uint32_t _initialState, uint32_t _finalState)
+    {
+        Resource resource;
+        resource.name           = _name;
+        resource.initialState   = _initialState;
+        resource.finalState     = _finalState;
+        m_resources.push_back(resource);
+        return static_cast<uint32_t>(m_resources.size() - 1);
+    }
+
+    // A resource only used within the graph. Its memory may be shared with other transients.
+    uint32_t CreateTransient(const char* _name, uint64_t _size, uint64_t _alignment)
+    {
+        Resource resource;
+        resource.name       = _name;
+        resource.transient  = true;
+        resource.size       = _size;
+        resource.alignment  = _alignment;
+        m_resources.push_back(resource);
+        return static_cast<uint32_t>(m_resources.size() - 1);
+    }
+
+    // Passes run in the order they are added. Side effect passes are never culled.
+    uint32_t AddPass(const char* _name, bool _sideEffect = false)
+    {
+        Pass pass;
+        pass.name       = _name;
+        pass.sideEffect = _sideEffect;
+        m_passes.push_back(pass);
+        return static_cast<uint32_t>(m_passes.size() - 1);
+    }
+
+    void Read(uint32_t _pass, uint32_t _resource, uint32_t _state)  { AddAccess(_pass, _resource, _state, false); }
+    void Write(uint32_t _pass, uint32_t _resource, uint32_t _state) { AddAccess(_pass, _resource, _state, true); }
+
+    // Backend object for a resource, e.g. this frame's back buffer. Only used by the translation.
+    void    Bind(uint32_t _resource, void* _native)     { m_resources[_resource].native = _native; }
+    void*   Native(uint32_t _resource) const            { return m_resources[_resource].native; }
+
+    void Compile(bool _splitBarriers = true)
+    {
+        m_compiledPasses.assign(m_passes.size(), CompiledPass());
+        m_compiledResources.assign(m_resources.size(), CompiledResource());
+        m_transientHeapSize = 0;
+
+        CullPasses();
+        std::vector<std::vector<Use>> uses = BuildUses();
+        PlaceTransients(uses);
+
+        uint32_t lastLive = GraphInvalid;
+        for (uint32_t p = 0; p < m_passes.size(); p++)
+        {
+            lastLive = m_compiledPasses[p].live ? p : lastLive;
+        }
+
+        for (uint32_t r = 0; r < m_resources.size(); r++)
+        {
+            const std::vector<Use>& resourceUses = uses[r];
+            if (resourceUses.empty())
+            {
+                continue;
+            }
+
+            // Transients are created in the state of their first use.
+            uint32_t state = m_resources[r].transient ? resourceUses[0].state : m_resources[r].initialState;
+            for (size_t u = 0; u < resourceUses.size(); u++)
+            {
+                const Use& use = resourceUses[u];
+                if (use.state != state)
+                {
+                    uint32_t previous = u > 0 ? resourceUses[u - 1].lastPass : GraphInvalid;
+                    AddTransition(r, state, use.state, previous, use.firstPass, _splitBarriers);
+                }
+                else if (u > 0 && (use.state & GraphStateUnorderedAccess))
+                {
+                    // Back to back UAV accesses still need their writes ordered.
+                    GraphBarrier barrier;
+                    barrier.type        = GraphBarrierType::Uav;
+                    barrier.resource    = r;
+                    m_compiledPasses[use.firstPass].before.push_back(barrier);
+                }
+                state = use.state;
+            }
+
+            if (!m_resources[r].transient && state != m_resources[r].finalState)
+            {
+                // The final transition closes the graph; begin it as soon as the resource is done with.
+                uint32_t last = resourceUses.back().lastPass;
+                if (_splitBarriers && last != lastLive)
+                {
+                    m_compiledPasses[last].after.push_back(MakeTransition(r, state, m_resources[r].finalState, GraphSplit::Begin));
+                    m_compiledPasses[lastLive].after.push_back(MakeTransition(r, state, m_resources[r].finalState, GraphSplit::End));
+                }
+                else
+                {
+                    m_compiledPasses[lastLive].after.push_back(MakeTransition(r, state, m_resources[r].finalState, GraphSplit::None));
+                }
+            }
+        }
+    }
+
+    const CompiledPass&     GetCompiledPass(uint32_t _pass) const           { return m_compiledPasses[_pass]; }
+    const CompiledResource& GetCompiledResource(uint32_t _resource) const   { return m_compiledResources[_resource]; }
+    uint64_t                TransientHeapSize() const                       { return m_transientHeapSize; }
+    uint32_t                PassCount() const                               { return static_cast<uint32_t>(m_passes.size()); }
+    uint32_t                ResourceCount() const                           { return static_cast<uint32_t>(m_resources.size()); }
+    const std::string&      PassName(uint32_t _pass) const                  { return m_passes[_pass].name; }
+    const std::string&      ResourceName(uint32_t _resource) const          { return m_resources[_resource].name; }
+
+private:
+    struct Access
+    {
+        uint32_t    resource;
+        uint32_t    state;
+        bool        write;
+    };
+
+    struct Pass
+    {
+        std::string         name;
+        bool                sideEffect = false;
+        std::vector<Access> accesses;
+    };
+
+    struct Resource
+    {
+        std::string name;
+        bool        transient       = false;
+        uint64_t    size            = 0;
+        uint64_t    alignment       = 1;
+        uint32_t    initialState    = GraphStateCommon;
+        uint32_t    finalState      = GraphStateCommon;
+        void*       native          = nullptr;
+    };
+
+    // A run of live passes that use a resource in one state: a single write, or consecutive reads.
+    struct Use
+    {
+        uint32_t    firstPass;
+        uint32_t    lastPass;
+        uint32_t    state;
+        bool        write;
+    };
+
+    void AddAccess(uint32_t _pass, uint32_t _resource, uint32_t _state, bool _write)
+    {
+        // A pass touches each resource once: reads merge, and a write replaces any read.
+        for (Access& access : m_passes[_pass].accesses)
+        {
+            if (access.resource == _resource)
+            {
+                if (_write)
+                {
+                    access.state = _state;
+                    access.write = true;
+                }
+                else if (!access.write)
+                {
+                    access.state |= _state;
+                }
+                return;
+            }
+        }
+        m_passes[_pass].accesses.push_back({ _resource, _state, _write });
+    }
+
+    // Walks backwards keeping passes whose writes reach an imported resource, a side effect, or a
+    // read of a pass already kept.
+    void CullPasses()
+    {
+        std::vector<bool> needed(m_resources.size(), false);
+        for (uint32_t r = 0; r < m_resources.size(); r++)
+        {
+            needed[r] = !m_resources[r].transient;
+        }
+
+        for (uint32_t p = static_cast<uint32_t>(m_passes.size()); p-- > 0;)
+        {
+            bool live = m_passes[p].sideEffect;
+            for (const Access& access : m_passes[p].accesses)
+            {
+                live = live || (access.write && needed[access.resource]);
+            }
+            if (!live)
+            {
+                continue;
+            }
+
+            m_compiledPasses[p].live = true;
+            for (const Access& access : m_passes[p].accesses)
+            {
+                needed[access.resource] = needed[access.resource] || !access.write;
+            }
+        }
+    }
+
+    std::vector<std::vector<Use>> BuildUses()
+    {
+        std::vector<std::vector<Use>> uses(m_resources.size());
+        for (uint32_t p = 0; p < m_passes.size(); p++)
+        {
+            if (!m_compiledPasses[p].live)
+            {
+                continue;
+            }
+
+            for (const Access& access : m_passes[p].accesses)
+            {
+                std::vector<Use>& resourceUses = uses[access.resource];
+                if (!access.write && !resourceUses.empty() && !resourceUses.back().write)
+                {
+                    resourceUses.back().lastPass    = p;
+                    resourceUses.back().state      |= access.state;
+                }
+                else
+                {
+                    resourceUses.push_back({ p, p, access.state, access.write });
+                }
+
+                CompiledResource& compiled = m_compiledResources[access.resource];
+                compiled.used       = true;
+                compiled.firstPass  = compiled.firstPass == GraphInvalid ? p : compiled.firstPass;
+                compiled.lastPass   = p;
+            }
+        }
+        return uses;
+    }
+
+    // Greedy placement: each transient, in order of first use, takes the smallest block whose last
+    // owner is already dead, or a new block at the end of the heap.
+    void PlaceTransients(const std::vector<std::vector<Use>>& _uses)
+    {
+        struct Block
+        {
+            uint64_t offset;
+            uint64_t size;
+            uint32_t owner;
+        };
+        std::vector<Block> blocks;
+
+        std::vector<uint32_t> order;
+        for (uint32_t r = 0; r < m_resources.size(); r++)
+        {
+            if (m_resources[r].transient && m_compiledResources[r].used)
+            {
+                order.push_back(r);
+            }
+        }
+        std::sort(order.begin(), order.end(), [this](uint32_t _a, uint32_t _b) { return m_compiledResources[_a].firstPass < m_compiledResources[_b].firstPass; });
+
+        for (uint32_t r : order)
+        {
+            const Resource&     resource    = m_resources[r];
+            CompiledResource&   compiled    = m_compiledResources[r];
+            compiled.createState            = _uses[r][0].state;
+
+            Block* best = nullptr;
+            for (Block& block : blocks)
+            {
+                bool dead       = m_compiledResources[block.owner].lastPass < compiled.firstPass;
+                bool fits       = block.size >= resource.size && (block.offset & (resource.alignment - 1)) == 0;
+                bool smaller    = !best || block.size < best->size;
+                best            = dead && fits && smaller ? &block : best;
+            }
+
+            if (best)
+            {
+                GraphBarrier barrier;
+                barrier.type            = GraphBarrierType::Aliasing;
+                barrier.resource        = r;
+                barrier.resourceBefore  = best->owner;
+                m_compiledPasses[compiled.firstPass].before.push_back(barrier);
+
+                compiled.offset = best->offset;
+                best->owner     = r;
+            }
+            else
+            {
+                uint64_t offset = (m_transientHeapSize + resource.alignment - 1) & ~(resource.alignment - 1);
+                compiled.offset     = offset;
+                m_transientHeapSize = offset + resource.size;
+                blocks.push_back({ offset, resource.size, r });
+            }
+        }
+    }
+
+    static GraphBarrier MakeTransition(uint32_t _resource, uint32_t _before, uint32_t _after, GraphSplit _split)
+    {
+        GraphBarrier barrier;
+        barrier.type        = GraphBarrierType::Transition;
+        barrier.split       = _split;
+        barrier.resource    = _resource;
+        barrier.before      = _before;
+        barrier.after       = _after;
+        return barrier;
+    }
+
+    // Splits the transition when live passes run between the previous use and the next.
+    void AddTransition(uint32_t _resource, uint32_t _before, uint32_t _after, uint32_t _previousPass, uint32_t _nextPass, bool _split)
+    {
+        bool gap = false;
+        for (uint32_t p = _previousPass + 1; _previousPass != GraphInvalid && p < _nextPass && !gap; p++)
+        {
+            gap = m_compiledPasses[p].live;
+        }
+
+        if (_split && gap)
+        {
+            m_compiledPasses[_previousPass].after.push_back(MakeTransition(_resource, _before, _after, GraphSplit::Begin));
+            m_compiledPasses[_nextPass].before.push_back(MakeTransition(_resource, _before, _after, GraphSplit::End));
+        }
+        else
+        {
+            m_compiledPasses[_nextPass].before.push_back(MakeTransition(_resource, _before, _after, GraphSplit::None));
+        }
+    }
+
+    std::vector<Pass>               m_passes;
+    std::vector<Resource>           m_resources;
+    std::vector<CompiledPass>       m_compiledPasses;
+    std::vector<CompiledResource>   m_compiledResources;
+    uint64_t                        m_transientHeapSize = 0;
+};
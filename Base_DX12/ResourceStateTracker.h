@@ -0,0 +1,335 @@
+#pragma once
+
+// Resource state tracking across command lists.
+// ResourceStateTable holds the state every resource, or each of its subresources, is known to be
+// in between submissions. Each command list records through its own CommandStateTracker, which
+// only knows what that list has done: the first time a list touches a resource its incoming state
+// is unknown, so the request is kept as pending instead of guessing a barrier. Later requests in
+// the same list become batched barriers, and requests for the state already held, or for a read
+// the current read state already covers, are dropped. A split transition begun with
+// BeginTransition is ended by the next request for that resource, or by EndSplits before the list
+// closes, so a list never hands a resource on mid-transition.
+// At submit, ResolveSubmission settles every list's pending requests against the table, drops the
+// ones that are already satisfied, and commits each list's final states. Fixups for resources no
+// earlier list in the submission touched are merged into a single batch ahead of the first list;
+// the rest must run directly before their own list.
+// States are opaque bitmasks, e.g. D3D12_RESOURCE_STATES. Portable C++, no graphics API dependencies.
+
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Matches D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES.
+static const uint32_t StateAllSubresources  = 0xFFFFFFFF;
+static const uint32_t StateUnknown          = 0xFFFFFFFF;
+
+// Match D3D12_RESOURCE_BARRIER_FLAG_BEGIN_ONLY and D3D12_RESOURCE_BARRIER_FLAG_END_ONLY.
+static const uint32_t StateSplitNone        = 0;
+static const uint32_t StateSplitBegin       = 1;
+static const uint32_t StateSplitEnd         = 2;
+
+struct StateTransition
+{
+    void*       resource;
+    uint32_t    subresource;
+    uint32_t    before;
+    uint32_t    after;
+    uint32_t    split = StateSplitNone;
+};
+
+class CommandStateTracker
+{
+public:
+    // _readStates are the states that only read and may be combined into one.
+    explicit CommandStateTracker(uint32_t _readStates) : m_readStates(_readStates) {}
+
+    // Requests _state for one subresource, or all of them, of a resource with _subresourceCount subresources.
+    void Transition(void* _resource, uint32_t _subresourceCount, uint32_t _subresource, uint32_t _state)
+    {
+        std::vector<uint32_t>& states = m_known[_resource];
+        if (states.empty())
+        {
+            states.assign(_subresourceCount, StateUnknown);
+        }
+        EndSplit(_resource, states);
+
+        if (_subresource != StateAllSubresources)
+        {
+            TransitionOne(_resource, states, _subresource, _state);
+            return;
+        }
+
+        // The whole resource in one barrier when every subresource agrees.
+        bool uniform = true;
+        for (uint32_t s = 1; s < states.size() && uniform; s++)
+        {
+            uniform = states[s] == states[0];
+        }
+        if (!uniform)
+        {
+            for (uint32_t s = 0; s < states.size(); s++)
+            {
+                TransitionOne(_resource, states, s, _state);
+            }
+            return;
+        }
+
+        uint32_t current = states[0];
+        if (current == StateUnknown)
+        {
+            m_pending.push_back({ _resource, StateAllSubresources, StateUnknown, _state });
+        }
+        else if (!Satisfies(current, _state))
+        {
+            m_barriers.push_back({ _resource, StateAllSubresources, current, _state });
+        }
+        else
+        {
+            return;
+        }
+        states.assign(states.size(), _state);
+    }
+
+    // Starts moving the whole resource to _state so the GPU can overlap it with later work. Only
+    // begins when this list knows the state it starts from; otherwise the transition happens in
+    // full wherever the resource is next requested.
+    void BeginTransition(void* _resource, uint32_t _state)
+    {
+        auto known = m_known.find(_resource);
+        if (known == m_known.end() || m_splits.count(_resource))
+        {
+            return;
+        }
+
+        const std::vector<uint32_t>& states = known->second;
+        for (uint32_t state : states)
+        {
+            if (state != states[0])
+            {
+                return;
+            }
+        }
+        if (states[0] == StateUnknown || Satisfies(states[0], _state))
+        {
+            return;
+        }
+
+        StateTransition split = { _resource, StateAllSubresources, states[0], _state, StateSplitBegin };
+        m_barriers.push_back(split);
+        m_splits[_resource] = split;
+    }
+
+    // Ends every split still open; call before the list closes.
+    void EndSplits()
+    {
+        for (auto& known : m_known)
+        {
+            EndSplit(known.first, known.second);
+        }
+    }
+
+    // Barriers recorded since the last ClearBarriers, to be flushed as one batch.
+    const std::vector<StateTransition>& Barriers() const    { return m_barriers; }
+    void                                ClearBarriers()     { m_barriers.clear(); }
+
+    // Forgets everything; call when the list is reset for recording.
+    void Reset()
+    {
+        m_known.clear();
+        m_pending.clear();
+        m_barriers.clear();
+        m_splits.clear();
+    }
+
+private:
+    friend class ResourceStateTable;
+
+    bool Satisfies(uint32_t _current, uint32_t _requested) const
+    {
+        if (_current == _requested)
+        {
+            return true;
+        }
+        bool currentReadOnly = (_current & ~m_readStates) == 0 && _current != 0;
+        return currentReadOnly && _requested != 0 && (_requested & ~_current) == 0;
+    }
+
+    void EndSplit(void* _resource, std::vector<uint32_t>& _states)
+    {
+        auto split = m_splits.find(_resource);
+        if (split == m_splits.end())
+        {
+            return;
+        }
+
+        StateTransition end = split->second;
+        end.split = StateSplitEnd;
+        m_barriers.push_back(end);
+        _states.assign(_states.size(), end.after);
+        m_splits.erase(split);
+    }
+
+    void TransitionOne(void* _resource, std::vector<uint32_t>& _states, uint32_t _subresource, uint32_t _state)
+    {
+        uint32_t current = _states[_subresource];
+        if (current == StateUnknown)
+        {
+            m_pending.push_back({ _resource, _subresource, StateUnknown, _state });
+        }
+        else if (!Satisfies(current, _state))
+        {
+            m_barriers.push_back({ _resource, _subresource, current, _state });
+        }
+        else
+        {
+            return;
+        }
+        _states[_subresource] = _state;
+    }
+
+    uint32_t                                            m_readStates;
+    std::unordered_map<void*, std::vector<uint32_t>>    m_known;        // Per subresource, StateUnknown until first touched.
+    std::vector<StateTransition>                        m_pending;      // First requests, incoming state unknown.
+    std::vector<StateTransition>                        m_barriers;
+    std::unordered_map<void*, StateTransition>          m_splits;       // Begun and not yet ended.
+};
+
+class ResourceStateTable
+{
+public:
+    void Register(void* _resource, uint32_t _subresourceCount, uint32_t _state)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_states[_resource].assign(_subresourceCount, _state);
+    }
+
+    void Unregister(void* _resource)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_states.erase(_resource);
+    }
+
+    // StateUnknown for resources that are not registered.
+    uint32_t GetState(void* _resource, uint32_t _subresource) const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto found = m_states.find(_resource);
+        return found == m_states.end() ? StateUnknown : found->second[_subresource == StateAllSubresources ? 0 : _subresource];
+    }
+
+    // Settles the pending requests of lists submitted together, in submission order. (*_fixups)[k]
+    // must execute directly before list k; most fixups land in (*_fixups)[0].
+    void ResolveSubmission(CommandStateTracker* const* _lists, size_t _count, std::vector<std::vector<StateTransition>>* _fixups)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        _fixups->assign(_count, std::vector<StateTransition>());
+
+        std::unordered_set<void*> touched;
+        for (size_t k = 0; k < _count; k++)
+        {
+            CommandStateTracker& list = *_lists[k];
+            for (const StateTransition& pending : list.m_pending)
+            {
+                auto found = m_states.find(pending.resource);
+                if (found == m_states.end())
+                {
+                    // Unregistered: adopt the list's view of it.
+                    continue;
+                }
+
+                std::vector<StateTransition>& fixups = (*_fixups)[touched.count(pending.resource) ? k : 0];
+                AddFixups(list, pending, found->second, &fixups);
+            }
+
+            for (auto& known : list.m_known)
+            {
+                std::vector<uint32_t>& states = m_states[known.first];
+                if (states.size() != known.second.size())
+                {
+                    states.assign(known.second.size(), StateUnknown);
+                }
+                for (size_t s = 0; s < states.size(); s++)
+                {
+                    states[s] = known.second[s] != StateUnknown ? known.second[s] : states[s];
+                }
+                touched.insert(known.first);
+            }
+        }
+    }
+
+private:
+    // A request the table's state already satisfies, such as a read covered by a combined read
+    // state, needs no fixup as long as the list left the subresource there. The list then commits
+    // the combined state rather than the narrower one it asked for, which is what the GPU has.
+    static bool Covered(const CommandStateTracker& _list, const StateTransition& _pending, uint32_t _subresource, uint32_t _current)
+    {
+        return _current == _pending.after ||
+            (_list.Satisfies(_current, _pending.after) && _list.m_known.at(_pending.resource)[_subresource] == _pending.after);
+    }
+
+    static void Adopt(CommandStateTracker& _list, const StateTransition& _pending, uint32_t _subresource, uint32_t _current)
+    {
+        if (_current != _pending.after)
+        {
+            _list.m_known[_pending.resource][_subresource] = _current;
+        }
+    }
+
+    static void AddFixups(CommandStateTracker& _list, const StateTransition& _pending, const std::vector<uint32_t>& _states, std::vector<StateTransition>* _fixups)
+    {
+        if (_pending.subresource != StateAllSubresources)
+        {
+            uint32_t current = _states[_pending.subresource];
+            if (Covered(_list, _pending, _pending.subresource, current))
+            {
+                Adopt(_list, _pending, _pending.subresource, current);
+            }
+            else
+            {
+                _fixups->push_back({ _pending.resource, _pending.subresource, current, _pending.after });
+            }
+            return;
+        }
+
+        bool uniform = true;
+        for (size_t s = 1; s < _states.size() && uniform; s++)
+        {
+            uniform = _states[s] == _states[0];
+        }
+        if (uniform)
+        {
+            bool covered = true;
+            for (uint32_t s = 0; s < _states.size() && covered; s++)
+            {
+                covered = Covered(_list, _pending, s, _states[0]);
+            }
+            if (!covered)
+            {
+                _fixups->push_back({ _pending.resource, StateAllSubresources, _states[0], _pending.after });
+                return;
+            }
+            for (uint32_t s = 0; s < _states.size(); s++)
+            {
+                Adopt(_list, _pending, s, _states[0]);
+            }
+            return;
+        }
+
+        for (uint32_t s = 0; s < _states.size(); s++)
+        {
+            if (Covered(_list, _pending, s, _states[s]))
+            {
+                Adopt(_list, _pending, s, _states[s]);
+            }
+            else
+            {
+                _fixups->push_back({ _pending.resource, s, _states[s], _pending.after });
+            }
+        }
+    }
+
+    std::unordered_map<void*, std::vector<uint32_t>>    m_states;
+    mutable std::mutex                                  m_mutex;
+};
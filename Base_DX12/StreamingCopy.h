@@ -0,0 +1,298 @@
+#pragma once
+
+// Row copies into upload memory.
+// Upload heaps are write-combined: the CPU never reads them back, so copying through the cache
+// only evicts useful lines. StreamCopy writes with non-temporal stores instead, after aligning the
+// destination to a cache line with a plain memcpy. The store width is picked at runtime with
+// cpuid: AVX-512, AVX2, else SSE2, so one build uses the widest the machine has without /arch or
+// -m flags. Copies too small to fill a write-combining buffer go through memcpy.
+// CopySubresourceRows copies the rows of a subresource as laid out by MemcpySubresource in
+// d3dx12.h. When both sides are tightly packed the rows form one span, copied as a whole;
+// otherwise rows are copied one by one. Large copies are split across the job system, each job
+// fencing its own streaming stores before it completes.
+// Portable C++, no graphics API dependencies.
+
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(_M_X64) || defined(__x86_64__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define STREAMING_COPY_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#else
+#define STREAMING_COPY_X86 0
+#endif
+
+// MSVC compiles any intrinsic regardless of /arch; GCC and Clang need the function to opt in.
+#if STREAMING_COPY_X86 && !defined(_MSC_VER)
+#define STREAMING_COPY_TARGET(_isa) __attribute__((target(_isa)))
+#else
+#define STREAMING_COPY_TARGET(_isa)
+#endif
+
+// Below this a copy cannot fill a write-combining buffer and streaming gains nothing.
+static const size_t StreamCopyMinBytes = 256;
+
+// Smallest share of a copy worth handing to another thread.
+static const size_t StreamCopyJobBytes = 256 * 1024;
+
+// Streams whole 64 byte lines to a line aligned _dest. _size is a multiple of 64.
+typedef void (*StreamCopyLinesFunction)(uint8_t* _dest, const uint8_t* _source, size_t _size);
+
+#if STREAMING_COPY_X86
+static inline void StreamCopyLinesSse2(uint8_t* _dest, const uint8_t* _source, size_t _size)
+{
+    for (size_t i = 0; i < _size; i += 64)
+    {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(_source + i));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(_source + i + 16));
+        __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(_source + i + 32));
+        __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(_source + i + 48));
+        _mm_stream_si128(reinterpret_cast<__m128i*>(_dest + i), a);
+        _mm_stream_si128(reinterpret_cast<__m128i*>(_dest + i + 16), b);
+        _mm_stream_si128(reinterpret_cast<__m128i*>(_dest + i + 32), c);
+        _mm_stream_si128(reinterpret_cast<__m128i*>(_dest + i + 48), d);
+    }
+}
+
+STREAMING_COPY_TARGET("avx2")
+static inline void StreamCopyLinesAvx2(uint8_t* _dest, const uint8_t* _source, size_t _size)
+{
+    for (size_t i = 0; i < _size; i += 64)
+    {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(_source + i));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(_source + i + 32));
+        _mm256_stream_si256(reinterpret_cast<__m256i*>(_dest + i), a);
+        _mm256_stream_si256(reinterpret_cast<__m256i*>(_dest + i + 32), b);
+    }
+}
+
+STREAMING_COPY_TARGET("avx512f")
+static inline void StreamCopyLinesAvx512(uint8_t* _dest, const uint8_t* _source, size_t _size)
+{
+    for (size_t i = 0; i < _size; i += 64)
+    {
+        _mm512_stream_si512(reinterpret_cast<__m512i*>(_dest + i), _mm512_loadu_si512(_source + i));
+    }
+}
+
+static inline void StreamCopyCpuid(uint32_t _leaf, uint32_t _subleaf, uint32_t _registers[4])
+{
+#if defined(_MSC_VER)
+    int registers[4];
+    __cpuidex(registers, static_cast<int>(_leaf), static_cast<int>(_subleaf));
+    for (int i = 0; i < 4; i++)
+    {
+        _registers[i] = static_cast<uint32_t>(registers[i]);
+    }
+#else
+    __cpuid_count(_leaf, _subleaf, _registers[0], _registers[1], _registers[2], _registers[3]);
+#endif
+}
+
+// Register state the OS saves on context switches, XCR0. Only valid when OSXSAVE is set.
+static inline uint64_t StreamCopyXgetbv()
+{
+#if defined(_MSC_VER)
+    return _xgetbv(0);
+#else
+    uint32_t low, high;
+    __asm__ volatile("xgetbv" : "=a"(low), "=d"(high) : "c"(0));
+    return (static_cast<uint64_t>(high) << 32) | low;
+#endif
+}
+#endif
+
+// Widest streaming store width in bytes the CPU and OS support: 64, 32, 16, or 0 off x86.
+static inline uint32_t StreamCopyDetectWidth()
+{
+#if STREAMING_COPY_X86
+    uint32_t registers[4];
+    StreamCopyCpuid(0, 0, registers);
+    uint32_t maxLeaf = registers[0];
+
+    StreamCopyCpuid(1, 0, registers);
+    bool osxsave = (registers[2] & (1u << 27)) != 0;
+    if (!osxsave || maxLeaf < 7)
+    {
+        return 16;
+    }
+
+    // AVX needs the OS to save XMM and YMM state; AVX-512 also opmask and ZMM state.
+    uint64_t xcr0 = StreamCopyXgetbv();
+    StreamCopyCpuid(7, 0, registers);
+    if ((registers[1] & (1u << 16)) && (xcr0 & 0xE6) == 0xE6)
+    {
+        return 64;
+    }
+    if ((registers[1] & (1u << 5)) && (xcr0 & 0x6) == 0x6)
+    {
+        return 32;
+    }
+    return 16;
+#else
+    return 0;
+#endif
+}
+
+// The width in use, the detected one unless StreamCopySetWidth narrowed it.
+static inline std::atomic<uint32_t>& StreamCopyWidthSetting()
+{
+    static std::atomic<uint32_t> width{ StreamCopyDetectWidth() };
+    return width;
+}
+
+static inline uint32_t StreamCopyWidth()
+{
+    return StreamCopyWidthSetting().load(std::memory_order_relaxed);
+}
+
+// Picks a narrower store width, e.g. to compare them; 0 copies with memcpy alone. Widths the
+// machine does not support fall back to the detected one.
+static inline void StreamCopySetWidth(uint32_t _width)
+{
+    uint32_t detected = StreamCopyDetectWidth();
+    StreamCopyWidthSetting().store(_width <= detected ? _width : detected, std::memory_order_relaxed);
+}
+
+static inline StreamCopyLinesFunction StreamCopyLines(uint32_t _width)
+{
+#if STREAMING_COPY_X86
+    switch (_width)
+    {
+    case 64: return StreamCopyLinesAvx512;
+    case 32: return StreamCopyLinesAvx2;
+    case 16: return StreamCopyLinesSse2;
+    default: break;
+    }
+#endif
+    (void)_width;
+    return nullptr;
+}
+
+// Copies [_source, _source + _size) to _dest. Streaming stores are weakly ordered, so call
+// StreamCopyFence before anything else may read the destination.
+static inline void StreamCopyUnfenced(void* _dest, const void* _source, size_t _size)
+{
+    StreamCopyLinesFunction lines   = StreamCopyLines(StreamCopyWidth());
+    uint8_t*                dest    = static_cast<uint8_t*>(_dest);
+    const uint8_t*          source  = static_cast<const uint8_t*>(_source);
+    size_t                  head    = (64 - reinterpret_cast<uintptr_t>(dest) % 64) % 64;
+    if (!lines || _size < StreamCopyMinBytes || _size < head + 64)
+    {
+        memcpy(_dest, _source, _size);
+        return;
+    }
+
+    memcpy(dest, source, head);
+    dest    += head;
+    source  += head;
+    _size   -= head;
+
+    size_t body = _size - _size % 64;
+    lines(dest, source, body);
+    memcpy(dest + body, source + body, _size - body);
+}
+
+static inline void StreamCopyFence()
+{
+#if STREAMING_COPY_X86
+    _mm_sfence();
+#endif
+}
+
+static inline void StreamCopy(void* _dest, const void* _source, size_t _size)
+{
+    StreamCopyUnfenced(_dest, _source, _size);
+    StreamCopyFence();
+}
+
+// One subresource: _rowCount rows of _rowSize bytes in each of _sliceCount slices. Pitches as in
+// D3D12_MEMCPY_DEST and D3D12_SUBRESOURCE_DATA; the source's may be negative.
+struct SubresourceRows
+{
+    uint8_t*        dest            = nullptr;
+    size_t          destRowPitch    = 0;
+    size_t          destSlicePitch  = 0;
+    const uint8_t*  source          = nullptr;
+    ptrdiff_t       sourceRowPitch  = 0;
+    ptrdiff_t       sourceSlicePitch = 0;
+    size_t          rowSize         = 0;
+    uint32_t        rowCount        = 0;
+    uint32_t        sliceCount      = 0;
+};
+
+// Rows are packed back to back on both sides, so the subresource is one contiguous span. A single
+// row, such as a buffer, always is.
+static inline bool SubresourceRowsContiguous(const SubresourceRows& _rows)
+{
+    size_t sliceSize = _rows.rowSize * _rows.rowCount;
+    return (_rows.rowCount <= 1 || (_rows.destRowPitch == _rows.rowSize && _rows.sourceRowPitch == static_cast<ptrdiff_t>(_rows.rowSize))) &&
+           (_rows.sliceCount <= 1 || (_rows.destSlicePitch == sliceSize && _rows.sourceSlicePitch == static_cast<ptrdiff_t>(sliceSize)));
+}
+
+// Copies rows [_first, _end), counted across slices, and fences them.
+static inline void CopySubresourceRowRange(const SubresourceRows& _rows, uint64_t _first, uint64_t _end)
+{
+    for (uint64_t row = _first; row < _end; row++)
+    {
+        uint64_t slice  = row / _rows.rowCount;
+        uint64_t y      = row % _rows.rowCount;
+        StreamCopyUnfenced(_rows.dest + _rows.destSlicePitch * slice + _rows.destRowPitch * y,
+                           _rows.source + _rows.sourceSlicePitch * static_cast<ptrdiff_t>(slice) + _rows.sourceRowPitch * static_cast<ptrdiff_t>(y),
+                           _rows.rowSize);
+    }
+    StreamCopyFence();
+}
+
+// _jobSystem may be null, in which case everything is copied on the calling thread.
+static void CopySubresourceRows(const SubresourceRows& _rows, JobSystem* _jobSystem = nullptr)
+{
+    uint64_t rowTotal   = static_cast<uint64_t>(_rows.rowCount) * _rows.sliceCount;
+    uint64_t byteTotal  = rowTotal * _rows.rowSize;
+    if (byteTotal == 0)
+    {
+        return;
+    }
+
+    uint64_t jobCount = _jobSystem ? (std::min)(static_cast<uint64_t>(_jobSystem->WorkerCount() + 1), byteTotal / StreamCopyJobBytes) : 1;
+    if (SubresourceRowsContiguous(_rows))
+    {
+        if (jobCount <= 1)
+        {
+            StreamCopy(_rows.dest, _rows.source, static_cast<size_t>(byteTotal));
+            return;
+        }
+
+        // Split the span on line boundaries so no two jobs stream into the same line.
+        uint64_t share = (byteTotal / jobCount + 63) & ~uint64_t(63);
+        _jobSystem->ParallelFor(static_cast<uint32_t>(jobCount), [&](uint32_t _job, uint32_t)
+        {
+            uint64_t begin  = (std::min)(share * _job, byteTotal);
+            uint64_t end    = (std::min)(begin + share, byteTotal);
+            StreamCopy(_rows.dest + begin, _rows.source + begin, static_cast<size_t>(end - begin));
+        });
+        return;
+    }
+
+    jobCount = (std::min)(jobCount, rowTotal);
+    if (jobCount <= 1)
+    {
+        CopySubresourceRowRange(_rows, 0, rowTotal);
+        return;
+    }
+
+    _jobSystem->ParallelFor(static_cast<uint32_t>(jobCount), [&](uint32_t _job, uint32_t)
+    {
+        CopySubresourceRowRange(_rows, rowTotal * _job / jobCount, rowTotal * (_job + 1) / jobCount);
+    });
+}
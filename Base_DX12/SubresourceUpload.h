@@ -0,0 +1,69 @@
+#pragma once
+
+// UpdateSubresources for persistently mapped upload memory.
+// Records the same copies as UpdateSubresources in d3dx12.h, but writes the staging data through
+// the caller's CPU pointer instead of mapping the intermediate, and copies the rows with
+// CopySubresourceRows: streaming stores, one span when pitches match and, given a job system,
+// split across threads. d3dx12.h itself is left untouched.
+
+#include <d3d12.h>
+#include "d3dx12.h"
+#include "StreamingCopy.h"
+
+#include <vector>
+
+// _intermediateData is the CPU address of _intermediate at _intermediateOffset. Returns the bytes
+// of staging used, 0 on failure, in which case nothing was recorded.
+inline UINT64 UpdateSubresourcesStreaming(ID3D12GraphicsCommandList* _commandList, ID3D12Resource* _destination,
+                                          ID3D12Resource* _intermediate, uint8_t* _intermediateData, UINT64 _intermediateOffset,
+                                          UINT _firstSubresource, UINT _count, const D3D12_SUBRESOURCE_DATA* _sources, JobSystem* _jobSystem)
+{
+    D3D12_RESOURCE_DESC destinationDesc  = _destination->GetDesc();
+    D3D12_RESOURCE_DESC intermediateDesc = _intermediate->GetDesc();
+
+    std::vector<D3D12_PLACED_SUBRESOURCE_FOOTPRINT> layouts(_count);
+    std::vector<UINT>                               rowCounts(_count);
+    std::vector<UINT64>                             rowSizes(_count);
+    UINT64                                          requiredSize = 0;
+
+    ID3D12Device* device = nullptr;
+    _destination->GetDevice(IID_PPV_ARGS(&device));
+    device->GetCopyableFootprints(&destinationDesc, _firstSubresource, _count, _intermediateOffset, layouts.data(), rowCounts.data(), rowSizes.data(), &requiredSize);
+    device->Release();
+
+    if (intermediateDesc.Dimension != D3D12_RESOURCE_DIMENSION_BUFFER || intermediateDesc.Width < requiredSize + layouts[0].Offset ||
+        (destinationDesc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER && (_firstSubresource != 0 || _count != 1)))
+    {
+        return 0;
+    }
+
+    for (UINT i = 0; i < _count; i++)
+    {
+        SubresourceRows rows;
+        rows.dest               = _intermediateData + (layouts[i].Offset - _intermediateOffset);
+        rows.destRowPitch       = layouts[i].Footprint.RowPitch;
+        rows.destSlicePitch     = static_cast<size_t>(layouts[i].Footprint.RowPitch) * rowCounts[i];
+        rows.source             = static_cast<const uint8_t*>(_sources[i].pData);
+        rows.sourceRowPitch     = _sources[i].RowPitch;
+        rows.sourceSlicePitch   = _sources[i].SlicePitch;
+        rows.rowSize            = static_cast<size_t>(rowSizes[i]);
+        rows.rowCount           = rowCounts[i];
+        rows.sliceCount         = layouts[i].Footprint.Depth;
+        CopySubresourceRows(rows, _jobSystem);
+    }
+
+    if (destinationDesc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER)
+    {
+        _commandList->CopyBufferRegion(_destination, 0, _intermediate, layouts[0].Offset, layouts[0].Footprint.Width);
+    }
+    else
+    {
+        for (UINT i = 0; i < _count; i++)
+        {
+            CD3DX12_TEXTURE_COPY_LOCATION destination(_destination, i + _firstSubresource);
+            CD3DX12_TEXTURE_COPY_LOCATION source(_intermediate, layouts[i]);
+            _commandList->CopyTextureRegion(&destination, 0, 0, 0, &source, nullptr);
+        }
+    }
+    return requiredSize;
+}
@@ -0,0 +1,198 @@
+// Asset streaming throughput and latency: LZ4 block compression and decompression on asset-like
+// data, AsyncFileReader reading plain chunks at full queue depth on its native backend (io_uring
+// on Linux), then AssetStreamer loading a batch of compressed assets and, one at a time, a small
+// one. The files are freshly written, so reads come from the page cache unless it is dropped
+// between writing and reading; the numbers are the software path's ceiling, not the disk's.
+
+#include "TestCommon.h"
+#include "AssetStreamer.h"
+
+#include <random>
+#include <string>
+#include <vector>
+
+// 1: a vertex buffer, 32 byte vertices on a grid with a few distinct normals and one colour.
+// 2: runs, like masks or sparse data.
+static std::vector<uint8_t> MakeAssetData(std::mt19937& _rng, size_t _size, int _mode)
+{
+    std::vector<uint8_t> data(_size);
+    if (_mode == 1)
+    {
+        struct Vertex
+        {
+            float       position[3];
+            uint32_t    normal;
+            uint16_t    uv[2];
+            uint32_t    color;
+            uint32_t    pad[2];
+        };
+        static const uint32_t normals[] = { 0x7F7F00FF, 0x7FFF007F, 0xFF7F007F, 0x7F7FFF00 };
+        for (size_t i = 0; i + sizeof(Vertex) <= _size; i += sizeof(Vertex))
+        {
+            uint32_t k = static_cast<uint32_t>(i / sizeof(Vertex));
+            Vertex   vertex = { { static_cast<float>(k % 256), static_cast<float>(k / 256 % 256), 0.25f * (k * 7 % 16) },
+                                normals[_rng() % 4], { static_cast<uint16_t>(k % 256 * 256), static_cast<uint16_t>(k / 256 % 256 * 256) },
+                                0xFF808080, { 0, 0 } };
+            memcpy(data.data() + i, &vertex, sizeof(vertex));
+        }
+        return data;
+    }
+    for (size_t i = 0; i < _size; i++)
+    {
+        data[i] = _rng() % 32 ? (i > 0 ? data[i - 1] : 0) : static_cast<uint8_t>(_rng());
+    }
+    return data;
+}
+
+static void BenchCompression(std::mt19937& _rng, uint32_t _repeats)
+{
+    const size_t BlockSize = 256 * 1024;
+    for (int mode = 1; mode <= 2; mode++)
+    {
+        std::vector<uint8_t> source = MakeAssetData(_rng, BlockSize, mode);
+        std::vector<uint8_t> packed(CompressBlockBound(BlockSize)), out(BlockSize);
+
+        auto   start       = std::chrono::steady_clock::now();
+        size_t packedSize  = 0;
+        for (uint32_t i = 0; i < _repeats; i++)
+        {
+            packedSize = CompressBlock(source.data(), BlockSize, packed.data(), packed.size());
+        }
+        double compress = static_cast<double>(BlockSize) * _repeats / SecondsSince(start) / 1e9;
+
+        start = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < _repeats * 10; i++)
+        {
+            CHECK(DecompressBlock(packed.data(), packedSize, out.data(), BlockSize));
+        }
+        double decompress = static_cast<double>(BlockSize) * _repeats * 10 / SecondsSince(start) / 1e9;
+        CHECK(out == source);
+        std::printf("LZ4 %s: ratio %.2f, compress %.2f GB/s, decompress %.2f GB/s\n", mode == 1 ? "vertices" : "runs    ",
+                    static_cast<double>(packedSize) / BlockSize, compress, decompress);
+    }
+}
+
+// Every file read in 256KB chunks through one reader, as many in flight as it allows.
+static void BenchReader(const std::vector<std::filesystem::path>& _files)
+{
+    const uint32_t Chunk = 256 * 1024, Depth = 64;
+    AsyncFileReader                 reader(Depth);
+    std::vector<uint8_t>            buffer(static_cast<size_t>(Chunk) * Depth);
+    std::vector<FileReadCompletion> completions;
+    uint64_t                        total = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (const std::filesystem::path& path : _files)
+    {
+        uint64_t size   = 0;
+        uint32_t file   = reader.Open(path, &size);
+        uint64_t offset = 0;
+        uint32_t issued = 0;
+        CHECK(file != FileInvalid);
+        while (offset < size || reader.InFlight() > 0)
+        {
+            while (offset < size)
+            {
+                uint32_t length = static_cast<uint32_t>((std::min)(static_cast<uint64_t>(Chunk), size - offset));
+                if (!reader.Read({ file, offset, length, buffer.data() + static_cast<size_t>(issued % Depth) * Chunk, 0 }))
+                {
+                    break;
+                }
+                offset += length;
+                issued++;
+            }
+            reader.Submit();
+            completions.clear();
+            reader.Reap(&completions, true);
+            for (const FileReadCompletion& completion : completions)
+            {
+                CHECK(completion.ok);
+            }
+        }
+        reader.Close(file);
+        total += size;
+    }
+    std::printf("AsyncFileReader (%s): %.2f GB/s over %.0f MB\n", reader.Backend(), total / SecondsSince(start) / 1e9, total / 1e6);
+}
+
+int main(int argc, char** argv)
+{
+    bool         quick      = QuickRun(argc, argv);
+    int          fileCount  = quick ? 4 : 16;
+    size_t       fileSize   = quick ? (4 << 20) : (32 << 20);
+    uint32_t     repeats    = quick ? 20 : 200;
+    std::mt19937 rng(7);
+
+    BenchCompression(rng, repeats);
+
+    std::filesystem::path directory = std::filesystem::temp_directory_path() / "base_dx12_asset_streamer_bench";
+    std::filesystem::create_directories(directory);
+    std::vector<std::filesystem::path> paths;
+    uint64_t                           packedTotal = 0;
+    for (int i = 0; i < fileCount; i++)
+    {
+        std::vector<uint8_t> asset = MakeAssetData(rng, fileSize, 1 + i % 2);
+        paths.push_back(directory / (std::to_string(i) + ".asset"));
+        CHECK(WriteAssetFile(paths.back(), asset.data(), fileSize, 256 * 1024));
+        packedTotal += std::filesystem::file_size(paths.back());
+    }
+    std::printf("%d assets, %.0f MB raw, %.0f MB on disk\n", fileCount, fileCount * fileSize / 1e6, packedTotal / 1e6);
+
+    BenchReader(paths);
+
+    {
+        // Every load holds its whole output until its callback runs, so the batch stays well within memory.
+        JobSystem     jobs;
+        AssetStreamer streamer(&jobs, 64, 64 << 20);
+        int           loaded = 0;
+        auto          start  = std::chrono::steady_clock::now();
+        for (int i = 0; i < fileCount; i++)
+        {
+            streamer.Load(paths[i], [&](bool _ok, std::vector<uint8_t>&& _data)
+            {
+                CHECK(_ok && _data.size() == fileSize);
+                loaded++;
+            });
+        }
+        while (streamer.Pending() > 0)
+        {
+            if (streamer.Update() == 0)
+            {
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+            }
+        }
+        double             seconds = SecondsSince(start);
+        AssetStreamerStats stats   = streamer.Stats();
+        CHECK(loaded == fileCount);
+        std::printf("AssetStreamer batch (%s): %.2f GB/s read, %.2f GB/s delivered, %.3f s wall, latency %.2f ms avg, %.2f ms max\n",
+                    streamer.Backend(), stats.ReadGBps(), stats.RawGBps(), seconds, stats.AverageLatencyMs(), stats.maxLatencyMs);
+    }
+
+    // One small asset at a time: the latency a single streamed-in object sees.
+    {
+        std::vector<uint8_t>  small = MakeAssetData(rng, 1 << 20, 2);
+        std::filesystem::path path  = directory / "small.asset";
+        CHECK(WriteAssetFile(path, small.data(), small.size(), 64 * 1024));
+
+        JobSystem     jobs;
+        AssetStreamer streamer(&jobs, 64, 64 << 20);
+        int           loads = quick ? 20 : 200;
+        for (int i = 0; i < loads; i++)
+        {
+            bool loaded = false;
+            streamer.Load(path, [&](bool _ok, std::vector<uint8_t>&& _data) { loaded = _ok && _data == small; });
+            while (streamer.Update() == 0)
+            {
+                std::this_thread::yield();
+            }
+            CHECK(loaded);
+        }
+        AssetStreamerStats stats = streamer.Stats();
+        std::printf("AssetStreamer 1 MB asset alone: latency %.3f ms avg, %.3f ms max, %.2f GB/s delivered\n",
+                    stats.AverageLatencyMs(), stats.maxLatencyMs, stats.RawGBps());
+    }
+
+    std::error_code ec;
+    std::filesystem::remove_all(directory, ec);
+    return TestResult("AssetStreamerBench");
+}
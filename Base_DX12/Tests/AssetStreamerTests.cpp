@@ -0,0 +1,205 @@
+// AssetStreamer end to end: asset files of assorted sizes, block sizes and compressibility are
+// written, streamed back and compared byte for byte, alongside a missing, a corrupted and a
+// truncated file, one whose blocks overlap and one whose table promises far more data than the
+// file could decompress to. The run is repeated with a tiny in-flight budget, without a job system and with
+// a queue depth of two, and each streamer is destroyed with a load still in flight.
+
+#include "TestCommon.h"
+#include "AssetStreamer.h"
+
+#include <random>
+#include <string>
+#include <vector>
+
+// 0: random, incompressible. 1: slowly varying 16 bit values, like quantised vertices. 2: runs.
+static std::vector<uint8_t> MakeAssetData(std::mt19937& _rng, size_t _size, int _mode)
+{
+    std::vector<uint8_t> data(_size);
+    for (size_t i = 0; i < _size; i++)
+    {
+        if (_mode == 0)
+        {
+            data[i] = static_cast<uint8_t>(_rng());
+        }
+        else if (_mode == 1)
+        {
+            uint16_t value = static_cast<uint16_t>((i / 2) * 3 + _rng() % 4);
+            data[i] = static_cast<uint8_t>(i % 2 ? value >> 8 : value);
+        }
+        else
+        {
+            data[i] = _rng() % 32 ? (i > 0 ? data[i - 1] : 0) : static_cast<uint8_t>(_rng());
+        }
+    }
+    return data;
+}
+
+// Rewrites an asset file's header and table in place.
+static void EditAssetFile(const std::filesystem::path& _path, const std::function<void(AssetFileHeader&, std::vector<AssetBlock>&)>& _edit)
+{
+    std::fstream    file(_path, std::ios::in | std::ios::out | std::ios::binary);
+    AssetFileHeader header;
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    std::vector<AssetBlock> blocks(header.blockCount);
+    file.read(reinterpret_cast<char*>(blocks.data()), sizeof(AssetBlock) * blocks.size());
+
+    _edit(header, blocks);
+    file.seekp(0);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(blocks.data()), sizeof(AssetBlock) * blocks.size());
+}
+
+struct StreamerCase
+{
+    const char* name;
+    bool        jobs;
+    uint32_t    queueDepth;
+    uint64_t    budget;
+};
+
+int main()
+{
+    std::filesystem::path directory = std::filesystem::temp_directory_path() / "base_dx12_asset_streamer_tests";
+    std::filesystem::create_directories(directory);
+
+    // File 1 is empty and file 2 has 4KB blocks; the rest use 256KB blocks.
+    const int                         FileCount = 12;
+    std::mt19937                      rng(7);
+    std::vector<std::vector<uint8_t>> assets;
+    for (int i = 0; i < FileCount; i++)
+    {
+        size_t size = i == 1 ? 0 : rng() % (3 << 20) + 1;
+        assets.push_back(MakeAssetData(rng, size, i % 3));
+        CHECK(WriteAssetFile(directory / (std::to_string(i) + ".asset"), assets.back().data(), assets.back().size(), i == 2 ? 4096 : 256 * 1024));
+    }
+
+    // Junk over the end of a compressed asset's blocks, and a file that stops inside the header.
+    std::filesystem::copy_file(directory / "4.asset", directory / "corrupt.asset", std::filesystem::copy_options::overwrite_existing);
+    {
+        std::fstream file(directory / "corrupt.asset", std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(std::filesystem::file_size(directory / "corrupt.asset") - 100);
+        char junk[50];
+        for (char& c : junk)
+        {
+            c = static_cast<char>(rng());
+        }
+        file.write(junk, sizeof(junk));
+    }
+    {
+        std::ofstream file(directory / "truncated.asset", std::ios::binary | std::ios::trunc);
+        file.write("ASST", 4);
+    }
+
+    // Two identical stored blocks, the second pointing back at the first: it would even decompress
+    // correctly, but blocks must not overlap.
+    std::vector<uint8_t> repeated = MakeAssetData(rng, 4096, 0);
+    repeated.insert(repeated.end(), repeated.begin(), repeated.end());
+    CHECK(WriteAssetFile(directory / "overlapping.asset", repeated.data(), repeated.size(), 4096));
+    EditAssetFile(directory / "overlapping.asset", [](AssetFileHeader& _header, std::vector<AssetBlock>& _blocks)
+    {
+        CHECK(_header.blockCount == 2 && _blocks[0].packedSize == _blocks[0].rawSize);
+        _blocks[1].offset = _blocks[0].offset;
+    });
+
+    // 64 blocks of 16MB, one byte each: a 1GB asset out of a file barely over 1KB.
+    {
+        AssetFileHeader header;
+        header.blockSize    = AssetMaxBlockSize;
+        header.blockCount   = 64;
+        header.rawSize      = static_cast<uint64_t>(header.blockSize) * header.blockCount;
+        std::vector<AssetBlock> blocks(header.blockCount);
+        for (uint32_t i = 0; i < header.blockCount; i++)
+        {
+            blocks[i].offset        = sizeof(header) + sizeof(AssetBlock) * header.blockCount + i;
+            blocks[i].packedSize    = 1;
+            blocks[i].rawSize       = header.blockSize;
+        }
+        std::ofstream file(directory / "inflated.asset", std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(blocks.data()), sizeof(AssetBlock) * blocks.size());
+        file.write(std::string(header.blockCount, '\0').data(), header.blockCount);
+    }
+
+    const StreamerCase cases[] =
+    {
+        { "default",        true,   64, 64 << 20 },
+        { "64KB budget",    true,   64, 64 << 10 },
+        { "no job system",  false,  64, 64 << 20 },
+        { "queue depth 2",  true,   2,  64 << 20 },
+    };
+    for (const StreamerCase& test : cases)
+    {
+        JobSystem     jobs(3);
+        AssetStreamer streamer(test.jobs ? &jobs : nullptr, test.queueDepth, test.budget);
+
+        int matched = 0, failed = 0;
+        for (int i = 0; i < FileCount; i++)
+        {
+            streamer.Load(directory / (std::to_string(i) + ".asset"), [&, i](bool _ok, std::vector<uint8_t>&& _data)
+            {
+                CHECK(_ok);
+                CHECK(_data == assets[i]);
+                matched++;
+            });
+        }
+        streamer.Load(directory / "missing.asset", [&](bool _ok, std::vector<uint8_t>&& _data)
+        {
+            CHECK(!_ok && _data.empty());
+            failed++;
+        });
+        // The junk may or may not land in a block's compressed stream; either way it must not crash.
+        streamer.Load(directory / "corrupt.asset", [&](bool, std::vector<uint8_t>&&) { failed++; });
+        for (const char* name : { "truncated.asset", "overlapping.asset", "inflated.asset" })
+        {
+            streamer.Load(directory / name, [&](bool _ok, std::vector<uint8_t>&&)
+            {
+                CHECK(!_ok);
+                failed++;
+            });
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        while (streamer.Pending() > 0 && SecondsSince(start) < 30.0)
+        {
+            if (streamer.Update() == 0)
+            {
+                std::this_thread::sleep_for(std::chrono::microseconds(200));
+            }
+        }
+        CHECK(matched == FileCount);
+        CHECK(failed == 5);
+
+        AssetStreamerStats stats = streamer.Stats();
+        CHECK(stats.loads == static_cast<uint64_t>(FileCount + 5));
+        CHECK(stats.failed >= 4);
+        std::printf("%-14s %s: %llu loads, %.2f ms average latency\n", test.name, streamer.Backend(),
+                    static_cast<unsigned long long>(stats.loads), stats.AverageLatencyMs());
+
+        // Destroyed with this still in flight; its callback is dropped.
+        streamer.Load(directory / "0.asset", [](bool, std::vector<uint8_t>&&) {});
+    }
+
+    // Refused before any block is read or the asset's memory is allocated: the overlap once the
+    // table is in, the inflated size already at the header.
+    for (const char* name : { "overlapping.asset", "inflated.asset" })
+    {
+        AssetStreamer streamer(nullptr, 4, 64 << 20);
+        bool          ok = true;
+        streamer.Load(directory / name, [&](bool _ok, std::vector<uint8_t>&&) { ok = _ok; });
+        auto start = std::chrono::steady_clock::now();
+        while (streamer.Pending() > 0 && SecondsSince(start) < 30.0)
+        {
+            streamer.Update();
+        }
+        std::ifstream   file(directory / name, std::ios::binary);
+        AssetFileHeader header;
+        file.read(reinterpret_cast<char*>(&header), sizeof(header));
+        uint64_t tableBytes = name == std::string("overlapping.asset") ? sizeof(AssetBlock) * header.blockCount : 0;
+        CHECK(!ok);
+        CHECK(streamer.Stats().fileBytes == sizeof(AssetFileHeader) + tableBytes);
+    }
+
+    std::error_code ec;
+    std::filesystem::remove_all(directory, ec);
+    return TestResult("AssetStreamerTests");
+}
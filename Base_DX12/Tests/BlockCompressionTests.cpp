@@ -0,0 +1,133 @@
+// BlockCompression: round trips over random, repetitive, run and mostly-repeating data of many
+// sizes, a block built by hand in the reference LZ4 layout, compression into too small a buffer,
+// and the decoder fed truncated blocks and random junk, which must fail rather than overrun.
+
+#include "TestCommon.h"
+#include "BlockCompression.h"
+
+#include <random>
+#include <vector>
+
+static std::vector<uint8_t> MakeData(std::mt19937& _rng, size_t _size, int _mode)
+{
+    std::vector<uint8_t> data(_size);
+    for (size_t i = 0; i < _size; i++)
+    {
+        switch (_mode)
+        {
+        case 0:  data[i] = static_cast<uint8_t>(_rng());                                            break;
+        case 1:  data[i] = static_cast<uint8_t>((i / 7) % 13);                                      break;
+        case 2:  data[i] = 'a';                                                                     break;
+        default: data[i] = _rng() % 4 ? (i > 0 ? data[i - 1] : 0) : static_cast<uint8_t>(_rng());   break;
+        }
+    }
+    return data;
+}
+
+static void TestRoundTrips()
+{
+    std::mt19937 rng(1);
+    for (int iteration = 0; iteration < 300; iteration++)
+    {
+        // Small sizes first, to cover blocks too short to hold a match.
+        size_t               size   = iteration < 40 ? static_cast<size_t>(iteration) : rng() % 200000;
+        int                  mode   = iteration % 4;
+        std::vector<uint8_t> source = MakeData(rng, size, mode);
+        std::vector<uint8_t> packed(CompressBlockBound(size)), out(size, 0xCD);
+
+        size_t packedSize = CompressBlock(source.data(), size, packed.data(), packed.size());
+        CHECK(packedSize > 0 && packedSize <= packed.size());
+        CHECK(DecompressBlock(packed.data(), packedSize, out.data(), size));
+        CHECK(out == source);
+        if ((mode == 1 || mode == 2) && size > 1000)
+        {
+            CHECK(packedSize < size / 2);
+        }
+
+        // Cut short, or asked for a different size, the block must be rejected.
+        if (packedSize > 1)
+        {
+            CHECK(!DecompressBlock(packed.data(), packedSize - 1, out.data(), size));
+        }
+        if (size > 0)
+        {
+            CHECK(!DecompressBlock(packed.data(), packedSize, out.data(), size - 1));
+        }
+
+        // One byte short of what it needs, compression reports it does not fit.
+        CHECK(CompressBlock(source.data(), size, packed.data(), packedSize - 1) == 0);
+    }
+}
+
+// "abc" followed by a 9 byte match at offset 3, overlapping its own output, then 5 literals,
+// encoded by hand as the reference lz4 library lays it out.
+static void TestReferenceLayout()
+{
+    const uint8_t block[] =
+    {
+        0x35, 'a', 'b', 'c', 0x03, 0x00,    // 3 literals, match length 4 + 5, offset 3.
+        0x50, 'v', 'w', 'x', 'y', 'z',      // Last 5 literals, no match.
+    };
+    const char expected[] = "abcabcabcabcvwxyz";
+    uint8_t    out[sizeof(expected) - 1];
+    CHECK(DecompressBlock(block, sizeof(block), out, sizeof(out)));
+    CHECK(memcmp(out, expected, sizeof(out)) == 0);
+
+    // An offset reaching before the start of the output is malformed.
+    uint8_t bad[sizeof(block)];
+    memcpy(bad, block, sizeof(block));
+    bad[4] = 0x04;
+    CHECK(!DecompressBlock(bad, sizeof(bad), out, sizeof(out)));
+}
+
+// Lengths continued past 15 with 255 bytes, in both the literal and match fields.
+static void TestLongLengths()
+{
+    std::vector<uint8_t> source(70000, 'x');
+    std::mt19937         rng(5);
+    for (size_t i = 0; i < 600; i++)
+    {
+        source[i] = static_cast<uint8_t>(rng());
+    }
+    std::vector<uint8_t> packed(CompressBlockBound(source.size())), out(source.size());
+    size_t packedSize = CompressBlock(source.data(), source.size(), packed.data(), packed.size());
+    CHECK(packedSize > 0 && packedSize < 1000);
+    CHECK(DecompressBlock(packed.data(), packedSize, out.data(), out.size()));
+    CHECK(out == source);
+}
+
+// Random input must only ever fail cleanly; ASan or UBSan builds catch any overrun.
+static void TestDecoderFuzz()
+{
+    std::mt19937 rng(2);
+    for (int iteration = 0; iteration < 100000; iteration++)
+    {
+        uint8_t junk[64];
+        uint8_t out[256];
+        for (uint8_t& byte : junk)
+        {
+            byte = static_cast<uint8_t>(rng());
+        }
+        DecompressBlock(junk, rng() % sizeof(junk), out, rng() % sizeof(out));
+    }
+
+    // Valid blocks with single bytes flipped.
+    std::vector<uint8_t> source = MakeData(rng, 4096, 3);
+    std::vector<uint8_t> packed(CompressBlockBound(source.size())), out(source.size());
+    size_t packedSize = CompressBlock(source.data(), source.size(), packed.data(), packed.size());
+    for (int iteration = 0; iteration < 20000; iteration++)
+    {
+        std::vector<uint8_t> corrupt(packed.begin(), packed.begin() + packedSize);
+        corrupt[rng() % packedSize] ^= static_cast<uint8_t>(1 + rng() % 255);
+        DecompressBlock(corrupt.data(), corrupt.size(), out.data(), out.size());
+    }
+}
+
+int main()
+{
+    TestRoundTrips();
+    TestReferenceLayout();
+    TestLongLengths();
+    TestDecoderFuzz();
+    return TestResult("BlockCompressionTests");
+}
@@ -0,0 +1,248 @@
+// CopyBatchScheduler with a mock copy fence: batches respect the byte and count limits and keep
+// queue order, an upload over the byte budget goes alone, a refused batch stays at the front ahead
+// of uploads queued meanwhile, and tickets map to their batch's fence value and complete with it.
+// Also producers enqueueing from several threads while one thread flushes.
+
+#include "TestCommon.h"
+#include "CopyBatchScheduler.h"
+#include "MockGpuFence.h"
+
+#include <thread>
+#include <vector>
+
+typedef CopyBatchScheduler<int> Scheduler;
+
+struct Batch
+{
+    std::vector<int>    uploads;
+    uint64_t            bytes;
+};
+
+// Records every batch it is handed; refuses from the _refuseFrom'th call on.
+static Scheduler::SubmitFn Recorder(std::vector<Batch>* _batches, uint32_t _refuseFrom = 0xFFFFFFFF)
+{
+    return [_batches, _refuseFrom](std::vector<int>& _uploads, uint64_t _bytes)
+    {
+        if (_batches->size() >= _refuseFrom)
+        {
+            return false;
+        }
+        _batches->push_back({ _uploads, _bytes });
+        return true;
+    };
+}
+
+static void TestLimits()
+{
+    MockGpuFence fence;
+    Scheduler    scheduler(&fence, 1000, 4);
+
+    // 300 bytes each: three fit the byte budget before the count limit of four matters.
+    for (int i = 0; i < 7; i++)
+    {
+        scheduler.Enqueue(i, 300);
+    }
+    // 10 bytes each: the count limit cuts these.
+    for (int i = 7; i < 16; i++)
+    {
+        scheduler.Enqueue(i, 10);
+    }
+    CHECK(scheduler.QueuedCount() == 16 && scheduler.QueuedBytes() == 7 * 300 + 9 * 10);
+
+    std::vector<Batch> batches;
+    CHECK(scheduler.Flush(Recorder(&batches)) == 5);
+    CHECK(scheduler.QueuedCount() == 0 && scheduler.QueuedBytes() == 0);
+
+    const std::vector<std::vector<int>> expected = { { 0, 1, 2 }, { 3, 4, 5 }, { 6, 7, 8, 9 }, { 10, 11, 12, 13 }, { 14, 15 } };
+    CHECK(batches.size() == expected.size());
+    for (size_t b = 0; b < batches.size() && b < expected.size(); b++)
+    {
+        CHECK(batches[b].uploads == expected[b]);
+        CHECK(batches[b].uploads.size() <= 4 && batches[b].bytes <= 1000);
+    }
+    CHECK(batches[0].bytes == 900 && batches[2].bytes == 330);
+    CHECK(fence.GetLastSignaledValue() == 5);
+
+    // Exactly the budget still fits in one batch.
+    scheduler.Enqueue(100, 500);
+    scheduler.Enqueue(101, 500);
+    batches.clear();
+    CHECK(scheduler.Flush(Recorder(&batches)) == 1 && batches[0].bytes == 1000);
+
+    // Nothing queued, nothing submitted.
+    CHECK(scheduler.Flush(Recorder(&batches)) == 0 && fence.GetLastSignaledValue() == 6);
+}
+
+static void TestOversized()
+{
+    MockGpuFence fence;
+    Scheduler    scheduler(&fence, 1000, 8);
+    scheduler.Enqueue(0, 100);
+    scheduler.Enqueue(1, 5000);
+    scheduler.Enqueue(2, 100);
+    scheduler.Enqueue(3, 1001);
+
+    std::vector<Batch> batches;
+    CHECK(scheduler.Flush(Recorder(&batches)) == 4);
+    CHECK(batches.size() == 4);
+    CHECK(batches[0].uploads == std::vector<int>{ 0 });
+    CHECK(batches[1].uploads == std::vector<int>{ 1 } && batches[1].bytes == 5000);
+    CHECK(batches[2].uploads == std::vector<int>{ 2 });
+    CHECK(batches[3].uploads == std::vector<int>{ 3 } && batches[3].bytes == 1001);
+}
+
+// The submit callback refuses, as it does when the copy queue's command lists run out.
+static void TestRefusedBatch()
+{
+    MockGpuFence fence;
+    Scheduler    scheduler(&fence, 1000, 2);
+    CopyTicket   tickets[6];
+    for (int i = 0; i < 6; i++)
+    {
+        tickets[i] = scheduler.Enqueue(i, 100);
+    }
+
+    // The second batch is refused; it and everything after stay queued, with no fence signalled.
+    std::vector<Batch> batches;
+    CHECK(scheduler.Flush(Recorder(&batches, 1)) == 1);
+    CHECK(batches.size() == 1 && batches[0].uploads == (std::vector<int>{ 0, 1 }));
+    CHECK(fence.GetLastSignaledValue() == 1);
+    CHECK(scheduler.QueuedCount() == 4 && scheduler.QueuedBytes() == 400);
+    CHECK(scheduler.FenceValue(tickets[1]) == 1);
+    CHECK(scheduler.FenceValue(tickets[2]) == 0);
+
+    // Refused outright: nothing moves.
+    CHECK(scheduler.Flush(Recorder(&batches, 0)) == 0);
+    CHECK(scheduler.QueuedCount() == 4 && fence.GetLastSignaledValue() == 1);
+
+    // Uploads queued meanwhile go after the refused ones.
+    CopyTicket late = scheduler.Enqueue(6, 100);
+    batches.clear();
+    CHECK(scheduler.Flush(Recorder(&batches)) == 3);
+    CHECK(batches.size() == 3);
+    CHECK(batches[0].uploads == (std::vector<int>{ 2, 3 }));
+    CHECK(batches[1].uploads == (std::vector<int>{ 4, 5 }));
+    CHECK(batches[2].uploads == std::vector<int>{ 6 });
+    CHECK(scheduler.FenceValue(tickets[2]) == 2 && scheduler.FenceValue(tickets[5]) == 3 && scheduler.FenceValue(late) == 4);
+}
+
+static void TestTickets()
+{
+    MockGpuFence fence;
+    Scheduler    scheduler(&fence, 1000, 3);
+
+    std::vector<CopyTicket> tickets;
+    for (int i = 0; i < 8; i++)
+    {
+        tickets.push_back(scheduler.Enqueue(i, 10));
+    }
+    CHECK(tickets.front() != CopyTicketInvalid);
+    for (size_t i = 1; i < tickets.size(); i++)
+    {
+        CHECK(tickets[i] == tickets[i - 1] + 1);
+    }
+
+    // Not submitted yet: no fence value and not complete.
+    CHECK(scheduler.FenceValue(tickets[0]) == 0 && !scheduler.IsComplete(tickets[0]));
+
+    std::vector<Batch> batches;
+    CHECK(scheduler.Flush(Recorder(&batches)) == 3);
+    const uint64_t expected[] = { 1, 1, 1, 2, 2, 2, 3, 3 };
+    for (size_t i = 0; i < tickets.size(); i++)
+    {
+        CHECK(scheduler.FenceValue(tickets[i]) == expected[i]);
+        CHECK(!scheduler.IsComplete(tickets[i]));
+    }
+
+    // Complete with their batch, and keep reporting their fence value once pruned.
+    fence.Complete(2);
+    for (size_t i = 0; i < tickets.size(); i++)
+    {
+        CHECK(scheduler.IsComplete(tickets[i]) == (expected[i] <= 2));
+    }
+    CHECK(scheduler.FenceValue(tickets[5]) == 2 && scheduler.FenceValue(tickets[7]) == 3);
+
+    fence.CompleteAll();
+    CHECK(scheduler.IsComplete(tickets[7]) && scheduler.FenceValue(tickets[7]) == 3);
+
+    // A fence signalled by something else between flushes does not confuse the mapping.
+    CopyTicket next = scheduler.Enqueue(8, 10);
+    fence.Signal();
+    CHECK(scheduler.Flush(Recorder(&batches)) == 1);
+    CHECK(scheduler.FenceValue(next) == 5 && !scheduler.IsComplete(next));
+    fence.Complete(4);
+    CHECK(!scheduler.IsComplete(next));
+    fence.Complete(5);
+    CHECK(scheduler.IsComplete(next));
+}
+
+// Producers enqueue while the flushing thread keeps submitting; every upload is submitted exactly
+// once, tickets stay in order within each batch, and all complete.
+static void TestConcurrentEnqueue()
+{
+    const int       ProducerCount = 4, PerProducer = 5000;
+    MockGpuFence    fence;
+    Scheduler       scheduler(&fence, 64 * 1024, 16);
+
+    std::vector<std::vector<CopyTicket>> tickets(ProducerCount);
+    std::vector<std::thread>             producers;
+    std::atomic<int>                     running{ ProducerCount };
+    for (int p = 0; p < ProducerCount; p++)
+    {
+        producers.emplace_back([&, p]
+        {
+            for (int i = 0; i < PerProducer; i++)
+            {
+                tickets[p].push_back(scheduler.Enqueue(p * PerProducer + i, 1000 + i % 7000));
+            }
+            running--;
+        });
+    }
+
+    std::vector<int>   seen(ProducerCount * PerProducer, 0);
+    std::vector<Batch> batches;
+    auto               submit = Recorder(&batches);
+    while (running > 0 || scheduler.QueuedCount() > 0)
+    {
+        size_t before = batches.size();
+        scheduler.Flush(submit);
+        for (size_t b = before; b < batches.size(); b++)
+        {
+            CHECK(batches[b].uploads.size() <= 16 && (batches[b].uploads.size() == 1 || batches[b].bytes <= 64 * 1024));
+            for (int upload : batches[b].uploads)
+            {
+                seen[upload]++;
+            }
+        }
+        fence.CompleteAll();
+    }
+    for (std::thread& producer : producers)
+    {
+        producer.join();
+    }
+
+    bool once = true;
+    for (int count : seen)
+    {
+        once = once && count == 1;
+    }
+    CHECK(once);
+    for (const std::vector<CopyTicket>& list : tickets)
+    {
+        for (CopyTicket ticket : list)
+        {
+            CHECK(scheduler.IsComplete(ticket));
+        }
+    }
+    CHECK(fence.GetLastSignaledValue() == batches.size());
+}
+
+int main()
+{
+    TestLimits();
+    TestOversized();
+    TestRefusedBatch();
+    TestTickets();
+    TestConcurrentEnqueue();
+    return TestResult("CopyBatchSchedulerTests");
+}
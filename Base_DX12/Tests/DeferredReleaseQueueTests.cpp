@@ -0,0 +1,238 @@
+// DeferredReleaseQueue over a mock fence and a fake COM object that counts its references and
+// logs the order it was released in: nothing goes before its fence value, oldest value first,
+// within the per-call budget, exactly once, and Flush and the destructor leave nothing behind.
+
+#include "TestCommon.h"
+#include "DeferredReleaseQueue.h"
+#include "MockGpuFence.h"
+
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Stands in for IUnknown. Release logs the object's id the moment its last reference goes.
+class FakeComObject
+{
+public:
+    FakeComObject(int _id, std::vector<int>* _releaseLog, std::mutex* _logMutex)
+        : m_id(_id), m_releaseLog(_releaseLog), m_logMutex(_logMutex)
+    {
+    }
+
+    unsigned long AddRef() { return ++m_refs; }
+
+    unsigned long Release()
+    {
+        unsigned long refs = --m_refs;
+        CHECK(refs != static_cast<unsigned long>(-1));
+        if (refs == 0)
+        {
+            std::lock_guard<std::mutex> lock(*m_logMutex);
+            m_releaseLog->push_back(m_id);
+        }
+        return refs;
+    }
+
+    unsigned long Refs() const { return m_refs; }
+
+private:
+    int                         m_id;
+    std::atomic<unsigned long>  m_refs{ 1 };
+    std::vector<int>*           m_releaseLog;
+    std::mutex*                 m_logMutex;
+};
+
+struct ObjectSet
+{
+    std::vector<int>                            log;
+    std::mutex                                  logMutex;
+    std::vector<std::unique_ptr<FakeComObject>> objects;
+
+    FakeComObject* Make()
+    {
+        objects.push_back(std::make_unique<FakeComObject>(static_cast<int>(objects.size()), &log, &logMutex));
+        return objects.back().get();
+    }
+};
+
+// Objects go only once the fence passes their value, oldest value first whatever order they were deferred in.
+static void TestFenceOrder()
+{
+    MockGpuFence                        fence;
+    ObjectSet                           set;
+    DeferredReleaseQueue<FakeComObject> queue(&fence);
+
+    uint64_t v1 = fence.Signal();
+    uint64_t v2 = fence.Signal();
+    uint64_t v3 = fence.Signal();
+    FakeComObject* a = set.Make();
+    FakeComObject* b = set.Make();
+    FakeComObject* c = set.Make();
+    queue.Defer(a, v3);
+    queue.Defer(b, v1);
+    queue.Defer(c, v2);
+    queue.Defer(nullptr, v1);
+    CHECK(queue.Pending() == 3);
+
+    CHECK(queue.Collect(16) == 0);
+    CHECK(set.log.empty());
+
+    fence.Complete(v2);
+    CHECK(queue.Collect(16) == 2);
+    CHECK((set.log == std::vector<int>{ 1, 2 }));
+    CHECK(a->Refs() == 1);
+
+    fence.Complete(v3);
+    CHECK(queue.Collect(16) == 1);
+    CHECK((set.log == std::vector<int>{ 1, 2, 0 }));
+    CHECK(queue.Released() == 3);
+    CHECK(queue.Pending() == 0);
+    CHECK(queue.PeakPending() == 3);
+}
+
+// Only the queue's reference is dropped; the caller's own stays alive.
+static void TestReleasesOneReference()
+{
+    MockGpuFence                        fence;
+    ObjectSet                           set;
+    DeferredReleaseQueue<FakeComObject> queue(&fence);
+
+    FakeComObject* shared = set.Make();
+    shared->AddRef();
+    queue.Defer(shared, fence.Signal());
+    fence.CompleteAll();
+    queue.Collect(16);
+    CHECK(shared->Refs() == 1);
+    CHECK(set.log.empty());
+    shared->Release();
+    CHECK(set.log.size() == 1);
+}
+
+// A burst is spread over several calls; every call that leaves completed work behind is counted.
+static void TestBudget()
+{
+    MockGpuFence                        fence;
+    ObjectSet                           set;
+    DeferredReleaseQueue<FakeComObject> queue(&fence);
+
+    uint64_t value = fence.Signal();
+    for (int i = 0; i < 10; i++)
+    {
+        queue.Defer(set.Make(), value);
+    }
+    fence.CompleteAll();
+
+    CHECK(queue.Collect(4) == 4);
+    CHECK(queue.Collect(4) == 4);
+    CHECK(queue.Collect(4) == 2);
+    CHECK(queue.Collect(4) == 0);
+    CHECK(queue.OverBudget() == 2);
+    CHECK(set.log.size() == 10);
+
+    // Exactly filling the budget with nothing completed left over is not over budget.
+    value = fence.Signal();
+    for (int i = 0; i < 4; i++)
+    {
+        queue.Defer(set.Make(), value);
+    }
+    fence.CompleteAll();
+    CHECK(queue.Collect(4) == 4);
+    CHECK(queue.OverBudget() == 2);
+}
+
+// Flush waits for the GPU rather than dropping or leaking what is still in flight.
+static void TestFlushWaits()
+{
+    MockGpuFence                        fence;
+    ObjectSet                           set;
+    DeferredReleaseQueue<FakeComObject> queue(&fence);
+
+    for (int i = 0; i < 8; i++)
+    {
+        queue.Defer(set.Make(), fence.Signal());
+    }
+    std::thread gpu([&]
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        fence.CompleteAll();
+    });
+    queue.Flush();
+    gpu.join();
+    CHECK(set.log.size() == 8);
+    CHECK(queue.Pending() == 0);
+}
+
+static void TestDestructorFlushes()
+{
+    MockGpuFence fence;
+    ObjectSet    set;
+    {
+        DeferredReleaseQueue<FakeComObject> queue(&fence);
+        for (int i = 0; i < 5; i++)
+        {
+            queue.Defer(set.Make(), fence.Signal());
+        }
+        fence.CompleteAll();
+    }
+    CHECK(set.log.size() == 5);
+}
+
+// Several threads defer while one collects each "frame", as the render and service threads do.
+static void TestConcurrentDefer()
+{
+    const int ThreadCount   = 4;
+    const int PerThread     = 2000;
+
+    MockGpuFence                        fence;
+    ObjectSet                           set;
+    std::mutex                          submitMutex;
+    DeferredReleaseQueue<FakeComObject> queue(&fence);
+    for (int i = 0; i < ThreadCount * PerThread; i++)
+    {
+        set.Make();
+    }
+
+    std::atomic<int>         deferring{ ThreadCount };
+    std::vector<std::thread> threads;
+    for (int t = 0; t < ThreadCount; t++)
+    {
+        threads.emplace_back([&, t]
+        {
+            for (int i = 0; i < PerThread; i++)
+            {
+                std::lock_guard<std::mutex> lock(submitMutex);
+                queue.Defer(set.objects[t * PerThread + i].get(), fence.Signal());
+            }
+            deferring--;
+        });
+    }
+
+    size_t released = 0;
+    while (deferring > 0 || queue.Pending() > 0)
+    {
+        fence.CompleteAll();
+        released += queue.Collect(64);
+    }
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+    CHECK(released == static_cast<size_t>(ThreadCount * PerThread));
+    CHECK(set.log.size() == static_cast<size_t>(ThreadCount * PerThread));
+    for (const std::unique_ptr<FakeComObject>& object : set.objects)
+    {
+        CHECK(object->Refs() == 0);
+    }
+}
+
+int main()
+{
+    TestFenceOrder();
+    TestReleasesOneReference();
+    TestBudget();
+    TestFlushWaits();
+    TestDestructorFlushes();
+    TestConcurrentDefer();
+    return TestResult("DeferredReleaseQueueTests");
+}
@@ -0,0 +1,230 @@
+// IndexFreeList and DescriptorRingAllocator under threads: free list slots are never handed to two
+// owners at once, even with a handful of slots hammered by every thread, which is where a head
+// without its tag would fall to ABA. Ring ranges are contiguous, never straddle the end of the
+// heap, never overlap another live range, and only reuse space once the fence has passed it.
+
+#include "TestCommon.h"
+#include "DescriptorAllocator.h"
+#include "MockGpuFence.h"
+
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+static void TestFreeListBasics()
+{
+    IndexFreeList empty(0);
+    CHECK(empty.Allocate() == DescriptorInvalid);
+
+    const uint32_t    Capacity = 64;
+    IndexFreeList     list(Capacity);
+    std::vector<bool> seen(Capacity, false);
+    for (uint32_t i = 0; i < Capacity; i++)
+    {
+        uint32_t index = list.Allocate();
+        CHECK(index < Capacity && !seen[index]);
+        seen[index] = true;
+    }
+    CHECK(list.Allocate() == DescriptorInvalid);
+    CHECK(list.AllocatedCount() == Capacity);
+
+    // Last freed, first reused.
+    list.Free(17);
+    list.Free(3);
+    CHECK(list.Allocate() == 3);
+    CHECK(list.Allocate() == 17);
+    CHECK(list.Allocate() == DescriptorInvalid);
+}
+
+// Every slot records its owner; taking a slot someone else holds is the failure being looked for.
+static void TestFreeListThreads(uint32_t _capacity, uint32_t _iterations)
+{
+    const uint32_t                          ThreadCount = 4;
+    IndexFreeList                           list(_capacity);
+    std::unique_ptr<std::atomic<int>[]>     owners(new std::atomic<int>[_capacity]);
+    std::atomic<uint32_t>                   doubleOwned{ 0 };
+    for (uint32_t i = 0; i < _capacity; i++)
+    {
+        owners[i] = -1;
+    }
+
+    std::vector<std::thread> threads;
+    for (uint32_t t = 0; t < ThreadCount; t++)
+    {
+        threads.emplace_back([&, t]
+        {
+            std::mt19937          rng(t + 1);
+            std::vector<uint32_t> held;
+            for (uint32_t i = 0; i < _iterations; i++)
+            {
+                if (held.empty() || (rng() % 2 && held.size() < 8))
+                {
+                    uint32_t index = list.Allocate();
+                    if (index != DescriptorInvalid)
+                    {
+                        int expected = -1;
+                        doubleOwned += owners[index].compare_exchange_strong(expected, static_cast<int>(t)) ? 0 : 1;
+                        held.push_back(index);
+                    }
+                }
+                else
+                {
+                    size_t   pick  = rng() % held.size();
+                    uint32_t index = held[pick];
+                    held[pick] = held.back();
+                    held.pop_back();
+                    owners[index] = -1;
+                    list.Free(index);
+                }
+            }
+            for (uint32_t index : held)
+            {
+                owners[index] = -1;
+                list.Free(index);
+            }
+        });
+    }
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+
+    CHECK(doubleOwned == 0);
+    CHECK(list.AllocatedCount() == 0);
+
+    // Nothing lost or duplicated: every slot comes back exactly once.
+    std::vector<bool> seen(_capacity, false);
+    uint32_t          count = 0;
+    for (uint32_t index = list.Allocate(); index != DescriptorInvalid; index = list.Allocate())
+    {
+        CHECK(index < _capacity && !seen[index]);
+        seen[index] = true;
+        count++;
+    }
+    CHECK(count == _capacity);
+}
+
+static void TestRingBasics()
+{
+    MockGpuFence            fence;
+    DescriptorRingAllocator ring(&fence, 100);
+    uint32_t                first = DescriptorInvalid;
+
+    CHECK(!ring.Allocate(0, &first));
+    CHECK(!ring.Allocate(101, &first));
+
+    CHECK(ring.Allocate(60, &first) && first == 0);
+    CHECK(ring.Allocate(30, &first) && first == 60);
+    ring.EndFrame(fence.Signal());
+
+    // 20 more would straddle the end, so the table starts over at 0, which frame 1 still holds.
+    CHECK(!ring.Allocate(20, &first));
+    CHECK(ring.Allocate(10, &first) && first == 90);
+    ring.Retire();
+    CHECK(ring.InUse() == 100);
+
+    fence.Complete(1);
+    ring.Retire();
+    CHECK(ring.InUse() == 10);
+    CHECK(ring.Allocate(20, &first) && first == 0);
+    CHECK(ring.InUse() == 30);
+    ring.EndFrame(fence.Signal());
+
+    // A table the size of the whole heap fits once everything before it has retired, even though
+    // reaching slot 0 skips the rest of the heap.
+    CHECK(!ring.Allocate(100, &first));
+    fence.CompleteAll();
+    ring.Retire();
+    CHECK(ring.InUse() == 0);
+    CHECK(ring.Allocate(100, &first) && first == 0);
+}
+
+// Threads carve tables for a frame while the GPU trails behind by a few frames.
+static void TestRingThreads()
+{
+    const uint32_t Capacity = 1024, ThreadCount = 4, PerThread = 16, Frames = 300;
+    MockGpuFence            fence;
+    DescriptorRingAllocator ring(&fence, Capacity);
+    std::vector<uint64_t>   slotFrame(Capacity, 0);     // Fence value of the frame that last used each slot.
+    std::mt19937            rng(3);
+    uint32_t                failed = 0, allocated = 0;
+
+    struct Range
+    {
+        uint32_t first;
+        uint32_t count;
+    };
+
+    for (uint32_t frame = 0; frame < Frames; frame++)
+    {
+        ring.Retire();
+        uint64_t completed = fence.GetCompletedValue();
+        uint64_t value     = fence.GetLastSignaledValue() + 1;
+
+        std::vector<std::vector<Range>> ranges(ThreadCount);
+        std::vector<uint32_t>           failures(ThreadCount, 0);
+        std::vector<std::thread>        threads;
+        for (uint32_t t = 0; t < ThreadCount; t++)
+        {
+            threads.emplace_back([&, t, seed = rng()]
+            {
+                std::mt19937 local(seed);
+                for (uint32_t i = 0; i < PerThread; i++)
+                {
+                    Range range = { 0, 1 + static_cast<uint32_t>(local() % 12) };
+                    if (ring.Allocate(range.count, &range.first))
+                    {
+                        ranges[t].push_back(range);
+                    }
+                    else
+                    {
+                        failures[t]++;
+                    }
+                }
+            });
+        }
+        for (std::thread& thread : threads)
+        {
+            thread.join();
+        }
+
+        for (uint32_t t = 0; t < ThreadCount; t++)
+        {
+            failed += failures[t];
+            for (const Range& range : ranges[t])
+            {
+                CHECK(range.first + range.count <= Capacity);
+                for (uint32_t s = range.first; s < range.first + range.count; s++)
+                {
+                    CHECK(slotFrame[s] != value && slotFrame[s] <= completed);
+                    slotFrame[s] = value;
+                }
+                allocated++;
+            }
+        }
+        CHECK(ring.InUse() <= Capacity);
+
+        CHECK(fence.Signal() == value);
+        ring.EndFrame(value);
+
+        // Mostly two or three frames behind, now and then a stall that fills the ring.
+        uint64_t lag = frame % 50 < 45 ? 2 + rng() % 2 : 12;
+        if (value > lag)
+        {
+            fence.Complete(value - lag);
+        }
+    }
+    std::printf("ring: %u tables, %u refused while the GPU was behind\n", allocated, failed);
+    CHECK(failed > 0 && allocated > failed);
+}
+
+int main()
+{
+    TestFreeListBasics();
+    TestFreeListThreads(4, 200000);
+    TestFreeListThreads(256, 200000);
+    TestRingBasics();
+    TestRingThreads();
+    return TestResult("DescriptorAllocatorTests");
+}
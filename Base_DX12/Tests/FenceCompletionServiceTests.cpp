@@ -0,0 +1,214 @@
+// FenceCompletionService: many producers enqueueing on several mock fences while a "GPU" thread
+// completes them out of step; every continuation must run once, after its value, in value order
+// per fence, and register its value with the fence no more than once. Also waking on completion
+// rather than polling, timeouts, continuations that enqueue more, Drain, and shutdown with work
+// pending.
+
+#include "TestCommon.h"
+#include "FenceCompletionService.h"
+#include "MockGpuFence.h"
+
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+static void TestStress()
+{
+    const uint32_t FenceCount       = 4;
+    const uint32_t ProducerCount    = 4;
+    const uint32_t PerProducer      = 5000;
+
+    // Signalling and enqueueing happen under the fence's lock, as a queue's submissions are ordered.
+    std::vector<std::unique_ptr<MockGpuFence>> fences;
+    std::vector<std::mutex>                    submitMutexes(FenceCount);
+    for (uint32_t f = 0; f < FenceCount; f++)
+    {
+        fences.push_back(std::make_unique<MockGpuFence>());
+    }
+
+    // Per fence, the values continuations ran for, in the order they ran. Only the service thread writes.
+    std::vector<std::vector<uint64_t>> ranValues(FenceCount);
+    std::atomic<uint32_t>              early{ 0 };
+    std::atomic<uint32_t>              timedOut{ 0 };
+    std::atomic<bool>                  producing{ true };
+
+    FenceCompletionService service;
+    std::vector<std::thread> producers;
+    for (uint32_t p = 0; p < ProducerCount; p++)
+    {
+        producers.emplace_back([&, p]
+        {
+            std::mt19937 rng(p + 1);
+            for (uint32_t i = 0; i < PerProducer; i++)
+            {
+                uint32_t                    f       = rng() % FenceCount;
+                MockGpuFence*               fence   = fences[f].get();
+                std::lock_guard<std::mutex> lock(submitMutexes[f]);
+                uint64_t                    value   = fence->Signal();
+                service.Enqueue(fence, value, [&, f, fence, value](bool _reached)
+                {
+                    early    += fence->GetCompletedValue() < value ? 1 : 0;
+                    timedOut += _reached ? 0 : 1;
+                    ranValues[f].push_back(value);
+                });
+            }
+        });
+    }
+
+    // The GPU trails the producers, completing each fence in uneven steps.
+    std::thread gpu([&]
+    {
+        std::mt19937 rng(99);
+        while (producing)
+        {
+            MockGpuFence& fence = *fences[rng() % FenceCount];
+            uint64_t      last  = fence.GetLastSignaledValue();
+            uint64_t      done  = fence.GetCompletedValue();
+            fence.Complete(done + (last > done ? rng() % (last - done + 1) : 0));
+            std::this_thread::yield();
+        }
+        for (auto& fence : fences)
+        {
+            fence->CompleteAll();
+        }
+    });
+
+    for (std::thread& producer : producers)
+    {
+        producer.join();
+    }
+    producing = false;
+    gpu.join();
+    service.Drain();
+
+    CHECK(service.Pending() == 0);
+    CHECK(service.Reached() == ProducerCount * PerProducer);
+    CHECK(service.TimedOut() == 0 && timedOut == 0);
+    CHECK(early == 0);
+
+    // Each fence's values were signalled once each, so they run as exactly 1..n, in order.
+    uint64_t total = 0, registrations = 0;
+    for (uint32_t f = 0; f < FenceCount; f++)
+    {
+        bool ordered = true;
+        for (size_t i = 0; i < ranValues[f].size(); i++)
+        {
+            ordered = ordered && ranValues[f][i] == i + 1;
+        }
+        CHECK(ordered);
+        CHECK(ranValues[f].size() == fences[f]->GetLastSignaledValue());
+        total           += ranValues[f].size();
+        registrations   += fences[f]->Registrations();
+        CHECK(fences[f]->PendingRegistrations() == 0);
+    }
+    CHECK(total == ProducerCount * PerProducer);
+    CHECK(registrations <= total);
+}
+
+// An idle wait registers once and sleeps until the fence wakes it, however long that takes.
+static void TestWakeOnCompletion()
+{
+    MockGpuFence           fence;
+    FenceCompletionService service;
+    std::atomic<bool>      ran{ false };
+    std::chrono::steady_clock::time_point ranAt;
+    service.Enqueue(&fence, fence.Signal(), [&](bool _reached)
+    {
+        ranAt = std::chrono::steady_clock::now();
+        ran   = _reached;
+    });
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    CHECK(!ran);
+    CHECK(fence.Registrations() == 1 && fence.PendingRegistrations() == 1);
+
+    auto completedAt = std::chrono::steady_clock::now();
+    fence.CompleteAll();
+    service.Drain();
+    CHECK(ran);
+    CHECK(std::chrono::duration<double>(ranAt - completedAt).count() < 0.02);
+    CHECK(fence.Registrations() == 1 && fence.PendingRegistrations() == 0);
+}
+
+static void TestTimeout()
+{
+    MockGpuFence           fence;
+    FenceCompletionService service;
+    std::atomic<int>       result{ -1 };
+    auto                   start = std::chrono::steady_clock::now();
+    service.Enqueue(&fence, 5, [&](bool _reached) { result = _reached ? 1 : 0; }, 30);
+
+    // A reachable request on the same fence is not held up by the hung one.
+    std::atomic<bool> later{ false };
+    service.Enqueue(&fence, 1, [&](bool _reached) { later = _reached; });
+    fence.Complete(1);
+    service.Drain();
+
+    CHECK(result == 0 && later);
+    CHECK(SecondsSince(start) >= 0.025);
+    CHECK(service.TimedOut() == 1 && service.Reached() == 1);
+}
+
+static void TestChainedContinuations()
+{
+    MockGpuFence           fence;
+    FenceCompletionService service;
+    std::atomic<uint32_t>  steps{ 0 };
+
+    // Each step enqueues the next on a later value, like readback feeding another submission.
+    std::function<void(bool)> step = [&](bool _reached)
+    {
+        CHECK(_reached);
+        if (++steps < 10)
+        {
+            service.Enqueue(&fence, fence.Signal(), step);
+        }
+    };
+    service.Enqueue(&fence, fence.Signal(), step);
+
+    std::thread gpu([&]
+    {
+        while (steps < 10)
+        {
+            fence.CompleteAll();
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    });
+    gpu.join();
+    service.Drain();
+    CHECK(steps == 10 && service.Reached() == 10);
+}
+
+// Destroying the service waits for what is still pending rather than dropping it.
+static void TestShutdownRunsPending()
+{
+    MockGpuFence     fence;
+    std::atomic<int> ran{ 0 };
+    std::thread      gpu;
+    {
+        FenceCompletionService service;
+        for (int i = 0; i < 100; i++)
+        {
+            service.Enqueue(&fence, fence.Signal(), [&](bool _reached) { ran += _reached ? 1 : 0; });
+        }
+        gpu = std::thread([&]
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            fence.CompleteAll();
+        });
+    }
+    gpu.join();
+    CHECK(ran == 100);
+}
+
+int main()
+{
+    TestStress();
+    TestWakeOnCompletion();
+    TestTimeout();
+    TestChainedContinuations();
+    TestShutdownRunsPending();
+    return TestResult("FenceCompletionServiceTests");
+}
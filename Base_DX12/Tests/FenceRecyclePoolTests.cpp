@@ -0,0 +1,172 @@
+// FenceRecyclePool over a mock fence with integer items: reuse only once the fence passes, the
+// cap making Acquire wait, trimming to the high-water mark, and Discard taking a broken item out
+// of circulation rather than handing it straight back.
+
+#include "TestCommon.h"
+#include "FenceRecyclePool.h"
+#include "MockGpuFence.h"
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+struct PoolHarness
+{
+    MockGpuFence            fence;
+    int                     nextItem = 1;
+    std::vector<int>        destroyed;
+    FenceRecyclePool<int>   pool;
+
+    PoolHarness(uint32_t _maxItems, uint32_t _windowLength)
+        : pool(&fence,
+               [this](int* _item) { *_item = nextItem++; return true; },
+               [this](int& _item) { destroyed.push_back(_item); },
+               _maxItems, _windowLength)
+    {
+    }
+};
+
+static void TestReuseAfterFence()
+{
+    PoolHarness h(0, 4);
+    int a = 0;
+    CHECK(h.pool.Acquire(&a));
+    h.pool.Retire(a, h.fence.Signal());
+
+    // Still in flight: a new item.
+    int b = 0;
+    CHECK(h.pool.Acquire(&b));
+    CHECK(b != a);
+    CHECK(h.pool.Created() == 2);
+
+    h.fence.CompleteAll();
+    int c = 0;
+    CHECK(h.pool.Acquire(&c));
+    CHECK(c == a);
+    CHECK(h.pool.Created() == 2);
+    h.pool.Retire(b, 0);
+    h.pool.Retire(c, 0);
+}
+
+// Retired items come back oldest fence first, whatever order they were retired in.
+static void TestFenceOrder()
+{
+    PoolHarness h(0, 4);
+    int items[3] = {};
+    for (int& item : items)
+    {
+        CHECK(h.pool.Acquire(&item));
+    }
+    uint64_t v1 = h.fence.Signal();
+    uint64_t v2 = h.fence.Signal();
+    uint64_t v3 = h.fence.Signal();
+    h.pool.Retire(items[0], v3);
+    h.pool.Retire(items[1], v1);
+    h.pool.Retire(items[2], v2);
+    h.fence.CompleteAll();
+
+    int out = 0;
+    CHECK(h.pool.Acquire(&out) && out == items[1]);
+    CHECK(h.pool.Acquire(&out) && out == items[2]);
+    CHECK(h.pool.Acquire(&out) && out == items[0]);
+}
+
+// At the cap Acquire waits for the oldest retired item, and fails only if nothing is retired.
+static void TestCap()
+{
+    PoolHarness h(2, 4);
+    int a = 0, b = 0, c = 0;
+    CHECK(h.pool.Acquire(&a));
+    CHECK(h.pool.Acquire(&b));
+    CHECK(!h.pool.Acquire(&c));
+
+    uint64_t value = h.fence.Signal();
+    h.pool.Retire(a, value);
+    std::thread gpu([&]
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        h.fence.Complete(value);
+    });
+    CHECK(h.pool.Acquire(&c));
+    gpu.join();
+    CHECK(c == a);
+    CHECK(h.pool.CapWaits() == 1);
+    CHECK(h.pool.Owned() == 2);
+}
+
+// A burst grows the pool; once it falls out of the window, Trim destroys the idle surplus.
+static void TestTrimToHighWater()
+{
+    const uint32_t Window = 3;
+    PoolHarness h(0, Window);
+
+    std::vector<int> burst(8);
+    for (int& item : burst)
+    {
+        CHECK(h.pool.Acquire(&item));
+    }
+    uint64_t value = h.fence.Signal();
+    for (int item : burst)
+    {
+        h.pool.Retire(item, value);
+    }
+    h.fence.CompleteAll();
+    h.pool.Trim();
+    CHECK(h.pool.HighWater() == 8);
+    CHECK(h.destroyed.empty());
+
+    // Steady frames of two items push the burst out of the window.
+    for (uint32_t frame = 0; frame < Window + 1; frame++)
+    {
+        int x = 0, y = 0;
+        CHECK(h.pool.Acquire(&x));
+        CHECK(h.pool.Acquire(&y));
+        uint64_t frameValue = h.fence.Signal();
+        h.pool.Retire(x, frameValue);
+        h.pool.Retire(y, frameValue);
+        h.fence.CompleteAll();
+        h.pool.Trim();
+    }
+    CHECK(h.pool.HighWater() == 2);
+    CHECK(h.pool.Owned() == 2);
+    CHECK(h.destroyed.size() == 6);
+    CHECK(h.pool.Created() == 8);
+}
+
+// The CommandListPool reset-failure path: a discarded item is destroyed, not retired, so the
+// next Acquire never sees it again and the counts stay balanced.
+static void TestDiscard()
+{
+    PoolHarness h(2, 4);
+    int bad = 0;
+    CHECK(h.pool.Acquire(&bad));
+    h.pool.Discard(bad);
+    CHECK(h.destroyed.size() == 1 && h.destroyed[0] == bad);
+    CHECK(h.pool.Owned() == 0);
+    CHECK(h.pool.Destroyed() == 1);
+
+    // The slot it held is free again: the cap still allows two.
+    int a = 0, b = 0;
+    CHECK(h.pool.Acquire(&a));
+    CHECK(h.pool.Acquire(&b));
+    CHECK(a != bad && b != bad);
+
+    // Discarding with others retired leaves them in line.
+    h.pool.Retire(a, 0);
+    h.pool.Discard(b);
+    int c = 0;
+    CHECK(h.pool.Acquire(&c));
+    CHECK(c == a);
+    CHECK(h.pool.Owned() == 1);
+    h.pool.Retire(c, 0);
+}
+
+int main()
+{
+    TestReuseAfterFence();
+    TestFenceOrder();
+    TestCap();
+    TestTrimToHighWater();
+    TestDiscard();
+    return TestResult("FenceRecyclePoolTests");
+}
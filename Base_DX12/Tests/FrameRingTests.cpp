@@ -0,0 +1,94 @@
+// FrameRing over a mock fence: the first N frames never wait, BeginFrame blocks only when it comes
+// back round to a slot whose previous frame has not completed, and returns as soon as that one
+// frame does, however far behind the frames after it are. WaitIdle waits for the last submission.
+
+#include "TestCommon.h"
+#include "FrameRing.h"
+#include "MockGpuFence.h"
+
+#include <thread>
+
+// Runs _call on another thread; true if it is still blocked after a while, or returned at all
+// once _release has run.
+template <typename Call, typename Release>
+static bool BlocksUntil(Call _call, Release _release)
+{
+    std::atomic<bool> returned{ false };
+    std::thread       thread([&] { _call(); returned = true; });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    bool blocked = !returned;
+    _release();
+    thread.join();
+    return blocked && returned;
+}
+
+static void TestSlots()
+{
+    const uint32_t Frames = 3;
+    MockGpuFence   fence;
+    FrameRing      ring(&fence, Frames);
+    CHECK(ring.FrameCount() == Frames && ring.FramesSubmitted() == 0);
+
+    // Nothing completes, yet the first N frames go straight through to their own slots.
+    for (uint32_t i = 0; i < Frames; i++)
+    {
+        CHECK(ring.FrameFenceValue(i) == 0);
+        CHECK(ring.BeginFrame() == i && ring.CurrentFrame() == i);
+        CHECK(ring.EndFrame() == i + 1);
+        CHECK(ring.FrameFenceValue(i) == i + 1);
+    }
+    CHECK(ring.FramesSubmitted() == Frames);
+
+    // Back at slot 0, whose frame is still on the GPU: it waits for that frame and no other.
+    uint32_t slot = Frames;
+    CHECK(BlocksUntil([&] { slot = ring.BeginFrame(); }, [&] { fence.Complete(1); }));
+    CHECK(slot == 0);
+    CHECK(fence.GetCompletedValue() == 1);
+    CHECK(ring.EndFrame() == 4 && ring.FrameFenceValue(0) == 4);
+
+    // Slot 1's frame finishes while 3 and 4 are still pending: no wait at all.
+    fence.Complete(2);
+    CHECK(ring.BeginFrame() == 1);
+    CHECK(ring.EndFrame() == 5);
+
+    // Slot 2 waits on value 3 only; completing beyond it releases it just the same.
+    CHECK(BlocksUntil([&] { slot = ring.BeginFrame(); }, [&] { fence.Complete(4); }));
+    CHECK(slot == 2);
+    ring.EndFrame();
+
+    // Slot 0 now holds 4, already complete.
+    CHECK(ring.BeginFrame() == 0);
+    ring.EndFrame();
+    CHECK(ring.FramesSubmitted() == 7 && fence.GetLastSignaledValue() == 7);
+}
+
+static void TestWaitIdle()
+{
+    MockGpuFence fence;
+    FrameRing    ring(&fence, 2);
+
+    // Nothing submitted: nothing to wait for.
+    ring.WaitIdle();
+
+    ring.BeginFrame();
+    ring.EndFrame();
+    ring.BeginFrame();
+    ring.EndFrame();
+    fence.Complete(1);
+
+    // Waits for the last frame even though its slot's neighbour is done.
+    CHECK(BlocksUntil([&] { ring.WaitIdle(); }, [&] { fence.Complete(2); }));
+
+    // A single slot waits for the frame before on every BeginFrame.
+    FrameRing single(&fence, 1);
+    CHECK(single.BeginFrame() == 0);
+    CHECK(single.EndFrame() == 3);
+    CHECK(BlocksUntil([&] { single.BeginFrame(); }, [&] { fence.Complete(3); }));
+}
+
+int main()
+{
+    TestSlots();
+    TestWaitIdle();
+    return TestResult("FrameRingTests");
+}
@@ -0,0 +1,181 @@
+// GpuProfileStats: aggregation of synthetic timestamps into the scope tree, skipped scopes, the
+// trace window and its JSON, and GpuScopeFrame's bookkeeping under concurrent recording.
+
+#include "TestCommon.h"
+#include "GpuProfileStats.h"
+
+#include <cmath>
+#include <thread>
+#include <vector>
+
+static const uint64_t Frequency = 10000000;    // 10 MHz, 10 ticks per microsecond.
+
+static bool Near(double _a, double _b)
+{
+    return std::fabs(_a - _b) < 1e-9;
+}
+
+// One frame of the sample's shape: Frame > { Cull, Clear, Draw > { Range 0, Range 1 } }, with Draw
+// taking _drawTicks and starting at _start.
+static void AddSampleFrame(GpuProfileStats& _stats, uint64_t _frameIndex, uint64_t _start, uint64_t _drawTicks)
+{
+    std::vector<GpuScopeRecord> scopes =
+    {
+        { "Frame",   GpuScopeRoot, true, true },
+        { "Cull",    0,            true, true },
+        { "Clear",   0,            true, true },
+        { "Draw",    0,            true, true },
+        { "Range 0", 3,            true, true },
+        { "Range 1", 3,            true, true },
+    };
+    uint64_t draw = _start + 300;
+    std::vector<uint64_t> timestamps =
+    {
+        _start,         draw + _drawTicks + 50,
+        _start + 10,    _start + 200,
+        _start + 200,   _start + 300,
+        draw,           draw + _drawTicks,
+        draw,           draw + _drawTicks / 2,
+        draw,           draw + _drawTicks,
+    };
+    _stats.AddFrame(_frameIndex, scopes.data(), static_cast<uint32_t>(scopes.size()), timestamps.data(), Frequency);
+}
+
+static void TestAggregation()
+{
+    GpuProfileStats stats;
+    AddSampleFrame(stats, 0, 1000, 10000);  // Draw 1.0 ms.
+    AddSampleFrame(stats, 1, 50000, 30000); // Draw 3.0 ms.
+    AddSampleFrame(stats, 2, 90000, 20000); // Draw 2.0 ms.
+    CHECK(stats.FramesAdded() == 3);
+    CHECK(stats.Scopes().size() == 6);
+
+    uint32_t frame = stats.Find(GpuScopeRoot, "Frame");
+    uint32_t draw  = stats.Find(frame, "Draw");
+    uint32_t range = stats.Find(draw, "Range 0");
+    CHECK(frame != GpuScopeInvalid && draw != GpuScopeInvalid && range != GpuScopeInvalid);
+    CHECK(stats.Find(GpuScopeRoot, "Draw") == GpuScopeInvalid);
+
+    const GpuScopeStats& drawStats = stats.Scopes()[draw];
+    CHECK(drawStats.parent == frame && drawStats.depth == 1);
+    CHECK(drawStats.samples == 3);
+    CHECK(Near(drawStats.minMs, 1.0) && Near(drawStats.maxMs, 3.0) && Near(drawStats.lastMs, 2.0));
+    CHECK(Near(drawStats.AverageMs(), 2.0));
+
+    const GpuScopeStats& rangeStats = stats.Scopes()[range];
+    CHECK(rangeStats.depth == 2 && Near(rangeStats.totalMs, 3.0));
+    CHECK(Near(stats.Scopes()[stats.Find(frame, "Clear")].AverageMs(), 0.01));
+
+    // Parents precede their children.
+    for (uint32_t i = 0; i < stats.Scopes().size(); i++)
+    {
+        CHECK(stats.Scopes()[i].parent == GpuScopeRoot || stats.Scopes()[i].parent < i);
+    }
+}
+
+static void TestSkippedScopes()
+{
+    GpuProfileStats stats;
+    std::vector<GpuScopeRecord> scopes =
+    {
+        { "Frame",      GpuScopeRoot, true,  true  },
+        { "Unended",    0,            true,  false },
+        { "Child",      1,            true,  true  },   // Its parent is skipped, so it is too.
+        { "Backwards",  0,            true,  true  },
+        { "Good",       0,            true,  true  },
+    };
+    std::vector<uint64_t> timestamps = { 0, 1000, 10, 0, 20, 30, 500, 400, 600, 700 };
+    stats.AddFrame(0, scopes.data(), static_cast<uint32_t>(scopes.size()), timestamps.data(), Frequency);
+
+    uint32_t frame = stats.Find(GpuScopeRoot, "Frame");
+    CHECK(stats.Scopes().size() == 2);
+    CHECK(stats.Find(frame, "Unended") == GpuScopeInvalid);
+    CHECK(stats.Find(frame, "Backwards") == GpuScopeInvalid);
+    CHECK(stats.Find(frame, "Good") != GpuScopeInvalid);
+
+    // A frame without a frequency is ignored outright.
+    stats.AddFrame(1, scopes.data(), static_cast<uint32_t>(scopes.size()), timestamps.data(), 0);
+    CHECK(stats.FramesAdded() == 1);
+}
+
+static size_t Count(const std::string& _text, const std::string& _what)
+{
+    size_t count = 0;
+    for (size_t at = _text.find(_what); at != std::string::npos; at = _text.find(_what, at + 1))
+    {
+        count++;
+    }
+    return count;
+}
+
+static void TestTraceWindow()
+{
+    GpuProfileStats stats(4);
+    for (uint64_t frame = 0; frame < 10; frame++)
+    {
+        AddSampleFrame(stats, frame, 1000 + frame * 100000, 10000);
+    }
+
+    // Only the last four frames are kept, six events each; statistics keep every frame.
+    std::string trace = stats.ChromeTrace();
+    CHECK(Count(trace, "\"ph\":\"X\"") == 4 * 6);
+    CHECK(Count(trace, "\"frame\":5}") == 0 && Count(trace, "\"frame\":6}") == 6 && Count(trace, "\"frame\":9}") == 6);
+    CHECK(stats.Scopes()[stats.Find(GpuScopeRoot, "Frame")].samples == 10);
+
+    // Times are relative to the first timestamp, in microseconds: frame 9 starts 90 ms in.
+    CHECK(trace.find("\"name\":\"Frame\",\"cat\":\"gpu\",\"ph\":\"X\",\"pid\":0,\"tid\":0,\"ts\":90000.000000,\"dur\":1035.000000") != std::string::npos);
+    CHECK(trace.compare(0, 15, "{\"traceEvents\":") == 0 && trace.compare(trace.size() - 3, 3, "]}\n") == 0);
+
+    // Names are escaped.
+    GpuProfileStats quoted;
+    GpuScopeRecord  scope       = { "Say \"hi\"\\", GpuScopeRoot, true, true };
+    uint64_t        timestamps[] = { 0, 10 };
+    quoted.AddFrame(0, &scope, 1, timestamps, Frequency);
+    CHECK(quoted.ChromeTrace().find("\"name\":\"Say \\\"hi\\\"\\\\\"") != std::string::npos);
+}
+
+static void TestScopeFrame()
+{
+    GpuScopeFrame frame(64);
+    frame.Reset(7);
+    CHECK(frame.FrameIndex() == 7);
+
+    // Lists recorded on several threads add their scopes concurrently.
+    std::vector<std::thread> threads;
+    for (uint32_t t = 0; t < 4; t++)
+    {
+        threads.emplace_back([&frame]
+        {
+            for (uint32_t i = 0; i < 20; i++)
+            {
+                uint32_t scope = frame.Add("Range", GpuScopeRoot);
+                if (scope != GpuScopeInvalid)
+                {
+                    CHECK(frame.MarkBegun(scope) && frame.MarkEnded(scope));
+                }
+            }
+        });
+    }
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+    CHECK(frame.Scopes().size() == 64);
+    CHECK(frame.Add("Overflow", GpuScopeRoot) == GpuScopeInvalid);
+
+    // Each timestamp is written once; invalid scopes are refused.
+    CHECK(!frame.MarkBegun(0) && !frame.MarkEnded(0));
+    CHECK(!frame.MarkBegun(GpuScopeInvalid));
+
+    frame.Reset(8);
+    CHECK(frame.Scopes().empty() && frame.Add("Frame", GpuScopeRoot) == 0);
+}
+
+int main()
+{
+    TestAggregation();
+    TestSkippedScopes();
+    TestTraceWindow();
+    TestScopeFrame();
+    return TestResult("GpuProfileStatsTests");
+}
@@ -0,0 +1,72 @@
+// JobSystem scaling: synthetic draw recording split into one list per range, as the sample's
+// parallel recording does, timed from 1 to 64 workers against a serial baseline. Each draw burns a
+// fixed amount of work standing in for the driver's cost of recording it.
+
+#include "TestCommon.h"
+#include "JobSystem.h"
+
+#include <vector>
+
+static uint64_t RecordDraw(uint32_t _draw, uint32_t _work, std::vector<uint64_t>& _list)
+{
+    uint64_t state = _draw * 0x9E3779B97F4A7C15ull;
+    for (uint32_t i = 0; i < _work; i++)
+    {
+        state ^= state >> 13;
+        state *= 0xFF51AFD7ED558CCDull;
+    }
+    _list.push_back(state);
+    return state;
+}
+
+int main(int argc, char** argv)
+{
+    bool     quick      = QuickRun(argc, argv);
+    uint32_t drawCount  = quick ? 20000 : 200000;
+    uint32_t work       = 200;
+    uint32_t rangeCount = 64;
+    uint32_t repeats    = quick ? 1 : 5;
+
+    std::vector<uint64_t> serialList;
+    serialList.reserve(drawCount);
+    auto serialStart = std::chrono::steady_clock::now();
+    for (uint32_t repeat = 0; repeat < repeats; repeat++)
+    {
+        serialList.clear();
+        for (uint32_t draw = 0; draw < drawCount; draw++)
+        {
+            RecordDraw(draw, work, serialList);
+        }
+    }
+    double serialSeconds = SecondsSince(serialStart) / repeats;
+    std::printf("%u draws, %u lists, %u hardware threads\n", drawCount, rangeCount, std::thread::hardware_concurrency());
+    std::printf("serial       %8.2f ms\n", serialSeconds * 1000.0);
+
+    for (uint32_t workers : { 1u, 2u, 4u, 8u, 16u, 32u, 64u })
+    {
+        JobSystem                          jobs(workers);
+        std::vector<std::vector<uint64_t>> lists(rangeCount);
+        auto start = std::chrono::steady_clock::now();
+        for (uint32_t repeat = 0; repeat < repeats; repeat++)
+        {
+            jobs.ParallelFor(rangeCount, [&](uint32_t _range, uint32_t)
+            {
+                lists[_range].clear();
+                for (uint32_t draw = drawCount * _range / rangeCount; draw < drawCount * (_range + 1) / rangeCount; draw++)
+                {
+                    RecordDraw(draw, work, lists[_range]);
+                }
+            });
+        }
+        double seconds = SecondsSince(start) / repeats;
+
+        std::vector<uint64_t> merged;
+        for (const std::vector<uint64_t>& list : lists)
+        {
+            merged.insert(merged.end(), list.begin(), list.end());
+        }
+        CHECK(merged == serialList);
+        std::printf("%2u workers   %8.2f ms   %5.2fx\n", workers, seconds * 1000.0, serialSeconds / seconds);
+    }
+    return TestResult("JobSystemBench");
+}
@@ -0,0 +1,149 @@
+// JobSystem: coverage, per-thread state, nesting, concurrent waiters, and synthetic command
+// recording that must merge back into the serial order, as the parallel draw lists do.
+
+#include "TestCommon.h"
+#include "JobSystem.h"
+
+#include <ctime>
+#include <vector>
+
+static void TestParallelForCoversEveryIndexOnce(JobSystem& _jobs)
+{
+    for (uint32_t count : { 0u, 1u, 7u, 1000u, 100000u })
+    {
+        std::vector<std::atomic<uint32_t>> hits(count);
+        _jobs.ParallelFor(count, [&](uint32_t _index, uint32_t _threadIndex)
+        {
+            CHECK(_threadIndex <= _jobs.WorkerCount());
+            hits[_index]++;
+        });
+        for (uint32_t i = 0; i < count; i++)
+        {
+            CHECK(hits[i] == 1);
+        }
+    }
+}
+
+// One "command list" per job, each recording a range of draws, concatenated in job order.
+static void TestSyntheticRecordMatchesSerial(JobSystem& _jobs)
+{
+    const uint32_t drawCount = 50000;
+    std::vector<uint64_t> serial;
+    for (uint32_t draw = 0; draw < drawCount; draw++)
+    {
+        serial.push_back((static_cast<uint64_t>(draw) << 8) | 1);   // Set state.
+        serial.push_back((static_cast<uint64_t>(draw) << 8) | 2);   // Draw.
+    }
+
+    for (uint32_t rangeCount : { 1u, 4u, 13u, 64u })
+    {
+        std::vector<std::vector<uint64_t>> lists(rangeCount);
+        std::vector<uint32_t>              commandsPerThread(_jobs.WorkerCount() + 1, 0);
+        _jobs.ParallelFor(rangeCount, [&](uint32_t _range, uint32_t _threadIndex)
+        {
+            for (uint32_t draw = drawCount * _range / rangeCount; draw < drawCount * (_range + 1) / rangeCount; draw++)
+            {
+                lists[_range].push_back((static_cast<uint64_t>(draw) << 8) | 1);
+                lists[_range].push_back((static_cast<uint64_t>(draw) << 8) | 2);
+            }
+            // Per-thread state needs no lock: one thread per index.
+            commandsPerThread[_threadIndex] += static_cast<uint32_t>(lists[_range].size());
+        });
+
+        std::vector<uint64_t> merged;
+        for (const std::vector<uint64_t>& list : lists)
+        {
+            merged.insert(merged.end(), list.begin(), list.end());
+        }
+        CHECK(merged == serial);
+
+        uint32_t total = 0;
+        for (uint32_t commands : commandsPerThread)
+        {
+            total += commands;
+        }
+        CHECK(total == serial.size());
+    }
+}
+
+// Jobs that wait on their own sub-jobs keep running others meanwhile, so nesting cannot deadlock.
+static void TestNestedWait(JobSystem& _jobs)
+{
+    std::atomic<uint64_t> sum{ 0 };
+    _jobs.ParallelFor(32, [&](uint32_t _outer, uint32_t)
+    {
+        _jobs.ParallelFor(32, [&](uint32_t _inner, uint32_t)
+        {
+            sum += _outer * 32 + _inner;
+        });
+    });
+    CHECK(sum == 1024ull * 1023 / 2);
+}
+
+// Several threads outside the pool waiting at once share index WorkerCount(); no two jobs may
+// ever run under the same index at the same time, or per-thread state would be shared.
+static void TestConcurrentExternalWaiters(JobSystem& _jobs)
+{
+    std::vector<std::thread>                threads;
+    std::atomic<uint32_t>                   completed{ 0 }, sharedIndex{ 0 };
+    std::vector<std::atomic<uint32_t>>      busy(_jobs.WorkerCount() + 1);
+    for (uint32_t t = 0; t < 4; t++)
+    {
+        threads.emplace_back([&]
+        {
+            for (uint32_t round = 0; round < 50; round++)
+            {
+                JobCounter            counter;
+                std::atomic<uint32_t> ran{ 0 };
+                for (uint32_t i = 0; i < 20; i++)
+                {
+                    _jobs.Submit(counter, [&](uint32_t _threadIndex)
+                    {
+                        sharedIndex += busy[_threadIndex].exchange(1) ? 1 : 0;
+                        std::this_thread::sleep_for(std::chrono::microseconds(50));
+                        busy[_threadIndex] = 0;
+                        ran++;
+                    });
+                }
+                _jobs.Wait(counter);
+                CHECK(ran == 20);
+                completed++;
+            }
+        });
+    }
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+    CHECK(completed == 200);
+    CHECK(sharedIndex == 0);
+}
+
+// A waiter with nothing to run must sleep rather than spin while a long job runs elsewhere.
+static void TestWaitSleeps(JobSystem& _jobs)
+{
+    JobCounter counter;
+    _jobs.Submit(counter, [](uint32_t) { std::this_thread::sleep_for(std::chrono::milliseconds(300)); });
+
+    // Give a worker time to take the job, so the waiter finds nothing to run.
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    std::clock_t cpuStart = std::clock();
+    _jobs.Wait(counter);
+    double cpuSeconds = static_cast<double>(std::clock() - cpuStart) / CLOCKS_PER_SEC;
+    CHECK(counter.pending == 0);
+    CHECK(cpuSeconds < 0.1);
+}
+
+int main()
+{
+    for (uint32_t workers : { 1u, 3u, 8u })
+    {
+        JobSystem jobs(workers);
+        TestParallelForCoversEveryIndexOnce(jobs);
+        TestSyntheticRecordMatchesSerial(jobs);
+        TestNestedWait(jobs);
+        TestConcurrentExternalWaiters(jobs);
+        TestWaitSleeps(jobs);
+    }
+    return TestResult("JobSystemTests");
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+// A GPU fence for tests: the "GPU" is whoever calls Complete. Thread-safe like the D3D12 one, so
+// one thread may wait on it while others signal and complete.
+
+#include "GpuFence.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+class MockGpuFence : public IGpuFence
+{
+public:
+    uint64_t Signal() override                      { return ++m_signaled; }
+    uint64_t GetLastSignaledValue() const override  { return m_signaled; }
+
+    // Read under the lock, so a value is only seen once the waiters it wakes have been woken and
+    // a waiter destroyed after seeing it is never touched again.
+    uint64_t GetCompletedValue() const override
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_completed;
+    }
+
+    bool WaitForValue(uint64_t _value, uint32_t _timeoutMs = GpuFenceInfinite) override
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        auto reached = [this, _value]() { return m_completed >= _value; };
+        if (_timeoutMs == GpuFenceInfinite)
+        {
+            m_completedChanged.wait(lock, reached);
+            return true;
+        }
+        return m_completedChanged.wait_for(lock, std::chrono::milliseconds(_timeoutMs), reached);
+    }
+
+    void WakeOnCompletion(uint64_t _value, GpuFenceWaiter& _waiter) override
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_registrations++;
+            if (m_completed < _value)
+            {
+                m_waiters.push_back({ _value, &_waiter });
+                return;
+            }
+        }
+        _waiter.Wake();
+    }
+
+    // The GPU reaching _value. Values never go backwards.
+    void Complete(uint64_t _value)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_completed = _value > m_completed ? _value : m_completed.load();
+            for (size_t i = 0; i < m_waiters.size();)
+            {
+                if (m_waiters[i].first <= m_completed)
+                {
+                    m_waiters[i].second->Wake();
+                    m_waiters[i] = m_waiters.back();
+                    m_waiters.pop_back();
+                }
+                else
+                {
+                    i++;
+                }
+            }
+        }
+        m_completedChanged.notify_all();
+    }
+
+    void CompleteAll() { Complete(m_signaled); }
+
+    // WakeOnCompletion calls so far, and those not yet woken.
+    uint64_t Registrations()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_registrations;
+    }
+
+    size_t PendingRegistrations()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_waiters.size();
+    }
+
+private:
+    std::atomic<uint64_t>   m_signaled{ 0 };
+    std::atomic<uint64_t>   m_completed{ 0 };
+    mutable std::mutex      m_mutex;
+    std::condition_variable m_completedChanged;
+
+    std::vector<std::pair<uint64_t, GpuFenceWaiter*>> m_waiters;
+    uint64_t                                          m_registrations = 0;
+};
@@ -0,0 +1,244 @@
+// ObjectCulling: CullPlanesFromMatrix on a known perspective projection, with and without a view
+// translation, gives the expected normalised planes and classifies points and spheres either side
+// of them. CullSpheres, the SSE path where the build has it, matches CullSpheresScalar exactly for
+// every tail length 0-7 and start offset, including spheres touching a plane to the last bit.
+// CountCullMismatches forgives disagreements on a plane and counts the rest.
+
+#include "TestCommon.h"
+#include "ObjectCulling.h"
+
+#include <random>
+#include <vector>
+
+// Left-handed perspective for row vectors, laid out like XMMatrixPerspectiveFovLH.
+static void Perspective(float _xScale, float _yScale, float _near, float _far, float _m[16])
+{
+    float range = _far / (_far - _near);
+    const float m[16] =
+    {
+        _xScale,    0.0f,       0.0f,               0.0f,
+        0.0f,       _yScale,    0.0f,               0.0f,
+        0.0f,       0.0f,       range,              1.0f,
+        0.0f,       0.0f,       -_near * range,     0.0f,
+    };
+    memcpy(_m, m, sizeof(m));
+}
+
+static void Multiply(const float _a[16], const float _b[16], float _out[16])
+{
+    for (int r = 0; r < 4; r++)
+    {
+        for (int c = 0; c < 4; c++)
+        {
+            _out[r * 4 + c] = 0.0f;
+            for (int k = 0; k < 4; k++)
+            {
+                _out[r * 4 + c] += _a[r * 4 + k] * _b[k * 4 + c];
+            }
+        }
+    }
+}
+
+static bool Near(float _a, float _b, float _epsilon = 1e-5f)
+{
+    return std::fabs(_a - _b) <= _epsilon;
+}
+
+static bool PlaneIs(const float* _plane, float _a, float _b, float _c, float _d)
+{
+    return Near(_plane[0], _a) && Near(_plane[1], _b) && Near(_plane[2], _c) && Near(_plane[3], _d, 1e-3f);
+}
+
+static void TestPlanesFromMatrix()
+{
+    // 90 degrees both ways, so the side planes are at 45 degrees.
+    float projection[16];
+    Perspective(1.0f, 1.0f, 1.0f, 100.0f, projection);
+    CullPlanes planes;
+    CullPlanesFromMatrix(projection, &planes);
+
+    const float s = std::sqrt(0.5f);
+    CHECK(PlaneIs(planes.planes[0],  s,    0.0f, s,     0.0f));      // Left: x >= -z
+    CHECK(PlaneIs(planes.planes[1], -s,    0.0f, s,     0.0f));      // Right: x <= z
+    CHECK(PlaneIs(planes.planes[2],  0.0f, s,    s,     0.0f));      // Bottom
+    CHECK(PlaneIs(planes.planes[3],  0.0f, -s,   s,     0.0f));      // Top
+    CHECK(PlaneIs(planes.planes[4],  0.0f, 0.0f, 1.0f,  -1.0f));     // Near: z >= 1
+    CHECK(PlaneIs(planes.planes[5],  0.0f, 0.0f, -1.0f, 100.0f));    // Far: z <= 100
+
+    auto visible = [&](float _x, float _y, float _z, float _r) { return CullSphereVisible(planes, { _x, _y, _z, _r }); };
+    CHECK(visible(0.0f, 0.0f, 5.0f, 0.0f));
+    CHECK(visible(4.9f, -4.9f, 5.0f, 0.0f));
+    CHECK(!visible(5.1f, 0.0f, 5.0f, 0.0f));
+    CHECK(!visible(0.0f, -5.1f, 5.0f, 0.0f));
+    CHECK(!visible(0.0f, 0.0f, 0.5f, 0.0f));
+    CHECK(!visible(0.0f, 0.0f, 101.0f, 0.0f));
+
+    // Outside by less than the radius still counts; 5.5 is 0.35 from the right plane.
+    CHECK(visible(5.5f, 0.0f, 5.0f, 0.5f));
+    CHECK(!visible(5.5f, 0.0f, 5.0f, 0.3f));
+    CHECK(visible(0.0f, 0.0f, 0.5f, 0.6f));
+    CHECK(visible(0.0f, 0.0f, 101.0f, 1.5f));
+
+    // A narrower horizontal field: x <= z / 2.
+    Perspective(2.0f, 1.0f, 0.1f, 1000.0f, projection);
+    CullPlanesFromMatrix(projection, &planes);
+    CHECK(PlaneIs(planes.planes[1], -2.0f / std::sqrt(5.0f), 0.0f, 1.0f / std::sqrt(5.0f), 0.0f));
+    CHECK(PlaneIs(planes.planes[4], 0.0f, 0.0f, 1.0f, -0.1f));
+    CHECK(visible(2.4f, 0.0f, 5.0f, 0.0f) && !visible(2.6f, 0.0f, 5.0f, 0.0f));
+    CHECK(visible(0.0f, 4.9f, 5.0f, 0.0f));
+
+    // A camera at (10, 0, -20): view translates by minus the eye, so the frustum moves with it.
+    Perspective(1.0f, 1.0f, 1.0f, 100.0f, projection);
+    const float view[16] =
+    {
+        1.0f,   0.0f,   0.0f,   0.0f,
+        0.0f,   1.0f,   0.0f,   0.0f,
+        0.0f,   0.0f,   1.0f,   0.0f,
+        -10.0f, 0.0f,   20.0f,  1.0f,
+    };
+    float viewProjection[16];
+    Multiply(view, projection, viewProjection);
+    CullPlanesFromMatrix(viewProjection, &planes);
+    CHECK(visible(10.0f, 0.0f, -15.0f, 0.0f));
+    CHECK(visible(0.0f, 0.0f, 5.0f, 0.0f));             // (-10, 0, 25) in view space.
+    CHECK(!visible(10.0f, 0.0f, -19.5f, 0.0f));
+    CHECK(!visible(10.0f, 0.0f, 81.0f, 0.0f));
+    CHECK(!visible(16.0f, 0.0f, -15.0f, 0.0f));
+
+    // Every plane comes out unit length.
+    for (const float* plane : planes.planes)
+    {
+        CHECK(Near(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2], 1.0f));
+    }
+}
+
+static bool SameDraws(const std::vector<IndirectDrawArguments>& _a, uint32_t _countA, const std::vector<IndirectDrawArguments>& _b, uint32_t _countB)
+{
+    return _countA == _countB && memcmp(_a.data(), _b.data(), _countA * sizeof(IndirectDrawArguments)) == 0;
+}
+
+// Spheres whose distance to a plane is exactly minus their radius, or one ulp either side, so the
+// >= comparison decides them and any difference in rounding between the paths would show.
+static std::vector<CullSphere> BoundarySpheres(const CullPlanes& _planes, std::mt19937& _rng, uint32_t _count)
+{
+    std::uniform_real_distribution<float> position(-60.0f, 60.0f);
+    std::vector<CullSphere>               spheres;
+    while (spheres.size() < _count)
+    {
+        CullSphere   sphere   = { position(_rng), position(_rng), std::fabs(position(_rng)) + 1.0f, 0.0f };
+        const float* plane    = _planes.planes[_rng() % 6];
+        float        distance = CullPlaneDistance(plane, sphere);
+        if (distance >= 0.0f)
+        {
+            continue;
+        }
+        sphere.radius = -distance;
+        switch (_rng() % 3)
+        {
+        case 0:                                                                 break;
+        case 1:  sphere.radius = std::nextafter(sphere.radius, 0.0f);          break;
+        default: sphere.radius = std::nextafter(sphere.radius, 1e30f);         break;
+        }
+        spheres.push_back(sphere);
+    }
+    return spheres;
+}
+
+static void TestSseMatchesScalar()
+{
+#if OBJECT_CULLING_SSE
+    std::printf("CullSpheres: SSE path\n");
+#else
+    std::printf("CullSpheres: scalar path only\n");
+#endif
+
+    float projection[16];
+    Perspective(1.3f, 1.7f, 0.5f, 80.0f, projection);
+    CullPlanes planes;
+    CullPlanesFromMatrix(projection, &planes);
+
+    std::mt19937                          rng(4);
+    std::uniform_real_distribution<float> position(-100.0f, 100.0f), radius(0.0f, 10.0f);
+    std::vector<CullSphere>               random(64);
+    for (CullSphere& sphere : random)
+    {
+        sphere = { position(rng), position(rng), position(rng), radius(rng) };
+    }
+    std::vector<CullSphere> boundary = BoundarySpheres(planes, rng, 4096);
+
+    // Mixed, so a group of four holds both kinds.
+    std::vector<CullSphere> mixed;
+    for (size_t i = 0; i < random.size(); i++)
+    {
+        mixed.push_back(random[i]);
+        mixed.push_back(boundary[i]);
+    }
+
+    uint32_t boundaryVisible = 0;
+    for (const std::vector<CullSphere>* spheres : { &random, &boundary, &mixed })
+    {
+        std::vector<IndirectDrawArguments> fast(spheres->size() + 1), reference(spheres->size() + 1);
+        for (uint32_t first = 0; first < 4; first++)
+        {
+            for (uint32_t count = 0; first + count <= spheres->size() && count < 40; count++)
+            {
+                // Sentinels past the end catch a write beyond the visible count.
+                memset(fast.data(), 0xCD, fast.size() * sizeof(IndirectDrawArguments));
+                memset(reference.data(), 0xCD, reference.size() * sizeof(IndirectDrawArguments));
+                uint32_t fastCount      = CullSpheres(spheres->data(), first, count, planes, 3, fast.data());
+                uint32_t referenceCount = CullSpheresScalar(spheres->data(), first, count, planes, 3, reference.data());
+                CHECK(SameDraws(fast, fastCount, reference, referenceCount));
+                CHECK(fast[fastCount].vertexCountPerInstance == 0xCDCDCDCD);
+            }
+        }
+
+        // The whole set at once as well.
+        uint32_t fastCount      = CullSpheres(spheres->data(), 0, static_cast<uint32_t>(spheres->size()), planes, 3, fast.data());
+        uint32_t referenceCount = CullSpheresScalar(spheres->data(), 0, static_cast<uint32_t>(spheres->size()), planes, 3, reference.data());
+        CHECK(SameDraws(fast, fastCount, reference, referenceCount));
+        if (spheres == &boundary)
+        {
+            boundaryVisible = referenceCount;
+        }
+    }
+
+    // The boundary set really does sit on the edge: some in, some out.
+    CHECK(boundaryVisible > 0 && boundaryVisible < boundary.size());
+}
+
+// Unordered output, as the GPU writes it, with one draw missing.
+static void TestMismatchCount()
+{
+    float projection[16];
+    Perspective(1.0f, 1.0f, 1.0f, 100.0f, projection);
+    CullPlanes planes;
+    CullPlanesFromMatrix(projection, &planes);
+
+    // 0 and 2 well inside, 1 touching the right plane, 3 well outside.
+    const CullSphere spheres[] = { { 0.0f, 0.0f, 10.0f, 1.0f }, { 11.0f, 0.0f, 10.0f, std::sqrt(0.5f) }, { 1.0f, 1.0f, 20.0f, 1.0f }, { 0.0f, 0.0f, -50.0f, 1.0f } };
+    IndirectDrawArguments reference[4];
+    uint32_t count = CullSpheresScalar(spheres, 0, 4, planes, 3, reference);
+    CHECK(count == 3);
+
+    IndirectDrawArguments shuffled[3] = { reference[2], reference[0], reference[1] };
+    CHECK(CountCullMismatches(spheres, planes, reference, count, shuffled, 3, 0.0f) == 0);
+
+    // Dropping the sphere on the plane is rounding; dropping one well inside is a real miss.
+    IndirectDrawArguments withoutBoundary[2] = { reference[0], reference[2] };
+    IndirectDrawArguments withoutInside[2]   = { reference[1], reference[2] };
+    CHECK(CountCullMismatches(spheres, planes, reference, count, withoutBoundary, 2, 1e-4f) == 0);
+    CHECK(CountCullMismatches(spheres, planes, reference, count, withoutInside, 2, 1e-4f) == 1);
+
+    // So is drawing one that is well outside.
+    IndirectDrawArguments extra[4] = { reference[0], reference[1], reference[2], reference[0] };
+    extra[3].startInstanceLocation = 3;
+    CHECK(CountCullMismatches(spheres, planes, reference, count, extra, 4, 1e-4f) == 1);
+}
+
+int main()
+{
+    TestPlanesFromMatrix();
+    TestSseMatchesScalar();
+    TestMismatchCount();
+    return TestResult("ObjectCullingTests");
+}
@@ -0,0 +1,179 @@
+// Fnv1aHasher and PipelineCacheFile: the hash matches the reference FNV-1a values, null and empty
+// strings stay apart, and hashing field by field ignores whatever sits in a struct's padding. The
+// cache file round trips, and a missing, truncated, bad-magic, wrong-version or oversized-blob file
+// is rejected with the contents left empty.
+
+#include "TestCommon.h"
+#include "PipelineCacheFile.h"
+
+#include <random>
+#include <string>
+
+static void TestHasher()
+{
+    // Reference 64-bit FNV-1a values.
+    CHECK(Fnv1aHasher().Hash() == 0xcbf29ce484222325ull);
+    CHECK(Fnv1aHasher().Bytes("a", 1).Hash() == 0xaf63dc4c8601ec8cull);
+    CHECK(Fnv1aHasher().Bytes("foobar", 6).Hash() == 0x85944171f73967e8ull);
+
+    // Null, empty and non-empty strings all differ, and a terminator separates neighbours.
+    uint64_t null   = Fnv1aHasher().String(nullptr).Hash();
+    uint64_t empty  = Fnv1aHasher().String("").Hash();
+    CHECK(null != empty);
+    CHECK(empty != Fnv1aHasher().String("a").Hash());
+    CHECK(Fnv1aHasher().String("ab").String("c").Hash() != Fnv1aHasher().String("a").String("bc").Hash());
+    CHECK(Fnv1aHasher().String(nullptr).String("").Hash() != Fnv1aHasher().String("").String(nullptr).Hash());
+    CHECK(Fnv1aHasher().String("VSMain").Hash() == Fnv1aHasher().String(std::string("VSMain").c_str()).Hash());
+}
+
+// Shaped like the descriptions the pipeline cache hashes: a byte before a wider field leaves padding.
+struct PaddedDesc
+{
+    uint8_t     topology;
+    uint32_t    sampleCount;
+    uint16_t    format;
+    uint64_t    mask;
+};
+static_assert(sizeof(PaddedDesc) > 15, "The test needs a struct with padding");
+
+static uint64_t HashFields(const PaddedDesc& _desc)
+{
+    return Fnv1aHasher().Value(_desc.topology).Value(_desc.sampleCount).Value(_desc.format).Value(_desc.mask).Hash();
+}
+
+static void TestPaddingIndependence()
+{
+    PaddedDesc a, b;
+    memset(&a, 0x00, sizeof(a));
+    memset(&b, 0xAB, sizeof(b));
+    for (PaddedDesc* desc : { &a, &b })
+    {
+        desc->topology      = 4;
+        desc->sampleCount   = 1;
+        desc->format        = 28;
+        desc->mask          = 0xFFFFFFFFull;
+    }
+
+    // The whole struct's bytes see the padding; the fields alone do not.
+    CHECK(Fnv1aHasher().Bytes(&a, sizeof(a)).Hash() != Fnv1aHasher().Bytes(&b, sizeof(b)).Hash());
+    CHECK(HashFields(a) == HashFields(b));
+
+    // And every field still counts.
+    b.format = 29;
+    CHECK(HashFields(a) != HashFields(b));
+}
+
+static std::vector<uint8_t> RandomBlob(std::mt19937& _rng, size_t _size)
+{
+    std::vector<uint8_t> blob(_size);
+    for (uint8_t& byte : blob)
+    {
+        byte = static_cast<uint8_t>(_rng());
+    }
+    return blob;
+}
+
+static std::vector<char> ReadAll(const std::filesystem::path& _path)
+{
+    std::ifstream in(_path, std::ios::binary);
+    return std::vector<char>(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+static void WriteAll(const std::filesystem::path& _path, const std::vector<char>& _bytes)
+{
+    std::ofstream out(_path, std::ios::binary | std::ios::trunc);
+    out.write(_bytes.data(), _bytes.size());
+}
+
+static void TestFile()
+{
+    std::filesystem::path directory = std::filesystem::temp_directory_path() / "base_dx12_pipeline_cache_tests";
+    std::filesystem::create_directories(directory);
+    std::filesystem::path path = directory / "pipelines.bin";
+
+    std::mt19937      rng(2);
+    PipelineCacheFile saved;
+    saved.library = RandomBlob(rng, 100000);
+    for (uint64_t i = 0; i < 20; i++)
+    {
+        saved.rootSignatures[Fnv1aHasher().Value(i).Hash()] = RandomBlob(rng, rng() % 500);
+    }
+    saved.rootSignatures[7] = {};
+    CHECK(saved.Save(path));
+    CHECK(!std::filesystem::exists(directory / "pipelines.bin.tmp"));
+
+    PipelineCacheFile loaded;
+    CHECK(loaded.Load(path));
+    CHECK(loaded.library == saved.library);
+    CHECK(loaded.rootSignatures == saved.rootSignatures);
+
+    // Saving over an existing cache replaces it.
+    saved.library.resize(10);
+    saved.rootSignatures.clear();
+    CHECK(saved.Save(path));
+    CHECK(loaded.Load(path));
+    CHECK(loaded.library == saved.library && loaded.rootSignatures.empty());
+
+    // An empty cache is still a valid one.
+    PipelineCacheFile empty;
+    CHECK(empty.Save(path));
+    CHECK(loaded.Load(path));
+    CHECK(loaded.library.empty() && loaded.rootSignatures.empty());
+
+    // Rejected files leave nothing behind from a previous load.
+    auto rejected = [&](const std::vector<char>& _bytes)
+    {
+        CHECK(loaded.Load(path));
+        WriteAll(directory / "bad.bin", _bytes);
+        bool ok = loaded.Load(directory / "bad.bin");
+        CHECK(loaded.library.empty() && loaded.rootSignatures.empty());
+        return !ok;
+    };
+
+    saved.library = RandomBlob(rng, 5000);
+    saved.rootSignatures[1] = RandomBlob(rng, 300);
+    saved.rootSignatures[2] = RandomBlob(rng, 300);
+    CHECK(saved.Save(path));
+    std::vector<char> good = ReadAll(path);
+
+    CHECK(!loaded.Load(directory / "missing.bin"));
+    CHECK(rejected({}));
+
+    // Cut anywhere short of the end: in the header, the library, the count or a root signature.
+    const size_t cuts[] = { 3, 7, 12, 15, 100, 5015, 5018, 5020, 5030, good.size() - 1 };
+    for (size_t cut : cuts)
+    {
+        CHECK(rejected(std::vector<char>(good.begin(), good.begin() + cut)));
+    }
+
+    std::vector<char> bad = good;
+    bad[0] ^= 1;
+    CHECK(rejected(bad));
+
+    bad = good;
+    bad[4] = 2;
+    CHECK(rejected(bad));
+
+    // A library size far past the end of the file is refused before anything is allocated.
+    bad = good;
+    uint64_t huge = uint64_t(1) << 31;
+    memcpy(bad.data() + 8, &huge, sizeof(huge));
+    CHECK(rejected(bad));
+
+    // A root signature count larger than the entries present.
+    bad = good;
+    uint32_t count = 1000;
+    memcpy(bad.data() + 16 + saved.library.size(), &count, sizeof(count));
+    CHECK(rejected(bad));
+
+    std::error_code ec;
+    std::filesystem::remove_all(directory, ec);
+}
+
+int main()
+{
+    TestHasher();
+    TestPaddingIndependence();
+    TestFile();
+    return TestResult("PipelineCacheFileTests");
+}
@@ -0,0 +1,278 @@
+// RenderGraph: compiles small frames and compares every pass's barriers, the culled passes and the
+// transient placement against golden text, so any change to the compiler's output shows as a diff.
+
+#include "TestCommon.h"
+#include "RenderGraph.h"
+
+#include <string>
+#include <vector>
+
+static std::string StateName(uint32_t _state)
+{
+    static const char* const names[] =
+    {
+        "Present", "VertexBuffer", "IndexBuffer", "ConstantBuffer", "ShaderResource", "IndirectArgument",
+        "CopySource", "DepthRead", "RenderTarget", "UnorderedAccess", "DepthWrite", "CopyDest",
+    };
+    if (_state == GraphStateCommon)
+    {
+        return "Common";
+    }
+    std::string name;
+    for (uint32_t bit = 0; bit < sizeof(names) / sizeof(names[0]); bit++)
+    {
+        if (_state & (1u << bit))
+        {
+            name += (name.empty() ? "" : "|") + std::string(names[bit]);
+        }
+    }
+    return name;
+}
+
+static std::string BarrierText(const RenderGraph& _graph, const GraphBarrier& _barrier)
+{
+    const std::string& resource = _graph.ResourceName(_barrier.resource);
+    switch (_barrier.type)
+    {
+    case GraphBarrierType::Aliasing:
+        return "alias " + _graph.ResourceName(_barrier.resourceBefore) + " -> " + resource;
+    case GraphBarrierType::Uav:
+        return "uav " + resource;
+    default:
+        break;
+    }
+
+    static const char* const splits[] = { "", " (begin)", " (end)" };
+    return "transition " + resource + " " + StateName(_barrier.before) + " -> " + StateName(_barrier.after) + splits[static_cast<int>(_barrier.split)];
+}
+
+// Barriers per pass, then every used resource's lifetime and, for transients, its placement.
+static std::string Dump(const RenderGraph& _graph, const std::vector<uint32_t>& _transients = {})
+{
+    std::string text;
+    for (uint32_t p = 0; p < _graph.PassCount(); p++)
+    {
+        const CompiledPass& pass = _graph.GetCompiledPass(p);
+        text += _graph.PassName(p) + (pass.live ? "\n" : " (culled)\n");
+        for (const GraphBarrier& barrier : pass.before)
+        {
+            text += "  before " + BarrierText(_graph, barrier) + "\n";
+        }
+        for (const GraphBarrier& barrier : pass.after)
+        {
+            text += "  after  " + BarrierText(_graph, barrier) + "\n";
+        }
+    }
+    for (uint32_t r = 0; r < _graph.ResourceCount(); r++)
+    {
+        const CompiledResource& resource = _graph.GetCompiledResource(r);
+        if (!resource.used)
+        {
+            continue;
+        }
+        text += _graph.ResourceName(r) + " passes " + std::to_string(resource.firstPass) + "-" + std::to_string(resource.lastPass);
+        if (std::find(_transients.begin(), _transients.end(), r) != _transients.end())
+        {
+            text += " @" + std::to_string(resource.offset) + " created " + StateName(resource.createState);
+        }
+        text += "\n";
+    }
+    text += "heap " + std::to_string(_graph.TransientHeapSize()) + "\n";
+    return text;
+}
+
+static void CheckGolden(const char* _name, const std::string& _actual, const char* _golden)
+{
+    if (_actual != _golden)
+    {
+        std::printf("%s: output differs from golden\n--- expected\n%s--- actual\n%s", _name, _golden, _actual.c_str());
+        testFailures++;
+    }
+}
+
+// The sample's own frame: clear and draw into the back buffer.
+static void TestBackBufferFrame()
+{
+    RenderGraph graph;
+    uint32_t backBuffer = graph.Import("BackBuffer", GraphStatePresent, GraphStatePresent);
+    uint32_t vertices   = graph.Import("Vertices", GraphStateVertexBuffer, GraphStateVertexBuffer);
+    uint32_t clear      = graph.AddPass("Clear");
+    uint32_t draw       = graph.AddPass("Draw");
+    graph.Write(clear, backBuffer, GraphStateRenderTarget);
+    graph.Read(draw, vertices, GraphStateVertexBuffer);
+    graph.Write(draw, backBuffer, GraphStateRenderTarget);
+    graph.Compile();
+
+    CheckGolden("BackBufferFrame", Dump(graph),
+        "Clear\n"
+        "  before transition BackBuffer Present -> RenderTarget\n"
+        "Draw\n"
+        "  after  transition BackBuffer RenderTarget -> Present\n"
+        "BackBuffer passes 0-1\n"
+        "Vertices passes 1-1\n"
+        "heap 0\n");
+}
+
+// Deferred shading: G-buffer and shadow map feed lighting, then a compute blur and tonemap. Debug
+// output nobody reads is culled, and the blur target reuses the dead G-buffer's memory.
+static RenderGraph BuildDeferredFrame(std::vector<uint32_t>& _transients)
+{
+    RenderGraph graph;
+    uint32_t backBuffer = graph.Import("BackBuffer", GraphStatePresent, GraphStatePresent);
+    uint32_t gbuffer    = graph.CreateTransient("GBuffer", 8 << 20, 65536);
+    uint32_t depth      = graph.CreateTransient("Depth", 4 << 20, 65536);
+    uint32_t shadow     = graph.CreateTransient("Shadow", 4 << 20, 65536);
+    uint32_t hdr        = graph.CreateTransient("Hdr", 8 << 20, 65536);
+    uint32_t blurred    = graph.CreateTransient("Blurred", 8 << 20, 65536);
+    uint32_t debug      = graph.CreateTransient("Debug", 1 << 20, 65536);
+    _transients = { gbuffer, depth, shadow, hdr, blurred, debug };
+
+    uint32_t geometry = graph.AddPass("Geometry");
+    graph.Write(geometry, gbuffer, GraphStateRenderTarget);
+    graph.Write(geometry, depth, GraphStateDepthWrite);
+
+    uint32_t shadows = graph.AddPass("Shadows");
+    graph.Write(shadows, shadow, GraphStateDepthWrite);
+
+    uint32_t debugView = graph.AddPass("DebugView");
+    graph.Read(debugView, gbuffer, GraphStateShaderResource);
+    graph.Write(debugView, debug, GraphStateRenderTarget);
+
+    uint32_t lighting = graph.AddPass("Lighting");
+    graph.Read(lighting, gbuffer, GraphStateShaderResource);
+    graph.Read(lighting, depth, GraphStateDepthRead);
+    graph.Read(lighting, shadow, GraphStateShaderResource);
+    graph.Write(lighting, hdr, GraphStateRenderTarget);
+
+    // Two compute passes on the same target need their writes ordered.
+    uint32_t blurX = graph.AddPass("BlurX");
+    graph.Read(blurX, hdr, GraphStateShaderResource);
+    graph.Write(blurX, blurred, GraphStateUnorderedAccess);
+
+    uint32_t blurY = graph.AddPass("BlurY");
+    graph.Read(blurY, depth, GraphStateShaderResource);
+    graph.Write(blurY, blurred, GraphStateUnorderedAccess);
+
+    uint32_t tonemap = graph.AddPass("Tonemap");
+    graph.Read(tonemap, blurred, GraphStateShaderResource);
+    graph.Write(tonemap, backBuffer, GraphStateRenderTarget);
+
+    uint32_t ui = graph.AddPass("Ui");
+    graph.Write(ui, backBuffer, GraphStateRenderTarget);
+    return graph;
+}
+
+static void TestDeferredFrame()
+{
+    std::vector<uint32_t> transients;
+    RenderGraph graph = BuildDeferredFrame(transients);
+    graph.Compile();
+    CheckGolden("DeferredFrame", Dump(graph, transients),
+        "Geometry\n"
+        "  after  transition GBuffer RenderTarget -> ShaderResource (begin)\n"
+        "  after  transition Depth DepthWrite -> ShaderResource|DepthRead (begin)\n"
+        "Shadows\n"
+        "DebugView (culled)\n"
+        "Lighting\n"
+        "  before transition GBuffer RenderTarget -> ShaderResource (end)\n"
+        "  before transition Depth DepthWrite -> ShaderResource|DepthRead (end)\n"
+        "  before transition Shadow DepthWrite -> ShaderResource\n"
+        "BlurX\n"
+        "  before alias GBuffer -> Blurred\n"
+        "  before transition Hdr RenderTarget -> ShaderResource\n"
+        "BlurY\n"
+        "  before uav Blurred\n"
+        "Tonemap\n"
+        "  before transition BackBuffer Present -> RenderTarget\n"
+        "  before transition Blurred UnorderedAccess -> ShaderResource\n"
+        "Ui\n"
+        "  after  transition BackBuffer RenderTarget -> Present\n"
+        "BackBuffer passes 6-7\n"
+        "GBuffer passes 0-3 @0 created RenderTarget\n"
+        "Depth passes 0-5 @8388608 created DepthWrite\n"
+        "Shadow passes 1-3 @12582912 created DepthWrite\n"
+        "Hdr passes 3-4 @16777216 created RenderTarget\n"
+        "Blurred passes 4-6 @0 created UnorderedAccess\n"
+        "heap 25165824\n");
+}
+
+static void TestDeferredFrameUnsplit()
+{
+    std::vector<uint32_t> transients;
+    RenderGraph graph = BuildDeferredFrame(transients);
+    graph.Compile(false);
+    CheckGolden("DeferredFrameUnsplit", Dump(graph, transients),
+        "Geometry\n"
+        "Shadows\n"
+        "DebugView (culled)\n"
+        "Lighting\n"
+        "  before transition GBuffer RenderTarget -> ShaderResource\n"
+        "  before transition Depth DepthWrite -> ShaderResource|DepthRead\n"
+        "  before transition Shadow DepthWrite -> ShaderResource\n"
+        "BlurX\n"
+        "  before alias GBuffer -> Blurred\n"
+        "  before transition Hdr RenderTarget -> ShaderResource\n"
+        "BlurY\n"
+        "  before uav Blurred\n"
+        "Tonemap\n"
+        "  before transition BackBuffer Present -> RenderTarget\n"
+        "  before transition Blurred UnorderedAccess -> ShaderResource\n"
+        "Ui\n"
+        "  after  transition BackBuffer RenderTarget -> Present\n"
+        "BackBuffer passes 6-7\n"
+        "GBuffer passes 0-3 @0 created RenderTarget\n"
+        "Depth passes 0-5 @8388608 created DepthWrite\n"
+        "Shadow passes 1-3 @12582912 created DepthWrite\n"
+        "Hdr passes 3-4 @16777216 created RenderTarget\n"
+        "Blurred passes 4-6 @0 created UnorderedAccess\n"
+        "heap 25165824\n");
+}
+
+// An imported buffer written early and read late: the read transition begins right after the write
+// and ends before the read, and the final transition back begins once the resource is done with.
+static void TestSplitAcrossPasses()
+{
+    RenderGraph graph;
+    uint32_t backBuffer = graph.Import("BackBuffer", GraphStatePresent, GraphStatePresent);
+    uint32_t particles  = graph.Import("Particles", GraphStateCommon, GraphStateCommon);
+
+    uint32_t simulate = graph.AddPass("Simulate");
+    graph.Write(simulate, particles, GraphStateUnorderedAccess);
+
+    uint32_t opaque = graph.AddPass("Opaque");
+    graph.Write(opaque, backBuffer, GraphStateRenderTarget);
+
+    uint32_t drawParticles = graph.AddPass("DrawParticles");
+    graph.Read(drawParticles, particles, GraphStateVertexBuffer);
+    graph.Read(drawParticles, particles, GraphStateIndirectArgument);
+    graph.Write(drawParticles, backBuffer, GraphStateRenderTarget);
+
+    uint32_t post = graph.AddPass("Post", true);
+    graph.Write(post, backBuffer, GraphStateRenderTarget);
+    graph.Compile();
+
+    CheckGolden("SplitAcrossPasses", Dump(graph),
+        "Simulate\n"
+        "  before transition Particles Common -> UnorderedAccess\n"
+        "  after  transition Particles UnorderedAccess -> VertexBuffer|IndirectArgument (begin)\n"
+        "Opaque\n"
+        "  before transition BackBuffer Present -> RenderTarget\n"
+        "DrawParticles\n"
+        "  before transition Particles UnorderedAccess -> VertexBuffer|IndirectArgument (end)\n"
+        "  after  transition Particles VertexBuffer|IndirectArgument -> Common (begin)\n"
+        "Post\n"
+        "  after  transition BackBuffer RenderTarget -> Present\n"
+        "  after  transition Particles VertexBuffer|IndirectArgument -> Common (end)\n"
+        "BackBuffer passes 1-3\n"
+        "Particles passes 0-2\n"
+        "heap 0\n");
+}
+
+int main()
+{
+    TestBackBufferFrame();
+    TestDeferredFrame();
+    TestDeferredFrameUnsplit();
+    TestSplitAcrossPasses();
+    return TestResult("RenderGraphTests");
+}
@@ -0,0 +1,124 @@
+// ResourceStateTracker: barriers within a list, split transitions, and the fixups resolved at
+// submit, including pending reads the table's combined read state already covers.
+
+#include "TestCommon.h"
+#include "ResourceStateTracker.h"
+
+// Stand-ins for D3D12 states: two read states that combine, and two writes.
+static const uint32_t ReadA     = 1 << 0;
+static const uint32_t ReadB     = 1 << 1;
+static const uint32_t Target    = 1 << 2;
+static const uint32_t Copy      = 1 << 3;
+static const uint32_t Reads     = ReadA | ReadB;
+
+static bool Same(const StateTransition& _a, const StateTransition& _b)
+{
+    return _a.resource == _b.resource && _a.subresource == _b.subresource && _a.before == _b.before && _a.after == _b.after && _a.split == _b.split;
+}
+
+static void TestBarriersWithinList()
+{
+    int                 texture;
+    CommandStateTracker list(Reads);
+    list.Transition(&texture, 1, StateAllSubresources, Target);     // Pending, incoming state unknown.
+    list.Transition(&texture, 1, StateAllSubresources, Reads);
+    list.Transition(&texture, 1, StateAllSubresources, ReadA);      // Covered by the combined read.
+    list.Transition(&texture, 1, StateAllSubresources, Copy);
+    CHECK(list.Barriers().size() == 2);
+    CHECK(Same(list.Barriers()[0], { &texture, StateAllSubresources, Target, Reads }));
+    CHECK(Same(list.Barriers()[1], { &texture, StateAllSubresources, Reads, Copy }));
+}
+
+static void TestSplitInOneList()
+{
+    int                 texture;
+    CommandStateTracker list(Reads);
+    list.Transition(&texture, 1, StateAllSubresources, Target);
+    list.BeginTransition(&texture, ReadA);
+    list.Transition(&texture, 1, StateAllSubresources, ReadA);     // Ends the split, nothing more.
+    list.Transition(&texture, 1, StateAllSubresources, Copy);
+    CHECK(list.Barriers().size() == 3);
+    CHECK(Same(list.Barriers()[0], { &texture, StateAllSubresources, Target, ReadA, StateSplitBegin }));
+    CHECK(Same(list.Barriers()[1], { &texture, StateAllSubresources, Target, ReadA, StateSplitEnd }));
+    CHECK(Same(list.Barriers()[2], { &texture, StateAllSubresources, ReadA, Copy }));
+}
+
+static void TestSplitEndedAtClose()
+{
+    int                 texture;
+    CommandStateTracker list(Reads);
+    list.Transition(&texture, 1, StateAllSubresources, Target);
+    list.BeginTransition(&texture, ReadA);
+    list.EndSplits();
+    CHECK(list.Barriers().size() == 2);
+    CHECK(Same(list.Barriers()[1], { &texture, StateAllSubresources, Target, ReadA, StateSplitEnd }));
+
+    // The next list finds it in the end state, so its request needs no fixup.
+    ResourceStateTable table;
+    table.Register(&texture, 1, Copy);
+    CommandStateTracker next(Reads);
+    next.Transition(&texture, 1, StateAllSubresources, ReadA);
+    CommandStateTracker*                      lists[] = { &list, &next };
+    std::vector<std::vector<StateTransition>> fixups;
+    table.ResolveSubmission(lists, 2, &fixups);
+    CHECK(fixups[0].size() == 1 && Same(fixups[0][0], { &texture, StateAllSubresources, Copy, Target }));
+    CHECK(fixups[1].empty());
+    CHECK(table.GetState(&texture, 0) == ReadA);
+}
+
+// A split whose starting state this list does not know is left to the end half.
+static void TestSplitNeedsKnownState()
+{
+    int                 texture;
+    CommandStateTracker list(Reads);
+    list.BeginTransition(&texture, ReadA);
+    list.Transition(&texture, 1, StateAllSubresources, Target);
+    list.BeginTransition(&texture, Target);
+    list.EndSplits();
+    CHECK(list.Barriers().empty());
+}
+
+static void TestFixupsUseSatisfies()
+{
+    int                vertices, texture;
+    ResourceStateTable table;
+    table.Register(&vertices, 1, Reads);
+    table.Register(&texture, 2, Reads);
+
+    // A read the combined state covers needs no fixup, and the table keeps the combined state.
+    CommandStateTracker reader(Reads);
+    reader.Transition(&vertices, 1, StateAllSubresources, ReadA);
+    reader.Transition(&texture, 2, 1, ReadB);
+
+    // A list that moves on from the narrower read recorded its barrier from it, so it needs the exact state.
+    CommandStateTracker writer(Reads);
+    writer.Transition(&texture, 2, 0, ReadA);
+    writer.Transition(&texture, 2, 0, Copy);
+
+    CommandStateTracker*                      lists[] = { &reader, &writer };
+    std::vector<std::vector<StateTransition>> fixups;
+    table.ResolveSubmission(lists, 2, &fixups);
+    // The reader touched the texture first, so the writer's fixup must run directly before it.
+    CHECK(fixups[0].empty());
+    CHECK(fixups[1].size() == 1 && Same(fixups[1][0], { &texture, 0, Reads, ReadA }));
+    CHECK(table.GetState(&vertices, 0) == Reads);
+    CHECK(table.GetState(&texture, 0) == Copy);
+    CHECK(table.GetState(&texture, 1) == Reads);
+
+    // A write is never covered by a read state.
+    CommandStateTracker target(Reads);
+    target.Transition(&vertices, 1, StateAllSubresources, Target);
+    CommandStateTracker* single[] = { &target };
+    table.ResolveSubmission(single, 1, &fixups);
+    CHECK(fixups[0].size() == 1 && Same(fixups[0][0], { &vertices, StateAllSubresources, Reads, Target }));
+}
+
+int main()
+{
+    TestBarriersWithinList();
+    TestSplitInOneList();
+    TestSplitEndedAtClose();
+    TestSplitNeedsKnownState();
+    TestFixupsUseSatisfies();
+    return TestResult("ResourceStateTrackerTests");
+}
@@ -0,0 +1,87 @@
+// StreamingCopy throughput: memcpy against streaming stores at each supported width, for a span
+// that fits in cache and ones that do not, then CopySubresourceRows on a pitched 4096x4096 RGBA
+// texture, the case MemcpySubresource copies row by row, on 1 to 8 threads.
+
+#include "TestCommon.h"
+#include "StreamingCopy.h"
+
+#include <vector>
+
+// Best of _repeats, in GB/s.
+template<typename Copy>
+static double Measure(size_t _bytes, uint32_t _repeats, Copy _copy)
+{
+    double best = 0.0;
+    for (uint32_t repeat = 0; repeat < _repeats; repeat++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        _copy();
+        double gbps = _bytes / SecondsSince(start) / 1e9;
+        best = gbps > best ? gbps : best;
+    }
+    return best;
+}
+
+int main(int argc, char** argv)
+{
+    bool     quick    = QuickRun(argc, argv);
+    uint32_t repeats  = quick ? 2 : 10;
+    uint32_t detected = StreamCopyDetectWidth();
+    std::printf("Detected streaming store width: %u bytes, %u hardware threads\n", detected, std::thread::hardware_concurrency());
+
+    std::vector<size_t> sizes = { 256 * 1024, 16 << 20 };
+    if (!quick)
+    {
+        sizes.push_back(256 << 20);
+    }
+    for (size_t size : sizes)
+    {
+        std::vector<uint8_t> source(size, 1), dest(size, 0);
+        std::printf("%8zu KB  memcpy %6.2f GB/s", size >> 10, Measure(size, repeats, [&] { memcpy(dest.data(), source.data(), size); }));
+        for (uint32_t width : { 16u, 32u, 64u })
+        {
+            if (width <= detected)
+            {
+                StreamCopySetWidth(width);
+                std::printf("  stream%-3u %6.2f GB/s", width * 8, Measure(size, repeats, [&] { StreamCopy(dest.data(), source.data(), size); }));
+            }
+        }
+        std::printf("\n");
+        CHECK(dest == source);
+    }
+    StreamCopySetWidth(detected);
+
+    // A 4096x4096 RGBA8 texture with its rows padded as GetCopyableFootprints would for a 4000 wide one.
+    uint32_t             rowCount   = quick ? 512 : 4096;
+    size_t               rowSize    = 4000 * 4;
+    size_t               destPitch  = 16128;
+    std::vector<uint8_t> source(rowSize * rowCount, 2), dest(destPitch * rowCount, 0);
+
+    SubresourceRows rows;
+    rows.dest               = dest.data();
+    rows.destRowPitch       = destPitch;
+    rows.destSlicePitch     = destPitch * rowCount;
+    rows.source             = source.data();
+    rows.sourceRowPitch     = static_cast<ptrdiff_t>(rowSize);
+    rows.sourceSlicePitch   = static_cast<ptrdiff_t>(rowSize * rowCount);
+    rows.rowSize            = rowSize;
+    rows.rowCount           = rowCount;
+    rows.sliceCount         = 1;
+
+    size_t bytes = rowSize * rowCount;
+    std::printf("pitched texture %u rows, row by row memcpy %6.2f GB/s\n", rowCount, Measure(bytes, repeats, [&]
+    {
+        for (uint32_t y = 0; y < rowCount; y++)
+        {
+            memcpy(dest.data() + destPitch * y, source.data() + rowSize * y, rowSize);
+        }
+    }));
+    std::printf("  CopySubresourceRows, calling thread %6.2f GB/s\n", Measure(bytes, repeats, [&] { CopySubresourceRows(rows); }));
+    for (uint32_t workers : { 1u, 3u, 7u })
+    {
+        JobSystem jobs(workers);
+        std::printf("  CopySubresourceRows, %u threads     %6.2f GB/s\n", workers + 1, Measure(bytes, repeats, [&] { CopySubresourceRows(rows, &jobs); }));
+    }
+    CHECK(dest[destPitch * (rowCount - 1) + rowSize - 1] == 2 && dest[rowSize] == 0);
+    return TestResult("StreamingCopyBench");
+}
@@ -0,0 +1,133 @@
+// StreamingCopy: every store width the machine supports against memcpy, at every alignment and
+// around the size thresholds, and CopySubresourceRows against a row by row reference in the
+// manner of MemcpySubresource, packed and pitched, forwards and bottom up, with and without jobs.
+
+#include "TestCommon.h"
+#include "StreamingCopy.h"
+
+#include <random>
+#include <vector>
+
+static const uint8_t Guard = 0xCD;
+
+static void TestStreamCopy(std::mt19937& _rng)
+{
+    const size_t         capacity = 64 * 1024;
+    std::vector<uint8_t> source(capacity + 128);
+    std::vector<uint8_t> dest(capacity + 256);
+    for (uint8_t& byte : source)
+    {
+        byte = static_cast<uint8_t>(_rng());
+    }
+
+    std::vector<size_t> sizes = { 0, 1, 63, 64, 65, StreamCopyMinBytes - 1, StreamCopyMinBytes, StreamCopyMinBytes + 1, 319, 320, 4096, capacity };
+    for (uint32_t i = 0; i < 200; i++)
+    {
+        sizes.push_back(_rng() % capacity);
+    }
+
+    for (size_t size : sizes)
+    {
+        for (size_t destOffset = 0; destOffset < 64; destOffset += 1 + _rng() % 9)
+        {
+            size_t sourceOffset = _rng() % 64;
+            std::fill(dest.begin(), dest.end(), Guard);
+            StreamCopy(dest.data() + 64 + destOffset, source.data() + sourceOffset, size);
+
+            bool matches = memcmp(dest.data() + 64 + destOffset, source.data() + sourceOffset, size) == 0;
+            bool guarded = true;
+            for (size_t b = 0; b < dest.size(); b++)
+            {
+                bool inside = b >= 64 + destOffset && b < 64 + destOffset + size;
+                guarded = guarded && (inside || dest[b] == Guard);
+            }
+            CHECK(matches && guarded);
+        }
+    }
+}
+
+// What MemcpySubresource does: one memcpy per row.
+static void ReferenceRows(const SubresourceRows& _rows)
+{
+    for (uint32_t slice = 0; slice < _rows.sliceCount; slice++)
+    {
+        for (uint32_t y = 0; y < _rows.rowCount; y++)
+        {
+            memcpy(_rows.dest + _rows.destSlicePitch * slice + _rows.destRowPitch * y,
+                   _rows.source + _rows.sourceSlicePitch * static_cast<ptrdiff_t>(slice) + _rows.sourceRowPitch * static_cast<ptrdiff_t>(y),
+                   _rows.rowSize);
+        }
+    }
+}
+
+static void CheckRows(std::mt19937& _rng, JobSystem* _jobs, size_t _rowSize, uint32_t _rowCount, uint32_t _sliceCount,
+                      size_t _destPitch, size_t _sourcePitch, bool _bottomUp)
+{
+    size_t               sourceSlice = _sourcePitch * _rowCount;
+    std::vector<uint8_t> source(sourceSlice * _sliceCount);
+    for (uint8_t& byte : source)
+    {
+        byte = static_cast<uint8_t>(_rng());
+    }
+
+    SubresourceRows rows;
+    rows.destRowPitch       = _destPitch;
+    rows.destSlicePitch     = _destPitch * _rowCount;
+    rows.source             = source.data();
+    rows.sourceRowPitch     = static_cast<ptrdiff_t>(_sourcePitch);
+    rows.sourceSlicePitch   = static_cast<ptrdiff_t>(sourceSlice);
+    rows.rowSize            = _rowSize;
+    rows.rowCount           = _rowCount;
+    rows.sliceCount         = _sliceCount;
+    if (_bottomUp)
+    {
+        // Source rows stored bottom up, as in a BMP: start at the last row and step backwards.
+        rows.source            += _sourcePitch * (_rowCount - 1);
+        rows.sourceRowPitch     = -rows.sourceRowPitch;
+    }
+
+    std::vector<uint8_t> expected(rows.destSlicePitch * _sliceCount, Guard);
+    std::vector<uint8_t> actual(expected.size(), Guard);
+    rows.dest = expected.data();
+    ReferenceRows(rows);
+    rows.dest = actual.data();
+    CopySubresourceRows(rows, _jobs);
+    CHECK(expected == actual);
+}
+
+static void TestCopySubresourceRows(std::mt19937& _rng, JobSystem* _jobs)
+{
+    CheckRows(_rng, _jobs, 4096 * 4, 512, 1, 4096 * 4, 4096 * 4, false);    // Packed: one span.
+    CheckRows(_rng, _jobs, 4096 * 4, 64, 8, 4096 * 4, 4096 * 4, false);     // Packed volume.
+    CheckRows(_rng, _jobs, 1000 * 4, 300, 1, 4096, 1000 * 4, false);        // Pitched to 256 alignment.
+    CheckRows(_rng, _jobs, 1000 * 4, 300, 3, 4096, 1000 * 4 + 12, false);   // Both sides padded, several slices.
+    CheckRows(_rng, _jobs, 1000 * 4, 300, 1, 4096, 1000 * 4, true);         // Bottom up source.
+    CheckRows(_rng, _jobs, 3, 7, 1, 256, 3, false);                         // Tiny rows.
+    CheckRows(_rng, _jobs, 3 << 20, 1, 1, 3 << 20, 3 << 20, false);         // A buffer: one large row.
+}
+
+int main()
+{
+    std::mt19937 rng(7);
+    JobSystem    jobs(3);
+    uint32_t     detected = StreamCopyDetectWidth();
+    std::printf("Detected streaming store width: %u bytes\n", detected);
+
+    for (uint32_t width : { 0u, 16u, 32u, 64u })
+    {
+        if (width > detected)
+        {
+            continue;
+        }
+        StreamCopySetWidth(width);
+        CHECK(StreamCopyWidth() == width);
+        TestStreamCopy(rng);
+        TestCopySubresourceRows(rng, nullptr);
+        TestCopySubresourceRows(rng, &jobs);
+    }
+
+    // Asking for more than the machine has gives what it has.
+    StreamCopySetWidth(1024);
+    CHECK(StreamCopyWidth() == detected);
+    return TestResult("StreamingCopyTests");
+}
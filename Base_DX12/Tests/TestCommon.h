@@ -0,0 +1,51 @@
+#pragma once
+
+// Shared helpers for the portable core tests and benchmarks.
+// No framework: CHECK reports a failed condition with its location and carries on, and main
+// returns TestResult(), non-zero if any check failed. Checks may run on any thread.
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+static std::atomic<int> testFailures{ 0 };
+
+#define CHECK(_condition)                                                                       \
+    do                                                                                          \
+    {                                                                                           \
+        if (!(_condition))                                                                      \
+        {                                                                                       \
+            std::printf("%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #_condition);         \
+            testFailures++;                                                                     \
+        }                                                                                       \
+    } while (0)
+
+static inline int TestResult(const char* _name)
+{
+    if (testFailures > 0)
+    {
+        std::printf("%s: %d checks failed\n", _name, testFailures.load());
+        return 1;
+    }
+    std::printf("%s: passed\n", _name);
+    return 0;
+}
+
+// Benchmarks take --quick to shrink their workload when run as tests.
+static inline bool QuickRun(int _argc, char** _argv)
+{
+    for (int i = 1; i < _argc; i++)
+    {
+        if (std::strcmp(_argv[i], "--quick") == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+static inline double SecondsSince(std::chrono::steady_clock::time_point _start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - _start).count();
+}
@@ -0,0 +1,256 @@
+// TileResidency over synthetic tile-feedback traces: a view panning across a mip chain, a working
+// set larger than the pool, and zipf-distributed requests. A shadow page table replays every
+// update and checks the invariants the D3D12 side relies on: unmaps name resident tiles, maps name
+// missing ones, no slot is ever shared or out of range, and pinned tiles never move.
+
+#include "TestCommon.h"
+#include "TileResidency.h"
+
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+// Mirrors what UpdateTileMappings would have applied, unmaps first.
+struct ShadowPageTable
+{
+    std::unordered_map<uint64_t, uint32_t> tiles;
+    std::unordered_map<uint32_t, uint64_t> slots;
+
+    // Pinned tiles are mapped up front, outside any update.
+    uint32_t Pin(TileResidency& _residency, uint64_t _key)
+    {
+        uint32_t slot = _residency.Pin(_key);
+        if (slot != TileSlotInvalid)
+        {
+            CHECK(slots.count(slot) == 0);
+            tiles[_key] = slot;
+            slots[slot] = _key;
+        }
+        return slot;
+    }
+
+    void Apply(const TileResidency& _residency, const TileResidencyUpdate& _update)
+    {
+        for (uint64_t key : _update.unmapped)
+        {
+            auto found = tiles.find(key);
+            CHECK(found != tiles.end());
+            CHECK(!_residency.IsResident(key));
+            if (found != tiles.end())
+            {
+                slots.erase(found->second);
+                tiles.erase(found);
+            }
+        }
+        for (const TileMapping& mapping : _update.mapped)
+        {
+            CHECK(mapping.slot < _residency.SlotCount());
+            CHECK(tiles.count(mapping.key) == 0);
+            CHECK(slots.count(mapping.slot) == 0);
+            CHECK(_residency.IsResident(mapping.key));
+            tiles[mapping.key]      = mapping.slot;
+            slots[mapping.slot]     = mapping.key;
+        }
+        CHECK(tiles.size() == _residency.ResidentCount());
+        CHECK(tiles.size() <= _residency.SlotCount());
+    }
+};
+
+// Requests, updates and replays one frame of feedback.
+static void RunFrame(TileResidency& _residency, ShadowPageTable& _shadow, const std::vector<uint64_t>& _feedback, uint32_t _maxMappings, TileResidencyUpdate& _update)
+{
+    for (uint64_t key : _feedback)
+    {
+        _residency.Request(key);
+    }
+    _residency.Update(_maxMappings, &_update);
+    _shadow.Apply(_residency, _update);
+}
+
+// Within one update the coarsest level maps first, and the cap defers the rest to next frame.
+static void TestCoarsestFirstAndCap()
+{
+    TileResidency       residency(8);
+    ShadowPageTable     shadow;
+    TileResidencyUpdate update;
+
+    RunFrame(residency, shadow, { PackTileKey(0, 0, 0), PackTileKey(2, 0, 0), PackTileKey(1, 0, 0), PackTileKey(0, 1, 0) }, 2, update);
+    CHECK(update.mapped.size() == 2 && update.mapped[0].key == PackTileKey(2, 0, 0) && update.mapped[1].key == PackTileKey(1, 0, 0));
+    CHECK(residency.Stats().deferred == 2);
+
+    // Dropped requests are not remembered; the next frame's feedback brings them back.
+    RunFrame(residency, shadow, {}, 2, update);
+    CHECK(update.mapped.empty());
+    RunFrame(residency, shadow, { PackTileKey(0, 0, 0), PackTileKey(0, 1, 0) }, 2, update);
+    CHECK(update.mapped.size() == 2 && update.mapped[0].key == PackTileKey(0, 0, 0) && update.mapped[1].key == PackTileKey(0, 1, 0));
+}
+
+// The feedback a W x H tile view at (x, y) on level 0 produces, with the coarser levels it falls back to.
+static std::vector<uint64_t> ViewFeedback(uint32_t _x, uint32_t _y, uint32_t _width, uint32_t _height, uint32_t _levels)
+{
+    std::vector<uint64_t> feedback;
+    for (uint32_t level = 0; level < _levels; level++)
+    {
+        uint32_t x0 = _x >> level, x1 = (_x + _width - 1) >> level;
+        uint32_t y0 = _y >> level, y1 = (_y + _height - 1) >> level;
+        for (uint32_t y = y0; y <= y1; y++)
+        {
+            for (uint32_t x = x0; x <= x1; x++)
+            {
+                feedback.push_back(PackTileKey(level, x, y));
+            }
+        }
+    }
+    return feedback;
+}
+
+// A view panning one tile a frame with room for about two views: once warm, each frame maps just
+// the new column per level and evicts only tiles the view has left.
+static void TestPan()
+{
+    const uint32_t Width = 8, Height = 6, Levels = 3;
+    TileResidency       residency(128);
+    ShadowPageTable     shadow;
+    TileResidencyUpdate update;
+
+    // The tail of the chain is pinned, as packed mips are.
+    uint64_t packed = PackTileKey(7, 0, 0);
+    CHECK(shadow.Pin(residency, packed) == 0);
+
+    for (uint32_t frame = 0; frame < 200; frame++)
+    {
+        std::vector<uint64_t> feedback = ViewFeedback(frame, 0, Width, Height, Levels);
+        feedback.push_back(packed);
+        RunFrame(residency, shadow, feedback, 64, update);
+
+        // Everything the view needs is resident after the update that saw it.
+        for (uint64_t key : feedback)
+        {
+            CHECK(residency.IsResident(key));
+        }
+        for (uint64_t key : update.unmapped)
+        {
+            CHECK(key != packed);
+            CHECK(TileKeyX(key) < (frame >> TileKeyLevel(key)));
+        }
+        if (frame > 0)
+        {
+            // Level 0 gains a column every frame, coarser levels every 2^level frames.
+            size_t expected = 0;
+            for (uint32_t level = 0; level < Levels; level++)
+            {
+                uint32_t before = (frame - 1 + Width - 1) >> level;
+                uint32_t after  = (frame + Width - 1) >> level;
+                expected += (after - before) * (((Height - 1) >> level) + 1);
+            }
+            CHECK(update.mapped.size() == expected);
+        }
+    }
+    CHECK(shadow.tiles[packed] == 0);
+    CHECK(residency.Stats().starved == 0);
+    CHECK(residency.Stats().deferred == 0);
+    CHECK(residency.Stats().evicted > 0);
+}
+
+// A working set larger than the pool: the pool fills once and then holds still. Evicting a tile
+// the same frame still samples would only swap which tiles are missing, every frame.
+static void TestOvercommit()
+{
+    const uint32_t Slots = 16, WorkingSet = 24;
+    TileResidency       residency(Slots);
+    ShadowPageTable     shadow;
+    TileResidencyUpdate update;
+
+    std::vector<uint64_t> feedback;
+    for (uint32_t i = 0; i < WorkingSet; i++)
+    {
+        feedback.push_back(PackTileKey(0, i, 0));
+    }
+
+    RunFrame(residency, shadow, feedback, 64, update);
+    CHECK(update.mapped.size() == Slots);
+    CHECK(residency.Stats().starved == WorkingSet - Slots);
+
+    for (uint32_t frame = 1; frame < 50; frame++)
+    {
+        RunFrame(residency, shadow, feedback, 64, update);
+        CHECK(update.mapped.empty());
+        CHECK(update.unmapped.empty());
+    }
+    CHECK(residency.Stats().evicted == 0);
+    CHECK(residency.Stats().starved == 50 * (WorkingSet - Slots));
+    CHECK(residency.Stats().hits == 49 * Slots);
+
+    // Once the view moves on, the tiles it left are reclaimed for the new ones.
+    std::vector<uint64_t> moved;
+    for (uint32_t i = 0; i < Slots; i++)
+    {
+        moved.push_back(PackTileKey(1, i, 0));
+    }
+    RunFrame(residency, shadow, moved, 64, update);
+    CHECK(update.mapped.size() == Slots);
+    CHECK(update.unmapped.size() == Slots);
+}
+
+// Requests drawn from a zipf distribution over many tiles: LRU keeps the hot head resident, far
+// above what the pool's share of the tiles would give, and pinned tiles survive the churn.
+static void TestZipf()
+{
+    const uint32_t Universe = 4096, Slots = 256, PerFrame = 64, Frames = 1000, Pinned = 4;
+    TileResidency       residency(Slots);
+    ShadowPageTable     shadow;
+    TileResidencyUpdate update;
+
+    std::vector<uint64_t> pinnedKeys;
+    for (uint32_t i = 0; i < Pinned; i++)
+    {
+        pinnedKeys.push_back(PackTileKey(12, i, 0));
+        CHECK(shadow.Pin(residency, pinnedKeys.back()) == i);
+    }
+    CHECK(residency.PinnedCount() == Pinned);
+
+    std::vector<double> weights(Universe);
+    for (uint32_t i = 0; i < Universe; i++)
+    {
+        weights[i] = 1.0 / (i + 1);
+    }
+    std::mt19937                    rng(42);
+    std::discrete_distribution<>    zipf(weights.begin(), weights.end());
+
+    uint64_t warmRequests = 0, warmHits = 0;
+    for (uint32_t frame = 0; frame < Frames; frame++)
+    {
+        std::vector<uint64_t> feedback;
+        for (uint32_t r = 0; r < PerFrame; r++)
+        {
+            uint32_t tile = static_cast<uint32_t>(zipf(rng));
+            feedback.push_back(PackTileKey(tile % 4, tile / 64, tile % 64));
+        }
+        uint64_t requests = residency.Stats().requests, hits = residency.Stats().hits;
+        RunFrame(residency, shadow, feedback, 16, update);
+        if (frame >= Frames / 10)
+        {
+            warmRequests    += residency.Stats().requests - requests;
+            warmHits        += residency.Stats().hits - hits;
+        }
+    }
+
+    double hitRate = static_cast<double>(warmHits) / warmRequests;
+    std::printf("zipf: %.1f%% hits with %u of %u tiles resident\n", 100.0 * hitRate, Slots, Universe);
+    CHECK(hitRate > 0.4);    // The pool holds 6% of the tiles.
+    CHECK(residency.ResidentCount() == Slots);
+    for (uint32_t i = 0; i < Pinned; i++)
+    {
+        CHECK(residency.IsResident(pinnedKeys[i]));
+        CHECK(shadow.tiles[pinnedKeys[i]] == i);
+    }
+}
+
+int main()
+{
+    TestCoarsestFirstAndCap();
+    TestPan();
+    TestOvercommit();
+    TestZipf();
+    return TestResult("TileResidencyTests");
+}
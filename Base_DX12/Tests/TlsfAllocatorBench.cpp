@@ -0,0 +1,62 @@
+// TlsfAllocator throughput: steady state allocate/free churn over a 1GB heap with a fixed number
+// of live allocations, for a few size mixes. Reports millions of operations per second and the
+// fragmentation left behind.
+
+#include "TestCommon.h"
+#include "TlsfAllocator.h"
+
+#include <random>
+#include <vector>
+
+static void Run(const char* _name, uint64_t _minSize, uint64_t _maxSize, uint64_t _alignment, uint32_t _operations)
+{
+    const uint64_t heapSize  = 1ull << 30;
+    const uint32_t liveCount = 4096;
+
+    // Sizes and victims are drawn up front so the timing only covers the allocator.
+    std::mt19937_64       rng(42);
+    std::vector<uint64_t> sizes(_operations);
+    std::vector<uint32_t> victims(_operations);
+    for (uint32_t i = 0; i < _operations; i++)
+    {
+        sizes[i]   = _minSize + rng() % (_maxSize - _minSize + 1);
+        victims[i] = static_cast<uint32_t>(rng() % liveCount);
+    }
+
+    TlsfAllocator               allocator(heapSize);
+    std::vector<TlsfAllocation> live(liveCount);
+    for (uint32_t i = 0; i < liveCount; i++)
+    {
+        CHECK(allocator.Allocate(sizes[i], _alignment, &live[i]));
+    }
+
+    uint32_t failed = 0;
+    auto     start  = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < _operations; i++)
+    {
+        TlsfAllocation& victim = live[victims[i]];
+        if (victim.block != TlsfInvalid)
+        {
+            allocator.Free(victim.block);
+            victim.block = TlsfInvalid;
+        }
+        if (!allocator.Allocate(sizes[i], _alignment, &victim))
+        {
+            failed++;
+        }
+    }
+    double seconds = SecondsSince(start);
+
+    std::printf("%-22s %7.1f Mops/s  %6.1f ns/op  fragmentation %4.1f%%  failed %u\n",
+        _name, 2.0 * _operations / seconds / 1e6, seconds * 1e9 / (2.0 * _operations), 100.0 * allocator.Fragmentation(), failed);
+    CHECK(failed == 0);
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t operations = QuickRun(argc, argv) ? 100000 : 10000000;
+    Run("small 256B-4KB",       256,    4096,       256,    operations);
+    Run("buffers 4KB-64KB",     4096,   65536,      65536,  operations);
+    Run("mixed 1B-32KB",        1,      32768,      1,      operations);
+    return TestResult("TlsfAllocatorBench");
+}
@@ -0,0 +1,167 @@
+// TlsfAllocator: randomised allocate/free against a model of the live ranges, checking bounds,
+// alignment, overlap and accounting, and that freeing everything coalesces back into one block.
+
+#include "TestCommon.h"
+#include "TlsfAllocator.h"
+
+#include <algorithm>
+#include <map>
+#include <random>
+#include <vector>
+
+// The smallest free block Allocate is guaranteed to use: the padded request rounded up to the
+// next second level size class, so any block in a list it searches fits without a scan.
+static uint64_t GuaranteedFit(uint64_t _size, uint64_t _alignment)
+{
+    uint64_t search = _size + _alignment - 1;
+    if (search < 16)
+    {
+        return search;
+    }
+    uint32_t log2 = 0;
+    while ((search >> log2) > 1)
+    {
+        log2++;
+    }
+    return search + (uint64_t(1) << (log2 - 4)) - 1;
+}
+
+static void TestEdgeCases()
+{
+    TlsfAllocator  allocator(1024);
+    TlsfAllocation allocation;
+    CHECK(!allocator.Allocate(0, 1, &allocation));
+    CHECK(!allocator.Allocate(1025, 1, &allocation));
+    CHECK(!allocator.Allocate(~0ull, 1, &allocation));
+
+    // An exact fit takes the whole range, after which nothing fits.
+    CHECK(allocator.Allocate(1024, 1, &allocation));
+    CHECK(allocation.offset == 0 && allocation.size == 1024);
+    CHECK(allocator.FreeBytes() == 0 && allocator.LargestFreeBlock() == 0);
+    TlsfAllocation other;
+    CHECK(!allocator.Allocate(1, 1, &other));
+    allocator.Free(allocation.block);
+    CHECK(allocator.IsEmpty() && allocator.LargestFreeBlock() == 1024);
+}
+
+static void TestCoalescing()
+{
+    TlsfAllocator  allocator(4096);
+    TlsfAllocation a, b, c, d;
+    CHECK(allocator.Allocate(1000, 1, &a));
+    CHECK(allocator.Allocate(1000, 1, &b));
+    CHECK(allocator.Allocate(1000, 1, &c));
+    CHECK(allocator.Allocate(1024, 1, &d));
+    CHECK(allocator.FreeBytes() == 72);
+
+    // Non-adjacent holes stay separate.
+    allocator.Free(a.block);
+    allocator.Free(c.block);
+    CHECK(allocator.LargestFreeBlock() == 1000);
+    CHECK(allocator.Fragmentation() > 0.0);
+
+    // Freeing the block between them merges all three, both neighbours at once.
+    allocator.Free(b.block);
+    CHECK(allocator.LargestFreeBlock() == 3000);
+
+    // Requests round up to the next size class, so ask for one the merged block is guaranteed to hold.
+    TlsfAllocation merged;
+    CHECK(allocator.Allocate(2048, 1, &merged) && merged.offset == 0);
+    allocator.Free(merged.block);
+    allocator.Free(d.block);
+    CHECK(allocator.IsEmpty() && allocator.LargestFreeBlock() == 4096);
+}
+
+static void TestAlignmentPaddingIsReturned()
+{
+    TlsfAllocator  allocator(1 << 20);
+    TlsfAllocation small, aligned;
+    CHECK(allocator.Allocate(100, 1, &small));
+    CHECK(allocator.Allocate(65536, 65536, &aligned));
+    CHECK(aligned.offset == 65536);
+
+    // The padding in front of the aligned block is free again and usable.
+    TlsfAllocation padding;
+    CHECK(allocator.Allocate(32768, 1, &padding) && padding.offset == 100);
+    allocator.Free(padding.block);
+    allocator.Free(small.block);
+    allocator.Free(aligned.block);
+    CHECK(allocator.IsEmpty() && allocator.LargestFreeBlock() == (1 << 20));
+}
+
+static void TestFuzz(uint32_t _seed, uint64_t _heapSize)
+{
+    std::mt19937_64                      rng(_seed);
+    TlsfAllocator                        allocator(_heapSize);
+    std::map<uint64_t, TlsfAllocation>   live;   // By offset.
+    std::vector<uint64_t>                liveOffsets;   // For picking a random victim.
+    uint64_t                             usedBytes = 0;
+
+    for (uint32_t step = 0; step < 200000; step++)
+    {
+        bool allocate = live.empty() || (rng() % 100) < 55;
+        if (allocate)
+        {
+            // Mostly small, sometimes large, like buffers next to textures.
+            uint64_t size      = (rng() % 8) ? 1 + rng() % 4096 : 1 + rng() % (_heapSize / 8);
+            uint64_t alignment = uint64_t(1) << (rng() % 17);
+            TlsfAllocation allocation;
+            if (!allocator.Allocate(size, alignment, &allocation))
+            {
+                // Failing is only allowed when no free block is large enough to be guaranteed a fit.
+                CHECK(GuaranteedFit(size, alignment) > allocator.LargestFreeBlock());
+                continue;
+            }
+
+            CHECK(allocation.size >= size);
+            CHECK(allocation.offset % alignment == 0);
+            CHECK(allocation.offset + allocation.size <= _heapSize);
+
+            // No overlap with the neighbours on either side.
+            auto next = live.lower_bound(allocation.offset);
+            CHECK(next == live.end() || allocation.offset + allocation.size <= next->first);
+            if (next != live.begin())
+            {
+                auto prev = std::prev(next);
+                CHECK(prev->first + prev->second.size <= allocation.offset);
+            }
+            live[allocation.offset] = allocation;
+            liveOffsets.push_back(allocation.offset);
+            usedBytes += allocation.size;
+        }
+        else
+        {
+            size_t victim = rng() % liveOffsets.size();
+            auto   it     = live.find(liveOffsets[victim]);
+            liveOffsets[victim] = liveOffsets.back();
+            liveOffsets.pop_back();
+            usedBytes -= it->second.size;
+            allocator.Free(it->second.block);
+            live.erase(it);
+        }
+
+        CHECK(allocator.UsedBytes() == usedBytes);
+        CHECK(allocator.AllocationCount() == live.size());
+    }
+
+    for (auto& entry : live)
+    {
+        allocator.Free(entry.second.block);
+    }
+    CHECK(allocator.IsEmpty());
+    CHECK(allocator.LargestFreeBlock() == _heapSize);
+    CHECK(allocator.Fragmentation() == 0.0);
+}
+
+int main()
+{
+    TestEdgeCases();
+    TestCoalescing();
+    TestAlignmentPaddingIsReturned();
+    for (uint32_t seed = 1; seed <= 4; seed++)
+    {
+        TestFuzz(seed, 64ull << 20);
+    }
+    TestFuzz(5, (1ull << 40) + 12345);   // Not a power of two, beyond 32 bits.
+    return TestResult("TlsfAllocatorTests");
+}
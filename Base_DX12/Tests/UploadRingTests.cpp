@@ -0,0 +1,217 @@
+// UploadRing over fake pages and a mock fence: allocations honour their alignment and never
+// overlap, a page is only handed out again once the fence has passed the frame that last used it,
+// and requests larger than a page get a dedicated page that is destroyed, not recycled.
+
+#include "TestCommon.h"
+#include "UploadRing.h"
+#include "MockGpuFence.h"
+
+#include <map>
+#include <memory>
+#include <random>
+#include <vector>
+
+const uint64_t PageSize = 64 * 1024;
+
+// Pages are plain memory, with a GPU address per page so both views can be checked.
+struct FakePages
+{
+    std::map<void*, std::unique_ptr<uint8_t[]>> live;
+    uint32_t                                    created     = 0;
+    uint32_t                                    destroyed   = 0;
+    uint32_t                                    dedicated   = 0;
+    bool                                        fail        = false;
+
+    bool Create(uint64_t _size, UploadPage* _page)
+    {
+        if (fail)
+        {
+            return false;
+        }
+        std::unique_ptr<uint8_t[]> memory(new uint8_t[_size]);
+        _page->resource     = memory.get();
+        _page->cpuAddress   = memory.get();
+        _page->gpuAddress   = 0x100000000ull * ++created;
+        _page->size         = _size;
+        dedicated          += _size > PageSize ? 1 : 0;
+        live[_page->resource] = std::move(memory);
+        return true;
+    }
+
+    void Destroy(UploadPage* _page)
+    {
+        CHECK(live.erase(_page->resource) == 1);
+        destroyed++;
+    }
+};
+
+static UploadRing MakeRing(MockGpuFence& _fence, FakePages& _pages)
+{
+    return UploadRing(&_fence, PageSize,
+                      [&_pages](uint64_t _size, UploadPage* _page) { return _pages.Create(_size, _page); },
+                      [&_pages](UploadPage* _page) { _pages.Destroy(_page); });
+}
+
+// Mixed sizes and alignments: every allocation is aligned on both the CPU and GPU side, stays in
+// its page, and holds what was written to it until the frame ends.
+static void TestAlignment()
+{
+    MockGpuFence fence;
+    FakePages    pages;
+    {
+        UploadRing   ring = MakeRing(fence, pages);
+        std::mt19937 rng(1);
+        const uint64_t alignments[] = { 1, UploadAlignVertexBuffer, UploadAlignConstantBuffer, UploadAlignTexture };
+
+        std::vector<UploadAllocation> allocations;
+        for (int i = 0; i < 2000; i++)
+        {
+            uint64_t         alignment  = alignments[rng() % 4];
+            uint64_t         size       = 1 + rng() % 3000;
+            UploadAllocation allocation;
+            CHECK(ring.Allocate(size, alignment, &allocation));
+            CHECK(allocation.offset % alignment == 0);
+            CHECK(allocation.gpuAddress % alignment == 0);
+            CHECK(allocation.offset + allocation.size <= PageSize);
+            CHECK(allocation.size == size);
+            CHECK(allocation.cpuAddress == static_cast<uint8_t*>(allocation.resource) + allocation.offset);
+            memset(allocation.cpuAddress, i & 0xFF, size);
+            allocations.push_back(allocation);
+        }
+
+        bool intact = true;
+        for (size_t i = 0; i < allocations.size(); i++)
+        {
+            for (uint64_t b = 0; b < allocations[i].size; b++)
+            {
+                intact = intact && allocations[i].cpuAddress[b] == static_cast<uint8_t>(i & 0xFF);
+            }
+        }
+        CHECK(intact);
+        CHECK(pages.dedicated == 0);
+        ring.EndFrame(fence.Signal());
+    }
+    CHECK(pages.destroyed == pages.created && pages.live.empty());
+}
+
+// Frames run ahead of a GPU that completes them late and unevenly. No page may come back before
+// the frame that last used it has completed, and once the GPU keeps up the pool stops growing.
+static void TestReuseAfterFence()
+{
+    MockGpuFence fence;
+    FakePages    pages;
+    UploadRing   ring = MakeRing(fence, pages);
+
+    // Frame 1 fills two pages; frame 2 cannot have them back until the fence passes frame 1.
+    UploadAllocation allocation;
+    CHECK(ring.Allocate(PageSize / 2 + 1, 16, &allocation));
+    void* first = allocation.resource;
+    CHECK(ring.Allocate(PageSize / 2 + 1, 16, &allocation));
+    void* second = allocation.resource;
+    CHECK(second != first);
+    ring.EndFrame(fence.Signal());
+
+    CHECK(ring.Allocate(16, 16, &allocation));
+    CHECK(pages.created == 3);
+    ring.EndFrame(fence.Signal());
+
+    fence.Complete(1);
+    CHECK(ring.Allocate(16, 16, &allocation));
+    CHECK(pages.created == 3);
+    CHECK(allocation.resource == first || allocation.resource == second);
+    ring.EndFrame(fence.Signal());
+
+    // The fence value each page was last retired with, checked every time it is handed out.
+    std::map<void*, uint64_t> retiredAt;
+    std::vector<void*>        framePages;
+    std::mt19937              rng(2);
+    uint32_t                  pagesAtWarm = 0;
+    for (uint32_t frame = 0; frame < 500; frame++)
+    {
+        framePages.clear();
+        uint32_t count = rng() % 40;
+        for (uint32_t i = 0; i < count; i++)
+        {
+            CHECK(ring.Allocate(256 + rng() % 8192, UploadAlignConstantBuffer, &allocation));
+            auto found = retiredAt.find(allocation.resource);
+            CHECK(found == retiredAt.end() || found->second <= fence.GetCompletedValue());
+            framePages.push_back(allocation.resource);
+        }
+
+        uint64_t value = fence.Signal();
+        ring.EndFrame(value);
+        for (void* page : framePages)
+        {
+            retiredAt[page] = value;
+        }
+
+        // Up to three frames behind while warming up, then at most one.
+        uint64_t lag = frame < 250 ? rng() % 4 : rng() % 2;
+        if (value > lag)
+        {
+            fence.Complete(value - lag);
+        }
+        if (frame == 300)
+        {
+            pagesAtWarm = pages.created;
+        }
+    }
+    CHECK(pages.created == pagesAtWarm);
+    CHECK(ring.PageCount() == pages.live.size());
+}
+
+// Oversized requests get a page of their own at offset 0, leave the linear page where it was,
+// and are destroyed once retired rather than joining the free pages.
+static void TestDedicatedPages()
+{
+    MockGpuFence fence;
+    FakePages    pages;
+    {
+        UploadRing ring = MakeRing(fence, pages);
+
+        UploadAllocation small, large, next;
+        CHECK(ring.Allocate(100, 16, &small));
+        CHECK(ring.Allocate(PageSize * 3 + 5, UploadAlignTexture, &large));
+        CHECK(large.offset == 0 && large.size == PageSize * 3 + 5);
+        CHECK(large.resource != small.resource);
+        CHECK(pages.dedicated == 1);
+
+        // The linear page carries on after the dedicated one.
+        CHECK(ring.Allocate(100, 16, &next));
+        CHECK(next.resource == small.resource && next.offset == 112);
+
+        // Exactly a page still fits in a shared one.
+        CHECK(ring.Allocate(PageSize, 16, &next));
+        CHECK(pages.dedicated == 1 && next.offset == 0);
+        CHECK(ring.PageCount() == 3);
+
+        ring.EndFrame(fence.Signal());
+        fence.CompleteAll();
+        CHECK(ring.Allocate(16, 16, &next));
+        CHECK(pages.destroyed == 1 && pages.live.count(large.resource) == 0);
+        CHECK(ring.PageCount() == 2);
+
+        // A second oversized request gets a fresh page.
+        CHECK(ring.Allocate(PageSize + 1, 16, &large));
+        CHECK(pages.dedicated == 2 && pages.created == 4);
+
+        // Failing to create a page fails the allocation without disturbing the ring. The last
+        // free page is still used first.
+        pages.fail = true;
+        CHECK(!ring.Allocate(PageSize * 2, 16, &large));
+        CHECK(ring.Allocate(PageSize, 16, &next));
+        CHECK(!ring.Allocate(16, 16, &next));
+        CHECK(ring.PageCount() == 3);
+        pages.fail = false;
+        ring.EndFrame(fence.Signal());
+    }
+    CHECK(pages.destroyed == pages.created && pages.live.empty());
+}
+
+int main()
+{
+    TestAlignment();
+    TestReuseAfterFence();
+    TestDedicatedPages();
+    return TestResult("UploadRingTests");
+}
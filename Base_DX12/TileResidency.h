@@ -0,0 +1,208 @@
+#pragma once
+
+// Tile residency bookkeeping for reserved (tiled) resources.
+// A fixed pool of physical tile slots backs a virtual texture far larger than it. Feedback
+// requests the tiles a frame sampled; resident ones are touched in an LRU list, the rest queue up.
+// Update, once a frame, maps queued tiles to slots, coarsest level first so the fallback a missing
+// tile is sampled from arrives before its detail. Once the pool is full, it takes the slot of the
+// least recently used tile, unless that tile was requested this frame too. The pool is then
+// overcommitted, and taking the slot would only trade one missing tile for another. Requests
+// left unmapped, by that or by the per-update cap, are dropped; feedback repeats them next frame.
+// Pinned tiles, such as packed mips, hold their slot for good and are never evicted.
+// Not thread-safe: feedback is gathered and applied on one thread.
+// Portable C++, no graphics API dependencies.
+
+#include <algorithm>
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+static const uint32_t TileSlotInvalid = 0xFFFFFFFF;
+
+// Identifies a tile by level, usually the mip, and tile coordinates within it, 16 bits each.
+static inline uint64_t PackTileKey(uint32_t _level, uint32_t _x, uint32_t _y, uint32_t _z = 0)
+{
+    return (static_cast<uint64_t>(_level & 0xFFFF) << 48) | (static_cast<uint64_t>(_z & 0xFFFF) << 32) |
+           (static_cast<uint64_t>(_y & 0xFFFF) << 16)    | static_cast<uint64_t>(_x & 0xFFFF);
+}
+
+static inline uint32_t TileKeyLevel(uint64_t _key)  { return static_cast<uint32_t>(_key >> 48); }
+static inline uint32_t TileKeyX(uint64_t _key)      { return static_cast<uint32_t>(_key & 0xFFFF); }
+static inline uint32_t TileKeyY(uint64_t _key)      { return static_cast<uint32_t>((_key >> 16) & 0xFFFF); }
+static inline uint32_t TileKeyZ(uint64_t _key)      { return static_cast<uint32_t>((_key >> 32) & 0xFFFF); }
+
+struct TileMapping
+{
+    uint64_t    key     = 0;
+    uint32_t    slot    = TileSlotInvalid;
+};
+
+// One Update's changes. Unmaps must be applied before maps, as a mapped tile may reuse an
+// unmapped tile's slot. Newly mapped tiles hold undefined data until written.
+struct TileResidencyUpdate
+{
+    std::vector<uint64_t>       unmapped;
+    std::vector<TileMapping>    mapped;
+
+    void Clear()
+    {
+        unmapped.clear();
+        mapped.clear();
+    }
+};
+
+struct TileResidencyStats
+{
+    uint64_t    requests    = 0;
+    uint64_t    hits        = 0;    // Requests for tiles already resident.
+    uint64_t    mapped      = 0;
+    uint64_t    evicted     = 0;
+    uint64_t    starved     = 0;    // Requests dropped because every slot was in use this frame.
+    uint64_t    deferred    = 0;    // Requests dropped by the per-update cap.
+};
+
+class TileResidency
+{
+public:
+    explicit TileResidency(uint32_t _slotCount)
+        : m_slotCount(_slotCount)
+    {
+        // Hand out low slots first, so pinned tiles taken up front are contiguous.
+        for (uint32_t slot = _slotCount; slot > 0; slot--)
+        {
+            m_freeSlots.push_back(slot - 1);
+        }
+    }
+
+    // Makes _key resident for good. Returns its slot, or TileSlotInvalid if none is free.
+    uint32_t Pin(uint64_t _key)
+    {
+        auto found = m_resident.find(_key);
+        if (found != m_resident.end())
+        {
+            if (!found->second.pinned)
+            {
+                m_lru.erase(found->second.lru);
+                found->second.pinned = true;
+                m_pinnedCount++;
+            }
+            return found->second.slot;
+        }
+        if (m_freeSlots.empty())
+        {
+            return TileSlotInvalid;
+        }
+
+        Tile tile;
+        tile.slot   = m_freeSlots.back();
+        tile.pinned = true;
+        m_freeSlots.pop_back();
+        m_resident[_key] = tile;
+        m_pinnedCount++;
+        return tile.slot;
+    }
+
+    // Feedback for the current frame.
+    void Request(uint64_t _key)
+    {
+        m_stats.requests++;
+        auto found = m_resident.find(_key);
+        if (found == m_resident.end())
+        {
+            if (m_wantedSet.insert(_key).second)
+            {
+                m_wanted.push_back(_key);
+            }
+            return;
+        }
+
+        m_stats.hits++;
+        Tile& tile = found->second;
+        tile.lastUse = m_frame;
+        if (!tile.pinned)
+        {
+            m_lru.splice(m_lru.begin(), m_lru, tile.lru);
+        }
+    }
+
+    // Maps up to _maxMappings requested tiles, evicting as needed, and starts the next frame.
+    void Update(uint32_t _maxMappings, TileResidencyUpdate* _update)
+    {
+        _update->Clear();
+
+        // Coarsest level first; stable, so within a level tiles keep their request order.
+        std::stable_sort(m_wanted.begin(), m_wanted.end(), [](uint64_t _a, uint64_t _b) { return TileKeyLevel(_a) > TileKeyLevel(_b); });
+
+        for (size_t i = 0; i < m_wanted.size(); i++)
+        {
+            if (_update->mapped.size() >= _maxMappings)
+            {
+                m_stats.deferred += m_wanted.size() - i;
+                break;
+            }
+
+            uint32_t slot = TileSlotInvalid;
+            if (!m_freeSlots.empty())
+            {
+                slot = m_freeSlots.back();
+                m_freeSlots.pop_back();
+            }
+            else if (!m_lru.empty() && m_resident[m_lru.back()].lastUse < m_frame)
+            {
+                uint64_t victim = m_lru.back();
+                slot = m_resident[victim].slot;
+                m_lru.pop_back();
+                m_resident.erase(victim);
+                _update->unmapped.push_back(victim);
+                m_stats.evicted++;
+            }
+            else
+            {
+                m_stats.starved += m_wanted.size() - i;
+                break;
+            }
+
+            Tile tile;
+            tile.slot       = slot;
+            tile.lastUse    = m_frame;
+            m_lru.push_front(m_wanted[i]);
+            tile.lru        = m_lru.begin();
+            m_resident[m_wanted[i]] = tile;
+            _update->mapped.push_back({ m_wanted[i], slot });
+            m_stats.mapped++;
+        }
+
+        m_wanted.clear();
+        m_wantedSet.clear();
+        m_frame++;
+    }
+
+    bool IsResident(uint64_t _key) const { return m_resident.count(_key) != 0; }
+
+    uint32_t SlotCount() const      { return m_slotCount; }
+    uint32_t ResidentCount() const  { return static_cast<uint32_t>(m_resident.size()); }
+    uint32_t PinnedCount() const    { return m_pinnedCount; }
+
+    const TileResidencyStats& Stats() const { return m_stats; }
+
+private:
+    struct Tile
+    {
+        uint32_t                        slot    = TileSlotInvalid;
+        uint64_t                        lastUse = 0;
+        bool                            pinned  = false;
+        std::list<uint64_t>::iterator   lru;            // Unused when pinned.
+    };
+
+    uint32_t                            m_slotCount;
+    uint32_t                            m_pinnedCount = 0;
+    uint64_t                            m_frame = 0;
+    std::unordered_map<uint64_t, Tile>  m_resident;
+    std::list<uint64_t>                 m_lru;          // Most recently used first; pinned tiles are not in it.
+    std::vector<uint32_t>               m_freeSlots;    // Popped from the back.
+    std::vector<uint64_t>               m_wanted;       // This frame's requests for tiles not resident.
+    std::unordered_set<uint64_t>        m_wantedSet;
+    TileResidencyStats                  m_stats;
+};
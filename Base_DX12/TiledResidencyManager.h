@@ -0,0 +1,185 @@
+#pragma once
+
+// Residency for a reserved texture larger than the memory it may use.
+// A single heap of tile slots, sized to the budget, backs the texture; TileResidency decides which
+// tiles hold a slot. Feedback names the tiles a frame sampled, by tile or by UV region per mip.
+// Once a frame, Update applies the changes on the queue: every unmap as one UpdateTileMappings
+// call, then every map as another, each tile a one tile region with its own heap range. Queue
+// order makes this safe without fences: work already submitted reads the old mapping, later work
+// the new one. Newly mapped tiles hold undefined data; Update returns their coordinates so the
+// caller can write them before sampling. Packed mips cannot be mapped tile by tile, so they are
+// pinned and mapped up front.
+// Only single array slice 2D textures are handled, so the subresource is the mip.
+
+#include <d3d12.h>
+#include "d3dx12.h"
+#include "TileResidency.h"
+
+#include <iostream>
+#include <vector>
+
+class TiledResidencyManager
+{
+public:
+    // _resource must come from CreateReservedResource. Its packed mips are mapped on _queue here.
+    TiledResidencyManager(ID3D12Device* _device, ID3D12CommandQueue* _queue, ID3D12Resource* _resource, uint64_t _budgetBytes)
+        : m_resource(_resource), m_residency(static_cast<uint32_t>(_budgetBytes / D3D12_TILED_RESOURCE_TILE_SIZE_IN_BYTES))
+    {
+        D3D12_RESOURCE_DESC desc = _resource->GetDesc();
+        UINT tileCount      = 0;
+        UINT subresources   = desc.MipLevels;
+        m_tilings.resize(subresources);
+        _device->GetResourceTiling(_resource, &tileCount, &m_packedMips, &m_tileShape, &subresources, 0, m_tilings.data());
+
+        CD3DX12_HEAP_DESC heapDesc(static_cast<UINT64>(m_residency.SlotCount()) * D3D12_TILED_RESOURCE_TILE_SIZE_IN_BYTES, D3D12_HEAP_TYPE_DEFAULT, 0,
+                                   D3D12_HEAP_FLAG_DENY_BUFFERS | D3D12_HEAP_FLAG_DENY_RT_DS_TEXTURES);
+        if (!SUCCEEDED(_device->CreateHeap(&heapDesc, IID_PPV_ARGS(&m_heap))))
+        {
+            std::cout << "Failed to create tile pool heap\n";
+            return;
+        }
+
+        // Packed mips take the first slots, so one heap range covers them all.
+        if (m_packedMips.NumTilesForPackedMips > 0)
+        {
+            UINT firstSlot = TileSlotInvalid;
+            for (UINT i = 0; i < m_packedMips.NumTilesForPackedMips; i++)
+            {
+                uint32_t slot = m_residency.Pin(PackTileKey(m_packedMips.NumStandardMips, i, 0));
+                if (slot == TileSlotInvalid)
+                {
+                    std::cout << "Tile budget is too small for the packed mips\n";
+                    return;
+                }
+                firstSlot = i == 0 ? slot : firstSlot;
+            }
+
+            CD3DX12_TILED_RESOURCE_COORDINATE   coordinate(0, 0, 0, m_packedMips.NumStandardMips);
+            CD3DX12_TILE_REGION_SIZE            regionSize(m_packedMips.NumTilesForPackedMips, FALSE, 0, 0, 0);
+            D3D12_TILE_RANGE_FLAGS              rangeFlags      = D3D12_TILE_RANGE_FLAG_NONE;
+            UINT                                rangeTileCount  = m_packedMips.NumTilesForPackedMips;
+            _queue->UpdateTileMappings(m_resource, 1, &coordinate, &regionSize, m_heap, 1, &rangeFlags, &firstSlot, &rangeTileCount, D3D12_TILE_MAPPING_FLAG_NONE);
+        }
+        m_valid = true;
+    }
+
+    ~TiledResidencyManager()
+    {
+        if (m_heap)
+        {
+            m_heap->Release();
+        }
+    }
+
+    bool IsValid() const { return m_valid; }
+
+    // Mips at or past the packed ones are always resident and need no feedback.
+    void RequestTile(UINT _mip, UINT _x, UINT _y)
+    {
+        if (_mip < m_packedMips.NumStandardMips && _x < m_tilings[_mip].WidthInTiles && _y < m_tilings[_mip].HeightInTiles)
+        {
+            m_residency.Request(PackTileKey(_mip, _x, _y));
+        }
+    }
+
+    // Requests every tile of _mip under the normalised region [_u0, _u1) x [_v0, _v1).
+    void RequestRegion(UINT _mip, float _u0, float _v0, float _u1, float _v1)
+    {
+        if (_mip >= m_packedMips.NumStandardMips)
+        {
+            return;
+        }
+
+        const D3D12_SUBRESOURCE_TILING& tiling = m_tilings[_mip];
+        UINT x0 = TileIndex(_u0, tiling.WidthInTiles);
+        UINT x1 = TileIndex(_u1, tiling.WidthInTiles);
+        UINT y0 = TileIndex(_v0, tiling.HeightInTiles);
+        UINT y1 = TileIndex(_v1, tiling.HeightInTiles);
+        for (UINT y = y0; y <= y1; y++)
+        {
+            for (UINT x = x0; x <= x1; x++)
+            {
+                m_residency.Request(PackTileKey(_mip, x, y));
+            }
+        }
+    }
+
+    // Maps up to _maxMappings requested tiles on _queue and fills _mapped with their coordinates.
+    void Update(ID3D12CommandQueue* _queue, uint32_t _maxMappings, std::vector<D3D12_TILED_RESOURCE_COORDINATE>* _mapped)
+    {
+        _mapped->clear();
+        if (!m_valid)
+        {
+            return;
+        }
+
+        m_residency.Update(_maxMappings, &m_update);
+
+        if (!m_update.unmapped.empty())
+        {
+            m_coordinates.clear();
+            for (uint64_t key : m_update.unmapped)
+            {
+                m_coordinates.push_back(Coordinate(key));
+            }
+            m_regionSizes.assign(m_coordinates.size(), CD3DX12_TILE_REGION_SIZE(1, FALSE, 0, 0, 0));
+
+            // A single NULL range covering every region unmaps them all.
+            D3D12_TILE_RANGE_FLAGS  rangeFlags      = D3D12_TILE_RANGE_FLAG_NULL;
+            UINT                    rangeTileCount  = static_cast<UINT>(m_coordinates.size());
+            _queue->UpdateTileMappings(m_resource, static_cast<UINT>(m_coordinates.size()), m_coordinates.data(), m_regionSizes.data(),
+                                       nullptr, 1, &rangeFlags, nullptr, &rangeTileCount, D3D12_TILE_MAPPING_FLAG_NONE);
+        }
+
+        if (!m_update.mapped.empty())
+        {
+            m_coordinates.clear();
+            m_heapOffsets.clear();
+            for (const TileMapping& mapping : m_update.mapped)
+            {
+                m_coordinates.push_back(Coordinate(mapping.key));
+                m_heapOffsets.push_back(mapping.slot);
+            }
+            m_regionSizes.assign(m_coordinates.size(), CD3DX12_TILE_REGION_SIZE(1, FALSE, 0, 0, 0));
+            m_rangeFlags.assign(m_coordinates.size(), D3D12_TILE_RANGE_FLAG_NONE);
+            m_rangeTileCounts.assign(m_coordinates.size(), 1);
+            _queue->UpdateTileMappings(m_resource, static_cast<UINT>(m_coordinates.size()), m_coordinates.data(), m_regionSizes.data(),
+                                       m_heap, static_cast<UINT>(m_coordinates.size()), m_rangeFlags.data(), m_heapOffsets.data(), m_rangeTileCounts.data(),
+                                       D3D12_TILE_MAPPING_FLAG_NONE);
+            _mapped->assign(m_coordinates.begin(), m_coordinates.end());
+        }
+    }
+
+    ID3D12Resource*             Resource() const    { return m_resource; }
+    const D3D12_TILE_SHAPE&     TileShape() const   { return m_tileShape; }
+    UINT                        StandardMips() const { return m_packedMips.NumStandardMips; }
+    const TileResidency&        Residency() const   { return m_residency; }
+
+private:
+    static UINT TileIndex(float _coordinate, UINT _tiles)
+    {
+        float scaled = _coordinate * static_cast<float>(_tiles);
+        return scaled <= 0.0f ? 0 : (std::min)(static_cast<UINT>(scaled), _tiles - 1);
+    }
+
+    static CD3DX12_TILED_RESOURCE_COORDINATE Coordinate(uint64_t _key)
+    {
+        return CD3DX12_TILED_RESOURCE_COORDINATE(TileKeyX(_key), TileKeyY(_key), TileKeyZ(_key), TileKeyLevel(_key));
+    }
+
+    ID3D12Resource*                                 m_resource;
+    ID3D12Heap*                                     m_heap          = nullptr;
+    bool                                            m_valid         = false;
+    TileResidency                                   m_residency;
+    TileResidencyUpdate                             m_update;
+    D3D12_PACKED_MIP_INFO                           m_packedMips    = {};
+    D3D12_TILE_SHAPE                                m_tileShape     = {};
+    std::vector<CD3DX12_SUBRESOURCE_TILING>         m_tilings;
+
+    // Scratch for the batched UpdateTileMappings calls.
+    std::vector<D3D12_TILED_RESOURCE_COORDINATE>    m_coordinates;
+    std::vector<D3D12_TILE_REGION_SIZE>             m_regionSizes;
+    std::vector<D3D12_TILE_RANGE_FLAGS>             m_rangeFlags;
+    std::vector<UINT>                               m_heapOffsets;
+    std::vector<UINT>                               m_rangeTileCounts;
+};
@@ -0,0 +1,361 @@
+#pragma once
+
+// Two-level segregated fit (TLSF) offset allocator.
+// Manages a range of offsets, e.g. a GPU heap, with O(1) allocation and free. Free blocks are kept
+// in lists indexed by a first level (power of two) and second level (linear subdivision of that
+// power of two) size class, with bitmaps to find the first non-empty list. Freed blocks merge
+// with free physical neighbours. All bookkeeping is held outside the managed memory, so it works
+// for memory the CPU cannot touch. Portable C++, no graphics API dependencies.
+
+#include <cstdint>
+#include <vector>
+
+#if defined(_MSC_VER)
+    #include <intrin.h>
+#endif
+
+static const uint32_t TlsfInvalid = 0xFFFFFFFF;
+
+struct TlsfAllocation
+{
+    uint64_t offset = 0;
+    uint64_t size   = 0;
+    uint32_t block  = TlsfInvalid;  // Handle passed back to Free.
+};
+
+class TlsfAllocator
+{
+public:
+    explicit TlsfAllocator(uint64_t _size) : m_size(_size)
+    {
+        for (uint32_t fl = 0; fl < FirstLevelCount; fl++)
+        {
+            for (uint32_t sl = 0; sl < SecondLevelCount; sl++)
+            {
+                m_freeHeads[fl][sl] = TlsfInvalid;
+            }
+        }
+
+        uint32_t block = NewBlock();
+        m_blocks[block].offset = 0;
+        m_blocks[block].size   = _size;
+        InsertFree(block);
+    }
+
+    // _alignment must be a power of two.
+    bool Allocate(uint64_t _size, uint64_t _alignment, TlsfAllocation* _allocation)
+    {
+        if (_size == 0)
+        {
+            return false;
+        }
+
+        // Over-request so any block found can absorb the alignment padding.
+        uint64_t search = _size + (_alignment > 1 ? _alignment - 1 : 0);
+        uint32_t block  = FindFree(search);
+        if (block == TlsfInvalid)
+        {
+            return false;
+        }
+        RemoveFree(block);
+
+        // Split off the alignment padding at the front as its own free block.
+        uint64_t aligned = (m_blocks[block].offset + _alignment - 1) & ~(_alignment - 1);
+        uint64_t padding = aligned - m_blocks[block].offset;
+        if (padding > 0)
+        {
+            uint32_t front = SplitFront(block, padding);
+            InsertFree(front);
+        }
+
+        // Return the tail to the free lists.
+        if (m_blocks[block].size > _size)
+        {
+            uint32_t front = SplitFront(block, _size);
+            InsertFree(block);
+            block = front;
+        }
+
+        m_blocks[block].free = false;
+        m_usedBytes += m_blocks[block].size;
+        m_allocationCount++;
+
+        _allocation->offset = m_blocks[block].offset;
+        _allocation->size   = m_blocks[block].size;
+        _allocation->block  = block;
+        return true;
+    }
+
+    void Free(uint32_t _block)
+    {
+        Block& freed = m_blocks[_block];
+        m_usedBytes -= freed.size;
+        m_allocationCount--;
+
+        // Merge with free physical neighbours.
+        uint32_t next = freed.nextPhys;
+        if (next != TlsfInvalid && m_blocks[next].free)
+        {
+            RemoveFree(next);
+            Absorb(_block, next);
+        }
+
+        uint32_t prev = m_blocks[_block].prevPhys;
+        if (prev != TlsfInvalid && m_blocks[prev].free)
+        {
+            RemoveFree(prev);
+            Absorb(prev, _block);
+            _block = prev;
+        }
+
+        InsertFree(_block);
+    }
+
+    uint64_t Size() const               { return m_size; }
+    uint64_t UsedBytes() const          { return m_usedBytes; }
+    uint64_t FreeBytes() const          { return m_size - m_usedBytes; }
+    uint32_t AllocationCount() const    { return m_allocationCount; }
+    bool     IsEmpty() const            { return m_allocationCount == 0; }
+
+    uint64_t LargestFreeBlock() const
+    {
+        if (m_firstLevelMap == 0)
+        {
+            return 0;
+        }
+
+        uint32_t fl     = 63 - CountLeadingZeros64(m_firstLevelMap);
+        uint32_t sl     = 31 - CountLeadingZeros32(m_secondLevelMap[fl]);
+        uint64_t largest = 0;
+        for (uint32_t block = m_freeHeads[fl][sl]; block != TlsfInvalid; block = m_blocks[block].nextFree)
+        {
+            largest = m_blocks[block].size > largest ? m_blocks[block].size : largest;
+        }
+        return largest;
+    }
+
+    // 0 when all free space is one block, approaching 1 as it splinters.
+    double Fragmentation() const
+    {
+        uint64_t freeBytes = FreeBytes();
+        return freeBytes ? 1.0 - static_cast<double>(LargestFreeBlock()) / freeBytes : 0.0;
+    }
+
+private:
+    static const uint32_t SecondLevelLog2   = 4;
+    static const uint32_t SecondLevelCount  = 1 << SecondLevelLog2;
+    static const uint32_t FirstLevelCount   = 64 - SecondLevelLog2 + 1;
+
+    struct Block
+    {
+        uint64_t offset     = 0;
+        uint64_t size       = 0;
+        uint32_t prevPhys   = TlsfInvalid;
+        uint32_t nextPhys   = TlsfInvalid;
+        uint32_t prevFree   = TlsfInvalid;
+        uint32_t nextFree   = TlsfInvalid;
+        bool     free       = false;
+    };
+
+    static uint32_t CountTrailingZeros64(uint64_t _value)
+    {
+    #if defined(_MSC_VER)
+        unsigned long index;
+        _BitScanForward64(&index, _value);
+        return index;
+    #else
+        return __builtin_ctzll(_value);
+    #endif
+    }
+
+    static uint32_t CountTrailingZeros32(uint32_t _value)
+    {
+    #if defined(_MSC_VER)
+        unsigned long index;
+        _BitScanForward(&index, _value);
+        return index;
+    #else
+        return __builtin_ctz(_value);
+    #endif
+    }
+
+    static uint32_t CountLeadingZeros64(uint64_t _value)
+    {
+    #if defined(_MSC_VER)
+        unsigned long index;
+        _BitScanReverse64(&index, _value);
+        return 63 - index;
+    #else
+        return __builtin_clzll(_value);
+    #endif
+    }
+
+    static uint32_t CountLeadingZeros32(uint32_t _value)
+    {
+    #if defined(_MSC_VER)
+        unsigned long index;
+        _BitScanReverse(&index, _value);
+        return 31 - index;
+    #else
+        return __builtin_clz(_value);
+    #endif
+    }
+
+    // Size class a block of _size belongs to.
+    static void Mapping(uint64_t _size, uint32_t* _fl, uint32_t* _sl)
+    {
+        if (_size < SecondLevelCount)
+        {
+            *_fl = 0;
+            *_sl = static_cast<uint32_t>(_size);
+            return;
+        }
+
+        uint32_t log2 = 63 - CountLeadingZeros64(_size);
+        *_fl = log2 - SecondLevelLog2 + 1;
+        *_sl = static_cast<uint32_t>((_size >> (log2 - SecondLevelLog2)) ^ SecondLevelCount);
+    }
+
+    // First free block guaranteed to hold _size: round up to the next size class and search upwards.
+    uint32_t FindFree(uint64_t _size) const
+    {
+        if (_size >= SecondLevelCount)
+        {
+            uint32_t log2   = 63 - CountLeadingZeros64(_size);
+            uint64_t round  = (uint64_t(1) << (log2 - SecondLevelLog2)) - 1;
+            if (_size + round < _size)
+            {
+                return TlsfInvalid;
+            }
+            _size += round;
+        }
+
+        uint32_t fl, sl;
+        Mapping(_size, &fl, &sl);
+        if (fl >= FirstLevelCount)
+        {
+            return TlsfInvalid;
+        }
+
+        uint32_t slMap = m_secondLevelMap[fl] & (~0u << sl);
+        if (slMap == 0)
+        {
+            uint64_t flMap = fl + 1 < 64 ? m_firstLevelMap & (~0ull << (fl + 1)) : 0;
+            if (flMap == 0)
+            {
+                return TlsfInvalid;
+            }
+            fl      = CountTrailingZeros64(flMap);
+            slMap   = m_secondLevelMap[fl];
+        }
+
+        return m_freeHeads[fl][CountTrailingZeros32(slMap)];
+    }
+
+    void InsertFree(uint32_t _block)
+    {
+        uint32_t fl, sl;
+        Mapping(m_blocks[_block].size, &fl, &sl);
+
+        Block& block    = m_blocks[_block];
+        block.free      = true;
+        block.prevFree  = TlsfInvalid;
+        block.nextFree  = m_freeHeads[fl][sl];
+        if (block.nextFree != TlsfInvalid)
+        {
+            m_blocks[block.nextFree].prevFree = _block;
+        }
+        m_freeHeads[fl][sl] = _block;
+
+        m_firstLevelMap     |= uint64_t(1) << fl;
+        m_secondLevelMap[fl] |= 1u << sl;
+    }
+
+    void RemoveFree(uint32_t _block)
+    {
+        uint32_t fl, sl;
+        Mapping(m_blocks[_block].size, &fl, &sl);
+
+        Block& block = m_blocks[_block];
+        if (block.prevFree != TlsfInvalid) { m_blocks[block.prevFree].nextFree = block.nextFree; }
+        if (block.nextFree != TlsfInvalid) { m_blocks[block.nextFree].prevFree = block.prevFree; }
+        if (m_freeHeads[fl][sl] == _block)
+        {
+            m_freeHeads[fl][sl] = block.nextFree;
+            if (block.nextFree == TlsfInvalid)
+            {
+                m_secondLevelMap[fl] &= ~(1u << sl);
+                if (m_secondLevelMap[fl] == 0)
+                {
+                    m_firstLevelMap &= ~(uint64_t(1) << fl);
+                }
+            }
+        }
+
+        block.free      = false;
+        block.prevFree  = TlsfInvalid;
+        block.nextFree  = TlsfInvalid;
+    }
+
+    // Cuts the first _size bytes of _block into a new block placed before it and returns the new block.
+    uint32_t SplitFront(uint32_t _block, uint64_t _size)
+    {
+        uint32_t front = NewBlock();
+        Block&   block = m_blocks[_block];
+        Block&   split = m_blocks[front];
+
+        split.offset    = block.offset;
+        split.size      = _size;
+        split.prevPhys  = block.prevPhys;
+        split.nextPhys  = _block;
+        if (split.prevPhys != TlsfInvalid)
+        {
+            m_blocks[split.prevPhys].nextPhys = front;
+        }
+
+        block.offset   += _size;
+        block.size     -= _size;
+        block.prevPhys  = front;
+        return front;
+    }
+
+    // Merges _next, which must directly follow _block, into _block.
+    void Absorb(uint32_t _block, uint32_t _next)
+    {
+        Block& block = m_blocks[_block];
+        Block& next  = m_blocks[_next];
+
+        block.size     += next.size;
+        block.nextPhys  = next.nextPhys;
+        if (block.nextPhys != TlsfInvalid)
+        {
+            m_blocks[block.nextPhys].prevPhys = _block;
+        }
+        m_unusedBlocks.push_back(_next);
+    }
+
+    uint32_t NewBlock()
+    {
+        if (!m_unusedBlocks.empty())
+        {
+            uint32_t block = m_unusedBlocks.back();
+            m_unusedBlocks.pop_back();
+            m_blocks[block] = Block();
+            return block;
+        }
+
+        m_blocks.push_back(Block());
+        return static_cast<uint32_t>(m_blocks.size() - 1);
+    }
+
+    uint64_t                m_size;
+    uint64_t                m_usedBytes         = 0;
+    uint32_t                m_allocationCount   = 0;
+
+    std::vector<Block>      m_blocks;
+    std::vector<uint32_t>   m_unusedBlocks;
+
+    uint64_t                m_firstLevelMap     = 0;
+    uint32_t                m_secondLevelMap[FirstLevelCount] = {};
+    uint32_t                m_freeHeads[FirstLevelCount][SecondLevelCount];
+};
@@ -0,0 +1,165 @@
+#pragma once
+
+// Linear per-frame upload allocator.
+// Dynamic data is suballocated front to back out of large, persistently mapped upload pages. At
+// the end of a frame every page it touched is tagged with the frame's fence value and is only
+// handed out again once the GPU has passed that value. Requests larger than a page get a
+// dedicated page which is destroyed rather than recycled on retirement.
+// Page creation is supplied by the caller, so the allocation logic has no graphics API dependency.
+
+#include "GpuFence.h"
+
+#include <deque>
+#include <functional>
+#include <vector>
+
+// Placement alignments matching D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT and friends.
+static const uint64_t UploadAlignConstantBuffer = 256;
+static const uint64_t UploadAlignVertexBuffer   = 16;
+static const uint64_t UploadAlignTexture        = 512;
+
+struct UploadPage
+{
+    void*       resource    = nullptr;  // Backend object, e.g. ID3D12Resource*.
+    void*       allocation  = nullptr;  // Backend allocation the resource is placed in, if any.
+    uint8_t*    cpuAddress  = nullptr;
+    uint64_t    gpuAddress  = 0;
+    uint64_t    size        = 0;
+    uint64_t    retireFence = 0;
+    bool        dedicated   = false;
+};
+
+struct UploadAllocation
+{
+    void*       resource    = nullptr;
+    uint8_t*    cpuAddress  = nullptr;
+    uint64_t    gpuAddress  = 0;
+    uint64_t    offset      = 0;        // Offset within resource.
+    uint64_t    size        = 0;
+};
+
+typedef std::function<bool(uint64_t _size, UploadPage* _page)> UploadPageCreateFn;
+typedef std::function<void(UploadPage* _page)>                  UploadPageDestroyFn;
+
+class UploadRing
+{
+public:
+    UploadRing(IGpuFence* _fence, uint64_t _pageSize, UploadPageCreateFn _createPage, UploadPageDestroyFn _destroyPage)
+        : m_fence(_fence), m_pageSize(_pageSize), m_createPage(std::move(_createPage)), m_destroyPage(std::move(_destroyPage))
+    {
+    }
+
+    ~UploadRing()
+    {
+        for (UploadPage& page : m_framePages)       { m_destroyPage(&page); }
+        for (UploadPage& page : m_inFlightPages)    { m_destroyPage(&page); }
+        for (UploadPage& page : m_freePages)        { m_destroyPage(&page); }
+    }
+
+    // _alignment must be a power of two.
+    bool Allocate(uint64_t _size, uint64_t _alignment, UploadAllocation* _allocation)
+    {
+        if (_size > m_pageSize)
+        {
+            UploadPage page;
+            if (!m_createPage(_size, &page))
+            {
+                return false;
+            }
+            page.dedicated = true;
+            m_framePages.push_back(page);
+            Fill(m_framePages.back(), 0, _size, _allocation);
+            return true;
+        }
+
+        uint64_t offset = (m_offset + _alignment - 1) & ~(_alignment - 1);
+        if (m_current < 0 || offset + _size > m_pageSize)
+        {
+            if (!NextPage())
+            {
+                return false;
+            }
+            offset = 0;
+        }
+
+        Fill(m_framePages[m_current], offset, _size, _allocation);
+        m_offset = offset + _size;
+        return true;
+    }
+
+    // Tags every page used since the last call with the frame's fence value.
+    void EndFrame(uint64_t _fenceValue)
+    {
+        for (UploadPage& page : m_framePages)
+        {
+            page.retireFence = _fenceValue;
+            m_inFlightPages.push_back(page);
+        }
+        m_framePages.clear();
+        m_current   = -1;
+        m_offset    = 0;
+    }
+
+    // Returns pages the GPU has finished with to the free list.
+    void Retire()
+    {
+        uint64_t completed = m_fence->GetCompletedValue();
+        while (!m_inFlightPages.empty() && m_inFlightPages.front().retireFence <= completed)
+        {
+            UploadPage page = m_inFlightPages.front();
+            m_inFlightPages.pop_front();
+            if (page.dedicated)
+            {
+                m_destroyPage(&page);
+            }
+            else
+            {
+                m_freePages.push_back(page);
+            }
+        }
+    }
+
+    size_t PageCount() const { return m_framePages.size() + m_inFlightPages.size() + m_freePages.size(); }
+
+private:
+    bool NextPage()
+    {
+        Retire();
+
+        UploadPage page;
+        if (!m_freePages.empty())
+        {
+            page = m_freePages.back();
+            m_freePages.pop_back();
+        }
+        else if (!m_createPage(m_pageSize, &page))
+        {
+            return false;
+        }
+
+        m_framePages.push_back(page);
+        m_current   = static_cast<int>(m_framePages.size()) - 1;
+        m_offset    = 0;
+        return true;
+    }
+
+    static void Fill(const UploadPage& _page, uint64_t _offset, uint64_t _size, UploadAllocation* _allocation)
+    {
+        _allocation->resource   = _page.resource;
+        _allocation->cpuAddress = _page.cpuAddress + _offset;
+        _allocation->gpuAddress = _page.gpuAddress + _offset;
+        _allocation->offset     = _offset;
+        _allocation->size       = _size;
+    }
+
+    IGpuFence*              m_fence;
+    uint64_t                m_pageSize;
+    UploadPageCreateFn      m_createPage;
+    UploadPageDestroyFn     m_destroyPage;
+
+    std::vector<UploadPage> m_framePages;       // Pages written this frame.
+    std::deque<UploadPage>  m_inFlightPages;    // In fence order.
+    std::vector<UploadPage> m_freePages;
+    int                     m_current   = -1;   // Index into m_framePages of the linear page.
+    uint64_t                m_offset    = 0;
+};
@@ -5,8 +5,113 @@
 #include <dxgi1_6.h>
 #include <D3Dcompiler.h>
 #include <DirectXMath.h>
+#include <atomic>
+#include <chrono>
 #include <iostream>
 #include "main.h"
+#include "GpuFence.h"
+#include "AssetStreamer.h"
+#include "CommandListPool.h"
+#include "CopyQueueUploader.h"
+#include "DeferredReleaseQueue.h"
+#include "DescriptorHeaps.h"
+#include "FenceCompletionService.h"
+#include "FrameRing.h"
+#include "GpuCullingPass.h"
+#include "GpuTimestampProfiler.h"
+#include "HeapManager.h"
+#include "JobSystem.h"
+#include "PipelineStateCache.h"
+#include "RenderGraph.h"
+#include "ResourceStateTracker.h"
+#include "TiledResidencyManager.h"
+#include "UploadRing.h"
+
+// Tools/embed_shaders.py compiles the HLSL() sources below to DXIL at build time when dxc is available.
+#if __has_include("ShadersDxil.h")
+    #include "ShadersDxil.h"
+    #define HAS_EMBEDDED_SHADERS 1
+#else
+    #define HAS_EMBEDDED_SHADERS 0
+#endif
+
+// Number of frames the CPU may record ahead of the GPU.
+static const unsigned int FramesInFlight = 2;
+
+// Maximum number of command lists draws are split across for parallel recording.
+static const unsigned int ParallelRecordLists = 4;
+
+// Command allocator/list pairs a queue type may have alive at once, and the frames their pool
+// keeps enough for the busiest of.
+static const uint32_t MaxCommandListsPerQueue    = 64;
+static const uint32_t CommandListHighWaterFrames = 120;
+
+// Size of each persistently mapped upload page.
+static const uint64_t UploadPageSize = 2 * 1024 * 1024;
+
+// Size of the heaps upload pages are placed in.
+static const uint64_t UploadHeapSize = 16 * 1024 * 1024;
+
+// Size of the DEFAULT heaps static geometry and indirect arguments are placed in.
+static const uint64_t StaticHeapSize = 16 * 1024 * 1024;
+
+// Objects in the scene, each a culled and indirectly drawn triangle.
+static const uint32_t ObjectCount = 100000;
+static const uint32_t ObjectVertexCount = 3;
+
+// Staging bytes and upload count a single copy queue submission is limited to.
+static const uint64_t CopyBatchBytes   = 2 * 1024 * 1024;
+static const uint32_t CopyBatchUploads = 256;
+
+// Capacity of the CPU render target view heap.
+static const uint32_t RtvDescriptorCapacity = 64;
+
+// States that only read and may be combined, for the state trackers.
+static const uint32_t D3D12ReadStates = D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER | D3D12_RESOURCE_STATE_INDEX_BUFFER |
+                                        D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE  | D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE |
+                                        D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT          | D3D12_RESOURCE_STATE_COPY_SOURCE |
+                                        D3D12_RESOURCE_STATE_DEPTH_READ;
+
+// Timestamp scopes a frame may record.
+static const uint32_t MaxGpuScopes = 64;
+
+// Fence waits longer than this are reported as a hung GPU rather than waited on.
+static const uint32_t FenceTimeoutMs = 5000;
+
+// Objects the deferred release queue frees per completed frame at most; the rest wait for the next one.
+static const size_t ReleaseBudgetPerFrame = 64;
+
+// Side of the virtual texture, its physical tile budget and the tiles it may map per frame.
+static const uint32_t VirtualTextureSize    = 16384;
+static const uint64_t VirtualTextureBudget  = 32 * 1024 * 1024;
+static const uint32_t MaxTileMapsPerFrame   = 32;
+
+// Asset files are cut into blocks of this size; the streamer keeps this many reads and bytes in flight.
+static const uint32_t AssetBlockSize     = 256 * 1024;
+static const uint32_t AssetQueueDepth    = 64;
+static const uint64_t AssetInFlightBytes = 16 * 1024 * 1024;
+
+// Per-object data read from the instance-rate vertex buffer: offset, scale.
+struct ObjectInstance
+{
+    float x, y, scale, padding;
+};
+
+// Draws for one chunk of objects: up to maxCount arguments, with the number to draw read from the count buffer.
+struct IndirectBatch
+{
+    UINT    maxCount;
+    UINT64  argumentOffset;
+    UINT64  countOffset;
+};
+
+struct IndirectDraws
+{
+    ID3D12CommandSignature*     signature   = nullptr;
+    ID3D12Resource*             arguments   = nullptr;
+    ID3D12Resource*             counts      = nullptr;
+    std::vector<IndirectBatch>  batches;
+};
 
 #define HLSL(input) #input
 
@@ -18,10 +123,10 @@ struct vertexOutput
     float4 p_position : SV_POSITION;
 };
 
-vertexOutput vs_main(float3 v_position : POSITION)
+vertexOutput vs_main(float3 v_position : POSITION, float4 instance : INSTANCE)
 {
     vertexOutput output;
-    output.p_position = float4(v_position, 1.0);
+    output.p_position = float4(v_position * instance.z + float3(instance.xy, 0.0), 1.0);
     return output;
 }
 
@@ -32,6 +137,66 @@ float4 ps_main(vertexOutput input) : SV_TARGET
 }
 );
 
+// Appends a draw for every object whose sphere is inside the frustum to its chunk of the
+// argument buffer. Matches CullSpheres in ObjectCulling.h up to order.
+static const std::string cullShaderSource = HLSL(
+
+struct DrawArguments
+{
+    uint vertexCountPerInstance;
+    uint instanceCount;
+    uint startVertexLocation;
+    uint startInstanceLocation;
+};
+
+struct CullConstants
+{
+    float4  planes[6];
+    uint    objectCount;
+    uint    chunkSize;
+    uint    vertexCount;
+    uint    padding;
+};
+
+ConstantBuffer<CullConstants>       constants : register(b0);
+StructuredBuffer<float4>            spheres   : register(t0);
+RWStructuredBuffer<DrawArguments>   arguments : register(u0);
+RWByteAddressBuffer                 counts    : register(u1);
+
+[numthreads(64, 1, 1)]
+void cs_main(uint3 id : SV_DispatchThreadID)
+{
+    uint object = id.x;
+    if (object >= constants.objectCount)
+    {
+        return;
+    }
+
+    float4 sphere  = spheres[object];
+    bool   visible = true;
+    for (uint p = 0; p < 6; p++)
+    {
+        float4 plane = constants.planes[p];
+        visible = visible && ((plane.x * sphere.x + plane.y * sphere.y) + plane.z * sphere.z) + plane.w >= -sphere.w;
+    }
+    if (!visible)
+    {
+        return;
+    }
+
+    uint chunk = object / constants.chunkSize;
+    uint slot;
+    counts.InterlockedAdd(chunk * 4, 1, slot);
+
+    DrawArguments draw;
+    draw.vertexCountPerInstance = constants.vertexCount;
+    draw.instanceCount          = 1;
+    draw.startVertexLocation    = 0;
+    draw.startInstanceLocation  = object;
+    arguments[chunk * constants.chunkSize + slot] = draw;
+}
+);
+
 static LRESULT CALLBACK WindowCallbackFn(HWND window, UINT msg, WPARAM wparam, LPARAM lparam)
 {
     LRESULT res = 0;
@@ -168,12 +333,85 @@ ID3D12Device* GetD3D12Device(IDXGIFactory7* _factory, bool _useWARP)
     return device;
 }
 
-ID3D12CommandQueue* CreateCommandQueue(ID3D12Device* _device)
+// IGpuFence over an ID3D12Fence that is signalled on a single command queue.
+class D3D12QueueFence : public IGpuFence
+{
+public:
+    D3D12QueueFence(ID3D12Device* _device, ID3D12CommandQueue* _queue) : m_queue(_queue)
+    {
+        if (!SUCCEEDED(_device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&m_fence))))
+        {
+            std::cout << "Failed to create fence\n";
+        }
+    }
+
+    ~D3D12QueueFence()
+    {
+        if (m_fence) { m_fence->Release(); }
+    }
+
+    // Signalled from the submitting thread only; other threads read the last value, which is
+    // published once the signal is on the queue so nobody waits for a value never signalled.
+    uint64_t Signal() override
+    {
+        uint64_t value = m_lastSignaled.load() + 1;
+        m_queue->Signal(m_fence, value);
+        m_lastSignaled.store(value);
+        return value;
+    }
+
+    uint64_t GetLastSignaledValue() const override  { return m_lastSignaled; }
+    uint64_t GetCompletedValue() const override     { return m_fence->GetCompletedValue(); }
+
+    bool WaitForValue(uint64_t _value, uint32_t _timeoutMs = GpuFenceInfinite) override
+    {
+        if (m_fence->GetCompletedValue() >= _value)
+        {
+            return true;
+        }
+
+        // One waiter per waiting thread, closed when the thread exits, and one registration per
+        // wait. An earlier timed out wait can leave the event set, so completion is re-checked
+        // rather than trusted from the event.
+        static thread_local GpuFenceWaiter waiter;
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(_timeoutMs == GpuFenceInfinite ? 0 : _timeoutMs);
+        m_fence->SetEventOnCompletion(_value, waiter.Event());
+        while (m_fence->GetCompletedValue() < _value)
+        {
+            uint32_t waitMs = GpuFenceInfinite;
+            if (_timeoutMs != GpuFenceInfinite)
+            {
+                auto remaining = std::chrono::ceil<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+                waitMs = remaining > 0 ? static_cast<uint32_t>(remaining) : 0;
+            }
+            if (!waiter.Wait(waitMs))
+            {
+                return m_fence->GetCompletedValue() >= _value;
+            }
+        }
+        return true;
+    }
+
+    void WakeOnCompletion(uint64_t _value, GpuFenceWaiter& _waiter) override
+    {
+        m_fence->SetEventOnCompletion(_value, _waiter.Event());
+    }
+
+    ID3D12Fence*        GetFence() const { return m_fence; }
+    ID3D12CommandQueue* GetQueue() const { return m_queue; }
+
+private:
+    ID3D12CommandQueue*     m_queue         = nullptr;
+    ID3D12Fence*            m_fence         = nullptr;
+    std::atomic<uint64_t>   m_lastSignaled{ 0 };
+};
+
+ID3D12CommandQueue* CreateCommandQueue(ID3D12Device* _device, D3D12_COMMAND_LIST_TYPE _type = D3D12_COMMAND_LIST_TYPE_DIRECT)
 {
     // Describe and create the command queue.
     D3D12_COMMAND_QUEUE_DESC queueDesc = {};
     queueDesc.Flags = D3D12_COMMAND_QUEUE_FLAG_NONE;
-    queueDesc.Type = D3D12_COMMAND_LIST_TYPE_DIRECT;
+    queueDesc.Type = _type;
 
     ID3D12CommandQueue* commandQueue = nullptr;
     if (!SUCCEEDED(_device->CreateCommandQueue(&queueDesc, IID_PPV_ARGS(&commandQueue))))
@@ -214,74 +452,80 @@ IDXGISwapChain1* CreateSwapChain(ID3D12Device* _device, ID3D12CommandQueue* _com
     return swapChain;
 }
 
-ID3D12DescriptorHeap* CreateRTVDescriptorHeap(ID3D12Device* _device, unsigned int* _rtvHeapSize)
+ID3D12Resource* CreateRenderTarget(ID3D12Device* _device, IDXGISwapChain1* _swapChain, D3D12_CPU_DESCRIPTOR_HANDLE _rtvHandle, unsigned int _index)
 {
-    ID3D12DescriptorHeap*       rtvHeap     = nullptr;
-    D3D12_DESCRIPTOR_HEAP_DESC  rtvHeapDesc = {};
-    rtvHeapDesc.NumDescriptors  = 2;
-    rtvHeapDesc.Type            = D3D12_DESCRIPTOR_HEAP_TYPE_RTV;
-    rtvHeapDesc.Flags           = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
-    if (!SUCCEEDED(_device->CreateDescriptorHeap(&rtvHeapDesc, IID_PPV_ARGS(&rtvHeap))))
-    {
-        return nullptr;
-    }
-    else
-    {
-        *_rtvHeapSize = _device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
-        return rtvHeap;
-    }
-}
-
-ID3D12Resource* CreateRenderTarget(ID3D12Device* _device, IDXGISwapChain1* _swapChain, ID3D12DescriptorHeap* _rtvHeap, unsigned int _rtvHeapSize, unsigned int _index)
-{
-    CD3DX12_CPU_DESCRIPTOR_HANDLE rtvHandle(_rtvHeap->GetCPUDescriptorHandleForHeapStart());
-    rtvHandle.Offset(_index, _rtvHeapSize);
-
     ID3D12Resource* renderTarget = nullptr;
     if (!SUCCEEDED(_swapChain->GetBuffer(_index, IID_PPV_ARGS(&renderTarget))))
     {
         return nullptr;
     }
     
-    _device->CreateRenderTargetView(renderTarget, nullptr, rtvHandle);
+    _device->CreateRenderTargetView(renderTarget, nullptr, _rtvHandle);
 
     return renderTarget;
 }
 
-ID3D12RootSignature* CreateRootSignature(ID3D12Device* _device)
+ID3D12RootSignature* CreateRootSignature(PipelineStateCache* _cache)
 {
     CD3DX12_ROOT_SIGNATURE_DESC rootSignatureDesc;
     rootSignatureDesc.Init(0, nullptr, 0, nullptr, D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
 
-    ID3DBlob* signature;
-    ID3DBlob* error;
-    ID3D12RootSignature* rootSignature = nullptr;
-    if (!SUCCEEDED(D3D12SerializeRootSignature(&rootSignatureDesc, D3D_ROOT_SIGNATURE_VERSION_1, &signature, &error)))
+    ID3D12RootSignature* rootSignature = _cache->GetRootSignature(rootSignatureDesc);
+    if (!rootSignature)
     {
-        return nullptr;
-    }
-    if (!SUCCEEDED(_device->CreateRootSignature(0, signature->GetBufferPointer(), signature->GetBufferSize(), IID_PPV_ARGS(&rootSignature))))
-    {
-        return nullptr;
+        std::cout << "Failed to create root signature\n";
     }
 
     return rootSignature;
 }
 
-void CreateShaders(ID3DBlob** vertexShader, ID3DBlob** pixelShader)
+// Bytecode of one entry point, backed either by embedded data or by a compiled blob.
+struct ShaderBytecode
+{
+    D3D12_SHADER_BYTECODE   bytecode    = {};
+    ID3DBlob*               blob        = nullptr;
+};
+
+// DXIL needs shader model 6.0; older drivers get the source compiled to DXBC instead.
+bool SupportsEmbeddedShaders(ID3D12Device* _device)
+{
+#if HAS_EMBEDDED_SHADERS
+    D3D12_FEATURE_DATA_SHADER_MODEL shaderModel = { D3D_SHADER_MODEL_6_0 };
+    return SUCCEEDED(_device->CheckFeatureSupport(D3D12_FEATURE_SHADER_MODEL, &shaderModel, sizeof(shaderModel))) &&
+           shaderModel.HighestShaderModel >= D3D_SHADER_MODEL_6_0;
+#else
+    (void)_device;
+    return false;
+#endif
+}
+
+// Uses the bytecode embedded at build time when allowed and present. Otherwise compiles _source
+// with D3DCompile, which is only loaded on this path. Empty bytecode on failure.
+ShaderBytecode LoadShader(bool _allowEmbedded, const std::string& _source, const char* _sourceName, const char* _entryPoint, const char* _target)
 {
+    ShaderBytecode shader;
+#if HAS_EMBEDDED_SHADERS
+    const EmbeddedShader* embedded = _allowEmbedded ? FindEmbeddedShader(_sourceName, _entryPoint) : nullptr;
+    if (embedded)
+    {
+        shader.bytecode = { embedded->bytecode, embedded->size };
+        return shader;
+    }
+#else
+    (void)_allowEmbedded;
+#endif
+
     UINT compilerFlags = D3DCOMPILE_ENABLE_STRICTNESS;
     #if defined( DEBUG ) || defined( _DEBUG )
         compilerFlags |= D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION; // add more debug output
     #endif
 
     ID3DBlob* errorBlob = nullptr;
-
-    HRESULT hr = D3DCompile(shaderSource.data(), shaderSource.length(),
-        "vertex_shader", nullptr, D3D_COMPILE_STANDARD_FILE_INCLUDE,
-        "vs_main", "vs_5_1",
+    HRESULT hr = D3DCompile(_source.data(), _source.length(),
+        _sourceName, nullptr, D3D_COMPILE_STANDARD_FILE_INCLUDE,
+        _entryPoint, _target,
         compilerFlags, 0,
-        vertexShader, &errorBlob);
+        &shader.blob, &errorBlob);
     if (!SUCCEEDED(hr))
     {
         if (errorBlob)
@@ -289,40 +533,49 @@ void CreateShaders(ID3DBlob** vertexShader, ID3DBlob** pixelShader)
             OutputDebugStringA((char*)errorBlob->GetBufferPointer());
             errorBlob->Release();
         }
-        if (*vertexShader) { (*vertexShader)->Release(); }
+        if (shader.blob) { shader.blob->Release(); }
+        return ShaderBytecode();
     }
 
-    hr = D3DCompile(shaderSource.data(), shaderSource.length(),
-        "pixel_shader", nullptr, D3D_COMPILE_STANDARD_FILE_INCLUDE,
-        "ps_main", "ps_5_1",
-        compilerFlags, 0,
-        pixelShader, &errorBlob);
-    if (!SUCCEEDED(hr))
+    shader.bytecode = CD3DX12_SHADER_BYTECODE(shader.blob);
+    return shader;
+}
+
+void ReleaseShader(ShaderBytecode* _shader)
+{
+    if (_shader->blob)
     {
-        if (errorBlob)
-        {
-            OutputDebugStringA((char*)errorBlob->GetBufferPointer());
-            errorBlob->Release();
-        }
-        if (*pixelShader) { (*pixelShader)->Release(); }
+        _shader->blob->Release();
     }
+    *_shader = ShaderBytecode();
+}
+
+void CreateShaders(bool _allowEmbedded, ShaderBytecode* vertexShader, ShaderBytecode* pixelShader)
+{
+    *vertexShader = LoadShader(_allowEmbedded, shaderSource, "shaderSource", "vs_main", "vs_5_1");
+    *pixelShader  = LoadShader(_allowEmbedded, shaderSource, "shaderSource", "ps_main", "ps_5_1");
 }
 
+// Empty if the cull shader fails to compile, in which case culling stays on the CPU.
+ShaderBytecode CreateCullShader(bool _allowEmbedded)
+{
+    return LoadShader(_allowEmbedded, cullShaderSource, "cullShaderSource", "cs_main", "cs_5_1");
+}
 
-ID3D12PipelineState* CreatePipeline(ID3D12Device* _device, ID3D12RootSignature* _rootSignature, ID3DBlob* _vertexShader, ID3DBlob* _pixelShader, D3D12_INPUT_ELEMENT_DESC* _inputElementDescs)
+ID3D12PipelineState* CreatePipeline(PipelineStateCache* _cache, ID3D12RootSignature* _rootSignature, const D3D12_SHADER_BYTECODE& _vertexShader, const D3D12_SHADER_BYTECODE& _pixelShader, D3D12_INPUT_ELEMENT_DESC* _inputElementDescs)
 {
-    ID3D12PipelineState* pipelineState = nullptr; 
     D3D12_INPUT_ELEMENT_DESC inputElementDescs[] =
     {
-        { "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 }
+        { "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT,    0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA,   0 },
+        { "INSTANCE", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 0, D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 1 }
     };
 
     // Describe and create the graphics pipeline state object (PSO).
     D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDesc = {};
     psoDesc.InputLayout                     = { inputElementDescs, _countof(inputElementDescs) };
     psoDesc.pRootSignature                  = _rootSignature;
-    psoDesc.VS                              = CD3DX12_SHADER_BYTECODE(_vertexShader);
-    psoDesc.PS                              = CD3DX12_SHADER_BYTECODE(_pixelShader);
+    psoDesc.VS                              = _vertexShader;
+    psoDesc.PS                              = _pixelShader;
     psoDesc.RasterizerState                 = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
     psoDesc.BlendState                      = CD3DX12_BLEND_DESC(D3D12_DEFAULT);
     psoDesc.DepthStencilState.DepthEnable   = FALSE;
@@ -332,18 +585,61 @@ ID3D12PipelineState* CreatePipeline(ID3D12Device* _device, ID3D12RootSignature*
     psoDesc.NumRenderTargets                = 1;
     psoDesc.RTVFormats[0]                   = DXGI_FORMAT_R8G8B8A8_UNORM;
     psoDesc.SampleDesc.Count                = 1;
-    if (!SUCCEEDED(_device->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&pipelineState))))
+
+    // Compiles on the job system on a cache miss; nothing else to overlap with here, so wait.
+    return _cache->RequestGraphicsPipeline(psoDesc).get();
+}
+
+// Upload pages are buffers placed in shared UPLOAD heaps that stay mapped for their whole lifetime.
+bool CreateUploadPage(HeapManager* _heaps, uint64_t _size, UploadPage* _page)
+{
+    HeapAllocation* allocation = _heaps->CreateResource(CD3DX12_RESOURCE_DESC::Buffer(_size), D3D12_RESOURCE_STATE_GENERIC_READ);
+    if (!allocation)
     {
-        return nullptr;
+        std::cout << "Failed to create upload page\n";
+        return false;
     }
 
-    return pipelineState;
+    CD3DX12_RANGE readRange(0, 0);        // We do not intend to read from this resource on the CPU.
+    if (!SUCCEEDED(allocation->resource->Map(0, &readRange, reinterpret_cast<void**>(&_page->cpuAddress))))
+    {
+        _heaps->DestroyResource(allocation);
+        return false;
+    }
+
+    _page->resource     = allocation->resource;
+    _page->allocation   = allocation;
+    _page->gpuAddress   = allocation->resource->GetGPUVirtualAddress();
+    _page->size         = _size;
+    return true;
 }
 
-void CreateVertexBuffer(ID3D12Device* _device, ID3D12Resource** _vertexBuffer, D3D12_VERTEX_BUFFER_VIEW* _vertexBufferView)
+void DestroyUploadPage(HeapManager* _heaps, UploadPage* _page)
+{
+    HeapAllocation* allocation = static_cast<HeapAllocation*>(_page->allocation);
+    allocation->resource->Unmap(0, nullptr);
+    _heaps->DestroyResource(allocation);
+    *_page = UploadPage();
+}
+
+// Places a buffer in a DEFAULT heap and queues its upload on the copy queue. Created in COMMON so
+// the copy queue can write it and the direct queue read it without barriers.
+HeapAllocation* CreateStaticBuffer(HeapManager* _heaps, CopyQueueUploader* _uploader, const void* _data, uint64_t _size, CopyTicket* _ticket)
+{
+    HeapAllocation* allocation = _heaps->CreateResource(CD3DX12_RESOURCE_DESC::Buffer(_size), D3D12_RESOURCE_STATE_COMMON);
+    if (!allocation)
+    {
+        std::cout << "Failed to create static buffer\n";
+        return nullptr;
+    }
+    *_ticket = _uploader->UploadBuffer(allocation->resource, _data, _size);
+    return allocation;
+}
+
+HeapAllocation* CreateStaticVertexBuffer(HeapManager* _heaps, CopyQueueUploader* _uploader, D3D12_VERTEX_BUFFER_VIEW* _vertexBufferView, CopyTicket* _ticket)
 {
     // Define the geometry for a triangle.
-    float triangleVertices[] =
+    static const float triangleVertices[] =
     {
          0.0f ,  0.25f, 0.0f,
          0.25f, -0.25f, 0.0f,
@@ -351,89 +647,478 @@ void CreateVertexBuffer(ID3D12Device* _device, ID3D12Resource** _vertexBuffer, D
     };
     const UINT vertexBufferSize = sizeof(triangleVertices);
 
-    CD3DX12_HEAP_PROPERTIES heapProps   = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
-    CD3DX12_RESOURCE_DESC   resDesc     = CD3DX12_RESOURCE_DESC::Buffer(vertexBufferSize);
+    HeapAllocation* allocation = CreateStaticBuffer(_heaps, _uploader, triangleVertices, vertexBufferSize, _ticket);
+    if (!allocation)
+    {
+        return nullptr;
+    }
+
+    // Initialize the vertex buffer view.
+    (*_vertexBufferView).BufferLocation = allocation->resource->GetGPUVirtualAddress();
+    (*_vertexBufferView).StrideInBytes  = sizeof(float) * 3;
+    (*_vertexBufferView).SizeInBytes    = vertexBufferSize;
+    return allocation;
+}
 
-    if (!SUCCEEDED(_device->CreateCommittedResource(
-                            &heapProps,
-                            D3D12_HEAP_FLAG_NONE,
-                            &resDesc,
-                            D3D12_RESOURCE_STATE_GENERIC_READ,
-                            nullptr,
-                            IID_PPV_ARGS(_vertexBuffer))))
+// Lays the objects out on a grid that overhangs the screen, so the outer ones are culled. Spheres
+// bound the triangle, whose furthest vertex is 0.25 * sqrt(2) from its origin.
+void CreateSceneObjects(std::vector<CullSphere>* _spheres, std::vector<ObjectInstance>* _instances)
+{
+    uint32_t side  = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(ObjectCount))));
+    float    cell  = 3.0f / side;
+    float    scale = cell * 1.6f;
+    for (uint32_t i = 0; i < ObjectCount; i++)
     {
-        return;
+        float x = -1.5f + cell * (0.5f + i % side);
+        float y = -1.5f + cell * (0.5f + i / side);
+        _instances->push_back({ x, y, scale, 0.0f });
+        _spheres->push_back({ x, y, 0.0f, scale * 0.3536f });
     }
+}
 
-    // Copy the triangle data to the vertex buffer.
-    UINT8* pVertexDataBegin;
-    CD3DX12_RANGE readRange(0, 0);        // We do not intend to read from this resource on the CPU.
-    if (!SUCCEEDED((*_vertexBuffer)->Map(0, &readRange, reinterpret_cast<void**>(&pVertexDataBegin))))
+// Each command is a single DrawInstanced, so the signature needs no root signature.
+ID3D12CommandSignature* CreateDrawCommandSignature(ID3D12Device* _device)
+{
+    D3D12_INDIRECT_ARGUMENT_DESC argument = {};
+    argument.Type = D3D12_INDIRECT_ARGUMENT_TYPE_DRAW;
+
+    D3D12_COMMAND_SIGNATURE_DESC signatureDesc = {};
+    signatureDesc.ByteStride        = sizeof(D3D12_DRAW_ARGUMENTS);
+    signatureDesc.NumArgumentDescs  = 1;
+    signatureDesc.pArgumentDescs    = &argument;
+
+    ID3D12CommandSignature* signature = nullptr;
+    if (!SUCCEEDED(_device->CreateCommandSignature(&signatureDesc, nullptr, IID_PPV_ARGS(&signature))))
+    {
+        std::cout << "Failed to create draw command signature\n";
+        return nullptr;
+    }
+    return signature;
+}
+
+// One batch per chunk of objects, with the chunk's arguments and count at these offsets.
+std::vector<IndirectBatch> CreateIndirectBatches(uint32_t _chunkSize, UINT64 _argumentBase, UINT64 _countBase)
+{
+    std::vector<IndirectBatch> batches;
+    for (uint32_t first = 0; first < ObjectCount; first += _chunkSize)
+    {
+        UINT count = (std::min)(_chunkSize, ObjectCount - first);
+        batches.push_back({ count, _argumentBase + sizeof(D3D12_DRAW_ARGUMENTS) * first, _countBase + sizeof(uint32_t) * batches.size() });
+    }
+    return batches;
+}
+
+// CPU fallback: culls every chunk in parallel straight into upload memory, which ExecuteIndirect reads in place.
+bool WriteCpuDraws(UploadRing* _uploadRing, JobSystem* _jobSystem, const std::vector<CullSphere>& _spheres, const CullPlanes& _planes,
+                   uint32_t _chunkSize, IndirectDraws* _draws)
+{
+    uint32_t         chunkCount = (ObjectCount + _chunkSize - 1) / _chunkSize;
+    UploadAllocation arguments, counts;
+    if (!_uploadRing->Allocate(sizeof(D3D12_DRAW_ARGUMENTS) * ObjectCount, UploadAlignConstantBuffer, &arguments) ||
+        !_uploadRing->Allocate(sizeof(uint32_t) * chunkCount, UploadAlignConstantBuffer, &counts))
+    {
+        return false;
+    }
+
+    _jobSystem->ParallelFor(chunkCount, [&](uint32_t _chunk, uint32_t)
+    {
+        uint32_t first = _chunk * _chunkSize;
+        uint32_t count = (std::min)(_chunkSize, ObjectCount - first);
+        reinterpret_cast<uint32_t*>(counts.cpuAddress)[_chunk] =
+            CullSpheres(_spheres.data(), first, count, _planes, ObjectVertexCount, reinterpret_cast<IndirectDrawArguments*>(arguments.cpuAddress) + first);
+    });
+
+    _draws->arguments   = static_cast<ID3D12Resource*>(arguments.resource);
+    _draws->counts      = static_cast<ID3D12Resource*>(counts.resource);
+    _draws->batches     = CreateIndirectBatches(_chunkSize, arguments.offset, counts.offset);
+    return true;
+}
+
+// A reserved texture far larger than its tile budget, or null when the device has no tiled resources.
+// Nothing samples it yet, so it stays in COPY_DEST for the tile fills.
+ID3D12Resource* CreateVirtualTexture(ID3D12Device* _device)
+{
+    D3D12_FEATURE_DATA_D3D12_OPTIONS options = {};
+    if (!SUCCEEDED(_device->CheckFeatureSupport(D3D12_FEATURE_D3D12_OPTIONS, &options, sizeof(options))) ||
+        options.TiledResourcesTier == D3D12_TILED_RESOURCES_TIER_NOT_SUPPORTED)
+    {
+        std::cout << "Tiled resources are not supported, no virtual texture\n";
+        return nullptr;
+    }
+
+    CD3DX12_RESOURCE_DESC desc = CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_R8G8B8A8_UNORM, VirtualTextureSize, VirtualTextureSize, 1, 0, 1, 0,
+                                                              D3D12_RESOURCE_FLAG_NONE, D3D12_TEXTURE_LAYOUT_64KB_UNDEFINED_SWIZZLE);
+    ID3D12Resource* texture = nullptr;
+    if (!SUCCEEDED(_device->CreateReservedResource(&desc, D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(&texture))))
+    {
+        std::cout << "Failed to create virtual texture\n";
+        return nullptr;
+    }
+    return texture;
+}
+
+// Stands in for sampler feedback: a view panning across the texture samples a sixteenth of it at
+// mip 0, and the same region at every coarser mip for filtering and fallback.
+void RequestVirtualTextureView(TiledResidencyManager* _residency, uint64_t _frame)
+{
+    float u0 = static_cast<float>(_frame % 4096) / 4096.0f;
+    float v0 = 0.5f;
+    for (UINT mip = 0; mip < _residency->StandardMips(); mip++)
+    {
+        _residency->RequestRegion(mip, u0, v0, u0 + 0.0625f, v0 + 0.0625f);
+    }
+}
+
+// Writes each newly mapped tile from the upload ring, tinted by mip so residency shows in a capture.
+// Tiles the ring cannot stage this frame stay undefined until evicted and mapped again.
+void RecordTileFills(ID3D12GraphicsCommandList* _commandList, ID3D12Resource* _texture, UploadRing* _uploadRing,
+                     const std::vector<D3D12_TILED_RESOURCE_COORDINATE>& _tiles)
+{
+    CD3DX12_TILE_REGION_SIZE oneTile(1, FALSE, 0, 0, 0);
+    for (const D3D12_TILED_RESOURCE_COORDINATE& tile : _tiles)
+    {
+        UploadAllocation staging;
+        if (!_uploadRing->Allocate(D3D12_TILED_RESOURCE_TILE_SIZE_IN_BYTES, UploadAlignTexture, &staging))
+        {
+            continue;
+        }
+
+        uint32_t  color  = 0xFF000000 | (0x20 * (tile.Subresource % 8)) << 16 | (tile.X * 37 % 256) << 8 | (tile.Y * 59 % 256);
+        uint32_t* texels = reinterpret_cast<uint32_t*>(staging.cpuAddress);
+        std::fill(texels, texels + D3D12_TILED_RESOURCE_TILE_SIZE_IN_BYTES / sizeof(uint32_t), color);
+        _commandList->CopyTiles(_texture, &tile, &oneTile, static_cast<ID3D12Resource*>(staging.resource), staging.offset,
+                                D3D12_TILE_COPY_FLAG_LINEAR_BUFFER_TO_SWIZZLED_TILED_RESOURCE);
+    }
+    _commandList->Close();
+}
+
+D3D12_RESOURCE_STATES ToD3D12State(uint32_t _state)
+{
+    D3D12_RESOURCE_STATES state = D3D12_RESOURCE_STATE_COMMON;
+    if (_state & GraphStatePresent)             { state |= D3D12_RESOURCE_STATE_PRESENT; }
+    if (_state & GraphStateVertexBuffer)        { state |= D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER; }
+    if (_state & GraphStateIndexBuffer)         { state |= D3D12_RESOURCE_STATE_INDEX_BUFFER; }
+    if (_state & GraphStateConstantBuffer)      { state |= D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER; }
+    if (_state & GraphStateShaderResource)      { state |= D3D12_RESOURCE_STATE_ALL_SHADER_RESOURCE; }
+    if (_state & GraphStateIndirectArgument)    { state |= D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT; }
+    if (_state & GraphStateCopySource)          { state |= D3D12_RESOURCE_STATE_COPY_SOURCE; }
+    if (_state & GraphStateDepthRead)           { state |= D3D12_RESOURCE_STATE_DEPTH_READ; }
+    if (_state & GraphStateRenderTarget)        { state |= D3D12_RESOURCE_STATE_RENDER_TARGET; }
+    if (_state & GraphStateUnorderedAccess)     { state |= D3D12_RESOURCE_STATE_UNORDERED_ACCESS; }
+    if (_state & GraphStateDepthWrite)          { state |= D3D12_RESOURCE_STATE_DEPTH_WRITE; }
+    if (_state & GraphStateCopyDest)            { state |= D3D12_RESOURCE_STATE_COPY_DEST; }
+    return state;
+}
+
+UINT SubresourceCount(ID3D12Device* _device, ID3D12Resource* _resource)
+{
+    return CD3DX12_RESOURCE_DESC(_resource->GetDesc()).Subresources(_device);
+}
+
+// Requests a state for one subresource, see D3D12CalcSubresource, or the whole resource.
+void TrackTransition(ID3D12Device* _device, CommandStateTracker* _tracker, ID3D12Resource* _resource, D3D12_RESOURCE_STATES _state,
+                     UINT _subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES)
+{
+    _tracker->Transition(_resource, SubresourceCount(_device, _resource), _subresource, _state);
+}
+
+void AppendTransitions(const std::vector<StateTransition>& _transitions, std::vector<D3D12_RESOURCE_BARRIER>* _barriers)
+{
+    for (const StateTransition& transition : _transitions)
+    {
+        _barriers->push_back(CD3DX12_RESOURCE_BARRIER::Transition(static_cast<ID3D12Resource*>(transition.resource),
+                                                                  static_cast<D3D12_RESOURCE_STATES>(transition.before),
+                                                                  static_cast<D3D12_RESOURCE_STATES>(transition.after),
+                                                                  transition.subresource,
+                                                                  static_cast<D3D12_RESOURCE_BARRIER_FLAGS>(transition.split)));
+    }
+}
+
+// Records the transitions a submitted list needs ahead of it into a list of their own.
+void RecordFixupList(ID3D12GraphicsCommandList* _commandList, const std::vector<StateTransition>& _fixups)
+{
+    std::vector<D3D12_RESOURCE_BARRIER> barriers;
+    AppendTransitions(_fixups, &barriers);
+
+    _commandList->ResourceBarrier(static_cast<UINT>(barriers.size()), barriers.data());
+    _commandList->Close();
+}
+
+// Records a compiled graph barrier batch as one ResourceBarrier call. Transitions go through the
+// list's state tracker, which supplies the real before state and drops ones already satisfied.
+// A split begins in the list that finishes with the resource; the tracker ends it at the next
+// request in the same list, or in EndGraphSplits when the list closes first, in which case the
+// graph's end half finds the resource already there.
+void RecordGraphBarriers(ID3D12Device*                      _device,
+                         ID3D12GraphicsCommandList*         _commandList,
+                         CommandStateTracker*               _tracker,
+                         const RenderGraph&                 _graph,
+                         const std::vector<GraphBarrier>*   _barriers)
+{
+    if (!_barriers)
     {
         return;
     }
-    memcpy(pVertexDataBegin, triangleVertices, sizeof(triangleVertices));
-    (*_vertexBuffer)->Unmap(0, nullptr);
 
-    // Initialize the vertex buffer view.
-    (*_vertexBufferView).BufferLocation = (*_vertexBuffer)->GetGPUVirtualAddress();
-    (*_vertexBufferView).StrideInBytes = sizeof(float) * 3;
-    (*_vertexBufferView).SizeInBytes   = vertexBufferSize;
+    std::vector<D3D12_RESOURCE_BARRIER> barriers;
+    for (const GraphBarrier& barrier : *_barriers)
+    {
+        ID3D12Resource* resource = static_cast<ID3D12Resource*>(_graph.Native(barrier.resource));
+        if (barrier.type == GraphBarrierType::Aliasing)
+        {
+            barriers.push_back(CD3DX12_RESOURCE_BARRIER::Aliasing(static_cast<ID3D12Resource*>(_graph.Native(barrier.resourceBefore)), resource));
+        }
+        else if (barrier.type == GraphBarrierType::Transition && barrier.split == GraphSplit::Begin)
+        {
+            _tracker->BeginTransition(resource, ToD3D12State(barrier.after));
+        }
+        else if (barrier.type == GraphBarrierType::Transition)
+        {
+            TrackTransition(_device, _tracker, resource, ToD3D12State(barrier.after));
+        }
+    }
+
+    AppendTransitions(_tracker->Barriers(), &barriers);
+    _tracker->ClearBarriers();
+
+    for (const GraphBarrier& barrier : *_barriers)
+    {
+        if (barrier.type == GraphBarrierType::Uav)
+        {
+            barriers.push_back(CD3DX12_RESOURCE_BARRIER::UAV(static_cast<ID3D12Resource*>(_graph.Native(barrier.resource))));
+        }
+    }
+
+    if (!barriers.empty())
+    {
+        _commandList->ResourceBarrier(static_cast<UINT>(barriers.size()), barriers.data());
+    }
 }
 
-void PopulateCommandList(ID3D12Device*                  _device,
-                         IDXGISwapChain3*               _swapChain,
-                         ID3D12CommandAllocator*        _commandAllocator,  ID3D12GraphicsCommandList* _commandList, 
-                         ID3D12PipelineState*           _pipelineState, 
-                         ID3D12RootSignature*           _rootSignature, 
-                         std::vector<ID3D12Resource*>   _renderTargets,
-                         D3D12_VERTEX_BUFFER_VIEW       _vertexBufferView,
-                         ID3D12DescriptorHeap*          _rtvHeap,           unsigned int _rtvHeapSize,
-                         CD3DX12_VIEWPORT               _viewport,          CD3DX12_RECT _scissorRect)
+// Ends the splits still open in a list about to close, which must not leave a resource mid-transition.
+void EndGraphSplits(ID3D12GraphicsCommandList* _commandList, CommandStateTracker* _tracker)
 {
-    
-   //static unsigned int frameIndex = 0;
-   //frameIndex = (frameIndex + 1) % 2;
+    _tracker->EndSplits();
+
+    std::vector<D3D12_RESOURCE_BARRIER> barriers;
+    AppendTransitions(_tracker->Barriers(), &barriers);
+    _tracker->ClearBarriers();
+    if (!barriers.empty())
+    {
+        _commandList->ResourceBarrier(static_cast<UINT>(barriers.size()), barriers.data());
+    }
+}
 
-    unsigned int frameIndex = _swapChain->GetCurrentBackBufferIndex();
+// Records indirect batches [_first, _end) into their own list. Every list sets up its own state, as nothing is
+// inherited between command lists. The first range records the pass's leading barriers, the last its trailing ones.
+// The range is timed in _rangeScope; _openScope and _closeScope, if valid, are begun first and ended last.
+void RecordDrawRange(ID3D12Device*                  _device,
+                     ID3D12GraphicsCommandList*     _commandList,
+                     ID3D12RootSignature*           _rootSignature,
+                     D3D12_CPU_DESCRIPTOR_HANDLE    _rtvHandle,
+                     const std::vector<D3D12_VERTEX_BUFFER_VIEW>& _vertexBufferViews,
+                     CD3DX12_VIEWPORT               _viewport,          CD3DX12_RECT _scissorRect,
+                     const IndirectDraws&           _draws,             size_t _first, size_t _end,
+                     const RenderGraph&             _graph,             CommandStateTracker* _tracker,
+                     const std::vector<GraphBarrier>* _beginBarriers,
+                     const std::vector<GraphBarrier>* _endBarriers,
+                     GpuTimestampProfiler*          _profiler,
+                     uint32_t                       _rangeScope,        uint32_t _openScope, uint32_t _closeScope)
+{
+    _tracker->Reset();
+    _profiler->Begin(_commandList, _openScope);
+    _profiler->Begin(_commandList, _rangeScope);
+    RecordGraphBarriers(_device, _commandList, _tracker, _graph, _beginBarriers);
 
-    // Command list allocators can only be reset when the associated 
-    // command lists have finished execution on the GPU; apps should use 
-    // fences to determine GPU execution progress.
-    HRESULT hr = _commandAllocator->Reset();
+    _commandList->SetGraphicsRootSignature(_rootSignature);
+    _commandList->RSSetViewports(1, &_viewport);
+    _commandList->RSSetScissorRects(1, &_scissorRect);
+    _commandList->OMSetRenderTargets(1, &_rtvHandle, FALSE, nullptr);
+    _commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+    _commandList->IASetVertexBuffers(0, static_cast<UINT>(_vertexBufferViews.size()), _vertexBufferViews.data());
+
+    for (size_t i = _first; i < _end; i++)
+    {
+        const IndirectBatch& batch = _draws.batches[i];
+        _commandList->ExecuteIndirect(_draws.signature, batch.maxCount, _draws.arguments, batch.argumentOffset, _draws.counts, batch.countOffset);
+    }
+
+    RecordGraphBarriers(_device, _commandList, _tracker, _graph, _endBarriers);
+    EndGraphSplits(_commandList, _tracker);
+    _profiler->End(_commandList, _rangeScope);
+    _profiler->End(_commandList, _closeScope);
+    _commandList->Close();
+}
 
-    // However, when ExecuteCommandList() is called on a particular command 
-    // list, that command list can then be reset at any time and must be before 
-    // re-recording.
-    hr = _commandList->Reset(_commandAllocator, _pipelineState);
+// Records the clear pass at the start of the frame, wrapped in the barriers the frame graph compiled
+// for it, and opens the frame's timing scope. Draws follow in the parallel lists.
+void PopulateCommandList(ID3D12Device*                  _device,
+                         ID3D12GraphicsCommandList*     _commandList,
+                         ID3D12RootSignature*           _rootSignature, 
+                         const RenderGraph&             _graph,             const CompiledPass& _pass,
+                         CommandStateTracker*           _tracker,
+                         D3D12_CPU_DESCRIPTOR_HANDLE    _rtvHandle,
+                         CD3DX12_VIEWPORT               _viewport,          CD3DX12_RECT _scissorRect,
+                         GpuTimestampProfiler*          _profiler,          uint32_t _frameScope, uint32_t _clearScope)
+{
+    // The list comes from the command list pool already reset, its allocator recycled once the GPU
+    // had finished with it, and open with the scene pipeline set.
+    _tracker->Reset();
+    _profiler->Begin(_commandList, _frameScope);
+    _profiler->Begin(_commandList, _clearScope);
 
     // Set necessary state.
     _commandList->SetGraphicsRootSignature(_rootSignature);
     _commandList->RSSetViewports(1, &_viewport);
     _commandList->RSSetScissorRects(1, &_scissorRect);
 
-    CD3DX12_RESOURCE_BARRIER transitionTo = CD3DX12_RESOURCE_BARRIER::Transition(_renderTargets[frameIndex], D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET);
-    // Indicate that the back buffer will be used as a render target.
-    _commandList->ResourceBarrier(1, &transitionTo);
+    // The back buffer's first transition in this list is only settled at submit, in a fixup list.
+    RecordGraphBarriers(_device, _commandList, _tracker, _graph, &_pass.before);
 
-    auto pp = _rtvHeap->GetCPUDescriptorHandleForHeapStart();
-    CD3DX12_CPU_DESCRIPTOR_HANDLE rtvHandle(_rtvHeap->GetCPUDescriptorHandleForHeapStart(), frameIndex, _rtvHeapSize);
-
-    _commandList->OMSetRenderTargets(1, &rtvHandle, FALSE, nullptr);
+    _commandList->OMSetRenderTargets(1, &_rtvHandle, FALSE, nullptr);
 
     // Record commands.
     const float clearColor[] = { 0.0f, 0.2f, 0.4f, 1.0f };
-    _commandList->ClearRenderTargetView(rtvHandle, clearColor, 0, nullptr);
-    _commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-    _commandList->IASetVertexBuffers(0, 1, &_vertexBufferView);
-    _commandList->DrawInstanced(3, 1, 0, 0);
+    _commandList->ClearRenderTargetView(_rtvHandle, clearColor, 0, nullptr);
+
+    RecordGraphBarriers(_device, _commandList, _tracker, _graph, &_pass.after);
+    EndGraphSplits(_commandList, _tracker);
+    _profiler->End(_commandList, _clearScope);
+    _commandList->Close();
 
-    // Indicate that the back buffer will now be used to present.
-    CD3DX12_RESOURCE_BARRIER transitionFrom = CD3DX12_RESOURCE_BARRIER::Transition(_renderTargets[frameIndex], D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT);
-    _commandList->ResourceBarrier(1, &transitionFrom);
+}
 
-    hr = _commandList->Close();
+// Runs the cull shader once and checks it against the CPU reference; GPU culling is only used if
+// they agree. Leaves the argument and count buffers in INDIRECT_ARGUMENT.
+bool ValidateGpuCulling(ID3D12Device* _device, ID3D12CommandQueue* _queue, IGpuFence* _fence, CommandListPool* _commandLists, UploadRing* _uploadRing,
+                        DeferredReleaseQueue<IUnknown>* _releaseQueue, GpuCullingPass* _culling, D3D12_GPU_VIRTUAL_ADDRESS _spheresAddress, const std::vector<CullSphere>& _spheres, const CullPlanes& _planes)
+{
+    UINT64 argumentBytes = sizeof(D3D12_DRAW_ARGUMENTS) * ObjectCount;
+    UINT64 countBytes    = sizeof(uint32_t) * _culling->ChunkCount();
+
+    CommandListPair            pair;
+    ID3D12Resource*            readback     = nullptr;
+    CD3DX12_HEAP_PROPERTIES    readbackHeap(D3D12_HEAP_TYPE_READBACK);
+    CD3DX12_RESOURCE_DESC      readbackDesc = CD3DX12_RESOURCE_DESC::Buffer(argumentBytes + countBytes);
+    UploadAllocation           zeros;
+    if (!_commandLists->Acquire(D3D12_COMMAND_LIST_TYPE_DIRECT, nullptr, &pair) ||
+        !SUCCEEDED(_device->CreateCommittedResource(&readbackHeap, D3D12_HEAP_FLAG_NONE, &readbackDesc, D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(&readback))) ||
+        !_uploadRing->Allocate(countBytes, UploadAlignConstantBuffer, &zeros))
+    {
+        std::cout << "Failed to set up cull validation\n";
+        if (readback)   { readback->Release(); }
+        if (pair.list)
+        {
+            pair.list->Close();
+            _commandLists->Retire(pair, 0);
+        }
+        return false;
+    }
+    ID3D12GraphicsCommandList* commandList = pair.list;
+    memset(zeros.cpuAddress, 0, static_cast<size_t>(countBytes));
 
+    ID3D12Resource* arguments = _culling->Arguments();
+    ID3D12Resource* counts    = _culling->Counts();
+
+    D3D12_RESOURCE_BARRIER toCopyDest = CD3DX12_RESOURCE_BARRIER::Transition(counts, D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_COPY_DEST);
+    commandList->ResourceBarrier(1, &toCopyDest);
+    _culling->RecordReset(commandList, static_cast<ID3D12Resource*>(zeros.resource), zeros.offset);
+
+    D3D12_RESOURCE_BARRIER toUav[] =
+    {
+        CD3DX12_RESOURCE_BARRIER::Transition(arguments, D3D12_RESOURCE_STATE_COMMON,    D3D12_RESOURCE_STATE_UNORDERED_ACCESS),
+        CD3DX12_RESOURCE_BARRIER::Transition(counts,    D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_UNORDERED_ACCESS),
+    };
+    commandList->ResourceBarrier(_countof(toUav), toUav);
+    _culling->RecordCull(commandList, _spheresAddress, _planes, ObjectVertexCount);
+
+    D3D12_RESOURCE_BARRIER toCopySource[] =
+    {
+        CD3DX12_RESOURCE_BARRIER::Transition(arguments, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COPY_SOURCE),
+        CD3DX12_RESOURCE_BARRIER::Transition(counts,    D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COPY_SOURCE),
+    };
+    commandList->ResourceBarrier(_countof(toCopySource), toCopySource);
+    commandList->CopyBufferRegion(readback, 0, arguments, 0, argumentBytes);
+    commandList->CopyBufferRegion(readback, argumentBytes, counts, 0, countBytes);
+
+    D3D12_RESOURCE_BARRIER toIndirect[] =
+    {
+        CD3DX12_RESOURCE_BARRIER::Transition(arguments, D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT),
+        CD3DX12_RESOURCE_BARRIER::Transition(counts,    D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT),
+    };
+    commandList->ResourceBarrier(_countof(toIndirect), toIndirect);
+    commandList->Close();
+
+    ID3D12CommandList* lists[] = { commandList };
+    _queue->ExecuteCommandLists(1, lists);
+    uint64_t fenceValue = _fence->Signal();
+    _uploadRing->EndFrame(fenceValue);
+    _commandLists->Retire(pair, fenceValue);
+    _releaseQueue->Defer(readback, fenceValue);
+    _fence->WaitForValue(fenceValue);
+
+    // Compare chunk by chunk; within a chunk the GPU appends in no particular order.
+    uint32_t        mismatches  = 0;
+    uint32_t        visible     = 0;
+    uint8_t*        mapped      = nullptr;
+    CD3DX12_RANGE   readRange(0, static_cast<SIZE_T>(argumentBytes + countBytes));
+    CD3DX12_RANGE   writeRange(0, 0);
+    if (SUCCEEDED(readback->Map(0, &readRange, reinterpret_cast<void**>(&mapped))))
+    {
+        const IndirectDrawArguments* gpuArguments   = reinterpret_cast<const IndirectDrawArguments*>(mapped);
+        const uint32_t*              gpuCounts      = reinterpret_cast<const uint32_t*>(mapped + argumentBytes);
+        std::vector<IndirectDrawArguments> cpuArguments(_culling->ChunkSize());
+        for (uint32_t chunk = 0; chunk < _culling->ChunkCount(); chunk++)
+        {
+            uint32_t first      = chunk * _culling->ChunkSize();
+            uint32_t count      = (std::min)(_culling->ChunkSize(), ObjectCount - first);
+            uint32_t cpuVisible = CullSpheres(_spheres.data(), first, count, _planes, ObjectVertexCount, cpuArguments.data());
+            uint32_t gpuVisible = (std::min)(gpuCounts[chunk], count);
+            mismatches += CountCullMismatches(_spheres.data(), _planes, cpuArguments.data(), cpuVisible, gpuArguments + first, gpuVisible, 1e-5f);
+            visible    += gpuVisible;
+        }
+        readback->Unmap(0, &writeRange);
+    }
+    else
+    {
+        mismatches = ObjectCount;
+    }
+
+    std::cout << "GPU culling kept " << visible << " of " << ObjectCount << " objects, " << mismatches << " mismatches against the CPU reference\n";
+    return mismatches == 0;
+}
+
+// Zeroes the chunk counts and runs the cull shader, each pass wrapped in the barriers the frame graph compiled for it.
+void RecordCullList(ID3D12Device*               _device,
+                    ID3D12GraphicsCommandList*  _commandList,
+                    const RenderGraph&          _graph,             CommandStateTracker* _tracker,
+                    const CompiledPass&         _resetPass,         const CompiledPass& _cullPass,
+                    GpuCullingPass*             _culling,           const UploadAllocation& _zeros,
+                    D3D12_GPU_VIRTUAL_ADDRESS   _spheresAddress,    const CullPlanes& _planes,
+                    GpuTimestampProfiler*       _profiler,          uint32_t _cullScope)
+{
+    _tracker->Reset();
+    _profiler->Begin(_commandList, _cullScope);
+
+    RecordGraphBarriers(_device, _commandList, _tracker, _graph, &_resetPass.before);
+    _culling->RecordReset(_commandList, static_cast<ID3D12Resource*>(_zeros.resource), _zeros.offset);
+    RecordGraphBarriers(_device, _commandList, _tracker, _graph, &_resetPass.after);
+
+    RecordGraphBarriers(_device, _commandList, _tracker, _graph, &_cullPass.before);
+    _culling->RecordCull(_commandList, _spheresAddress, _planes, ObjectVertexCount);
+    RecordGraphBarriers(_device, _commandList, _tracker, _graph, &_cullPass.after);
+    EndGraphSplits(_commandList, _tracker);
+
+    _profiler->End(_commandList, _cullScope);
+    _commandList->Close();
+}
+
+// Closes the frame's timing scope and resolves its timestamps, after every other list of the frame.
+void RecordProfilerList(ID3D12GraphicsCommandList* _commandList, GpuTimestampProfiler* _profiler, uint32_t _frameScope)
+{
+    _profiler->End(_commandList, _frameScope);
+    _profiler->Resolve(_commandList);
+    _commandList->Close();
 }
 
 int main()
@@ -465,26 +1150,33 @@ int main()
     IDXGISwapChain3* swapChain = (IDXGISwapChain3*)CreateSwapChain(device, commandQueue, factory, window, 1024, 1024);
     
     // Create Descriptor Heaps
-    unsigned int rtvHeapSize = 0;
-    ID3D12DescriptorHeap* rtvHeap = CreateRTVDescriptorHeap(device, &rtvHeapSize);
+    CpuDescriptorHeap* rtvDescriptors = new CpuDescriptorHeap(device, D3D12_DESCRIPTOR_HEAP_TYPE_RTV, RtvDescriptorCapacity);
+    uint32_t rtvIndices[2] = { rtvDescriptors->Allocate(), rtvDescriptors->Allocate() };
+    std::vector<D3D12_CPU_DESCRIPTOR_HANDLE> rtvHandles = { rtvDescriptors->Handle(rtvIndices[0]), rtvDescriptors->Handle(rtvIndices[1]) };
 
     // Create Render Target
-    ID3D12Resource* renderTarget0 = CreateRenderTarget(device, swapChain, rtvHeap, rtvHeapSize, 0);
-    ID3D12Resource* renderTarget1 = CreateRenderTarget(device, swapChain, rtvHeap, rtvHeapSize, 1);
+    ID3D12Resource* renderTarget0 = CreateRenderTarget(device, swapChain, rtvHandles[0], 0);
+    ID3D12Resource* renderTarget1 = CreateRenderTarget(device, swapChain, rtvHandles[1], 1);
     std::vector<ID3D12Resource*> renderTargetsVec = { renderTarget0, renderTarget1 };
 
-    // Create Command Allocator
-    ID3D12CommandAllocator* commandAllocator;
-    device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&commandAllocator));
+    // Job system for pipeline compilation and parallel draw recording
+    JobSystem jobSystem;
 
+    // Root signatures and pipelines come from the on-disk cache when a previous run stored them
+    PipelineStateCache* pipelineCache = new PipelineStateCache(device, std::filesystem::temp_directory_path() / "base_dx12_pipelines.bin", &jobSystem);
+    auto pipelineStart = std::chrono::steady_clock::now();
 
     // Create Empty Root Signatures
-    ID3D12RootSignature* rootSignature = CreateRootSignature(device);
+    ID3D12RootSignature* rootSignature = CreateRootSignature(pipelineCache);
 
     // Setup Shaders and Pipeline
-    ID3DBlob* vertexShader = nullptr;
-    ID3DBlob* pixelShader  = nullptr;
-    CreateShaders(&vertexShader,  &pixelShader);
+    auto           shaderStart    = std::chrono::steady_clock::now();
+    bool           embedShaders   = SupportsEmbeddedShaders(device);
+    ShaderBytecode vertexShader;
+    ShaderBytecode pixelShader;
+    CreateShaders(embedShaders, &vertexShader, &pixelShader);
+    auto shaderTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - shaderStart).count();
+    std::cout << "Shaders " << (vertexShader.blob ? "compiled from source" : "loaded from embedded DXIL") << " in " << shaderTime << " ms\n";
 
     // Define the vertex input layout.
     D3D12_INPUT_ELEMENT_DESC inputElementDescs = { 0 };
@@ -497,47 +1189,208 @@ int main()
     inputElementDescs.InstanceDataStepRate = 0;
 
     // Setup Pipeline
-    ID3D12PipelineState* pipelineState = CreatePipeline(device, rootSignature, vertexShader, pixelShader, &inputElementDescs);
-
-    // Build Command Lists
-    ID3D12GraphicsCommandList* commandList;
-    if (!SUCCEEDED(device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, commandAllocator, pipelineState, IID_PPV_ARGS(&commandList))))
+    ID3D12PipelineState* pipelineState = CreatePipeline(pipelineCache, rootSignature, vertexShader.bytecode, pixelShader.bytecode, &inputElementDescs);
+
+    // Cold runs compile every pipeline; warm runs should only see hits
+    auto pipelineTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - pipelineStart).count();
+    std::cout << "Pipelines ready in " << pipelineTime << " ms (" << pipelineCache->Hits() << " cached, " << pipelineCache->Misses() << " compiled)\n";
+
+    // Resource states are tracked per command list and resolved against the global table at submit.
+    // Transitions a list cannot know about are recorded into a fixup list ahead of it.
+    ResourceStateTable               stateTable;
+    // Tracker 0 is the frame start list, 1 the cull list and the rest the parallel draw lists.
+    std::vector<CommandStateTracker> listTrackers(ParallelRecordLists + 2, CommandStateTracker(D3D12ReadStates));
+    for (ID3D12Resource* renderTarget : renderTargetsVec)
     {
-        std::cout << "Failed to initialise commandlist\n";
+        stateTable.Register(renderTarget, SubresourceCount(device, renderTarget), D3D12_RESOURCE_STATE_PRESENT);
     }
-    commandList->Close();
 
     // Setup Geometry
-    ID3D12Resource*          vertexBuffer;
-    D3D12_VERTEX_BUFFER_VIEW vertexBufferView;
-    CreateVertexBuffer(device, &vertexBuffer, &vertexBufferView);
+    D3D12_VERTEX_BUFFER_VIEW vertexBufferView = {};
 
     // Create Viewport and ScissorRect
     CD3DX12_VIEWPORT  viewport(0.0f, 0.0f, static_cast<float>(1024), static_cast<float>(1024));
     CD3DX12_RECT scissorRect(0, 0, static_cast<LONG>(1024), static_cast<LONG>(1024));
 
-    //Create Fence
-    ID3D12Fence* dxfence = nullptr;
-    device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&dxfence));
-    unsigned long fenceValue = 123;
+    //Create Fence and Frame Ring
+    D3D12QueueFence* gpuFence = new D3D12QueueFence(device, commandQueue);
+    FrameRing        frameRing(gpuFence, FramesInFlight);
+
+    // Objects the GPU may still be using are handed here with the fence value of their last use.
+    DeferredReleaseQueue<IUnknown>* releaseQueue = new DeferredReleaseQueue<IUnknown>(gpuFence);
+
+    // Per-frame dynamic data is suballocated from the upload ring and retired by fence value.
+    // Its pages are placed resources in a few large upload heaps.
+    HeapManager* uploadHeaps = new HeapManager(device, D3D12_HEAP_TYPE_UPLOAD, D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS, UploadHeapSize);
+    UploadRing*  uploadRing  = new UploadRing(gpuFence, UploadPageSize,
+                                              [uploadHeaps](uint64_t _size, UploadPage* _page) { return CreateUploadPage(uploadHeaps, _size, _page); },
+                                              [uploadHeaps](UploadPage* _page) { DestroyUploadPage(uploadHeaps, _page); });
+
+    // Static data is copied into DEFAULT heaps on a dedicated copy queue, staged through its own upload pages.
+    ID3D12CommandQueue* copyQueue    = CreateCommandQueue(device, D3D12_COMMAND_LIST_TYPE_COPY);
+    D3D12QueueFence*    copyFence    = new D3D12QueueFence(device, copyQueue);
+
+    // Every command list comes from the pool and goes back with the fence value of the submission
+    // that executed it, on its own queue's timeline.
+    CommandListPool* commandLists = new CommandListPool(device, MaxCommandListsPerQueue, CommandListHighWaterFrames);
+    commandLists->AddQueue(D3D12_COMMAND_LIST_TYPE_DIRECT, gpuFence);
+    commandLists->AddQueue(D3D12_COMMAND_LIST_TYPE_COPY, copyFence);
+
+    HeapManager*        staticHeaps  = new HeapManager(device, D3D12_HEAP_TYPE_DEFAULT, D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS, StaticHeapSize);
+    CopyQueueUploader*  copyUploader = new CopyQueueUploader(copyQueue, copyFence, copyFence->GetFence(), commandLists, CopyBatchBytes, CopyBatchUploads,
+                                                             [uploadHeaps](uint64_t _size, UploadPage* _page) { return CreateUploadPage(uploadHeaps, _size, _page); },
+                                                             [uploadHeaps](UploadPage* _page) { DestroyUploadPage(uploadHeaps, _page); },
+                                                             &jobSystem);
+
+    // Scene objects: per-instance offsets for drawing, bounding spheres for culling.
+    std::vector<CullSphere>     objectSpheres;
+    std::vector<ObjectInstance> objectInstances;
+    CreateSceneObjects(&objectSpheres, &objectInstances);
+
+    // Tickets complete in order, so waiting for the last static upload covers them all.
+    CopyTicket      staticTicket       = CopyTicketInvalid;
+    HeapAllocation* vertexAllocation   = CreateStaticVertexBuffer(staticHeaps, copyUploader, &vertexBufferView, &staticTicket);
+    HeapAllocation* instanceAllocation = staticHeaps->CreateResource(CD3DX12_RESOURCE_DESC::Buffer(sizeof(ObjectInstance) * ObjectCount), D3D12_RESOURCE_STATE_COMMON);
+    if (!instanceAllocation)
+    {
+        std::cout << "Failed to create instance buffer\n";
+    }
+    HeapAllocation* sphereAllocation   = CreateStaticBuffer(staticHeaps, copyUploader, objectSpheres.data(), sizeof(CullSphere) * ObjectCount, &staticTicket);
+    if (!copyUploader->Flush())
+    {
+        std::cout << "Failed to submit static uploads\n";
+    }
+
+    // Instance data streams in from an asset file, written from the generated objects on first run,
+    // while the rest of setup goes on. The callback runs from Update and queues the upload.
+    AssetStreamer*        assetStreamer = new AssetStreamer(&jobSystem, AssetQueueDepth, AssetInFlightBytes);
+    std::filesystem::path instancePath  = std::filesystem::temp_directory_path() / "base_dx12_instances.asset";
+    uint64_t              instanceBytes = sizeof(ObjectInstance) * ObjectCount;
+    if (!std::filesystem::exists(instancePath) && !WriteAssetFile(instancePath, objectInstances.data(), instanceBytes, AssetBlockSize))
+    {
+        std::cout << "Failed to write instance asset\n";
+    }
+    assetStreamer->Load(instancePath, [&](bool _ok, std::vector<uint8_t>&& _data)
+    {
+        // A damaged or stale file, e.g. from a different object count, is replaced for the next run.
+        const void* instances = _data.data();
+        if (!_ok || _data.size() != instanceBytes)
+        {
+            std::cout << "Instance asset unusable, uploading generated instances\n";
+            instances = objectInstances.data();
+            if (!WriteAssetFile(instancePath, objectInstances.data(), instanceBytes, AssetBlockSize))
+            {
+                std::cout << "Failed to write instance asset\n";
+            }
+        }
+        if (instanceAllocation)
+        {
+            staticTicket = copyUploader->UploadBuffer(instanceAllocation->resource, instances, instanceBytes);
+        }
+    });
 
-    HANDLE fenceEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
-    if (fenceEvent == nullptr)
+    std::vector<D3D12_VERTEX_BUFFER_VIEW> vertexBufferViews = { vertexBufferView };
+    if (instanceAllocation)
     {
-        std::cout << "Unable to create event handle\n";
+        vertexBufferViews.push_back({ instanceAllocation->resource->GetGPUVirtualAddress(), static_cast<UINT>(sizeof(ObjectInstance) * ObjectCount), sizeof(ObjectInstance) });
     }
 
-    // Wait for GPU to finish any remaining work...
-    UINT64 fence = fenceValue;
-    (commandQueue->Signal(dxfence, fence));
-    fenceValue++;
+    // Objects are placed directly in clip space, so the view-projection is the identity.
+    const float viewProjection[16] = { 1.0f, 0.0f, 0.0f, 0.0f,  0.0f, 1.0f, 0.0f, 0.0f,  0.0f, 0.0f, 1.0f, 0.0f,  0.0f, 0.0f, 0.0f, 1.0f };
+    CullPlanes  cullPlanes;
+    CullPlanesFromMatrix(viewProjection, &cullPlanes);
+
+    // One chunk of objects per parallel draw list. Culling runs on the GPU when the cull shader agrees
+    // with the CPU reference, otherwise on the CPU straight into upload memory.
+    uint32_t                  chunkSize     = (ObjectCount + ParallelRecordLists - 1) / ParallelRecordLists;
+    ShaderBytecode            cullShader    = CreateCullShader(embedShaders);
+    GpuCullingPass*           gpuCulling    = new GpuCullingPass(device, pipelineCache, staticHeaps, cullShader.bytecode, ObjectCount, chunkSize);
+    D3D12_GPU_VIRTUAL_ADDRESS sphereAddress = sphereAllocation ? sphereAllocation->resource->GetGPUVirtualAddress() : 0;
+    copyFence->WaitForValue(copyFence->GetLastSignaledValue());
+    bool useGpuCulling = gpuCulling->IsValid() && sphereAllocation &&
+                         ValidateGpuCulling(device, commandQueue, gpuFence, commandLists, uploadRing, releaseQueue, gpuCulling, sphereAddress, objectSpheres, cullPlanes);
+    if (!useGpuCulling)
+    {
+        std::cout << "Culling on the CPU\n";
+    }
+
+    // Saved once every root signature is in, the cull shader's included.
+    if (!pipelineCache->Save())
+    {
+        std::cout << "Failed to save pipeline cache\n";
+    }
 
-    if (dxfence->GetCompletedValue() < fence)
+    IndirectDraws sceneDraws;
+    sceneDraws.signature = CreateDrawCommandSignature(device);
+    if (useGpuCulling)
     {
-        dxfence->SetEventOnCompletion(fence, fenceEvent);
-        WaitForSingleObject(fenceEvent, INFINITE);
+        sceneDraws.arguments    = gpuCulling->Arguments();
+        sceneDraws.counts       = gpuCulling->Counts();
+        sceneDraws.batches      = CreateIndirectBatches(chunkSize, 0, 0);
+        stateTable.Register(sceneDraws.arguments, 1, D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT);
+        stateTable.Register(sceneDraws.counts,    1, D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT);
     }
 
+    // Frame graph: passes declare what they touch and the barriers between them are compiled once.
+    // Without GPU culling the reset and cull passes touch nothing and are culled.
+    RenderGraph frameGraph;
+    uint32_t backBufferResource = frameGraph.Import("BackBuffer", GraphStatePresent, GraphStatePresent);
+    uint32_t argumentsResource  = frameGraph.Import("DrawArguments", GraphStateIndirectArgument, GraphStateIndirectArgument);
+    uint32_t countsResource     = frameGraph.Import("DrawCounts", GraphStateIndirectArgument, GraphStateIndirectArgument);
+    uint32_t clearPass          = frameGraph.AddPass("Clear");
+    uint32_t resetPass          = frameGraph.AddPass("ResetCounts");
+    uint32_t cullPass           = frameGraph.AddPass("Cull");
+    uint32_t scenePass          = frameGraph.AddPass("Scene");
+    frameGraph.Write(clearPass, backBufferResource, GraphStateRenderTarget);
+    if (useGpuCulling)
+    {
+        frameGraph.Write(resetPass, countsResource, GraphStateCopyDest);
+        frameGraph.Write(cullPass, argumentsResource, GraphStateUnorderedAccess);
+        frameGraph.Write(cullPass, countsResource, GraphStateUnorderedAccess);
+        frameGraph.Read(scenePass, argumentsResource, GraphStateIndirectArgument);
+        frameGraph.Read(scenePass, countsResource, GraphStateIndirectArgument);
+        frameGraph.Bind(argumentsResource, sceneDraws.arguments);
+        frameGraph.Bind(countsResource, sceneDraws.counts);
+    }
+    frameGraph.Write(scenePass, backBufferResource, GraphStateRenderTarget);
+    frameGraph.Compile();
+
+    // GPU timings per pass, read back FramesInFlight frames later.
+    GpuTimestampProfiler* profiler = new GpuTimestampProfiler(device, commandQueue, FramesInFlight, MaxGpuScopes);
+
+    // Runs the work that waits on a frame's fence: deferred releases, timestamp readback and the
+    // submit to completion latency. Continuations only count; the render thread does the printing.
+    FenceCompletionService* fenceService = new FenceCompletionService();
+    std::atomic<uint64_t>   frameLatencyTotalUs{ 0 };
+    std::atomic<uint64_t>   frameLatencyCount{ 0 };
+    std::atomic<uint64_t>   frameTimeouts{ 0 };
+    std::atomic<uint64_t>   timedOutFrame{ 0 };
+    uint64_t                reportedTimeouts = 0;
+
+    // A virtual texture whose tiles are made resident from feedback within a fixed memory budget.
+    ID3D12Resource*                              virtualTexture   = CreateVirtualTexture(device);
+    TiledResidencyManager*                       virtualResidency = virtualTexture ? new TiledResidencyManager(device, commandQueue, virtualTexture, VirtualTextureBudget) : nullptr;
+    std::vector<D3D12_TILED_RESOURCE_COORDINATE> mappedTiles;
+
+    // Draws read the instances from the first frame, so their load must have finished by now.
+    while (assetStreamer->Pending() > 0)
+    {
+        if (assetStreamer->Update() == 0)
+        {
+            std::this_thread::yield();
+        }
+    }
+    if (!copyUploader->Flush())
+    {
+        std::cout << "Failed to submit instance upload\n";
+    }
+    AssetStreamerStats assetStats = assetStreamer->Stats();
+    std::cout << "Assets: " << assetStats.loads << " loaded through " << assetStreamer->Backend() << ", " << assetStats.fileBytes << " bytes read for "
+              << assetStats.rawBytes << ", " << assetStats.AverageLatencyMs() << " ms avg latency, " << assetStats.RawGBps() << " GB/s\n";
+
+    // Wait for GPU to finish any remaining work...
+    gpuFence->WaitForValue(gpuFence->Signal());
+
     // Run render loop
     bool running = true;
     while (running)
@@ -556,47 +1409,251 @@ int main()
             }
         }
 
-        // Render
-        PopulateCommandList(device, swapChain, commandAllocator, commandList, pipelineState, rootSignature, renderTargetsVec, vertexBufferView, rtvHeap, rtvHeapSize, viewport, scissorRect);
+        // Render. Only blocks when the CPU is FramesInFlight frames ahead of the GPU.
+        unsigned int frameSlot  = frameRing.BeginFrame();
+        if (frameTimeouts > reportedTimeouts)
+        {
+            reportedTimeouts = frameTimeouts;
+            std::cout << "Frame " << timedOutFrame << " has not completed after " << FenceTimeoutMs << " ms\n";
+        }
+        assetStreamer->Update();
+        uploadRing->Retire();
+        profiler->BeginFrame(frameSlot, frameRing.FramesSubmitted());
+
+        unsigned int backBuffer = swapChain->GetCurrentBackBufferIndex();
+        D3D12_CPU_DESCRIPTOR_HANDLE rtvHandle = rtvHandles[backBuffer];
+
+        frameGraph.Bind(backBufferResource, renderTargetsVec[backBuffer]);
+        const CompiledPass& clear = frameGraph.GetCompiledPass(clearPass);
+        const CompiledPass& reset = frameGraph.GetCompiledPass(resetPass);
+        const CompiledPass& cull  = frameGraph.GetCompiledPass(cullPass);
+        const CompiledPass& scene = frameGraph.GetCompiledPass(scenePass);
+
+        // The GPU path clears last frame's counts from zeroed upload memory; the CPU path culls into it.
+        UploadAllocation zeroCounts = {};
+        if (useGpuCulling)
+        {
+            uint32_t countBytes = sizeof(uint32_t) * gpuCulling->ChunkCount();
+            if (uploadRing->Allocate(countBytes, UploadAlignConstantBuffer, &zeroCounts))
+            {
+                memset(zeroCounts.cpuAddress, 0, countBytes);
+            }
+        }
+        else if (!WriteCpuDraws(uploadRing, &jobSystem, objectSpheres, cullPlanes, chunkSize, &sceneDraws))
+        {
+            sceneDraws.batches.clear();
+        }
+        bool recordCull = useGpuCulling && zeroCounts.resource;
+
+        // Tile mapping changes go on the queue ahead of the frame, and the new tiles are filled first.
+        CommandListPair tilePair;
+        if (virtualResidency && virtualResidency->IsValid())
+        {
+            RequestVirtualTextureView(virtualResidency, frameRing.FramesSubmitted());
+            virtualResidency->Update(commandQueue, MaxTileMapsPerFrame, &mappedTiles);
+            if (!mappedTiles.empty() && commandLists->Acquire(D3D12_COMMAND_LIST_TYPE_DIRECT, nullptr, &tilePair))
+            {
+                RecordTileFills(tilePair.list, virtualTexture, uploadRing, mappedTiles);
+            }
+        }
+
+        // Job 0 records the frame start, job 1 the culling and the rest a range of draws each.
+        size_t rangeCount = sceneDraws.batches.size() < ParallelRecordLists ? sceneDraws.batches.size() : ParallelRecordLists;
+
+        // Scopes are declared up front so the lists that open and close them can record in parallel.
+        uint32_t frameScope = profiler->AddScope("Frame");
+        uint32_t clearScope = profiler->AddScope("Clear", frameScope);
+        uint32_t cullScope  = profiler->AddScope("Cull", frameScope);
+        uint32_t sceneScope = profiler->AddScope("Scene", frameScope);
+        std::vector<uint32_t> rangeScopes;
+        for (size_t range = 0; range < rangeCount; range++)
+        {
+            rangeScopes.push_back(profiler->AddScope("Draws", sceneScope));
+        }
+        // Each job takes its list from the pool; a job that could not get one leaves its slot empty.
+        std::vector<CommandListPair> framePairs(rangeCount + 2);
+        jobSystem.ParallelFor(static_cast<uint32_t>(rangeCount + 2), [&](uint32_t _job, uint32_t)
+        {
+            if (_job == 0)
+            {
+                if (commandLists->Acquire(D3D12_COMMAND_LIST_TYPE_DIRECT, pipelineState, &framePairs[0]))
+                {
+                    PopulateCommandList(device, framePairs[0].list, rootSignature, frameGraph, clear, &listTrackers[0], rtvHandle, viewport, scissorRect,
+                                        profiler, frameScope, clearScope);
+                }
+                return;
+            }
+            if (_job == 1)
+            {
+                if (recordCull && commandLists->Acquire(D3D12_COMMAND_LIST_TYPE_DIRECT, nullptr, &framePairs[1]))
+                {
+                    RecordCullList(device, framePairs[1].list, frameGraph, &listTrackers[1], reset, cull,
+                                   gpuCulling, zeroCounts, sphereAddress, cullPlanes, profiler, cullScope);
+                }
+                return;
+            }
+
+            size_t range = _job - 2;
+            size_t batchCount = sceneDraws.batches.size();
+            if (commandLists->Acquire(D3D12_COMMAND_LIST_TYPE_DIRECT, pipelineState, &framePairs[_job]))
+            {
+                RecordDrawRange(device, framePairs[_job].list, rootSignature, rtvHandle, vertexBufferViews, viewport, scissorRect,
+                                sceneDraws, batchCount * range / rangeCount, batchCount * (range + 1) / rangeCount,
+                                frameGraph, &listTrackers[_job],
+                                range == 0 ? &scene.before : nullptr, range + 1 == rangeCount ? &scene.after : nullptr,
+                                profiler, rangeScopes[range], range == 0 ? sceneScope : GpuScopeInvalid, range + 1 == rangeCount ? sceneScope : GpuScopeInvalid);
+            }
+        });
+
+        // Settle the lists' first-use transitions against the known states, in submission order.
+        std::vector<ID3D12GraphicsCommandList*> frameLists;
+        std::vector<CommandStateTracker*>       trackers;
+        for (size_t i = 0; i < framePairs.size(); i++)
+        {
+            if (framePairs[i].list)
+            {
+                frameLists.push_back(framePairs[i].list);
+                trackers.push_back(&listTrackers[i]);
+            }
+        }
+        std::vector<std::vector<StateTransition>> fixups;
+        stateTable.ResolveSubmission(trackers.data(), trackers.size(), &fixups);
+
+        // Execute the command lists in recording order with a single submission.
+        std::vector<ID3D12CommandList*> ppCommandLists;
+        if (tilePair.list)
+        {
+            ppCommandLists.push_back(tilePair.list);
+            framePairs.push_back(tilePair);
+        }
+        for (size_t i = 0; i < frameLists.size(); i++)
+        {
+            CommandListPair fixupPair;
+            if (!fixups[i].empty() && commandLists->Acquire(D3D12_COMMAND_LIST_TYPE_DIRECT, nullptr, &fixupPair))
+            {
+                RecordFixupList(fixupPair.list, fixups[i]);
+                ppCommandLists.push_back(fixupPair.list);
+                framePairs.push_back(fixupPair);
+            }
+            ppCommandLists.push_back(frameLists[i]);
+        }
+        CommandListPair profilerPair;
+        if (commandLists->Acquire(D3D12_COMMAND_LIST_TYPE_DIRECT, nullptr, &profilerPair))
+        {
+            RecordProfilerList(profilerPair.list, profiler, frameScope);
+            ppCommandLists.push_back(profilerPair.list);
+            framePairs.push_back(profilerPair);
+        }
 
-        // Execute the command list.
-        ID3D12CommandList* ppCommandLists[] = { commandList };
-        commandQueue->ExecuteCommandLists(_countof(ppCommandLists), ppCommandLists);
+        // The GPU waits for the copy queue only until the uploads have landed.
+        copyUploader->WaitOnQueue(commandQueue, staticTicket);
+        commandQueue->ExecuteCommandLists(static_cast<UINT>(ppCommandLists.size()), ppCommandLists.data());
 
         // Present the frame.
         HRESULT hrPresent = swapChain->Present(1, 0);
         if (!SUCCEEDED(hrPresent))
             std::cout << "Failed to present image to window\n";
 
-        // Wait for work to finish
-        fence = fenceValue;
-        commandQueue->Signal(dxfence, fence);
-        fenceValue++;
-
-        // Wait until the previous frame is finished.
+        // Tag the frame slot, its upload pages and descriptor tables with the frame's fence value.
+        uint64_t frameFence = frameRing.EndFrame();
+        auto     submitTime = std::chrono::steady_clock::now();
+        fenceService->Enqueue(gpuFence, frameFence, [&frameLatencyTotalUs, &frameLatencyCount, &frameTimeouts, &timedOutFrame, submitTime, frameFence](bool _reached)
+        {
+            if (!_reached)
+            {
+                timedOutFrame = frameFence;
+                frameTimeouts++;
+                return;
+            }
+            auto latency = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - submitTime);
+            frameLatencyTotalUs += static_cast<uint64_t>(latency.count());
+            frameLatencyCount++;
+        }, FenceTimeoutMs);
 
-        if (dxfence->GetCompletedValue() < fence)
+        // Objects deferred up to this frame are released as soon as it completes, a budget at a time.
+        fenceService->Enqueue(gpuFence, frameFence, [releaseQueue](bool)
+        {
+            releaseQueue->Collect(ReleaseBudgetPerFrame);
+        });
+        profiler->EndFrame(fenceService, gpuFence, frameFence, FenceTimeoutMs);
+        uploadRing->EndFrame(frameFence);
+        for (const CommandListPair& pair : framePairs)
         {
-            dxfence->SetEventOnCompletion(fence, fenceEvent);
-            WaitForSingleObject(fenceEvent, INFINITE);
+            commandLists->Retire(pair, frameFence);
         }
+        commandLists->Trim();
     }
 
 
-    // Shutdown. Release objects.
-    dxfence->Release();
-    vertexBuffer->Release();
-    rtvHeap->Release();
+    // Shutdown. Wait for frames in flight, then release objects.
+    frameRing.WaitIdle();
+    delete fenceService;
+    std::cout << "Deferred releases: " << releaseQueue->Released() << " over frames, " << releaseQueue->Pending() << " at shutdown, peak backlog "
+              << releaseQueue->PeakPending() << "\n";
+    delete releaseQueue;
+    if (frameLatencyCount > 0)
+    {
+        std::cout << "Submit to GPU completion: " << frameLatencyTotalUs / frameLatencyCount / 1000.0 << " ms avg over " << frameLatencyCount << " frames\n";
+    }
+
+    // Report averaged pass timings and keep the last frames as a trace for chrome://tracing.
+    GpuProfileStats gpuStats = profiler->Stats();
+    for (const GpuScopeStats& stats : gpuStats.Scopes())
+    {
+        std::cout << std::string(2 * stats.depth, ' ') << stats.name << ": " << stats.AverageMs() << " ms avg, "
+                  << stats.minMs << " min, " << stats.maxMs << " max\n";
+    }
+    if (!gpuStats.WriteChromeTrace(std::filesystem::temp_directory_path() / "base_dx12_gpu_trace.json"))
+    {
+        std::cout << "Failed to write GPU trace\n";
+    }
+    if (virtualResidency)
+    {
+        const TileResidencyStats& tiles = virtualResidency->Residency().Stats();
+        std::cout << "Virtual texture: " << virtualResidency->Residency().ResidentCount() << " of " << virtualResidency->Residency().SlotCount() << " tiles resident, "
+                  << tiles.hits << " hits of " << tiles.requests << " requests, " << tiles.mapped << " mapped, " << tiles.evicted << " evicted, "
+                  << tiles.starved << " starved\n";
+    }
+    if (virtualTexture)
+    {
+        virtualTexture->Release();
+    }
+    delete virtualResidency;
+    delete profiler;
+    delete assetStreamer;
+    delete copyUploader;
+    std::cout << "Command lists: " << commandLists->Owned(D3D12_COMMAND_LIST_TYPE_DIRECT) << " direct pairs kept of "
+              << commandLists->Created(D3D12_COMMAND_LIST_TYPE_DIRECT) << " created, " << commandLists->Owned(D3D12_COMMAND_LIST_TYPE_COPY) << " copy\n";
+    delete commandLists;
+    delete gpuCulling;
+    for (HeapAllocation* allocation : { vertexAllocation, instanceAllocation, sphereAllocation })
+    {
+        if (allocation)
+        {
+            staticHeaps->DestroyResource(allocation);
+        }
+    }
+    delete staticHeaps;
+    if (sceneDraws.signature)
+    {
+        sceneDraws.signature->Release();
+    }
+    ReleaseShader(&cullShader);
+    delete copyFence;
+    copyQueue->Release();
+    delete uploadRing;
+    delete uploadHeaps;
+    delete gpuFence;
+    rtvDescriptors->Free(rtvIndices[0]);
+    rtvDescriptors->Free(rtvIndices[1]);
+    delete rtvDescriptors;
     renderTarget0->Release();
     renderTarget1->Release();
     swapChain->Release();
-    commandList->Release();
     commandQueue->Release();
-    pipelineState->Release();
-    commandAllocator->Release();
-    rootSignature->Release();
-    pixelShader->Release();
-    vertexShader->Release();
+    delete pipelineCache;
+    ReleaseShader(&pixelShader);
+    ReleaseShader(&vertexShader);
     device->Release();
     debugController->Release();
     factory->Release();
@@ -0,0 +1,158 @@
+#pragma once
+
+// Completion-callback driven reads.
+// Instead of blocking the host thread in enqueueReadBuffer(..., CL_TRUE, ...), reads are enqueued
+// non-blocking and completed through clSetEventCallback, either fulfilling a future or running a
+// continuation. The callback runs on a runtime thread, so continuations should stay short.
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <mutex>
+
+typedef std::function<void(cl_int)> ReadContinuation;
+
+static void CL_CALLBACK ReadCompleteCallback(cl_event _event, cl_int _status, void* _userData)
+{
+	ReadContinuation* continuation = static_cast<ReadContinuation*>(_userData);
+	(*continuation)(_status);
+	delete continuation;
+	clReleaseEvent(_event);
+}
+
+// Enqueues a non-blocking read and calls _continuation with the final status once it completes.
+// Returns an error only if the continuation will never run.
+static cl_int EnqueueReadBufferAsync(cl::CommandQueue& _queue, const cl::Buffer& _buffer, size_t _offset, size_t _size, void* _dst, ReadContinuation _continuation, const std::vector<cl::Event>* _waitEvents = nullptr)
+{
+	cl::Event readEvent;
+	cl_int res = _queue.enqueueReadBuffer(_buffer, CL_FALSE, _offset, _size, _dst, _waitEvents, &readEvent);
+	if (res != CL_SUCCESS)
+		return res;
+
+	// Callbacks only fire for submitted work. Flush before arming the callback: once it is armed it
+	// reports the status itself, so nothing after that may return an error as well.
+	res = _queue.flush();
+	if (res != CL_SUCCESS)
+		return res;
+
+	// The callback owns a reference so the event outlives the cl::Event wrapper.
+	clRetainEvent(readEvent());
+	ReadContinuation* continuation = new ReadContinuation(std::move(_continuation));
+	res = clSetEventCallback(readEvent(), CL_COMPLETE, ReadCompleteCallback, continuation);
+	if (res != CL_SUCCESS)
+	{
+		delete continuation;
+		clReleaseEvent(readEvent());
+	}
+	return res;
+}
+
+// Future flavour of the above; the future holds the read status.
+static std::future<cl_int> EnqueueReadBufferAsync(cl::CommandQueue& _queue, const cl::Buffer& _buffer, size_t _offset, size_t _size, void* _dst, const std::vector<cl::Event>* _waitEvents = nullptr)
+{
+	std::shared_ptr<std::promise<cl_int>> promise = std::make_shared<std::promise<cl_int>>();
+	std::future<cl_int> future = promise->get_future();
+
+	cl_int res = EnqueueReadBufferAsync(_queue, _buffer, _offset, _size, _dst, [promise](cl_int _status) { promise->set_value(_status); }, _waitEvents);
+	if (res != CL_SUCCESS)
+		promise->set_value(res);
+
+	return future;
+}
+
+// Runs the same WriteValue jobs blocking and callback driven from a single host thread, and
+// reports throughput and the number of jobs the host thread kept in flight.
+static void RunAsyncBenchmark(const cl::Context& _context, const cl::Device& _device, const cl::Program& _program)
+{
+	const size_t	N				= 1024;
+	const int		jobCount		= 2000;
+	const int		queueCount		= 4;
+	const int		maxInFlight		= 16;
+
+	std::vector<cl::CommandQueue>		queues;
+	std::vector<cl::Kernel>				kernels;
+	std::vector<cl::Buffer>				buffers;
+	std::vector<std::vector<cl_int>>	staging(maxInFlight, std::vector<cl_int>(N));
+	for (int q = 0; q < queueCount; q++)
+	{
+		queues.push_back(cl::CommandQueue(_context, _device));
+		kernels.push_back(cl::Kernel(_program, "WriteValue"));
+	}
+	for (int s = 0; s < maxInFlight; s++)
+		buffers.push_back(cl::Buffer(_context, CL_MEM_READ_WRITE, N * sizeof(cl_int)));
+
+	// Blocking: one job in flight at a time.
+	auto blockingStart = std::chrono::high_resolution_clock::now();
+	bool blockingOk = true;
+	for (int i = 0; i < jobCount; i++)
+	{
+		kernels[0].setArg(0, static_cast<cl_int>(i));
+		kernels[0].setArg(1, buffers[0]);
+		queues[0].enqueueNDRangeKernel(kernels[0], cl::NullRange, N, cl::NullRange);
+		queues[0].enqueueReadBuffer(buffers[0], CL_TRUE, 0, N * sizeof(cl_int), staging[0].data());
+		blockingOk &= staging[0][1] == i + 1;
+	}
+	double blockingMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - blockingStart).count();
+
+	// Callback driven: the host thread only waits when every staging slot is busy.
+	std::mutex					slotMutex;
+	std::condition_variable		slotFree;
+	std::vector<int>			freeSlots;
+	std::atomic<int>			inFlight(0);
+	std::atomic<bool>			asyncOk(true);
+	int							peakInFlight	= 0;
+	long long					inFlightSum		= 0;
+	for (int s = 0; s < maxInFlight; s++)
+		freeSlots.push_back(s);
+
+	auto asyncStart = std::chrono::high_resolution_clock::now();
+	for (int i = 0; i < jobCount; i++)
+	{
+		int slot;
+		{
+			std::unique_lock<std::mutex> lock(slotMutex);
+			slotFree.wait(lock, [&] { return !freeSlots.empty(); });
+			slot = freeSlots.back();
+			freeSlots.pop_back();
+		}
+
+		int queueIndex = i % queueCount;
+		kernels[queueIndex].setArg(0, static_cast<cl_int>(i));
+		kernels[queueIndex].setArg(1, buffers[slot]);
+		queues[queueIndex].enqueueNDRangeKernel(kernels[queueIndex], cl::NullRange, N, cl::NullRange);
+
+		int current = ++inFlight;
+		peakInFlight = current > peakInFlight ? current : peakInFlight;
+		inFlightSum += current;
+
+		cl_int res = EnqueueReadBufferAsync(queues[queueIndex], buffers[slot], 0, N * sizeof(cl_int), staging[slot].data(), [&, slot, i](cl_int _status)
+		{
+			if (_status != CL_SUCCESS || staging[slot][1] != i + 1)
+				asyncOk = false;
+
+			std::lock_guard<std::mutex> lock(slotMutex);
+			inFlight--;
+			freeSlots.push_back(slot);
+			slotFree.notify_one();
+		});
+		if (res != CL_SUCCESS)
+		{
+			std::cout << "Async read failed to enqueue.\n";
+			asyncOk = false;
+			std::lock_guard<std::mutex> lock(slotMutex);
+			inFlight--;
+			freeSlots.push_back(slot);
+		}
+	}
+	{
+		std::unique_lock<std::mutex> lock(slotMutex);
+		slotFree.wait(lock, [&] { return freeSlots.size() == static_cast<size_t>(maxInFlight); });
+	}
+	double asyncMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - asyncStart).count();
+
+	std::cout << "Blocking: " << jobCount / (blockingMs / 1000.0) << " jobs/s, 1 job in flight per host thread"	<< (blockingOk ? "" : " (FAILED)") << "\n";
+	std::cout << "Callback: " << jobCount / (asyncMs / 1000.0) << " jobs/s, " << static_cast<double>(inFlightSum) / jobCount
+			  << " average / " << peakInFlight << " peak jobs in flight per host thread"									<< (asyncOk ? "" : " (FAILED)") << "\n";
+}
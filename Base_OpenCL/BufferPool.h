@@ -0,0 +1,207 @@
+#pragma once
+
+// Pooled OpenCL buffers.
+// Requests are rounded up to a power of two size class. Each class carves fixed size slots out of
+// large backing buffers with clCreateSubBuffer, aligned to CL_DEVICE_MEM_BASE_ADDR_ALIGN. The
+// sub-buffer objects are kept with their slots, so a released slot is handed out again without
+// touching the runtime. Requests above the largest class, or above what fits in one backing
+// buffer, get a dedicated buffer.
+
+#include <mutex>
+
+struct PooledBuffer
+{
+	cl::Buffer	buffer;
+	size_t		size		= 0;	// Requested size.
+	int			sizeClass	= -1;	// -1 for dedicated buffers.
+	size_t		slot		= 0;
+};
+
+struct BufferPoolStats
+{
+	size_t		liveAllocations		= 0;
+	size_t		requestedBytes		= 0;	// Sum of live request sizes.
+	size_t		allocatedBytes		= 0;	// Sum of live slot sizes.
+	size_t		backingBytes		= 0;	// Sum of backing and dedicated buffer sizes.
+	size_t		reusedSlots			= 0;	// Acquires served by an existing sub-buffer.
+	size_t		createdSlots		= 0;	// Acquires that had to call clCreateSubBuffer.
+	size_t		dedicatedBuffers	= 0;
+};
+
+class BufferPool
+{
+public:
+	static const int	MinClassShift	= 8;	// 256 bytes.
+	static const int	MaxClassShift	= 20;	// 1 MB.
+
+	// Sub-buffers inherit their backing buffer's flags, so one pool serves one set of flags.
+	BufferPool(const cl::Context& _context, const cl::Device& _device, cl_mem_flags _flags = CL_MEM_READ_WRITE, size_t _blockSize = 4 << 20)
+		: m_context(_context), m_flags(_flags), m_blockSize(_blockSize)
+	{
+		size_t baseAlign = _device.getInfo<CL_DEVICE_MEM_BASE_ADDR_ALIGN>() / 8;	// Reported in bits.
+		m_alignment = baseAlign > 0 ? baseAlign : 128;
+		m_classes.resize(MaxClassShift - MinClassShift + 1);
+	}
+
+	bool Acquire(size_t _size, PooledBuffer* _out)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		int sizeClass = SizeClassFor(_size);
+		if (sizeClass < 0)
+		{
+			cl_int res = CL_SUCCESS;
+			_out->buffer	= cl::Buffer(m_context, m_flags, _size, nullptr, &res);
+			_out->size		= _size;
+			_out->sizeClass = -1;
+			if (res != CL_SUCCESS)
+				return false;
+
+			m_stats.dedicatedBuffers++;
+			m_stats.backingBytes += _size;
+			Track(_size, _size);
+			return true;
+		}
+
+		SizeClass&	sc			= m_classes[sizeClass];
+		size_t		slotSize	= SlotSize(sizeClass);
+		if (sc.freeSlots.empty())
+		{
+			if (!Grow(sizeClass))
+				return false;
+		}
+
+		size_t slot = sc.freeSlots.back();
+		sc.freeSlots.pop_back();
+
+		if (sc.subBuffers[slot]() == nullptr)
+		{
+			size_t				slotsPerBlock	= m_blockSize / slotSize;
+			cl_buffer_region	region			= { (slot % slotsPerBlock) * slotSize, slotSize };
+			cl_int				res				= CL_SUCCESS;
+			sc.subBuffers[slot] = sc.blocks[slot / slotsPerBlock].createSubBuffer(m_flags, CL_BUFFER_CREATE_TYPE_REGION, &region, &res);
+			if (res != CL_SUCCESS)
+			{
+				sc.freeSlots.push_back(slot);
+				return false;
+			}
+			m_stats.createdSlots++;
+		}
+		else
+		{
+			m_stats.reusedSlots++;
+		}
+
+		_out->buffer	= sc.subBuffers[slot];
+		_out->size		= _size;
+		_out->sizeClass = sizeClass;
+		_out->slot		= slot;
+		Track(_size, slotSize);
+		return true;
+	}
+
+	void Release(PooledBuffer& _buffer)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		if (_buffer.sizeClass < 0)
+		{
+			m_stats.dedicatedBuffers--;
+			m_stats.backingBytes -= _buffer.size;
+			Untrack(_buffer.size, _buffer.size);
+		}
+		else
+		{
+			m_classes[_buffer.sizeClass].freeSlots.push_back(_buffer.slot);
+			Untrack(_buffer.size, SlotSize(_buffer.sizeClass));
+		}
+		_buffer = PooledBuffer();
+	}
+
+	BufferPoolStats GetStats() const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_stats;
+	}
+
+	void PrintStats() const
+	{
+		BufferPoolStats stats = GetStats();
+		size_t acquires = stats.reusedSlots + stats.createdSlots;
+		std::cout	<< "Buffer pool: " << stats.liveAllocations << " live, "
+					<< stats.requestedBytes << "/" << stats.allocatedBytes << "/" << stats.backingBytes << " bytes requested/allocated/backing, "
+					<< "internal fragmentation " << (stats.allocatedBytes ? 100.0 * (stats.allocatedBytes - stats.requestedBytes) / stats.allocatedBytes : 0.0) << "%, "
+					<< "slot reuse " << (acquires ? 100.0 * stats.reusedSlots / acquires : 0.0) << "%, "
+					<< stats.dedicatedBuffers << " dedicated\n";
+	}
+
+private:
+	struct SizeClass
+	{
+		std::vector<cl::Buffer>	blocks;
+		std::vector<cl::Buffer>	subBuffers;		// One per slot, created lazily.
+		std::vector<size_t>		freeSlots;
+	};
+
+	// Classes whose slot does not fit in a block are never used.
+	int SizeClassFor(size_t _size) const
+	{
+		for (int sizeClass = 0; sizeClass <= MaxClassShift - MinClassShift; sizeClass++)
+		{
+			if (_size <= SlotSize(sizeClass))
+				return SlotSize(sizeClass) <= m_blockSize ? sizeClass : -1;
+		}
+		return -1;
+	}
+
+	size_t SlotSize(int _sizeClass) const
+	{
+		// Every slot origin must satisfy the device base address alignment.
+		size_t size = size_t(1) << (_sizeClass + MinClassShift);
+		return (size + m_alignment - 1) / m_alignment * m_alignment;
+	}
+
+	bool Grow(int _sizeClass)
+	{
+		SizeClass&	sc				= m_classes[_sizeClass];
+		size_t		slotsPerBlock	= m_blockSize / SlotSize(_sizeClass);
+		cl_int		res				= CL_SUCCESS;
+		if (slotsPerBlock == 0)
+			return false;
+
+		cl::Buffer block(m_context, m_flags, m_blockSize, nullptr, &res);
+		if (res != CL_SUCCESS)
+			return false;
+
+		size_t firstSlot = sc.subBuffers.size();
+		sc.blocks.push_back(block);
+		sc.subBuffers.resize(firstSlot + slotsPerBlock);
+		for (size_t s = firstSlot + slotsPerBlock; s > firstSlot; s--)
+			sc.freeSlots.push_back(s - 1);
+
+		m_stats.backingBytes += m_blockSize;
+		return true;
+	}
+
+	void Track(size_t _requested, size_t _allocated)
+	{
+		m_stats.liveAllocations++;
+		m_stats.requestedBytes	+= _requested;
+		m_stats.allocatedBytes	+= _allocated;
+	}
+
+	void Untrack(size_t _requested, size_t _allocated)
+	{
+		m_stats.liveAllocations--;
+		m_stats.requestedBytes	-= _requested;
+		m_stats.allocatedBytes	-= _allocated;
+	}
+
+	cl::Context				m_context;
+	cl_mem_flags			m_flags;
+	size_t					m_blockSize;
+	size_t					m_alignment;
+	std::vector<SizeClass>	m_classes;
+	BufferPoolStats			m_stats;
+	mutable std::mutex		m_mutex;
+};
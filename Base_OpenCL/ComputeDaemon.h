@@ -0,0 +1,285 @@
+#pragma once
+
+// Resident compute daemon.
+// Keeps the OpenCL context, queue and built WriteValue kernel warm so a client only pays for a
+// round trip over a Unix domain socket. Payloads live in a memfd shared between client and daemon,
+// handed over once per connection with SCM_RIGHTS, so jobs never copy data through the socket.
+//
+//   Base_OpenCL -daemon [socketPath]
+//   Base_OpenCL -client [socketPath]
+//
+// Linux only (tested against POCL); other platforms report that the mode is unsupported.
+
+#include <chrono>
+
+#include "ComputeDaemonProtocol.h"
+
+#if defined(__linux__)
+
+#include <csignal>
+#include <poll.h>
+#include <sys/mman.h>
+
+static volatile sig_atomic_t computeDaemonRunning = 1;
+
+static void ComputeDaemonStop(int)
+{
+	computeDaemonRunning = 0;
+}
+
+struct ComputeDaemonClient
+{
+	int			socket	= -1;
+	void*		shared	= nullptr;
+	size_t		size	= 0;
+	cl::Buffer	buffer;			// Wraps the shared region, created on attach.
+};
+
+static void CloseDaemonClient(ComputeDaemonClient& _client)
+{
+	_client.buffer = cl::Buffer();
+	if (_client.shared)
+		munmap(_client.shared, _client.size);
+	close(_client.socket);
+	_client.shared = nullptr;
+	_client.socket = -1;
+}
+
+// Returns false when the connection should be dropped.
+static bool ServiceDaemonClient(ComputeDaemonClient& _client, const cl::Context& _context, cl::CommandQueue& _queue, cl::Kernel& _kernel)
+{
+	if (!_client.shared)
+	{
+		uint64_t size	= 0;
+		int		 memFd	= ReceiveAttach(_client.socket, &size);
+		if (memFd < 0)
+			return false;
+
+		_client.shared = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, memFd, 0);
+		close(memFd);
+		if (_client.shared == MAP_FAILED)
+		{
+			_client.shared = nullptr;
+			return false;
+		}
+		_client.size = size;
+
+		// Page aligned host memory lets CPU devices such as POCL run on it in place.
+		cl_int bufferRes = CL_SUCCESS;
+		_client.buffer = cl::Buffer(_context, CL_MEM_READ_WRITE | CL_MEM_USE_HOST_PTR, _client.size, _client.shared, &bufferRes);
+		return bufferRes == CL_SUCCESS;
+	}
+
+	ComputeDaemonRequest request = {};
+	if (!ReadFull(_client.socket, &request, sizeof(request)) || request.magic != ComputeDaemonMagic)
+		return false;
+
+	ComputeDaemonResponse response = { CL_SUCCESS, request.count };
+	if (request.count == 0 || static_cast<size_t>(request.count) * sizeof(cl_int) > _client.size)
+	{
+		response.status = CL_INVALID_BUFFER_SIZE;
+	}
+	else
+	{
+		_kernel.setArg(0, static_cast<cl_int>(request.offset));
+		_kernel.setArg(1, _client.buffer);
+		response.status = _queue.enqueueNDRangeKernel(_kernel, cl::NullRange, request.count, cl::NullRange);
+
+		// Mapping synchronises the host view of the shared region with the device.
+		if (response.status == CL_SUCCESS)
+		{
+			void* mapped = _queue.enqueueMapBuffer(_client.buffer, CL_TRUE, CL_MAP_READ, 0, request.count * sizeof(cl_int), nullptr, nullptr, &response.status);
+			if (response.status == CL_SUCCESS)
+				response.status = _queue.enqueueUnmapMemObject(_client.buffer, mapped);
+			if (response.status == CL_SUCCESS)
+				response.status = _queue.finish();
+		}
+	}
+
+	return WriteFull(_client.socket, &response, sizeof(response));
+}
+
+// The daemon prefers the GPU InitialiseCL picks, but CPU only setups such as POCL have none, so it
+// falls back to the first available device of any type.
+static bool InitialiseDaemonCL(cl::Context& _context, cl::Device& _device)
+{
+	if (InitialiseCL(_context, _device))
+		return true;
+
+	std::vector<cl::Platform> platforms;
+	cl::Platform::get(&platforms);
+	for (cl::Platform& platform : platforms)
+	{
+		std::vector<cl::Device> deviceList;
+		platform.getDevices(CL_DEVICE_TYPE_ALL, &deviceList);
+		for (cl::Device& device : deviceList)
+		{
+			if (!device.getInfo<CL_DEVICE_AVAILABLE>())
+				continue;
+
+			std::cout << "Found (non-GPU fallback): " << device.getInfo<CL_DEVICE_NAME>() << "\n";
+			_device		= device;
+			_context	= cl::Context(_device);
+			return true;
+		}
+	}
+	return false;
+}
+
+static int RunComputeDaemon(const char* _socketPath)
+{
+	cl::Context cl_context;
+	cl::Device	cl_device;
+	if (!InitialiseDaemonCL(cl_context, cl_device))
+	{
+		std::cout << "No available OpenCL device found.\n";
+		return 1;
+	}
+
+	cl::Program program;
+	if (!BuildProgram(cl_context, cl_device, source, program))
+		return 1;
+
+	cl::CommandQueue queue(cl_context, cl_device);
+	cl::Kernel		 writeValueKernel(program, "WriteValue");
+
+	sockaddr_un addr;
+	if (!ComputeDaemonAddress(_socketPath, addr))
+		return 1;
+
+	int listenSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+	unlink(_socketPath);
+	if (listenSocket < 0 || bind(listenSocket, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || listen(listenSocket, 16) != 0)
+	{
+		std::cout << "Failed to listen on " << _socketPath << "\n";
+		return 1;
+	}
+
+	signal(SIGINT, ComputeDaemonStop);
+	signal(SIGTERM, ComputeDaemonStop);
+	signal(SIGPIPE, SIG_IGN);
+	std::cout << "Compute daemon listening on " << _socketPath << "\n";
+
+	std::vector<ComputeDaemonClient> clients;
+	std::vector<pollfd>				 pollFds;
+	while (computeDaemonRunning)
+	{
+		pollFds.clear();
+		pollFds.push_back({ listenSocket, POLLIN, 0 });
+		for (const ComputeDaemonClient& client : clients)
+			pollFds.push_back({ client.socket, POLLIN, 0 });
+
+		if (poll(pollFds.data(), pollFds.size(), 250) <= 0)
+			continue;
+
+		for (size_t i = 0; i < clients.size(); i++)
+		{
+			if (!(pollFds[i + 1].revents & (POLLIN | POLLHUP | POLLERR)))
+				continue;
+
+			if (!ServiceDaemonClient(clients[i], cl_context, queue, writeValueKernel))
+				CloseDaemonClient(clients[i]);
+		}
+
+		for (auto c = clients.begin(); c != clients.end();)
+			c = c->socket < 0 ? clients.erase(c) : c + 1;
+
+		if (pollFds[0].revents & POLLIN)
+		{
+			ComputeDaemonClient client;
+			client.socket = accept(listenSocket, nullptr, nullptr);
+			if (client.socket >= 0)
+				clients.push_back(client);
+		}
+	}
+
+	for (ComputeDaemonClient& client : clients)
+		CloseDaemonClient(client);
+	close(listenSocket);
+	unlink(_socketPath);
+
+	std::cout << "Compute daemon stopped.\n";
+	return 0;
+}
+
+static int RunComputeClient(const char* _socketPath)
+{
+	const int		kernelValueOffset	= 10;
+	const size_t	N					= 1024;
+	const int		iterations			= 1000;
+	const size_t	sharedSize			= N * sizeof(cl_int);
+
+	int memFd = memfd_create("base_opencl_payload", 0);
+	if (memFd < 0 || ftruncate(memFd, sharedSize) != 0)
+	{
+		std::cout << "Failed to create shared payload.\n";
+		return 1;
+	}
+
+	void* mapping = mmap(nullptr, sharedSize, PROT_READ | PROT_WRITE, MAP_SHARED, memFd, 0);
+	if (mapping == MAP_FAILED)
+	{
+		std::cout << "Failed to map shared payload.\n";
+		close(memFd);
+		return 1;
+	}
+	cl_int* shared = static_cast<cl_int*>(mapping);
+
+	sockaddr_un addr;
+	int			clientSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (!ComputeDaemonAddress(_socketPath, addr) || connect(clientSocket, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0)
+	{
+		std::cout << "Failed to connect to compute daemon at " << _socketPath << "\n";
+		return 1;
+	}
+
+	if (!SendAttach(clientSocket, memFd, sharedSize))
+	{
+		std::cout << "Failed to share payload with daemon.\n";
+		return 1;
+	}
+	close(memFd);
+
+	bool	success = true;
+	auto	start	= std::chrono::high_resolution_clock::now();
+	for (int i = 0; i < iterations && success; i++)
+	{
+		ComputeDaemonRequest  request	= { ComputeDaemonMagic, kernelValueOffset + i, static_cast<uint32_t>(N) };
+		ComputeDaemonResponse response	= {};
+		success =	WriteFull(clientSocket, &request, sizeof(request)) &&
+					ReadFull(clientSocket, &response, sizeof(response)) &&
+					response.status == CL_SUCCESS &&
+					shared[1] == kernelValueOffset + i + 1;
+	}
+	auto end = std::chrono::high_resolution_clock::now();
+
+	close(clientSocket);
+	munmap(shared, sharedSize);
+
+	if (!success)
+	{
+		std::cout << "This program failed.\n";
+		return 1;
+	}
+
+	double totalUs = std::chrono::duration<double, std::micro>(end - start).count();
+	std::cout << "Average job round trip: " << totalUs / iterations << "us over " << iterations << " jobs\n";
+	std::cout << "This program ran successfully.\n";
+	return 0;
+}
+
+#else
+
+static int RunComputeDaemon(const char*)
+{
+	std::cout << "The compute daemon is only supported on Linux.\n";
+	return 1;
+}
+
+static int RunComputeClient(const char*)
+{
+	std::cout << "The compute daemon is only supported on Linux.\n";
+	return 1;
+}
+
+#endif
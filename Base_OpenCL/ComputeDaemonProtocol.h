@@ -0,0 +1,138 @@
+#pragma once
+
+// Wire protocol between the compute daemon and its clients.
+// Kept apart from ComputeDaemon.h so the socket handling can be built and tested without OpenCL.
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+static const char ComputeDaemonDefaultSocket[] = "/tmp/base_opencl.sock";
+
+static const uint32_t ComputeDaemonMagic = 0x4C434442; // "BDCL"
+
+struct ComputeDaemonAttach
+{
+	uint32_t magic;
+	uint64_t size;			// Size of the shared memory region passed alongside.
+};
+
+struct ComputeDaemonRequest
+{
+	uint32_t magic;
+	int32_t	 offset;		// WriteValue offset argument.
+	uint32_t count;			// Number of ints to write into the shared region.
+};
+
+struct ComputeDaemonResponse
+{
+	int32_t	 status;		// CL_SUCCESS or the failing OpenCL error code.
+	uint32_t count;
+};
+
+#if defined(__linux__)
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+static bool ComputeDaemonAddress(const char* _path, sockaddr_un& _addr)
+{
+	memset(&_addr, 0, sizeof(_addr));
+	_addr.sun_family = AF_UNIX;
+	if (strlen(_path) >= sizeof(_addr.sun_path))
+	{
+		std::cout << "Socket path too long: " << _path << "\n";
+		return false;
+	}
+	strcpy(_addr.sun_path, _path);
+	return true;
+}
+
+static bool ReadFull(int _fd, void* _data, size_t _size)
+{
+	char* bytes = static_cast<char*>(_data);
+	while (_size > 0)
+	{
+		ssize_t res = read(_fd, bytes, _size);
+		if (res <= 0)
+			return false;
+		bytes += res;
+		_size -= static_cast<size_t>(res);
+	}
+	return true;
+}
+
+// A peer that hung up must not raise SIGPIPE and take the daemon down with it; the send just fails.
+static bool WriteFull(int _socket, const void* _data, size_t _size)
+{
+	const char* bytes = static_cast<const char*>(_data);
+	while (_size > 0)
+	{
+		ssize_t res = send(_socket, bytes, _size, MSG_NOSIGNAL);
+		if (res <= 0)
+			return false;
+		bytes += res;
+		_size -= static_cast<size_t>(res);
+	}
+	return true;
+}
+
+static bool SendAttach(int _socket, int _memFd, uint64_t _size)
+{
+	ComputeDaemonAttach attach = { ComputeDaemonMagic, _size };
+	iovec iov = { &attach, sizeof(attach) };
+
+	char control[CMSG_SPACE(sizeof(int))] = {};
+	msghdr msg = {};
+	msg.msg_iov			= &iov;
+	msg.msg_iovlen		= 1;
+	msg.msg_control		= control;
+	msg.msg_controllen	= sizeof(control);
+
+	cmsghdr* cmsg		= CMSG_FIRSTHDR(&msg);
+	cmsg->cmsg_level	= SOL_SOCKET;
+	cmsg->cmsg_type		= SCM_RIGHTS;
+	cmsg->cmsg_len		= CMSG_LEN(sizeof(int));
+	memcpy(CMSG_DATA(cmsg), &_memFd, sizeof(int));
+
+	return sendmsg(_socket, &msg, MSG_NOSIGNAL) == sizeof(attach);
+}
+
+// The size is the peer's claim; it is only accepted if the descriptor really is that large, since
+// touching a mapping past the end of the file raises SIGBUS.
+static int ReceiveAttach(int _socket, uint64_t* _size)
+{
+	ComputeDaemonAttach attach = {};
+	iovec iov = { &attach, sizeof(attach) };
+
+	char control[CMSG_SPACE(sizeof(int))] = {};
+	msghdr msg = {};
+	msg.msg_iov			= &iov;
+	msg.msg_iovlen		= 1;
+	msg.msg_control		= control;
+	msg.msg_controllen	= sizeof(control);
+
+	ssize_t received = recvmsg(_socket, &msg, 0);
+
+	// A descriptor may arrive with a bad message too; it is ours to close then.
+	int		 memFd = -1;
+	cmsghdr* cmsg  = received > 0 ? CMSG_FIRSTHDR(&msg) : nullptr;
+	if (cmsg && cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS && cmsg->cmsg_len == CMSG_LEN(sizeof(int)))
+		memcpy(&memFd, CMSG_DATA(cmsg), sizeof(int));
+
+	struct stat status = {};
+	if (received != sizeof(attach) || attach.magic != ComputeDaemonMagic || memFd < 0 || attach.size == 0 ||
+		fstat(memFd, &status) != 0 || attach.size > static_cast<uint64_t>(status.st_size))
+	{
+		if (memFd >= 0)
+			close(memFd);
+		return -1;
+	}
+
+	*_size = attach.size;
+	return memFd;
+}
+
+#endif
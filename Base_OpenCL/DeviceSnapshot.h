@@ -0,0 +1,280 @@
+#pragma once
+
+// Cached platform/device enumeration.
+// Enumerating platforms loads every installed ICD, which can be slow. The first run records each
+// GPU device's capabilities and the device that was picked in a small binary file. Later runs
+// validate it against the installed ICD files' sizes and modification times and, when it still
+// matches, go straight to the recorded platform and device, checking only that device's name and
+// vendor ID. Tools can read the snapshot with LoadDeviceSnapshot without touching OpenCL.
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#if defined(_WIN32)
+	#include <Windows.h>
+#endif
+
+static const uint32_t DeviceSnapshotMagic	= 0x53534C43; // "CLSS"
+static const uint32_t DeviceSnapshotVersion	= 2;
+
+struct SnapshotIcd
+{
+	std::string	path;
+	uint64_t	size		= 0;
+	int64_t		writeTime	= 0;
+
+	bool operator==(const SnapshotIcd& _other) const { return path == _other.path && size == _other.size && writeTime == _other.writeTime; }
+};
+
+struct SnapshotDevice
+{
+	uint32_t	platformIndex	= 0;
+	uint32_t	deviceIndex		= 0;	// Index within the platform's GPU device list.
+	std::string	platformName;
+	std::string	deviceName;
+	uint32_t	vendorId		= 0;
+	uint32_t	available		= 0;
+	uint32_t	computeUnits	= 0;
+	uint64_t	globalMemSize	= 0;
+	uint64_t	maxWorkGroupSize = 0;
+};
+
+struct DeviceSnapshot
+{
+	std::vector<SnapshotIcd>	icds;
+	std::vector<SnapshotDevice>	devices;
+	int32_t						chosen = -1;	// Index into devices, -1 when nothing was usable.
+};
+
+static std::filesystem::path DeviceSnapshotPath()
+{
+	std::error_code ec;
+	return std::filesystem::temp_directory_path(ec) / "base_opencl_devices.bin";
+}
+
+static void AddSnapshotIcd(std::vector<SnapshotIcd>& _icds, const std::filesystem::path& _path)
+{
+	std::error_code ec;
+	SnapshotIcd icd;
+	icd.path		= _path.string();
+	icd.size		= std::filesystem::file_size(_path, ec);
+	icd.writeTime	= ec ? 0 : std::filesystem::last_write_time(_path, ec).time_since_epoch().count();
+	_icds.push_back(icd);
+}
+
+// The files the ICD loader would read, in a stable order.
+static std::vector<SnapshotIcd> ListInstalledIcds()
+{
+	std::vector<SnapshotIcd> icds;
+
+#if defined(_WIN32)
+	HKEY vendors;
+	if (RegOpenKeyExA(HKEY_LOCAL_MACHINE, "SOFTWARE\\Khronos\\OpenCL\\Vendors", 0, KEY_READ, &vendors) == ERROR_SUCCESS)
+	{
+		char	name[MAX_PATH];
+		DWORD	nameLength = MAX_PATH;
+		for (DWORD i = 0; RegEnumValueA(vendors, i, name, &nameLength, nullptr, nullptr, nullptr, nullptr) == ERROR_SUCCESS; i++, nameLength = MAX_PATH)
+			AddSnapshotIcd(icds, name);
+		RegCloseKey(vendors);
+	}
+
+	// Current GPU drivers register their ICD under their display adapter or software component
+	// device class key instead, one subkey per adapter. The paths point into the driver store, so
+	// a driver install or update changes them.
+	static const char* const classKeys[] =
+	{
+		"SYSTEM\\CurrentControlSet\\Control\\Class\\{4d36e968-e325-11ce-bfc1-08002be10318}",
+		"SYSTEM\\CurrentControlSet\\Control\\Class\\{5c4c3332-344d-483c-8739-259e934c9cc8}",
+	};
+	for (const char* classKey : classKeys)
+	{
+		HKEY adapters;
+		if (RegOpenKeyExA(HKEY_LOCAL_MACHINE, classKey, 0, KEY_READ, &adapters) != ERROR_SUCCESS)
+			continue;
+
+		char	adapter[MAX_PATH];
+		DWORD	adapterLength = MAX_PATH;
+		for (DWORD i = 0; RegEnumKeyExA(adapters, i, adapter, &adapterLength, nullptr, nullptr, nullptr, nullptr) == ERROR_SUCCESS; i++, adapterLength = MAX_PATH)
+		{
+			for (const char* valueName : { "OpenCLDriverName", "OpenCLDriverNameWow" })
+			{
+				char	value[4096]	= {};
+				DWORD	valueSize	= sizeof(value) - 2;	// Room for the terminators of a truncated list.
+				DWORD	type		= 0;
+				if (RegGetValueA(adapters, adapter, valueName, RRF_RT_REG_SZ | RRF_RT_REG_MULTI_SZ, &type, value, &valueSize) != ERROR_SUCCESS)
+					continue;
+
+				// A REG_MULTI_SZ holds one NUL terminated path after another.
+				for (const char* path = value; *path; path += strlen(path) + 1)
+					AddSnapshotIcd(icds, path);
+			}
+		}
+		RegCloseKey(adapters);
+	}
+#else
+	const char* vendorDir = getenv("OCL_ICD_VENDORS");
+	std::error_code ec;
+	for (const auto& entry : std::filesystem::directory_iterator(vendorDir ? vendorDir : "/etc/OpenCL/vendors", ec))
+	{
+		if (entry.path().extension() == ".icd")
+			AddSnapshotIcd(icds, entry.path());
+	}
+#endif
+
+	std::sort(icds.begin(), icds.end(), [](const SnapshotIcd& _a, const SnapshotIcd& _b) { return _a.path < _b.path; });
+	return icds;
+}
+
+template<typename T>
+static void WritePod(std::ofstream& _out, const T& _value)
+{
+	_out.write(reinterpret_cast<const char*>(&_value), sizeof(T));
+}
+
+static void WriteString(std::ofstream& _out, const std::string& _value)
+{
+	WritePod(_out, static_cast<uint32_t>(_value.size()));
+	_out.write(_value.data(), _value.size());
+}
+
+template<typename T>
+static bool ReadPod(std::ifstream& _in, T& _value)
+{
+	return static_cast<bool>(_in.read(reinterpret_cast<char*>(&_value), sizeof(T)));
+}
+
+static bool ReadString(std::ifstream& _in, std::string& _value)
+{
+	uint32_t length = 0;
+	if (!ReadPod(_in, length) || length > 4096)
+		return false;
+	_value.resize(length);
+	return static_cast<bool>(_in.read(&_value[0], length));
+}
+
+static bool SaveDeviceSnapshot(const DeviceSnapshot& _snapshot)
+{
+	std::ofstream out(DeviceSnapshotPath(), std::ios::binary | std::ios::trunc);
+	if (!out)
+		return false;
+
+	WritePod(out, DeviceSnapshotMagic);
+	WritePod(out, DeviceSnapshotVersion);
+
+	WritePod(out, static_cast<uint32_t>(_snapshot.icds.size()));
+	for (const SnapshotIcd& icd : _snapshot.icds)
+	{
+		WriteString(out, icd.path);
+		WritePod(out, icd.size);
+		WritePod(out, icd.writeTime);
+	}
+
+	WritePod(out, static_cast<uint32_t>(_snapshot.devices.size()));
+	for (const SnapshotDevice& device : _snapshot.devices)
+	{
+		WritePod(out, device.platformIndex);
+		WritePod(out, device.deviceIndex);
+		WriteString(out, device.platformName);
+		WriteString(out, device.deviceName);
+		WritePod(out, device.vendorId);
+		WritePod(out, device.available);
+		WritePod(out, device.computeUnits);
+		WritePod(out, device.globalMemSize);
+		WritePod(out, device.maxWorkGroupSize);
+	}
+
+	WritePod(out, _snapshot.chosen);
+	return static_cast<bool>(out);
+}
+
+// Fails when the file is missing, malformed or the installed ICDs changed since it was written.
+static bool LoadDeviceSnapshot(DeviceSnapshot& _snapshot)
+{
+	std::ifstream in(DeviceSnapshotPath(), std::ios::binary);
+	uint32_t magic = 0, version = 0, count = 0;
+	if (!in || !ReadPod(in, magic) || !ReadPod(in, version) || magic != DeviceSnapshotMagic || version != DeviceSnapshotVersion)
+		return false;
+
+	DeviceSnapshot snapshot;
+	if (!ReadPod(in, count) || count > 256)
+		return false;
+	snapshot.icds.resize(count);
+	for (SnapshotIcd& icd : snapshot.icds)
+	{
+		if (!ReadString(in, icd.path) || !ReadPod(in, icd.size) || !ReadPod(in, icd.writeTime))
+			return false;
+	}
+
+	if (!ReadPod(in, count) || count > 1024)
+		return false;
+	snapshot.devices.resize(count);
+	for (SnapshotDevice& device : snapshot.devices)
+	{
+		if (!ReadPod(in, device.platformIndex)	|| !ReadPod(in, device.deviceIndex)		||
+			!ReadString(in, device.platformName)	|| !ReadString(in, device.deviceName)	||
+			!ReadPod(in, device.vendorId)		|| !ReadPod(in, device.available)		||
+			!ReadPod(in, device.computeUnits)	|| !ReadPod(in, device.globalMemSize)	||
+			!ReadPod(in, device.maxWorkGroupSize))
+			return false;
+	}
+
+	if (!ReadPod(in, snapshot.chosen) || snapshot.chosen >= static_cast<int32_t>(snapshot.devices.size()))
+		return false;
+
+	if (snapshot.icds != ListInstalledIcds())
+		return false;
+
+	_snapshot = snapshot;
+	return true;
+}
+
+// Full enumeration of every GPU device on every platform.
+static DeviceSnapshot EnumerateDeviceSnapshot(std::vector<cl::Platform>& _platforms)
+{
+	DeviceSnapshot snapshot;
+	snapshot.icds = ListInstalledIcds();
+
+	for (size_t p = 0; p < _platforms.size(); p++)
+	{
+		std::string platname = _platforms[p].getInfo<CL_PLATFORM_NAME>();
+
+		std::vector<cl::Device> deviceList;
+		_platforms[p].getDevices(CL_DEVICE_TYPE_GPU, &deviceList);
+		for (size_t d = 0; d < deviceList.size(); d++)
+		{
+			SnapshotDevice device;
+			device.platformIndex	= static_cast<uint32_t>(p);
+			device.deviceIndex		= static_cast<uint32_t>(d);
+			device.platformName		= platname;
+			device.deviceName		= deviceList[d].getInfo<CL_DEVICE_NAME>();
+			device.vendorId			= deviceList[d].getInfo<CL_DEVICE_VENDOR_ID>();
+			device.available		= deviceList[d].getInfo<CL_DEVICE_AVAILABLE>() ? 1 : 0;
+			device.computeUnits		= deviceList[d].getInfo<CL_DEVICE_MAX_COMPUTE_UNITS>();
+			device.globalMemSize	= deviceList[d].getInfo<CL_DEVICE_GLOBAL_MEM_SIZE>();
+			device.maxWorkGroupSize	= deviceList[d].getInfo<CL_DEVICE_MAX_WORK_GROUP_SIZE>();
+
+			if (snapshot.chosen < 0 && device.available)
+				snapshot.chosen = static_cast<int32_t>(snapshot.devices.size());
+			snapshot.devices.push_back(device);
+		}
+	}
+
+	return snapshot;
+}
+
+static void PrintDeviceSnapshot(const DeviceSnapshot& _snapshot)
+{
+	for (size_t i = 0; i < _snapshot.devices.size(); i++)
+	{
+		const SnapshotDevice& device = _snapshot.devices[i];
+		std::cout	<< (static_cast<int32_t>(i) == _snapshot.chosen ? "* " : "  ")
+					<< device.platformName << " / " << device.deviceName
+					<< ": " << device.computeUnits << " CUs, " << (device.globalMemSize >> 20) << "MB, "
+					<< "max work group " << device.maxWorkGroupSize << (device.available ? "" : ", unavailable") << "\n";
+	}
+}
@@ -0,0 +1,257 @@
+#pragma once
+
+// Runtime fusion of elementwise int passes.
+// A chain such as "in + offset + gid, then scale, then clamp" is generated as one OpenCL C kernel,
+// so intermediate values stay in registers instead of round-tripping global memory once per stage.
+// Stage constants are kernel arguments, so the generated program only depends on the sequence of
+// operations; programs are built through BuildProgram and cached by that sequence.
+//
+//   ElementwiseChain chain(false);
+//   chain.AddConstant(10).AddGlobalId().Scale(3).Clamp(0, 2000);
+//   fusionCache.Enqueue(queue, chain, nullptr, output, N);
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+
+enum class ElementwiseOp : uint8_t
+{
+	AddConstant,	// v + a
+	AddGlobalId,	// v + gid
+	Scale,			// v * a
+	Clamp,			// clamp(v, a, b)
+};
+
+struct ElementwiseStage
+{
+	ElementwiseOp	op;
+	cl_int			a;
+	cl_int			b;
+};
+
+class ElementwiseChain
+{
+public:
+	// Chains either read an input buffer or start from zero, like WriteValue.
+	explicit ElementwiseChain(bool _readsInput) : m_readsInput(_readsInput) {}
+
+	ElementwiseChain& AddConstant(cl_int _value)		{ m_stages.push_back({ ElementwiseOp::AddConstant, _value, 0 });	return *this; }
+	ElementwiseChain& AddGlobalId()						{ m_stages.push_back({ ElementwiseOp::AddGlobalId, 0, 0 });			return *this; }
+	ElementwiseChain& Scale(cl_int _value)				{ m_stages.push_back({ ElementwiseOp::Scale, _value, 0 });			return *this; }
+	ElementwiseChain& Clamp(cl_int _min, cl_int _max)	{ m_stages.push_back({ ElementwiseOp::Clamp, _min, _max });			return *this; }
+
+	bool									ReadsInput() const	{ return m_readsInput; }
+	const std::vector<ElementwiseStage>&	Stages() const		{ return m_stages; }
+
+	// The operation sequence, one character per stage; constants are deliberately excluded.
+	std::string Signature() const
+	{
+		std::string signature(1, m_readsInput ? 'i' : 'z');
+		for (const ElementwiseStage& stage : m_stages)
+			signature += static_cast<char>('0' + static_cast<int>(stage.op));
+		return signature;
+	}
+
+	// FNV-1a over the signature, used to name the kernel.
+	uint64_t Hash() const
+	{
+		uint64_t hash = 14695981039346656037ull;
+		for (char c : Signature())
+			hash = (hash ^ static_cast<uint8_t>(c)) * 1099511628211ull;
+		return hash;
+	}
+
+	std::string KernelName() const
+	{
+		std::ostringstream name;
+		name << "Fused_" << std::hex << Hash();
+		return name.str();
+	}
+
+	std::string GenerateSource() const
+	{
+		std::ostringstream src;
+		src << "kernel void " << KernelName() << "(global const int* input, global int* output";
+		for (size_t s = 0; s < m_stages.size(); s++)
+			src << ", int a" << s << ", int b" << s;
+		src << ")\n{\n";
+		src << "\tsize_t global_id = get_global_id(0);\n";
+		src << "\tint v = " << (m_readsInput ? "input[global_id]" : "0") << ";\n";
+		for (size_t s = 0; s < m_stages.size(); s++)
+		{
+			switch (m_stages[s].op)
+			{
+			case ElementwiseOp::AddConstant:	src << "\tv = v + a" << s << ";\n";							break;
+			case ElementwiseOp::AddGlobalId:	src << "\tv = v + (int)global_id;\n";						break;
+			case ElementwiseOp::Scale:			src << "\tv = v * a" << s << ";\n";							break;
+			case ElementwiseOp::Clamp:			src << "\tv = clamp(v, a" << s << ", b" << s << ");\n";		break;
+			}
+		}
+		src << "\toutput[global_id] = v;\n}\n";
+		return src.str();
+	}
+
+	// Host reference for validation.
+	cl_int Evaluate(cl_int _input, size_t _globalId) const
+	{
+		cl_int v = m_readsInput ? _input : 0;
+		for (const ElementwiseStage& stage : m_stages)
+		{
+			switch (stage.op)
+			{
+			case ElementwiseOp::AddConstant:	v = v + stage.a;													break;
+			case ElementwiseOp::AddGlobalId:	v = v + static_cast<cl_int>(_globalId);								break;
+			case ElementwiseOp::Scale:			v = v * stage.a;													break;
+			case ElementwiseOp::Clamp:			v = v < stage.a ? stage.a : (v > stage.b ? stage.b : v);			break;
+			}
+		}
+		return v;
+	}
+
+private:
+	bool							m_readsInput;
+	std::vector<ElementwiseStage>	m_stages;
+};
+
+class FusionCache
+{
+public:
+	FusionCache(const cl::Context& _context, const cl::Device& _device) : m_context(_context), m_device(_device) {}
+
+	// Builds the chain's program on first use; later chains with the same operations reuse it.
+	// The build runs outside the lock, so other chains are not held up behind the compiler; when
+	// two threads build the same chain at once, the first to publish wins.
+	bool GetKernel(const ElementwiseChain& _chain, cl::Kernel& _kernel)
+	{
+		std::string signature = _chain.Signature();
+
+		cl::Program program;
+		bool		cached = false;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			auto found = m_programs.find(signature);
+			if (found != m_programs.end())
+			{
+				program	= found->second;
+				cached	= true;
+			}
+		}
+
+		if (!cached)
+		{
+			std::string source = _chain.GenerateSource();
+			if (!BuildProgram(m_context, m_device, source.c_str(), program))
+				return false;
+
+			std::lock_guard<std::mutex> lock(m_mutex);
+			program = m_programs.emplace(signature, program).first->second;
+		}
+
+		_kernel = cl::Kernel(program, _chain.KernelName().c_str());
+		return true;
+	}
+
+	// _input may be null for chains that do not read an input.
+	cl_int Enqueue(cl::CommandQueue& _queue, const ElementwiseChain& _chain, const cl::Buffer* _input, const cl::Buffer& _output, size_t _count)
+	{
+		cl::Kernel kernel;
+		if (!GetKernel(_chain, kernel))
+			return CL_INVALID_OPERATION;
+
+		// Chains without an input still take the argument; the output stands in for it.
+		kernel.setArg(0, _input ? *_input : _output);
+		kernel.setArg(1, _output);
+		const std::vector<ElementwiseStage>& stages = _chain.Stages();
+		for (size_t s = 0; s < stages.size(); s++)
+		{
+			kernel.setArg(static_cast<cl_uint>(2 + s * 2), stages[s].a);
+			kernel.setArg(static_cast<cl_uint>(3 + s * 2), stages[s].b);
+		}
+
+		return _queue.enqueueNDRangeKernel(kernel, cl::NullRange, _count, cl::NullRange);
+	}
+
+	size_t CachedPrograms() const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_programs.size();
+	}
+
+private:
+	cl::Context										m_context;
+	cl::Device										m_device;
+	std::unordered_map<std::string, cl::Program>	m_programs;
+	mutable std::mutex								m_mutex;
+};
+
+// Runs the example chain fused and as one pass per stage, checking both against the host.
+static int RunFusionBenchmark(const cl::Context& _context, const cl::Device& _device)
+{
+	const size_t		N			= 1 << 22;
+	const int			iterations	= 20;
+	FusionCache			cache(_context, _device);
+	cl::CommandQueue	queue(_context, _device);
+
+	ElementwiseChain fused(false);
+	fused.AddConstant(10).AddGlobalId().Scale(3).Clamp(0, 1 << 20);
+
+	// The unfused version runs every stage as its own chain, ping-ponging through global memory.
+	std::vector<ElementwiseChain> passes;
+	passes.push_back(ElementwiseChain(false).AddConstant(10));
+	passes.push_back(ElementwiseChain(true).AddGlobalId());
+	passes.push_back(ElementwiseChain(true).Scale(3));
+	passes.push_back(ElementwiseChain(true).Clamp(0, 1 << 20));
+
+	cl::Buffer			bufferA(_context, CL_MEM_READ_WRITE, N * sizeof(cl_int));
+	cl::Buffer			bufferB(_context, CL_MEM_READ_WRITE, N * sizeof(cl_int));
+	std::vector<cl_int> result(N);
+
+	// Warm both paths so program builds are excluded from the timings.
+	cache.Enqueue(queue, fused, nullptr, bufferA, N);
+	for (const ElementwiseChain& pass : passes)
+		cache.Enqueue(queue, pass, &bufferA, bufferB, N);
+	queue.finish();
+
+	auto fusedStart = std::chrono::high_resolution_clock::now();
+	for (int i = 0; i < iterations; i++)
+		cache.Enqueue(queue, fused, nullptr, bufferA, N);
+	queue.finish();
+	double fusedMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - fusedStart).count() / iterations;
+
+	queue.enqueueReadBuffer(bufferA, CL_TRUE, 0, N * sizeof(cl_int), result.data());
+	bool fusedOk = true;
+	for (size_t i = 0; i < N && fusedOk; i++)
+		fusedOk = result[i] == fused.Evaluate(0, i);
+
+	auto passStart = std::chrono::high_resolution_clock::now();
+	for (int i = 0; i < iterations; i++)
+	{
+		const cl::Buffer* src = nullptr;
+		const cl::Buffer* dst = &bufferA;
+		for (const ElementwiseChain& pass : passes)
+		{
+			cache.Enqueue(queue, pass, src, *dst, N);
+			src = dst;
+			dst = dst == &bufferA ? &bufferB : &bufferA;
+		}
+	}
+	queue.finish();
+	double passMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - passStart).count() / iterations;
+
+	// Four passes alternate A, B, A, B, so the final result is in B.
+	queue.enqueueReadBuffer(bufferB, CL_TRUE, 0, N * sizeof(cl_int), result.data());
+	bool passOk = true;
+	for (size_t i = 0; i < N && passOk; i++)
+		passOk = result[i] == fused.Evaluate(0, i);
+
+	size_t fusedBytes	= N * sizeof(cl_int);
+	size_t passBytes	= N * sizeof(cl_int) * (passes.size() * 2 - 1);
+	std::cout << "Fused:   " << fusedMs << "ms, " << fusedBytes / (1 << 20) << "MB global traffic"	<< (fusedOk ? "" : " (FAILED)") << "\n";
+	std::cout << "Unfused: " << passMs	<< "ms, " << passBytes / (1 << 20) << "MB global traffic"	<< (passOk ? "" : " (FAILED)") << "\n";
+	std::cout << "Cached programs: " << cache.CachedPrograms() << "\n";
+
+	return fusedOk && passOk ? 0 : 1;
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+// SPIR-V program loading.
+// embed_spirv.py compiles the kernels in main.cpp offline into KernelsSpirv.h. When that header
+// exists and the device lists SPIR-V in CL_DEVICE_IL_VERSION, programs are created with
+// clCreateProgramWithIL, which skips the OpenCL C front end at startup. Otherwise the source
+// string is built as before.
+
+#include <chrono>
+
+#if __has_include("KernelsSpirv.h")
+	#include "KernelsSpirv.h"
+	#define HAS_KERNEL_SPIRV 1
+#else
+	#define HAS_KERNEL_SPIRV 0
+#endif
+
+static bool DeviceSupportsSpirv(const cl::Device& _device)
+{
+#if defined(CL_VERSION_2_1)
+	size_t size = 0;
+	if (clGetDeviceInfo(_device(), CL_DEVICE_IL_VERSION, 0, nullptr, &size) != CL_SUCCESS || size == 0)
+		return false;
+
+	std::string ilVersion(size, '\0');
+	if (clGetDeviceInfo(_device(), CL_DEVICE_IL_VERSION, size, &ilVersion[0], nullptr) != CL_SUCCESS)
+		return false;
+
+	return ilVersion.find("SPIR-V") != std::string::npos;
+#else
+	return false;
+#endif
+}
+
+static bool BuildProgramFromIL(const cl::Context& _context, const cl::Device& _device, const void* _il, size_t _ilSize, cl::Program& _program)
+{
+#if defined(CL_VERSION_2_1)
+	cl_int		res			= CL_SUCCESS;
+	cl_program	ilProgram	= clCreateProgramWithIL(_context(), _il, _ilSize, &res);
+	if (res != CL_SUCCESS)
+		return false;
+
+	_program = cl::Program(ilProgram);
+
+	std::vector<cl::Device> device_vector = { _device };
+	if (_program.build(device_vector) != CL_SUCCESS)
+	{
+		std::cout << "OpenCL SPIR-V build error: \n" << _program.getBuildInfo<CL_PROGRAM_BUILD_LOG>(_device) << "\n";
+		return false;
+	}
+
+	return true;
+#else
+	return false;
+#endif
+}
+
+// Builds from the embedded SPIR-V when possible, falling back to _source. _forceSource skips the
+// IL path so both can be timed from a cold start. _path receives the path that was used.
+static bool BuildKernelProgram(const cl::Context& _context, const cl::Device& _device, const char* _source, bool _forceSource, cl::Program& _program, const char** _path)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+
+	const char* path	= "source";
+	bool		built	= false;
+#if HAS_KERNEL_SPIRV
+	if (!_forceSource && DeviceSupportsSpirv(_device))
+	{
+		built	= BuildProgramFromIL(_context, _device, kernelSpirv, sizeof(kernelSpirv), _program);
+		path	= "SPIR-V";
+		if (!built)
+			std::cout << "SPIR-V load failed, falling back to source.\n";
+	}
+#else
+	(void)_forceSource;
+#endif
+	if (!built)
+	{
+		path	= "source";
+		built	= BuildProgram(_context, _device, _source, _program);
+	}
+
+	double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	if (built)
+		std::cout << "Program built from " << path << " in " << ms << "ms\n";
+
+	*_path = path;
+	return built;
+}
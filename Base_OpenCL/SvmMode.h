@@ -0,0 +1,223 @@
+#pragma once
+
+// Shared virtual memory mode.
+// Pointer-rich data (here, linked lists) can live in SVM allocations and be handed to kernels as
+// host pointers, so there is no staging copy and no pointer-to-index translation. Coarse-grained
+// SVM needs map/unmap around host access; fine-grained SVM can be touched by the host directly.
+// -svm runs the same list walk through every supported SVM mode and through plain cl::Buffers.
+
+#include <algorithm>
+#include <chrono>
+#include <numeric>
+#include <random>
+
+static const char svmSource[] = GLSL(
+typedef struct Node
+{
+	int					value;
+	global struct Node*	next;
+} Node;
+
+// Kernel arguments cannot be pointers to pointers, so the list heads are wrapped.
+typedef struct ListHead
+{
+	global Node* first;
+} ListHead;
+
+kernel void SumListsSvm(global const ListHead* heads, global int* output)
+{
+	size_t global_id	= get_global_id(0);
+	int	   sum			= 0;
+	for (global Node* n = heads[global_id].first; n; n = n->next)
+		sum += n->value;
+	output[global_id] = sum;
+}
+
+kernel void SumListsBuffer(global const int2* nodes, global const int* heads, global int* output)
+{
+	size_t global_id	= get_global_id(0);
+	int	   sum			= 0;
+	for (int n = heads[global_id]; n >= 0; n = nodes[n].y)
+		sum += nodes[n].x;
+	output[global_id] = sum;
+});
+
+// Host layout of the kernel's Node; only valid when host and device pointers match in size.
+struct SvmNode
+{
+	cl_int		value;
+	SvmNode*	next;
+};
+
+static cl_device_svm_capabilities GetSvmCapabilities(const cl::Device& _device)
+{
+	cl_device_svm_capabilities caps = 0;
+#if defined(CL_VERSION_2_0)
+	if (clGetDeviceInfo(_device(), CL_DEVICE_SVM_CAPABILITIES, sizeof(caps), &caps, nullptr) != CL_SUCCESS)
+		caps = 0;
+#endif
+	return caps;
+}
+
+// SVM shares pointers verbatim, so the device must use the host pointer width.
+static bool DevicePointersMatchHost(const cl::Device& _device)
+{
+	cl_uint addressBits = 0;
+	clGetDeviceInfo(_device(), CL_DEVICE_ADDRESS_BITS, sizeof(addressBits), &addressBits, nullptr);
+	return addressBits == sizeof(void*) * 8;
+}
+
+// Random node placement: value i is stored at node order[i] and pushed onto list i % listCount.
+static std::vector<int> BuildListOrder(size_t _nodeCount)
+{
+	std::vector<int> order(_nodeCount);
+	std::iota(order.begin(), order.end(), 0);
+	std::shuffle(order.begin(), order.end(), std::mt19937(1234));
+	return order;
+}
+
+// Staging path: lists are translated to index form, uploaded, walked and read back.
+static double RunListsBuffer(const cl::Context& _context, cl::CommandQueue& _queue, const cl::Program& _program, const std::vector<int>& _order, size_t _listCount, std::vector<cl_int>& _result)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+
+	std::vector<cl_int2>	nodes(_order.size());
+	std::vector<cl_int>		heads(_listCount, -1);
+	for (size_t i = 0; i < _order.size(); i++)
+	{
+		size_t list		= i % _listCount;
+		int	   slot		= _order[i];
+		nodes[slot].s[0] = static_cast<cl_int>(i);
+		nodes[slot].s[1] = heads[list];
+		heads[list]		= slot;
+	}
+
+	cl::Buffer nodeBuffer(_context, CL_MEM_READ_ONLY, nodes.size() * sizeof(cl_int2));
+	cl::Buffer headBuffer(_context, CL_MEM_READ_ONLY, heads.size() * sizeof(cl_int));
+	cl::Buffer outBuffer(_context, CL_MEM_WRITE_ONLY, _listCount * sizeof(cl_int));
+	_queue.enqueueWriteBuffer(nodeBuffer, CL_FALSE, 0, nodes.size() * sizeof(cl_int2), nodes.data());
+	_queue.enqueueWriteBuffer(headBuffer, CL_FALSE, 0, heads.size() * sizeof(cl_int), heads.data());
+
+	cl::Kernel kernel(_program, "SumListsBuffer");
+	kernel.setArg(0, nodeBuffer);
+	kernel.setArg(1, headBuffer);
+	kernel.setArg(2, outBuffer);
+	_queue.enqueueNDRangeKernel(kernel, cl::NullRange, _listCount, cl::NullRange);
+
+	_result.resize(_listCount);
+	_queue.enqueueReadBuffer(outBuffer, CL_TRUE, 0, _listCount * sizeof(cl_int), _result.data());
+
+	return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+// SVM path: lists are built in place with real pointers and passed to the kernel as is.
+// Returns a negative time when the allocation or any SVM call fails.
+static double RunListsSvm(const cl::Context& _context, cl::CommandQueue& _queue, const cl::Program& _program, const std::vector<int>& _order, size_t _listCount, bool _fineGrain, std::vector<cl_int>& _result)
+{
+#if defined(CL_VERSION_2_0)
+	auto start = std::chrono::high_resolution_clock::now();
+
+	// Heads, nodes and output share one allocation so the kernel argument covers every pointer.
+	size_t headBytes	= _listCount * sizeof(SvmNode*);
+	size_t nodeBytes	= _order.size() * sizeof(SvmNode);
+	size_t outBytes		= _listCount * sizeof(cl_int);
+	size_t totalBytes	= headBytes + nodeBytes + outBytes;
+
+	cl_svm_mem_flags flags = CL_MEM_READ_WRITE | (_fineGrain ? CL_MEM_SVM_FINE_GRAIN_BUFFER : 0);
+	char* svm = static_cast<char*>(clSVMAlloc(_context(), flags, totalBytes, 0));
+	if (!svm)
+		return -1.0;
+
+	SvmNode**	heads	= reinterpret_cast<SvmNode**>(svm);
+	SvmNode*	nodes	= reinterpret_cast<SvmNode*>(svm + headBytes);
+	cl_int*		output	= reinterpret_cast<cl_int*>(svm + headBytes + nodeBytes);
+
+	// Anything already queued may still touch the allocation, so drain the queue before freeing.
+	auto fail = [&](const char* _what)
+	{
+		std::cout << "Failed to " << _what << "\n";
+		_queue.finish();
+		clSVMFree(_context(), svm);
+		return -1.0;
+	};
+
+	if (!_fineGrain && clEnqueueSVMMap(_queue(), CL_TRUE, CL_MAP_WRITE, svm, headBytes + nodeBytes, 0, nullptr, nullptr) != CL_SUCCESS)
+		return fail("map the SVM lists");
+
+	std::fill(heads, heads + _listCount, nullptr);
+	for (size_t i = 0; i < _order.size(); i++)
+	{
+		size_t	 list	= i % _listCount;
+		SvmNode* node	= &nodes[_order[i]];
+		node->value		= static_cast<cl_int>(i);
+		node->next		= heads[list];
+		heads[list]		= node;
+	}
+
+	if (!_fineGrain && clEnqueueSVMUnmap(_queue(), svm, 0, nullptr, nullptr) != CL_SUCCESS)
+		return fail("unmap the SVM lists");
+
+	cl::Kernel kernel(_program, "SumListsSvm");
+	if (clSetKernelArgSVMPointer(kernel(), 0, heads) != CL_SUCCESS || clSetKernelArgSVMPointer(kernel(), 1, output) != CL_SUCCESS)
+		return fail("set the SVM kernel arguments");
+	if (_queue.enqueueNDRangeKernel(kernel, cl::NullRange, _listCount, cl::NullRange) != CL_SUCCESS)
+		return fail("enqueue the SVM kernel");
+
+	if (!_fineGrain && clEnqueueSVMMap(_queue(), CL_TRUE, CL_MAP_READ, output, outBytes, 0, nullptr, nullptr) != CL_SUCCESS)
+		return fail("map the SVM output");
+	if (_fineGrain)
+		_queue.finish();
+
+	_result.assign(output, output + _listCount);
+
+	if (!_fineGrain && clEnqueueSVMUnmap(_queue(), output, 0, nullptr, nullptr) != CL_SUCCESS)
+		return fail("unmap the SVM output");
+	_queue.finish();
+
+	double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	clSVMFree(_context(), svm);
+	return ms;
+#else
+	return -1.0;
+#endif
+}
+
+static int RunSvmBenchmark(const cl::Context& _context, const cl::Device& _device)
+{
+	cl_device_svm_capabilities caps = DevicePointersMatchHost(_device) ? GetSvmCapabilities(_device) : 0;
+	std::cout	<< "SVM capabilities:"
+				<< ((caps & CL_DEVICE_SVM_COARSE_GRAIN_BUFFER)	? " coarse-grain"	: "")
+				<< ((caps & CL_DEVICE_SVM_FINE_GRAIN_BUFFER)	? " fine-grain"		: "")
+				<< ((caps & CL_DEVICE_SVM_FINE_GRAIN_SYSTEM)	? " system"			: "")
+				<< (caps ? "" : " none") << "\n";
+
+	cl::Program program;
+	if (!BuildProgram(_context, _device, svmSource, program, caps ? "-cl-std=CL2.0" : nullptr))
+		return 1;
+
+	const size_t			nodeCount	= 1 << 20;
+	const size_t			listCount	= 1024;
+	std::vector<int>		order		= BuildListOrder(nodeCount);
+	std::vector<cl_int>		expected;
+	std::vector<cl_int>		result;
+	cl::CommandQueue		queue(_context, _device);
+
+	double bufferMs = RunListsBuffer(_context, queue, program, order, listCount, expected);
+	std::cout << "Buffer path: " << bufferMs << "ms\n";
+
+	bool success = true;
+	for (int fine = 0; fine < 2; fine++)
+	{
+		cl_device_svm_capabilities required = fine ? CL_DEVICE_SVM_FINE_GRAIN_BUFFER : CL_DEVICE_SVM_COARSE_GRAIN_BUFFER;
+		if (!(caps & required))
+			continue;
+
+		double svmMs = RunListsSvm(_context, queue, program, order, listCount, fine != 0, result);
+		bool   match = svmMs >= 0.0 && result == expected;
+		success &= match;
+		std::cout << (fine ? "Fine-grain" : "Coarse-grain") << " SVM path: " << svmMs << "ms" << (match ? "" : " (FAILED)") << "\n";
+	}
+
+	std::cout << (success ? "This program ran successfully.\n" : "This program failed.\n");
+	return success ? 0 : 1;
+}
@@ -0,0 +1,175 @@
+// Compute daemon: the attach handshake over a socket pair, including a client claiming more shared
+// memory than its descriptor holds, and a write to a peer that hung up, which must fail rather than
+// raise SIGPIPE. Given the path of a Base_OpenCL build, a real daemon is started and must survive
+// an oversized attach and a client hanging up mid-job, then serve a full client run.
+
+#include "ComputeDaemonProtocol.h"
+
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+static int failures = 0;
+
+#define CHECK(_condition) \
+	do { if (!(_condition)) { std::printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #_condition); failures++; } } while (0)
+
+static int MakePayload(size_t _size)
+{
+	int memFd = memfd_create("compute_daemon_test", 0);
+	CHECK(memFd >= 0);
+	CHECK(ftruncate(memFd, _size) == 0);
+	return memFd;
+}
+
+static void TestAttach()
+{
+	int sockets[2];
+	CHECK(socketpair(AF_UNIX, SOCK_STREAM, 0, sockets) == 0);
+	int memFd = MakePayload(4096);
+
+	// Accepted at, or below, the descriptor's real size.
+	uint64_t size = 0;
+	CHECK(SendAttach(sockets[0], memFd, 4096));
+	int received = ReceiveAttach(sockets[1], &size);
+	CHECK(received >= 0 && size == 4096);
+	close(received);
+	CHECK(SendAttach(sockets[0], memFd, 100));
+	received = ReceiveAttach(sockets[1], &size);
+	CHECK(received >= 0 && size == 100);
+	close(received);
+
+	// Larger than the descriptor, or empty, it is rejected.
+	size = 7;
+	CHECK(SendAttach(sockets[0], memFd, 4097));
+	CHECK(ReceiveAttach(sockets[1], &size) < 0);
+	CHECK(SendAttach(sockets[0], memFd, 1ull << 40));
+	CHECK(ReceiveAttach(sockets[1], &size) < 0);
+	CHECK(SendAttach(sockets[0], memFd, 0));
+	CHECK(ReceiveAttach(sockets[1], &size) < 0);
+	CHECK(size == 7);
+
+	// An attach message without a descriptor, or with the wrong magic.
+	ComputeDaemonAttach attach = { ComputeDaemonMagic, 4096 };
+	CHECK(WriteFull(sockets[0], &attach, sizeof(attach)));
+	CHECK(ReceiveAttach(sockets[1], &size) < 0);
+	attach.magic = 0;
+	CHECK(WriteFull(sockets[0], &attach, sizeof(attach)));
+	CHECK(ReceiveAttach(sockets[1], &size) < 0);
+
+	close(memFd);
+	close(sockets[0]);
+	close(sockets[1]);
+}
+
+// SIGPIPE is left at its default here, so a plain write() would kill the test.
+static void TestPeerHungUp()
+{
+	int sockets[2];
+	CHECK(socketpair(AF_UNIX, SOCK_STREAM, 0, sockets) == 0);
+	close(sockets[1]);
+
+	ComputeDaemonResponse response = { 0, 1 };
+	CHECK(!WriteFull(sockets[0], &response, sizeof(response)));
+	int memFd = MakePayload(4096);
+	CHECK(!SendAttach(sockets[0], memFd, 4096));
+	close(memFd);
+	close(sockets[0]);
+}
+
+static pid_t Spawn(const char* _program, const char* _mode, const char* _socketPath)
+{
+	pid_t pid = fork();
+	if (pid == 0)
+	{
+		execl(_program, _program, _mode, _socketPath, static_cast<char*>(nullptr));
+		_exit(127);
+	}
+	return pid;
+}
+
+static int Connect(const char* _socketPath)
+{
+	sockaddr_un addr;
+	int			clientSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (!ComputeDaemonAddress(_socketPath, addr) || connect(clientSocket, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0)
+	{
+		close(clientSocket);
+		return -1;
+	}
+	return clientSocket;
+}
+
+static bool Running(pid_t _pid)
+{
+	int status = 0;
+	return waitpid(_pid, &status, WNOHANG) == 0;
+}
+
+static void TestDaemon(const char* _program)
+{
+	std::string socketPath = "/tmp/base_opencl_test_" + std::to_string(getpid()) + ".sock";
+	pid_t		daemon	   = Spawn(_program, "-daemon", socketPath.c_str());
+	CHECK(daemon > 0);
+
+	// Building the kernel can take a while on a cold CPU device.
+	int  probe = -1;
+	auto start = std::chrono::steady_clock::now();
+	while (probe < 0 && Running(daemon) && std::chrono::steady_clock::now() - start < std::chrono::seconds(60))
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+		probe = Connect(socketPath.c_str());
+	}
+	CHECK(probe >= 0);
+	if (probe < 0)
+	{
+		kill(daemon, SIGKILL);
+		waitpid(daemon, nullptr, 0);
+		return;
+	}
+
+	// Claims a gigabyte of a 4KB payload: the daemon drops the connection instead of mapping it.
+	int memFd = MakePayload(4096);
+	ComputeDaemonResponse response = {};
+	CHECK(SendAttach(probe, memFd, 1ull << 30));
+	CHECK(!ReadFull(probe, &response, sizeof(response)));
+	close(probe);
+
+	// Hangs up with a job in flight, so the daemon's response goes to a closed socket.
+	int hangUp = Connect(socketPath.c_str());
+	ComputeDaemonRequest request = { ComputeDaemonMagic, 10, 1024 };
+	CHECK(hangUp >= 0);
+	CHECK(SendAttach(hangUp, memFd, 4096));
+	CHECK(WriteFull(hangUp, &request, sizeof(request)));
+	close(hangUp);
+	close(memFd);
+	std::this_thread::sleep_for(std::chrono::milliseconds(500));
+	CHECK(Running(daemon));
+
+	// A full client run against the same daemon.
+	int	  status = -1;
+	pid_t client = Spawn(_program, "-client", socketPath.c_str());
+	CHECK(client > 0 && waitpid(client, &status, 0) == client);
+	CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+	kill(daemon, SIGTERM);
+	CHECK(waitpid(daemon, &status, 0) == daemon);
+	CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+}
+
+int main(int argc, char** argv)
+{
+	TestAttach();
+	TestPeerHungUp();
+	if (argc > 1)
+		TestDaemon(argv[1]);
+	else
+		std::printf("No Base_OpenCL build given; skipping the daemon round trip.\n");
+
+	std::printf("ComputeDaemonTests: %s\n", failures == 0 ? "passed" : "FAILED");
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,103 @@
+"""Offline SPIR-V build step for Base_OpenCL.
+
+Extracts the OpenCL C kernel held in the GLSL() string of main.cpp, compiles it to SPIR-V with
+clang and llvm-spirv, and writes a header holding the module as a byte array. main.cpp picks the
+header up with __has_include and loads it through clCreateProgramWithIL, falling back to the
+source string when the header or device support is missing.
+
+    python embed_spirv.py main.cpp KernelsSpirv.h
+
+Missing tools, or tools that cannot target SPIR-V, are not an error: the header is simply not
+generated, and a stale one is removed.
+"""
+
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+
+
+def extract_kernel_source(path):
+    text = open(path).read()
+    start = text.index("source[] = GLSL(") + len("source[] = GLSL(")
+    depth = 1
+    for i in range(start, len(text)):
+        if text[i] == "(":
+            depth += 1
+        elif text[i] == ")":
+            depth -= 1
+            if depth == 0:
+                return text[start:i]
+    raise ValueError("Unterminated GLSL() block in " + path)
+
+
+def find_tool(*names):
+    for name in names:
+        found = shutil.which(name)
+        if found:
+            return found
+    return None
+
+
+def compile_spirv(source, work_dir):
+    clang = find_tool("clang", "clang-18", "clang-17", "clang-16", "clang-15", "clang-14")
+    llvm_spirv = find_tool("llvm-spirv", "llvm-spirv-18", "llvm-spirv-17", "llvm-spirv-16", "llvm-spirv-15", "llvm-spirv-14")
+    if not clang or not llvm_spirv:
+        return None
+
+    cl_path = os.path.join(work_dir, "kernels.cl")
+    bc_path = os.path.join(work_dir, "kernels.bc")
+    spv_path = os.path.join(work_dir, "kernels.spv")
+    with open(cl_path, "w") as f:
+        f.write(source)
+
+    # A clang built without the spir64 target, for one, exists but cannot compile.
+    try:
+        subprocess.check_call([clang, "-c", "-cl-std=CL2.0", "-target", "spir64", "-O2", "-emit-llvm", "-o", bc_path, cl_path])
+        subprocess.check_call([llvm_spirv, bc_path, "-o", spv_path])
+    except (subprocess.CalledProcessError, OSError) as error:
+        print("embed_spirv: %s" % error)
+        return None
+    return open(spv_path, "rb").read()
+
+
+def write_header(path, spirv):
+    lines = [
+        "#pragma once",
+        "",
+        "// Generated by embed_spirv.py from the kernel source in main.cpp. Do not edit.",
+        "",
+        "static const unsigned char kernelSpirv[] =",
+        "{",
+    ]
+    for i in range(0, len(spirv), 16):
+        lines.append("\t" + ", ".join("0x%02x" % b for b in spirv[i:i + 16]) + ",")
+    lines.append("};")
+    lines.append("")
+    with open(path, "w") as f:
+        f.write("\n".join(lines))
+
+
+def main():
+    if len(sys.argv) != 3:
+        print("usage: embed_spirv.py <main.cpp> <output header>")
+        return 1
+
+    source = extract_kernel_source(sys.argv[1])
+    with tempfile.TemporaryDirectory() as work_dir:
+        spirv = compile_spirv(source, work_dir)
+
+    if spirv is None:
+        print("embed_spirv: no usable clang/llvm-spirv, kernels will be compiled from source at runtime.")
+        if os.path.exists(sys.argv[2]):
+            os.remove(sys.argv[2])
+        return 0
+
+    write_header(sys.argv[2], spirv)
+    print("embed_spirv: wrote %d bytes of SPIR-V to %s" % (len(spirv), sys.argv[2]))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
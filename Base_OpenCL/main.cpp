@@ -2,6 +2,10 @@
 // Get SDK from https ://github.com/KhronosGroup/OpenCL-SDK/releases
 #include <CL/cl.hpp>
 #include <iostream>
+#include <cstring>
+#include <chrono>
+
+#include "DeviceSnapshot.h"
 
 #define GLSL(input) #input
 static const char source[] = GLSL(
@@ -11,71 +15,163 @@ kernel void WriteValue(int offset, global int* output)
 	output[global_id] = offset + global_id;
 });
 
-int main()
+static bool InitialiseCL(cl::Context& _context, cl::Device& _device)
 {
 	// Get list of OpenCL platforms.
 	std::vector<cl::Platform> platform;
 	cl::Platform::get(&platform);
 
-	cl::Context cl_context;
-	cl::Device	cl_device;
-
-	bool found = false;
-	for (auto p = platform.begin(); !found && p != platform.end(); p++)
+	// A valid snapshot names the device directly, skipping the queries on every other device. The
+	// platform or driver may still order its devices differently, so the name and vendor have to
+	// match; otherwise everything is enumerated again.
+	DeviceSnapshot snapshot;
+	if (LoadDeviceSnapshot(snapshot) && snapshot.chosen >= 0)
 	{
-		std::string platname = p->getInfo<CL_PLATFORM_NAME>();
-		std::cout << "Platform Name: " << platname << "\n";
+		const SnapshotDevice& chosen = snapshot.devices[snapshot.chosen];
 
 		std::vector<cl::Device> deviceList;
-		p->getDevices(CL_DEVICE_TYPE_GPU, &deviceList);
-		for (auto d = deviceList.begin(); !found && d != deviceList.end(); d++)
+		if (chosen.platformIndex < platform.size())
+			platform[chosen.platformIndex].getDevices(CL_DEVICE_TYPE_GPU, &deviceList);
+
+		if (chosen.deviceIndex < deviceList.size() &&
+			deviceList[chosen.deviceIndex].getInfo<CL_DEVICE_NAME>() == chosen.deviceName &&
+			deviceList[chosen.deviceIndex].getInfo<CL_DEVICE_VENDOR_ID>() == chosen.vendorId)
 		{
-			if (!d->getInfo<CL_DEVICE_AVAILABLE>()) continue;
+			std::cout << "Found (cached): " << chosen.deviceName << "\n";
+			_device		= deviceList[chosen.deviceIndex];
+			_context	= cl::Context(_device);
+			return true;
+		}
+	}
+
+	snapshot = EnumerateDeviceSnapshot(platform);
+	SaveDeviceSnapshot(snapshot);
+	if (snapshot.chosen < 0)
+		return false;
+
+	const SnapshotDevice& chosen = snapshot.devices[snapshot.chosen];
+	std::cout << "Platform Name: " << chosen.platformName << "\n";
+	std::cout << "Found: " << chosen.deviceName << "\n";
+
+	std::vector<cl::Device> deviceList;
+	platform[chosen.platformIndex].getDevices(CL_DEVICE_TYPE_GPU, &deviceList);
+	_device		= deviceList[chosen.deviceIndex];
+	_context	= cl::Context(_device);
+	return true;
+}
 
-			std::string name = d->getInfo<CL_DEVICE_NAME>();
-			std::cout << "Found: " << name << "\n";
+static bool BuildProgram(const cl::Context& _context, const cl::Device& _device, const char* _source, cl::Program& _program, const char* _options = nullptr)
+{
+	_program = cl::Program(_context, cl::Program::Sources(1, std::make_pair(_source, strlen(_source))));
+
+	std::vector<cl::Device> device_vector = { _device };
+	cl_int programBuildRes = _program.build(device_vector, _options);
+	if (programBuildRes != CL_SUCCESS)
+	{
+		std::cout	<< "OpenCL GLSL compilation error: \n" << _program.getBuildInfo<CL_PROGRAM_BUILD_LOG>(_device)	<< "\n";
+		return false;
+	}
 
-			found		= true;
-			cl_device	= *d;
-			cl_context	= cl::Context(cl_device);
+	return true;
+}
+
+// Included after the helpers above, the daemon reuses them to keep its context warm.
+#include "ComputeDaemon.h"
+#include "ProgramIL.h"
+#include "AsyncQueue.h"
+#include "BufferPool.h"
+#include "SvmMode.h"
+#include "KernelFusion.h"
+
+int main(int argc, char** argv)
+{
+	if (argc > 1 && strcmp(argv[1], "-daemon") == 0)
+		return RunComputeDaemon(argc > 2 ? argv[2] : ComputeDaemonDefaultSocket);
+	if (argc > 1 && strcmp(argv[1], "-client") == 0)
+		return RunComputeClient(argc > 2 ? argv[2] : ComputeDaemonDefaultSocket);
+
+	// Lists the cached devices without loading any OpenCL driver.
+	if (argc > 1 && strcmp(argv[1], "-devices") == 0)
+	{
+		DeviceSnapshot snapshot;
+		if (!LoadDeviceSnapshot(snapshot))
+		{
+			std::cout << "No valid device snapshot, run once without arguments to create it.\n";
+			return 1;
 		}
+		PrintDeviceSnapshot(snapshot);
+		return 0;
 	}
 
-	std::cout << "CL Device and Context initialised \n";
-	cl::Program program(cl_context, cl::Program::Sources( 1, std::make_pair(source, strlen(source))));
+	bool forceSource = false;
+	for (int a = 1; a < argc; a++)
+		forceSource |= strcmp(argv[a], "-source") == 0;
 
-	std::vector<cl::Device> device_vector = { cl_device };
-	cl_int programBuildRes = program.build(device_vector);
-	if (programBuildRes != CL_SUCCESS)
+	cl::Context cl_context;
+	cl::Device	cl_device;
+	if (!InitialiseCL(cl_context, cl_device))
 	{
-		std::cout	<< "OpenCL GLSL compilation error: \n" << program.getBuildInfo<CL_PROGRAM_BUILD_LOG>(cl_device)	<< "\n";
+		std::cout << "No available OpenCL GPU device found.\n";
 		return 1;
 	}
 
+	std::cout << "CL Device and Context initialised \n";
+	// First launch latency covers program creation through the first result on the host.
+	auto		launchStart = std::chrono::high_resolution_clock::now();
+	const char* programPath = nullptr;
+	cl::Program program;
+	if (!BuildKernelProgram(cl_context, cl_device, source, forceSource, program, &programPath))
+		return 1;
+
+	if (argc > 1 && strcmp(argv[1], "-fusion") == 0)
+		return RunFusionBenchmark(cl_context, cl_device);
+
+	if (argc > 1 && strcmp(argv[1], "-svm") == 0)
+		return RunSvmBenchmark(cl_context, cl_device);
+
+	if (argc > 1 && strcmp(argv[1], "-async") == 0)
+	{
+		RunAsyncBenchmark(cl_context, cl_device, program);
+		return 0;
+	}
+
 	cl::CommandQueue queue(cl_context, cl_device);
 	cl::Kernel		 writeValueKernel(program, "WriteValue");
 
 	const int			kernelValueOffset	= 10;
 	const size_t		N					= 1024;
 	std::vector<cl_int> kernelOutputBuffer_staging(N);
-	cl::Buffer			kernelOutputBuffer(cl_context, CL_MEM_READ_WRITE, N * sizeof(cl_int));
+	BufferPool			bufferPool(cl_context, cl_device);
+	PooledBuffer		kernelOutputBuffer;
+	if (!bufferPool.Acquire(N * sizeof(cl_int), &kernelOutputBuffer))
+	{
+		std::cout << "Failed to allocate output buffer.\n";
+		return 1;
+	}
 
 	writeValueKernel.setArg(0, static_cast<cl_int>(kernelValueOffset));
-	writeValueKernel.setArg(1, kernelOutputBuffer);
-	
+	writeValueKernel.setArg(1, kernelOutputBuffer.buffer);
+
 	cl_int kernelRunRes = queue.enqueueNDRangeKernel(writeValueKernel, cl::NullRange, N, cl::NullRange);
 	if (kernelRunRes != CL_SUCCESS)
 		std::cout << "Kernel Failed to run.\n";
-	
-	// Get result back to host.
-	cl_int kernelBufferReadRes = queue.enqueueReadBuffer(kernelOutputBuffer, CL_TRUE, 0, N * sizeof(cl_int), kernelOutputBuffer_staging.data());
+
+	// Get result back to host. The host thread is free until the future is consumed.
+	std::future<cl_int> kernelBufferRead = EnqueueReadBufferAsync(queue, kernelOutputBuffer.buffer, 0, N * sizeof(cl_int), kernelOutputBuffer_staging.data());
+	cl_int kernelBufferReadRes = kernelBufferRead.get();
 	if (kernelBufferReadRes != CL_SUCCESS)
 		std::cout << "Buffer Failed to read.\n";
 
+	double launchMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - launchStart).count();
+	std::cout << "First launch latency (" << programPath << "): " << launchMs << "ms\n";
+
+	bufferPool.PrintStats();
+	bufferPool.Release(kernelOutputBuffer);
+
 	if (kernelOutputBuffer_staging[1] == kernelValueOffset + 1)
 		std::cout << "This program ran successfully.\n";
 	else
 		std::cout << "This program failed.\n";
 
 	return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,359 @@
+"""Offline shader build step for Base_DX12 and Base_DX11.
+
+Extracts every HLSL() source string of a main.cpp, compiles each vs/ps/cs/gs/hs/ds_main entry point
+it finds, and writes a header holding the bytecode as byte arrays together with reflection data
+taken from the compiler's listing: resource bindings and the input and output signatures. main.cpp
+picks the header up with __has_include and uses the bytecode directly, falling back to D3DCompile
+when the header is missing.
+
+    python embed_shaders.py main.cpp ShadersDxil.h             DXIL (shader model 6.0) with dxc
+    python embed_shaders.py --dxbc main.cpp ShadersDxbc.h      DXBC (shader model 5.0) with fxc, for D3D11
+    python embed_shaders.py --list main.cpp                    Print the entry points found, compile nothing
+
+dxc runs on Linux and Windows; fxc only ships with the Windows SDK. The DXIL container has to be
+signed for the D3D12 runtime to accept it, so dxc also needs its validator library (dxil.dll or
+libdxil.so) next to it. Missing tools are not an error: the header is simply not generated.
+Both projects run it from here as a pre-build step, skipping it when python is not on PATH.
+"""
+
+import os
+import re
+import shutil
+import subprocess
+import sys
+import tempfile
+
+SOURCE_PATTERN = re.compile(r"static\s+const\s+std::string\s+(\w+)\s*=\s*HLSL\(")
+ENTRY_PATTERN = re.compile(r"\b((vs|ps|cs|gs|hs|ds)_main)\s*\(")
+
+
+def extract_sources(path):
+    """Returns (name, hlsl) for every HLSL() string in the file, in order."""
+    text = open(path).read()
+    sources = []
+    for match in SOURCE_PATTERN.finditer(text):
+        start = match.end()
+        depth = 1
+        for i in range(start, len(text)):
+            if text[i] == "(":
+                depth += 1
+            elif text[i] == ")":
+                depth -= 1
+                if depth == 0:
+                    sources.append((match.group(1), text[start:i]))
+                    break
+        else:
+            raise ValueError("Unterminated HLSL() block " + match.group(1) + " in " + path)
+    return sources
+
+
+def find_entry_points(hlsl):
+    """Returns (entry point, stage) for every function named after a shader stage, in order."""
+    found = []
+    for match in ENTRY_PATTERN.finditer(hlsl):
+        if match.group(1) not in [entry for entry, _ in found]:
+            found.append((match.group(1), match.group(2)))
+    return found
+
+
+def find_tool(*names):
+    for name in names:
+        found = shutil.which(name)
+        if found:
+            return found
+    return None
+
+
+def parse_tables(listing):
+    """Splits the comment tables of a dxc or fxc listing into {title: [{column: value}]}.
+
+    Both compilers print them as a title line, a header row and a row of dashes whose runs give the
+    column widths, behind ';' (dxc) or '//' (fxc)."""
+    lines = []
+    for line in listing.splitlines():
+        stripped = line.strip()
+        if stripped.startswith(";"):
+            lines.append(stripped[1:])
+        elif stripped.startswith("//"):
+            lines.append(stripped[2:])
+        else:
+            lines.append(None)
+
+    tables = {}
+    i = 0
+    while i < len(lines):
+        line = lines[i]
+        if line is None or not line.strip().endswith(":") or i + 3 >= len(lines):
+            i += 1
+            continue
+
+        # Title, optional blank comment line, header, dashes.
+        title = line.strip()[:-1]
+        j = i + 1
+        while j < len(lines) and lines[j] is not None and not lines[j].strip():
+            j += 1
+        if j + 1 >= len(lines) or lines[j] is None or lines[j + 1] is None or not re.fullmatch(r"[\s-]+", lines[j + 1]) or "-" not in lines[j + 1]:
+            i += 1
+            continue
+
+        header, dashes = lines[j], lines[j + 1]
+        spans = [m.span() for m in re.finditer(r"-+", dashes)]
+        bounds = []
+        previous = 0
+        for _, end in spans:
+            bounds.append((previous, end))
+            previous = end
+        columns = [header[begin:end].strip() for begin, end in bounds]
+
+        rows = []
+        k = j + 2
+        while k < len(lines) and lines[k] is not None and lines[k].strip():
+            row = lines[k]
+            values = [row[begin:end].strip() for begin, end in bounds]
+            values[-1] = row[bounds[-1][0]:].strip()
+            rows.append(dict(zip(columns, values)))
+            k += 1
+        tables[title] = rows
+        i = k
+    return tables
+
+
+def parse_int(value, default=0):
+    try:
+        return int(value)
+    except ValueError:
+        return default
+
+
+def parse_bindings(rows):
+    bindings = []
+    for row in rows:
+        bind = row.get("HLSL Bind", "")
+        match = re.fullmatch(r"(cb|t|u|s)(\d+)(?:,\s*space(\d+))?", bind)
+        if not match:
+            continue
+        register = "b" if match.group(1) == "cb" else match.group(1)
+        bindings.append({
+            "name": row.get("Name", ""),
+            "type": row.get("Type", ""),
+            "register": register,
+            "index": int(match.group(2)),
+            "space": int(match.group(3) or 0),
+            "count": parse_int(row.get("Count", "1")),
+        })
+    return bindings
+
+
+def parse_signature(rows):
+    parameters = []
+    for row in rows:
+        # Skips "no parameters" and anything else that is not a parameter row.
+        if not row.get("Name") or not row.get("Index", "").isdigit():
+            continue
+        parameters.append({
+            "semantic": row["Name"],
+            "index": parse_int(row.get("Index", "0")),
+            "register": parse_int(row.get("Register", "0")),
+            "mask": row.get("Mask", ""),
+            "system": row.get("SysValue", ""),
+            "format": row.get("Format", ""),
+        })
+    return parameters
+
+
+def compile_shader(compiler, dxbc, hlsl_path, entry, target, work_dir):
+    """Returns (bytecode, listing) or None when the compiler cannot produce usable output."""
+    out_path = os.path.join(work_dir, entry + ".bin")
+    listing_path = os.path.join(work_dir, entry + ".asm")
+    if dxbc:
+        command = [compiler, "/nologo", "/O3", "/T", target, "/E", entry, "/Fo", out_path, "/Fc", listing_path, hlsl_path]
+    else:
+        command = [compiler, "-O3", "-T", target, "-E", entry, "-Fo", out_path, "-Fc", listing_path, hlsl_path]
+
+    result = subprocess.run(command, stdout=subprocess.PIPE, stderr=subprocess.STDOUT, universal_newlines=True)
+    if result.returncode != 0:
+        raise RuntimeError("Failed to compile %s (%s):\n%s" % (entry, target, result.stdout))
+    if not dxbc and "signing" in result.stdout.lower():
+        # Unsigned DXIL is rejected when the pipeline is created, so runtime compilation is better.
+        print("embed_shaders: " + result.stdout.strip())
+        return None
+    return open(out_path, "rb").read(), open(listing_path).read()
+
+
+def c_string(value):
+    return '"' + value.replace("\\", "\\\\").replace('"', '\\"') + '"'
+
+
+def write_header(path, main_name, shaders):
+    lines = [
+        "#pragma once",
+        "",
+        "// Generated by embed_shaders.py from the HLSL() sources in %s. Do not edit." % main_name,
+        "",
+        "#include <cstddef>",
+        "#include <cstdint>",
+        "#include <cstring>",
+        "",
+        "struct EmbeddedShaderBinding",
+        "{",
+        "    const char* name;",
+        "    const char* type;",
+        "    char        registerType;   // 'b', 't', 'u' or 's', as in register(t0).",
+        "    uint32_t    registerIndex;",
+        "    uint32_t    space;",
+        "    uint32_t    count;          // 0 when unbounded.",
+        "};",
+        "",
+        "struct EmbeddedShaderParameter",
+        "{",
+        "    const char* semanticName;",
+        "    uint32_t    semanticIndex;",
+        "    uint32_t    registerIndex;",
+        "    const char* mask;",
+        "    const char* systemValue;",
+        "    const char* format;",
+        "};",
+        "",
+        "struct EmbeddedShader",
+        "{",
+        "    const char*                     source;         // Name of the HLSL() string.",
+        "    const char*                     entryPoint;",
+        "    const char*                     target;",
+        "    const unsigned char*            bytecode;",
+        "    size_t                          size;",
+        "    const EmbeddedShaderBinding*    bindings;",
+        "    uint32_t                        bindingCount;",
+        "    const EmbeddedShaderParameter*  inputs;",
+        "    uint32_t                        inputCount;",
+        "    const EmbeddedShaderParameter*  outputs;",
+        "    uint32_t                        outputCount;",
+        "};",
+        "",
+    ]
+
+    entries = []
+    for shader in shaders:
+        symbol = shader["source"] + "_" + shader["entry"]
+        lines.append("static const unsigned char %s[] =" % symbol)
+        lines.append("{")
+        bytecode = shader["bytecode"]
+        for i in range(0, len(bytecode), 16):
+            lines.append("    " + ", ".join("0x%02x" % b for b in bytecode[i:i + 16]) + ",")
+        lines.append("};")
+        lines.append("")
+
+        arrays = {}
+        if shader["bindings"]:
+            arrays["bindings"] = symbol + "_bindings"
+            lines.append("static const EmbeddedShaderBinding %s[] =" % arrays["bindings"])
+            lines.append("{")
+            for b in shader["bindings"]:
+                lines.append("    { %s, %s, '%s', %d, %d, %d }," % (c_string(b["name"]), c_string(b["type"]), b["register"], b["index"], b["space"], b["count"]))
+            lines.append("};")
+            lines.append("")
+        for kind in ("inputs", "outputs"):
+            if shader[kind]:
+                arrays[kind] = symbol + "_" + kind
+                lines.append("static const EmbeddedShaderParameter %s[] =" % arrays[kind])
+                lines.append("{")
+                for p in shader[kind]:
+                    lines.append("    { %s, %d, %d, %s, %s, %s }," % (c_string(p["semantic"]), p["index"], p["register"], c_string(p["mask"]),
+                                                                     c_string(p["system"]), c_string(p["format"])))
+                lines.append("};")
+                lines.append("")
+
+        def reference(kind):
+            return "%s, %d" % (arrays[kind], len(shader[kind])) if kind in arrays else "nullptr, 0"
+
+        entries.append("    { %s, %s, %s, %s, sizeof(%s), %s, %s, %s }," % (
+            c_string(shader["source"]), c_string(shader["entry"]), c_string(shader["target"]), symbol, symbol,
+            reference("bindings"), reference("inputs"), reference("outputs")))
+
+    lines.append("static const EmbeddedShader embeddedShaders[] =")
+    lines.append("{")
+    lines.extend(entries)
+    lines.append("};")
+    lines.append("")
+    lines.append("// Null if the entry point was not compiled.")
+    lines.append("static const EmbeddedShader* FindEmbeddedShader(const char* _source, const char* _entryPoint)")
+    lines.append("{")
+    lines.append("    for (const EmbeddedShader& shader : embeddedShaders)")
+    lines.append("    {")
+    lines.append("        if (strcmp(shader.source, _source) == 0 && strcmp(shader.entryPoint, _entryPoint) == 0)")
+    lines.append("        {")
+    lines.append("            return &shader;")
+    lines.append("        }")
+    lines.append("    }")
+    lines.append("    return nullptr;")
+    lines.append("}")
+    lines.append("")
+    with open(path, "w") as f:
+        f.write("\n".join(lines))
+
+
+def main():
+    args = sys.argv[1:]
+    dxbc = "--dxbc" in args
+    list_only = "--list" in args
+    args = [arg for arg in args if arg not in ("--dxbc", "--list")]
+    if len(args) != (1 if list_only else 2):
+        print("usage: embed_shaders.py [--dxbc] <main.cpp> <output header>")
+        print("       embed_shaders.py --list <main.cpp>")
+        return 1
+
+    sources = extract_sources(args[0])
+    if list_only:
+        for name, hlsl in sources:
+            for entry, stage in find_entry_points(hlsl):
+                print("%s %s %s" % (name, entry, stage))
+        return 0
+
+    # A stale header would silently run old shaders, so it goes before anything can fail.
+    output = args[1]
+    if os.path.exists(output):
+        os.remove(output)
+
+    compiler = find_tool("fxc", "fxc.exe") if dxbc else find_tool("dxc", "dxc.exe")
+    if not compiler:
+        print("embed_shaders: %s not found, shaders will be compiled from source at runtime." % ("fxc" if dxbc else "dxc"))
+        return 0
+
+    model = "5_0" if dxbc else "6_0"
+    shaders = []
+    with tempfile.TemporaryDirectory() as work_dir:
+        for name, hlsl in sources:
+            hlsl_path = os.path.join(work_dir, name + ".hlsl")
+            with open(hlsl_path, "w") as f:
+                f.write(hlsl)
+
+            for entry, stage in find_entry_points(hlsl):
+                target = stage + "_" + model
+                compiled = compile_shader(compiler, dxbc, hlsl_path, entry, target, work_dir)
+                if compiled is None:
+                    print("embed_shaders: shaders will be compiled from source at runtime.")
+                    return 0
+
+                bytecode, listing = compiled
+                tables = parse_tables(listing)
+                shaders.append({
+                    "source": name,
+                    "entry": entry,
+                    "target": target,
+                    "bytecode": bytecode,
+                    "bindings": parse_bindings(tables.get("Resource Bindings", [])),
+                    "inputs": parse_signature(tables.get("Input signature", [])),
+                    "outputs": parse_signature(tables.get("Output signature", [])),
+                })
+
+    if not shaders:
+        print("embed_shaders: no entry points found in " + args[0])
+        return 0
+
+    write_header(output, os.path.basename(args[0]), shaders)
+    print("embed_shaders: wrote %d shaders, %d bytes of %s to %s" % (len(shaders), sum(len(s["bytecode"]) for s in shaders),
+                                                                    "DXBC" if dxbc else "DXIL", output))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())